@@ -0,0 +1,67 @@
+#include "bench_alloc.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+
+namespace {
+    // thread-local, so counting costs next to nothing
+    thread_local uint64_t threadAllocations = 0;
+
+    std::atomic<size_t> liveBytes{0};
+
+    void* allocate(size_t size) {
+        if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+            threadAllocations++;
+            liveBytes.fetch_add(malloc_usable_size(memory), std::memory_order_relaxed);
+            return memory;
+        }
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate(void* memory) noexcept {
+        if (memory == nullptr) {
+            return;
+        }
+
+        liveBytes.fetch_sub(malloc_usable_size(memory), std::memory_order_relaxed);
+        std::free(memory);
+    }
+}
+
+
+uint64_t bench_alloc::allocations() {
+    return threadAllocations;
+}
+
+size_t bench_alloc::heapInUse() {
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    deallocate(memory);
+}
@@ -0,0 +1,24 @@
+#ifndef SPL_BENCH_ALLOC_H
+#define SPL_BENCH_ALLOC_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ * The benchmarks replace the global operator new and operator delete once, in bench_alloc.cpp, to count what the
+ * interpreter allocates. Every benchmark in the executable shares these counters.
+ */
+namespace bench_alloc {
+    /**
+     * @return The number of heap allocations the calling thread has made so far
+     */
+    [[nodiscard]] uint64_t allocations();
+
+    /**
+     * @return The number of bytes live on the heap, over all threads
+     */
+    [[nodiscard]] size_t heapInUse();
+}
+
+#endif  // SPL_BENCH_ALLOC_H
@@ -0,0 +1,43 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+#include <string>
+
+
+namespace {
+    void runLoop(benchmark::State& state, const std::string& setup, const std::string& body) {
+        std::string source = setup + " for (i in 0.." + std::to_string(state.range(0)) + ") { " + body + " }";
+
+        for (auto _ : state) {
+            env::Environment env;
+            run(source, env);
+            benchmark::DoNotOptimize(env);
+        }
+
+        state.SetComplexityN(state.range(0));
+    }
+}
+
+
+// building a string one piece at a time: quadratic with s = s + ..., linear with s += ...
+static void BM_ConcatenateAssign(benchmark::State& state) {
+    runLoop(state, "s = \"\";", "s = s + \"abcdefgh\";");
+}
+
+static void BM_AppendInPlace(benchmark::State& state) {
+    runLoop(state, "s = \"\";", "s += \"abcdefgh\";");
+}
+
+static void BM_CounterAssign(benchmark::State& state) {
+    runLoop(state, "total = 0;", "total = total + i % 7;");
+}
+
+static void BM_CounterInPlace(benchmark::State& state) {
+    runLoop(state, "total = 0;", "total += i % 7;");
+}
+
+BENCHMARK(BM_ConcatenateAssign)->RangeMultiplier(4)->Range(1 << 10, 1 << 14)->Complexity()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AppendInPlace)->RangeMultiplier(4)->Range(1 << 10, 1 << 16)->Complexity()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CounterAssign)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_CounterInPlace)->Arg(100000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/batch.h"
+
+#include <vector>
+
+
+namespace {
+    const std::string RULE =
+        "total = price * quantity; discount = total / 10; "
+        "flagged = total > 5000 && !member || quantity == 0; net = total - discount + shipping;";
+
+    // the rule with a branch, so everything after the first two statements runs per row
+    const std::string BRANCHY_RULE =
+        "total = price * quantity; discount = 0; "
+        "if (total > 5000) { discount = total / 10; } net = total - discount + shipping;";
+
+    batch::Table orders(size_t rows) {
+        std::vector<int> prices;
+        std::vector<int> quantities;
+        std::vector<bool> members;
+        std::vector<float> shipping;
+
+        for (size_t i = 0; i < rows; i++) {
+            prices.push_back(static_cast<int>(i % 997));
+            quantities.push_back(static_cast<int>(i % 17));
+            members.push_back(i % 5 == 0);
+            shipping.push_back(static_cast<float>(i % 7) * 1.5f);
+        }
+
+        batch::Table table;
+        table.emplace("price", batch::Column{prices});
+        table.emplace("quantity", batch::Column{quantities});
+        table.emplace("member", batch::Column{members});
+        table.emplace("shipping", batch::Column{shipping});
+
+        return table;
+    }
+}
+
+
+/**
+ * What evaluating a rule over a table takes without batch mode: one run per row.
+ */
+static void BM_RunPerRow(benchmark::State& state) {
+    batch::Table inputs = orders(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        std::vector<float> net;
+
+        for (size_t row = 0; row < static_cast<size_t>(state.range(0)); row++) {
+            env::Environment env;
+
+            for (const auto& [name, column] : inputs) {
+                env.define(name, column.at(row));
+            }
+
+            run(RULE, env);
+            net.push_back(std::get<float>(env.get("net")));
+        }
+
+        benchmark::DoNotOptimize(net);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BatchColumns(benchmark::State& state) {
+    batch::Table inputs = orders(static_cast<size_t>(state.range(0)));
+    batch::Program program{RULE};
+
+    for (auto _ : state) {
+        batch::Table results = program.run(inputs, {"net", "flagged"});
+        benchmark::DoNotOptimize(results);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BatchRows(benchmark::State& state) {
+    batch::Table inputs = orders(static_cast<size_t>(state.range(0)));
+    batch::Program program{BRANCHY_RULE};
+
+    for (auto _ : state) {
+        batch::Table results = program.run(inputs, {"net"});
+        benchmark::DoNotOptimize(results);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_RunPerRow)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BatchColumns)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BatchRows)->Arg(10000)->Unit(benchmark::kMillisecond);
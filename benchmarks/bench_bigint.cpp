@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    // stays well inside an int: every operation takes the immediate path
+    const std::string SMALL_LOOP =
+        "i = 0; total = 0; "
+        "while (i < 5000) { total = total + i * 3 - i / 2 + i % 7; i = i + 1; }";
+
+    // overflows an int after 20 triplings and keeps growing
+    const std::string BIG_LOOP =
+        "x = 1; i = 0; total = 0; "
+        "while (i < 500) { x = x * 3; total = total + x % 1000; i = i + 1; }";
+}
+
+
+static void BM_SmallIntegers(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        run(SMALL_LOOP, env);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_BigIntegers(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        run(BIG_LOOP, env);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_SmallIntegers)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BigIntegers)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,206 @@
+#include <benchmark/benchmark.h>
+
+#include "../interpreter/ast.h"
+#include "../interpreter/environment.h"
+#include "../interpreter/parser.h"
+#include "../interpreter/tokenizer.h"
+#include "bench_alloc.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*
+ * Each stage of the interpreter on its own, on generated inputs of growing size. Every benchmark reports its complexity
+ * in the input size, so a stage that scales worse than linearly shows up as N^2 rather than as a slowdown on one input,
+ * and how many heap allocations it makes per item of input.
+ */
+
+
+namespace {
+    /**
+     * Counts the heap allocations made while it is alive and reports them per item of input.
+     */
+    class AllocationCounter {
+    public:
+        explicit AllocationCounter(benchmark::State& state) : state(state), start(bench_alloc::allocations()) {}
+
+        ~AllocationCounter() {
+            double items = static_cast<double>(state.iterations()) * static_cast<double>(state.range(0));
+            state.counters["allocs_per_item"] = static_cast<double>(bench_alloc::allocations() - start) / items;
+        }
+
+    private:
+        benchmark::State& state;
+        uint64_t start;
+    };
+
+    const std::string STATEMENTS[] = {
+        "x = (a + b * c - d / e) % 7 + (f - g) * (h + i * (j - k));\n",
+        "ok = a < b && b <= c || !(c == d) && d != e;\n",
+        "if (x > 10) { y = y + 1; }\n",
+        "values = [a, b, c * d]; values[1] = len(values) + max(values);\n",
+        "fun twice(n) { return n * 2; }\n",
+        "total = 0; i = 0; while (i < 3) { total = total + i; i = i + 1; }\n"
+    };
+
+    /**
+     * @return A program of the given number of statements, cycling through a mix of expressions, conditions, arrays,
+     * functions and loops
+     */
+    std::string mixedProgram(int64_t statements) {
+        std::string source;
+
+        for (int64_t i = 0; i < statements; i++) {
+            source += STATEMENTS[i % std::size(STATEMENTS)];
+        }
+
+        return source;
+    }
+
+    std::shared_ptr<const std::vector<token::Token>> tokenize(const std::string& source) {
+        return std::make_shared<const std::vector<token::Token>>(token::Tokenizer{source}.getTokens());
+    }
+
+    /**
+     * @return An assignment of one expression with the given number of operands
+     */
+    std::string longExpression(int64_t operands) {
+        const char* operators[] = {" + ", " * ", " - ", " / "};
+        std::string source = "x = a0";
+
+        for (int64_t i = 1; i < operands; i++) {
+            source += operators[i % 4];
+            source += "a" + std::to_string(i % 10);
+        }
+
+        return source + ";\n";
+    }
+
+    /**
+     * @return An assignment whose expression is nested the given number of parentheses deep
+     */
+    std::string nestedParentheses(int64_t depth) {
+        return "x = " + std::string(depth, '(') + "a" + std::string(depth, ')') + ";\n";
+    }
+
+    /**
+     * @return An assignment nested inside the given number of if blocks
+     */
+    std::string nestedBlocks(int64_t depth) {
+        std::string source;
+
+        for (int64_t i = 0; i < depth; i++) {
+            source += "if (a < b) {\n";
+        }
+
+        source += "x = 1;\n";
+
+        for (int64_t i = 0; i < depth; i++) {
+            source += "}\n";
+        }
+
+        return source;
+    }
+
+    void tokenizeStage(benchmark::State& state, const std::string& source) {
+        AllocationCounter counter{state};
+
+        for (auto _ : state) {
+            token::Tokenizer tokenizer{source};
+            benchmark::DoNotOptimize(tokenizer);
+        }
+
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+        state.SetComplexityN(state.range(0));
+    }
+
+    void parseStage(benchmark::State& state, const std::string& source) {
+        std::shared_ptr<const std::vector<token::Token>> tokens = tokenize(source);
+        AllocationCounter counter{state};
+
+        for (auto _ : state) {
+            Parser parser{tokens};
+            benchmark::DoNotOptimize(parser);
+        }
+
+        state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tokens->size()));
+        state.SetComplexityN(state.range(0));
+    }
+}
+
+
+static void BM_TokenizeStatements(benchmark::State& state) {
+    tokenizeStage(state, mixedProgram(state.range(0)));
+}
+
+static void BM_TokenizeNestedParentheses(benchmark::State& state) {
+    tokenizeStage(state, nestedParentheses(state.range(0)));
+}
+
+static void BM_ParseStatements(benchmark::State& state) {
+    parseStage(state, mixedProgram(state.range(0)));
+}
+
+// expressions are parsed by precedence climbing, which replaced the shunting-yard parser
+static void BM_ParseLongExpression(benchmark::State& state) {
+    parseStage(state, longExpression(state.range(0)));
+}
+
+static void BM_ParseNestedParentheses(benchmark::State& state) {
+    parseStage(state, nestedParentheses(state.range(0)));
+}
+
+static void BM_ParseNestedBlocks(benchmark::State& state) {
+    parseStage(state, nestedBlocks(state.range(0)));
+}
+
+/**
+ * Evaluating an already parsed program of the given number of statements, without type specialization.
+ */
+static void BM_EvaluateStatements(benchmark::State& state) {
+    std::string source = "a = 3; b = 5; c = 7; d = 2; e = 4; f = 9; g = 1; h = 6; i = 8; j = 3; k = 2; x = 0; y = 0;\n";
+    ast::RootNode prelude = Parser{tokenize(source)}.root();
+    ast::RootNode program = Parser{tokenize(mixedProgram(state.range(0)))}.root();
+
+    env::Environment env;
+    prelude.eval(env);
+
+    AllocationCounter counter{state};
+
+    for (auto _ : state) {
+        program.eval(env);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ * Evaluating a loop of the given number of iterations, which reassigns the same variables over and over.
+ */
+static void BM_EvaluateLoop(benchmark::State& state) {
+    std::string source = "total = 0; i = 0; while (i < " + std::to_string(state.range(0)) + ") { total = total + i * 2; i = i + 1; }";
+    ast::RootNode program = Parser{tokenize(source)}.root();
+
+    AllocationCounter counter{state};
+
+    for (auto _ : state) {
+        env::Environment env;
+        program.eval(env);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK(BM_TokenizeStatements)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+BENCHMARK(BM_TokenizeNestedParentheses)->RangeMultiplier(4)->Range(64, 4096)->Complexity();
+BENCHMARK(BM_ParseStatements)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+BENCHMARK(BM_ParseLongExpression)->RangeMultiplier(4)->Range(64, 4096)->Complexity();
+BENCHMARK(BM_ParseNestedParentheses)->RangeMultiplier(4)->Range(64, 1024)->Complexity();
+BENCHMARK(BM_ParseNestedBlocks)->RangeMultiplier(4)->Range(64, 1024)->Complexity();
+BENCHMARK(BM_EvaluateStatements)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
+BENCHMARK(BM_EvaluateLoop)->RangeMultiplier(4)->Range(64, 16384)->Complexity();
@@ -0,0 +1,134 @@
+#include <benchmark/benchmark.h>
+
+#include "../interpreter/environment.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+    /**
+     * Lookups are done in a shuffled order so neither table benefits from walking its buckets sequentially
+     */
+    template <typename T>
+    void shuffle(std::vector<T>& keys) {
+        std::mt19937 generator{42};
+        std::shuffle(keys.begin(), keys.end(), generator);
+    }
+
+    std::vector<std::string> makeStringKeys(size_t count) {
+        std::vector<std::string> keys;
+        keys.reserve(count);
+
+        for (size_t i = 0; i < count; i++) {
+            keys.push_back("key_" + std::to_string(i * 7919));
+        }
+
+        return keys;
+    }
+}
+
+
+static void BM_DictIntLookup(benchmark::State& state) {
+    auto count = static_cast<int>(state.range(0));
+    types::Dict dict;
+    std::vector<env::VariantType> keys;
+
+    for (int i = 0; i < count; i++) {
+        dict.set(i, i);
+        keys.emplace_back(i);
+    }
+    shuffle(keys);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dict.find(keys[next]));
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+}
+
+static void BM_UnorderedMapIntLookup(benchmark::State& state) {
+    auto count = static_cast<int>(state.range(0));
+    std::unordered_map<int, env::VariantType> map;
+    std::vector<int> keys;
+
+    for (int i = 0; i < count; i++) {
+        map[i] = i;
+        keys.push_back(i);
+    }
+    shuffle(keys);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(keys[next]));
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+}
+
+static void BM_DictStringLookup(benchmark::State& state) {
+    std::vector<std::string> strings = makeStringKeys(state.range(0));
+    types::Dict dict;
+    std::vector<env::VariantType> keys;
+
+    for (size_t i = 0; i < strings.size(); i++) {
+        dict.set(strings[i], static_cast<int>(i));
+        keys.emplace_back(strings[i]);
+    }
+    shuffle(keys);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dict.find(keys[next]));
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+}
+
+static void BM_UnorderedMapStringLookup(benchmark::State& state) {
+    std::vector<std::string> keys = makeStringKeys(state.range(0));
+    std::unordered_map<std::string, env::VariantType> map;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        map[keys[i]] = static_cast<int>(i);
+    }
+    shuffle(keys);
+
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.find(keys[next]));
+        next = next + 1 == keys.size() ? 0 : next + 1;
+    }
+}
+
+static void BM_DictInsert(benchmark::State& state) {
+    auto count = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        types::Dict dict;
+        for (int i = 0; i < count; i++) {
+            dict.set(i, i);
+        }
+        benchmark::DoNotOptimize(dict.size());
+    }
+}
+
+static void BM_UnorderedMapInsert(benchmark::State& state) {
+    auto count = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        std::unordered_map<int, env::VariantType> map;
+        for (int i = 0; i < count; i++) {
+            map[i] = i;
+        }
+        benchmark::DoNotOptimize(map.size());
+    }
+}
+
+BENCHMARK(BM_DictIntLookup)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_UnorderedMapIntLookup)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_DictStringLookup)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_UnorderedMapStringLookup)->RangeMultiplier(4)->Range(16, 4096);
+BENCHMARK(BM_DictInsert)->Arg(4096);
+BENCHMARK(BM_UnorderedMapInsert)->Arg(4096);
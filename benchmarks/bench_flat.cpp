@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+#include "../interpreter/flat.h"
+#include "bench_alloc.h"
+
+
+namespace {
+    const std::string LOOP =
+        "i = 0; total = 0; x = 0.5; "
+        "while (i < 10000) { total = total + i * 3 % 7; x = x * 0.5 + 1.0; if (total > 1000) { total = 0; } i = i + 1; }";
+
+    const std::string CALLS =
+        "fun fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); } a = fib(18);";
+
+    const std::string& source(int64_t program) {
+        return program == 0 ? LOOP : CALLS;
+    }
+
+    ast::RootNode parse(const std::string& input) {
+        token::Tokenizer tokenizer{input};
+        Parser parser{tokenizer.getTokens()};
+        ast::RootNode root = parser.root();
+
+        // the function bodies are parsed on their first call; parse them now so they count as part of the tree
+        for (const std::shared_ptr<ast::ASTNode>& statement : root.children()) {
+            if (auto function = std::dynamic_pointer_cast<ast::FunctionDefNode>(statement)) {
+                static_cast<void>(function->body()->root());
+            }
+        }
+
+        return root;
+    }
+}
+
+
+// Arg: 0 for a loop of arithmetic, 1 for recursive calls. Both run without type inference, so every operator is a
+// dynamic ExpressionNode in the tree
+static void BM_EvalTree(benchmark::State& state) {
+    size_t before = bench_alloc::heapInUse();
+    ast::RootNode root = parse(source(state.range(0)));
+    size_t bytes = bench_alloc::heapInUse() - before;
+
+    for (auto _ : state) {
+        env::Environment env;
+        root.eval(env);
+        benchmark::DoNotOptimize(env);
+    }
+
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+
+static void BM_EvalFlat(benchmark::State& state) {
+    ast::RootNode root = parse(source(state.range(0)));
+
+    flat::Program program{root};
+
+    for (auto _ : state) {
+        env::Environment env;
+        program.run(env);
+        benchmark::DoNotOptimize(env);
+    }
+
+    state.counters["bytes"] = static_cast<double>(program.memoryUsage());
+    state.counters["nodes"] = static_cast<double>(program.size());
+}
+
+BENCHMARK(BM_EvalTree)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EvalFlat)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
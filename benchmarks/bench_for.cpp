@@ -0,0 +1,50 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    // the same loops written both ways, with an empty body to measure the loop itself and with a small one
+    const std::string WHILE_EMPTY = "i = 0; while (i < 100000) { i = i + 1; }";
+    const std::string FOR_EMPTY = "for (i in 0..100000) { }";
+    const std::string WHILE_BODY = "total = 0; i = 0; while (i < 100000) { total = total + i % 7; i = i + 1; }";
+    const std::string FOR_BODY = "total = 0; for (i in 0..100000) { total = total + i % 7; }";
+
+    /**
+     * Runs a loop with the evaluator selected by the benchmark's argument: 0 for the tree walker, 1 for the flat layout.
+     */
+    void runLoop(benchmark::State& state, const std::string& source) {
+        RunOptions options;
+        options.flatten = state.range(0) == 1;
+
+        for (auto _ : state) {
+            env::Environment env;
+            run(source, env, options);
+            benchmark::DoNotOptimize(env);
+        }
+
+        state.SetItemsProcessed(state.iterations() * 100000);
+    }
+}
+
+
+static void BM_WhileEmpty(benchmark::State& state) {
+    runLoop(state, WHILE_EMPTY);
+}
+
+static void BM_ForEmpty(benchmark::State& state) {
+    runLoop(state, FOR_EMPTY);
+}
+
+static void BM_WhileBody(benchmark::State& state) {
+    runLoop(state, WHILE_BODY);
+}
+
+static void BM_ForBody(benchmark::State& state) {
+    runLoop(state, FOR_BODY);
+}
+
+BENCHMARK(BM_WhileEmpty)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ForEmpty)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_WhileBody)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ForBody)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
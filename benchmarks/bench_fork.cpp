@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    const std::string REQUEST = "a = scale(4) + limit;";
+
+    /**
+     * A prelude with many functions and constants, and one lookup table.
+     */
+    env::Environment& prelude() {
+        static env::Environment env = [] {
+            std::string source = "fun scale(x) { return x * 3; } limit = 10; table = [1, 2, 3]; ";
+
+            for (int i = 0; i < 2000; i++) {
+                std::string n = std::to_string(i);
+                source += "fun helper" + n + "(x, y, z) { return x + y + z + " + n + "; } name" + n + " = \"constant number " + n + "\"; ";
+            }
+
+            return run(source);
+        }();
+
+        return env;
+    }
+
+    /**
+     * A prelude holding one large lookup table, which every request reads.
+     */
+    env::Environment& tablePrelude() {
+        static env::Environment env = [] {
+            env::Environment env;
+            types::Dict table;
+            for (int i = 0; i < 100000; i++) {
+                table.set(i, i * 2);
+            }
+
+            env.define("table", std::move(table));
+            return env;
+        }();
+
+        return env;
+    }
+}
+
+
+// every variable is copied into a fresh environment for every request
+static void BM_CopyEnvironment(benchmark::State& state) {
+    env::Environment& base = prelude();
+
+    for (auto _ : state) {
+        env::Environment request;
+        for (const std::string& name : base.names()) {
+            request.define(name, base.get(name));
+        }
+
+        run(REQUEST, request);
+        benchmark::DoNotOptimize(request);
+    }
+}
+
+static void BM_ForkEnvironment(benchmark::State& state) {
+    env::Environment& base = prelude();
+
+    for (auto _ : state) {
+        env::Environment request = base.fork();
+        run(REQUEST, request);
+        benchmark::DoNotOptimize(request);
+    }
+}
+
+// the first read borrows the table instead of copying its 100k entries
+static void BM_ForkReadLargeTable(benchmark::State& state) {
+    env::Environment& base = tablePrelude();
+    env::Environment request = base.fork();
+
+    for (auto _ : state) {
+        run("x = table[42];", request);
+        benchmark::DoNotOptimize(request);
+        request.clear();
+    }
+}
+
+BENCHMARK(BM_CopyEnvironment)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ForkEnvironment)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ForkReadLargeTable)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    const std::string ARITHMETIC_LOOP =
+        "i = 0; total = 0; x = 0.5; "
+        "while (i < 10000) { total = total + i * 3 % 7; x = x * 0.5 + 1.0; i = i + 1; }";
+}
+
+
+static void BM_ArithmeticLoopTyped(benchmark::State& state) {
+    RunOptions options;
+    options.inferTypes = true;
+
+    for (auto _ : state) {
+        env::Environment env;
+        run(ARITHMETIC_LOOP, env, options);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_ArithmeticLoopDynamic(benchmark::State& state) {
+    RunOptions options;
+    options.inferTypes = false;
+
+    for (auto _ : state) {
+        env::Environment env;
+        run(ARITHMETIC_LOOP, env, options);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_ArithmeticLoopTyped);
+BENCHMARK(BM_ArithmeticLoopDynamic);
@@ -0,0 +1,27 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    const std::string HELPER_LOOP =
+        "fun sq(x) { return x * x; } "
+        "fun dist(a, b) { d = a - b; return sq(d); } "
+        "i = 0; total = 0; "
+        "while (i < 2000) { total = total + sq(i % 10) + dist(i % 7, 3); i = i + 1; }";
+}
+
+
+// Arg: 1 to inline sq and dist, 0 to call them
+static void BM_HelperCalls(benchmark::State& state) {
+    RunOptions options;
+    options.inlineFunctions = state.range(0) != 0;
+
+    for (auto _ : state) {
+        env::Environment env;
+        run(HELPER_LOOP, env, options);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_HelperCalls)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,214 @@
+#include <benchmark/benchmark.h>
+
+#include "../interpreter/io.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace {
+    /**
+     * Points standard output at /dev/null for as long as it is alive, so std::cout can be benchmarked without
+     * flooding the terminal.
+     */
+    class SilencedStdout {
+    public:
+        SilencedStdout() : savedFd(dup(STDOUT_FILENO)), nullFd(open("/dev/null", O_WRONLY)) {
+            std::cout.flush();
+            dup2(nullFd, STDOUT_FILENO);
+        }
+
+        ~SilencedStdout() {
+            std::cout.flush();
+            dup2(savedFd, STDOUT_FILENO);
+            close(savedFd);
+            close(nullFd);
+        }
+
+    private:
+        int savedFd;
+        int nullFd;
+    };
+
+    std::string makeFile(size_t size) {
+        std::string path = "/tmp/spl_bench_readall.txt";
+        std::ofstream file(path, std::ios::binary);
+        std::string line = "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxy\n";
+
+        for (size_t written = 0; written < size; written += line.size()) {
+            file << line;
+        }
+
+        return path;
+    }
+
+    std::vector<std::string> makeFiles(size_t count, size_t size) {
+        std::vector<std::string> paths;
+
+        for (size_t i = 0; i < count; i++) {
+            std::string path = "/tmp/spl_bench_async_" + std::to_string(i) + ".txt";
+            std::rename(makeFile(size).c_str(), path.c_str());
+
+            // written back now, so evicting the pages later drops them instead of leaving them dirty
+            int fd = open(path.c_str(), O_RDONLY);
+            fsync(fd);
+            close(fd);
+
+            paths.push_back(path);
+        }
+
+        return paths;
+    }
+
+    /**
+     * Drops the files from the page cache, so reading them has to wait for the disk.
+     */
+    void evict(const std::vector<std::string>& paths) {
+        for (const std::string& path : paths) {
+            int fd = open(path.c_str(), O_RDONLY);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+
+    /**
+     * Reads a byte of every page, as a script using the whole file would.
+     */
+    size_t touch(const env::VariantType& contents) {
+        std::string_view text = types::stringView(contents);
+        size_t sum = 0;
+
+        for (size_t i = 0; i < text.size(); i += 4096) {
+            sum += static_cast<unsigned char>(text[i]);
+        }
+
+        return sum;
+    }
+}
+
+
+// the same line the print builtin would produce for print(i, i * 0.5)
+static void BM_PrintBuffered(benchmark::State& state) {
+    int nullFd = open("/dev/null", O_WRONLY);
+    std::string line;
+    int i = 0;
+
+    {
+        io::OutputBuffer output{nullFd};
+
+        for (auto _ : state) {
+            line.clear();
+            io::format(line, i);
+            line += ' ';
+            io::format(line, static_cast<float>(i) * 0.5f);
+            line += '\n';
+
+            output.write(line);
+            i++;
+        }
+    }
+
+    close(nullFd);
+}
+
+static void BM_PrintCout(benchmark::State& state) {
+    SilencedStdout silenced;
+    int i = 0;
+
+    for (auto _ : state) {
+        std::cout << i << ' ' << static_cast<float>(i) * 0.5f << std::endl;
+        i++;
+    }
+}
+
+static void BM_PrintCoutNoFlush(benchmark::State& state) {
+    SilencedStdout silenced;
+    int i = 0;
+
+    for (auto _ : state) {
+        std::cout << i << ' ' << static_cast<float>(i) * 0.5f << '\n';
+        i++;
+    }
+}
+
+static void BM_ReadAllMmap(benchmark::State& state) {
+    std::string path = makeFile(state.range(0));
+
+    for (auto _ : state) {
+        env::VariantType contents = io::readAll(path);
+        benchmark::DoNotOptimize(types::stringView(contents).size());
+    }
+
+    std::remove(path.c_str());
+}
+
+static void BM_ReadAllIfstream(benchmark::State& state) {
+    std::string path = makeFile(state.range(0));
+
+    for (auto _ : state) {
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        benchmark::DoNotOptimize(contents.str().size());
+    }
+
+    std::remove(path.c_str());
+}
+
+// Args: the number of files, the size of each. The files are evicted from the page cache before every iteration
+static void BM_ReadFilesOneByOne(benchmark::State& state) {
+    std::vector<std::string> paths = makeFiles(state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        evict(paths);
+        state.ResumeTiming();
+
+        for (const std::string& path : paths) {
+            benchmark::DoNotOptimize(touch(io::readAll(path)));
+        }
+    }
+
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
+    }
+}
+
+static void BM_ReadFilesAsync(benchmark::State& state) {
+    std::vector<std::string> paths = makeFiles(state.range(0), state.range(1));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        evict(paths);
+        state.ResumeTiming();
+
+        // start every read before waiting for the first, as a script would with readasync
+        std::vector<std::shared_future<env::VariantType>> reads;
+        for (const std::string& path : paths) {
+            reads.push_back(io::readAllAsync(path));
+        }
+
+        for (const std::shared_future<env::VariantType>& read : reads) {
+            benchmark::DoNotOptimize(touch(read.get()));
+        }
+    }
+
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
+    }
+}
+
+BENCHMARK(BM_PrintBuffered);
+BENCHMARK(BM_PrintCout);
+BENCHMARK(BM_PrintCoutNoFlush);
+BENCHMARK(BM_ReadAllMmap)->Arg(16 << 20);
+BENCHMARK(BM_ReadAllIfstream)->Arg(16 << 20);
+BENCHMARK(BM_ReadFilesOneByOne)->Args({16, 1 << 20})->Args({64, 64 << 10})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReadFilesAsync)->Args({16, 1 << 20})->Args({64, 64 << 10})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/isolate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+namespace {
+    constexpr int CLIENTS = 4;
+    constexpr int REQUESTS_PER_CLIENT = 250;
+
+    const std::string PRELUDE =
+        "rates = [3, 5, 7, 11]; "
+        "fun unit(i) { return rates[i % 4] + i; } "
+        "fun discount(total) { if (total > 100) { return total / 10; } return 0; }";
+
+    const std::string REQUEST =
+        "total = 0; i = 0; while (i < quantity) { total = total + unit(i); i = i + 1; } total = total - discount(total);";
+
+    /**
+     * Sends requests from several client threads at once and reports the median and 99th percentile latency of the
+     * requests.
+     * @param handle Handles one request. Must be thread-safe
+     */
+    template<typename Handler>
+    void generateLoad(benchmark::State& state, Handler handle) {
+        std::vector<double> latencies;
+
+        for (auto _ : state) {
+            std::vector<std::vector<double>> clientLatencies(CLIENTS);
+            std::vector<std::thread> clients;
+
+            for (int c = 0; c < CLIENTS; c++) {
+                clients.emplace_back([&handle, &clientLatencies, c]() {
+                    for (int r = 0; r < REQUESTS_PER_CLIENT; r++) {
+                        auto start = std::chrono::steady_clock::now();
+                        handle(r % 16);
+                        auto end = std::chrono::steady_clock::now();
+
+                        clientLatencies[c].push_back(std::chrono::duration<double, std::micro>(end - start).count());
+                    }
+                });
+            }
+
+            for (std::thread& client : clients) {
+                client.join();
+            }
+
+            for (const std::vector<double>& client : clientLatencies) {
+                latencies.insert(latencies.end(), client.begin(), client.end());
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        state.counters["p50_us"] = latencies[latencies.size() / 2];
+        state.counters["p99_us"] = latencies[latencies.size() * 99 / 100];
+        state.SetItemsProcessed(static_cast<int64_t>(latencies.size()));
+    }
+}
+
+
+// a fresh environment, prelude and parse for every request
+static void BM_FreshEnvironment(benchmark::State& state) {
+    generateLoad(state, [](int quantity) {
+        env::Environment env;
+        run(PRELUDE, env);
+        env.set("quantity", quantity);
+        run(REQUEST, env);
+        benchmark::DoNotOptimize(env);
+    });
+}
+
+// a fork of a shared prelude, but the request is still parsed every time
+static void BM_ForkAndParse(benchmark::State& state) {
+    env::Environment prelude = run(PRELUDE);
+
+    generateLoad(state, [&prelude](int quantity) {
+        env::Environment env = prelude.fork();
+        env.set("quantity", quantity);
+        run(REQUEST, env);
+        benchmark::DoNotOptimize(env);
+    });
+}
+
+static void BM_IsolatePool(benchmark::State& state) {
+    env::Environment prelude = run(PRELUDE);
+    isolate::Pool pool{prelude, {{"request", REQUEST}}, isolate::Options{CLIENTS}};
+
+    generateLoad(state, [&pool](int quantity) {
+        isolate::Lease lease = pool.acquire();
+        lease->environment().set("quantity", quantity);
+        lease->run("request");
+        benchmark::DoNotOptimize(lease->environment());
+    });
+}
+
+BENCHMARK(BM_FreshEnvironment)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ForkAndParse)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_IsolatePool)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,32 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    const std::string FIBONACCI =
+        "fun fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); } a = fib(20);";
+}
+
+
+static void BM_FibonacciMemoized(benchmark::State& state) {
+    RunOptions options;
+    options.memoize = true;
+
+    for (auto _ : state) {
+        env::Environment env;
+        run(FIBONACCI, env, options);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_FibonacciPlain(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        run(FIBONACCI, env);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_FibonacciMemoized);
+BENCHMARK(BM_FibonacciPlain);
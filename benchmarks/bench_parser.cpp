@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+#include "../interpreter/frontend.h"
+
+#include <string>
+#include <vector>
+
+
+namespace {
+    /**
+     * A program made of the given statement repeated, so parsing dominates the time.
+     */
+    std::vector<token::Token> repeatedStatement(const std::string& statement, int count) {
+        std::string source;
+
+        for (int i = 0; i < count; i++) {
+            source += statement;
+        }
+
+        token::Tokenizer tokenizer{source};
+        return tokenizer.getTokens();
+    }
+
+    const std::string ARITHMETIC = "x = (a + b * c - d / e) % 7 + (f - g) * (h + i * (j - k)) - l * m + n;\n";
+    const std::string LOGICAL = "ok = a < b && b <= c || !(c == d) && d != e || f > g && !h;\n";
+    const std::string CALLS = "y = max(a[i + 1], b[j * 2]) + sum([a, b, c * d]) - len(f(x, g(y, z + 1)));\n";
+
+    /**
+     * A generated script: many helper functions, of which the main program only calls two.
+     */
+    std::string manyHelpers(int count) {
+        std::string source;
+
+        for (int i = 0; i < count; i++) {
+            std::string name = "helper" + std::to_string(i);
+            source += "fun " + name + "(a, b) {\n"
+                      "    total = 0; i = 0;\n"
+                      "    while (i < a) { if (i % 3 == 0) { total = total + i * b; } else { total = total - b; } i = i + 1; }\n"
+                      "    values = [a, b, total * 2, (a + b) * (a - b)];\n"
+                      "    return total + len(values) + max(values);\n"
+                      "}\n";
+        }
+
+        return source + "result = helper0(5, 2) + helper1(6, 3);\n";
+    }
+}
+
+
+static void parseTokens(benchmark::State& state, const std::string& statement) {
+    std::vector<token::Token> tokens = repeatedStatement(statement, 1000);
+
+    for (auto _ : state) {
+        Parser parser{tokens};
+        benchmark::DoNotOptimize(parser);
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(tokens.size()));
+}
+
+static void BM_ParseArithmetic(benchmark::State& state) {
+    parseTokens(state, ARITHMETIC);
+}
+
+static void BM_ParseLogical(benchmark::State& state) {
+    parseTokens(state, LOGICAL);
+}
+
+static void BM_ParseCalls(benchmark::State& state) {
+    parseTokens(state, CALLS);
+}
+
+/**
+ * Time to run a script whose cost is dominated by loading functions it never calls.
+ */
+static void BM_RunManyHelpers(benchmark::State& state) {
+    std::string source = manyHelpers(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        env::Environment env = run(source);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+/**
+ * Tokenizing and parsing a large generated script (about 2 MB) on the given number of threads.
+ */
+static void BM_ParseThreads(benchmark::State& state) {
+    std::string source = manyHelpers(5000);
+
+    for (int i = 0; i < 5000; i++) {
+        source += ARITHMETIC + LOGICAL + CALLS;
+    }
+
+    for (auto _ : state) {
+        ast::RootNode root = frontend::parse(source, static_cast<size_t>(state.range(0)));
+        benchmark::DoNotOptimize(root);
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+
+BENCHMARK(BM_ParseArithmetic);
+BENCHMARK(BM_ParseLogical);
+BENCHMARK(BM_ParseCalls);
+BENCHMARK(BM_RunManyHelpers)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ParseThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+
+namespace {
+    const std::string CALL_LOOP =
+        "fun step(x) { return x + 1; } i = 0; total = 0; "
+        "while (i < 10000) { total = step(total); i = i + 1; }";
+}
+
+
+static void BM_LoopUnlimited(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        run(CALL_LOOP, env);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_LoopWithLimits(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        sandbox::Limits limits{1'000'000, 1 << 20};
+        RunOptions options;
+        options.limits = &limits;
+
+        run(CALL_LOOP, env, options);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_LoopUnlimited);
+BENCHMARK(BM_LoopWithLimits);
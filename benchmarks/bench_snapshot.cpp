@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/snapshot.h"
+
+#include <cstdio>
+
+
+namespace {
+    // functions plus lookup tables that take a while to compute
+    const std::string PRELUDE =
+        "fun collatz(n) { count = 0; while (n != 1) { if (n % 2 == 0) { n = n / 2; } if (n % 2 == 1 && n != 1) { n = 3 * n + 1; } count = count + 1; } return count; } "
+        "fun sq(x) { return x * x; } "
+        "fun cube(x) { return x * x * x; } "
+        "steps = {}; squares = []; i = 1; "
+        "while (i < 1000) { steps[i] = collatz(i); push(squares, sq(i)); i = i + 1; }";
+
+    std::string snapshotPath() {
+        static std::string path = [] {
+            env::Environment env;
+            run(PRELUDE, env);
+
+            std::string file = "/tmp/spl_bench_snapshot.bin";
+            snapshot::saveFile(env, file);
+            return file;
+        }();
+
+        return path;
+    }
+}
+
+
+static void BM_RunPrelude(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env;
+        run(PRELUDE, env);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_RestoreSnapshot(benchmark::State& state) {
+    std::string path = snapshotPath();
+
+    for (auto _ : state) {
+        env::Environment env;
+        snapshot::restoreFile(env, path);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+BENCHMARK(BM_RunPrelude)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_RestoreSnapshot)->Unit(benchmark::kMillisecond);
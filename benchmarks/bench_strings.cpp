@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+
+#include <string>
+
+
+namespace {
+    const std::string PARSE_LOOP =
+        "count = 0; position = 0; "
+        "while (position < len(text)) { "
+        "    next = find(text, comma, position); "
+        "    if (next == 0 - 1) { next = len(text); } "
+        "    word = substr(text, position, next - position); "
+        "    count += len(word); "
+        "    position = next + 1; "
+        "}";
+
+    const std::string SPLIT_LOOP = "count = 0; parts = split(text, comma); for (i in 0..len(parts)) { count += len(parts[i]); }";
+
+    std::string makeFields(int count) {
+        std::string text;
+
+        for (int i = 0; i < count; i++) {
+            text += "field" + std::to_string(i) + ",";
+        }
+
+        return text;
+    }
+
+    /**
+     * Parses comma separated fields, with the text defined as a std::string (moved into a buffer of its own when it is
+     * stored, see types::share) or as a slice. Either way, reads and substr share one buffer.
+     */
+    void runParse(benchmark::State& state, const std::string& source, bool slice) {
+        std::string text = makeFields(static_cast<int>(state.range(0)));
+
+        for (auto _ : state) {
+            env::Environment env;
+            env.define("comma", std::string(","));
+
+            if (slice) {
+                env.define("text", types::StringSlice::owning(text));
+            } else {
+                env.define("text", text);
+            }
+
+            run(source, env);
+            benchmark::DoNotOptimize(env);
+        }
+
+        state.SetComplexityN(state.range(0));
+    }
+}
+
+
+static void BM_ParseString(benchmark::State& state) {
+    runParse(state, PARSE_LOOP, false);
+}
+
+static void BM_ParseSlice(benchmark::State& state) {
+    runParse(state, PARSE_LOOP, true);
+}
+
+static void BM_SplitSlice(benchmark::State& state) {
+    runParse(state, SPLIT_LOOP, true);
+}
+
+BENCHMARK(BM_ParseString)->RangeMultiplier(4)->Range(1 << 8, 1 << 14)->Complexity()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseSlice)->RangeMultiplier(4)->Range(1 << 8, 1 << 14)->Complexity()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SplitSlice)->RangeMultiplier(4)->Range(1 << 8, 1 << 14)->Complexity()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include "../spl.h"
+#include "../interpreter/trace.h"
+
+
+namespace {
+    const std::string LOOP =
+        "fun step(x) { return x + 1; } "
+        "i = 0; total = 0; while (i < 10000) { total = total + i; i = step(i); }";
+}
+
+
+static void BM_RecordEvent(benchmark::State& state) {
+    trace::enable();
+
+    int32_t line = 0;
+    for (auto _ : state) {
+        trace::record(trace::Event::STATEMENT, line++, 4);
+    }
+
+    trace::disable();
+    trace::clear();
+}
+
+static void BM_LoopUntraced(benchmark::State& state) {
+    for (auto _ : state) {
+        env::Environment env = run(LOOP);
+        benchmark::DoNotOptimize(env);
+    }
+}
+
+static void BM_LoopTraced(benchmark::State& state) {
+    trace::enable();
+
+    for (auto _ : state) {
+        env::Environment env = run(LOOP);
+        benchmark::DoNotOptimize(env);
+    }
+
+    trace::disable();
+    trace::clear();
+}
+
+BENCHMARK(BM_RecordEvent);
+BENCHMARK(BM_LoopUntraced)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoopTraced)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <variant>
+
+
+TEST(ArraysTest, LiteralAndIndex) {
+    env::Environment env = run("a = [1, 2, 3]; b = a[1]; c = a[1 + 1] * 2;");
+
+    ASSERT_EQ(std::get<int>(env.get("b")), 2);
+    ASSERT_EQ(std::get<int>(env.get("c")), 6);
+    ASSERT_EQ(env.get("a"), env::VariantType(types::Array{std::vector<int>{1, 2, 3}}));
+}
+
+TEST(ArraysTest, IndexAssignment) {
+    env::Environment env = run("a = [1, 2, 3]; i = 0; a[i + 2] = 7; a[0] = 2.5;");
+
+    ASSERT_EQ(env.get("a"), env::VariantType(types::Array{std::vector<float>{2.5f, 2.0f, 7.0f}}));
+}
+
+TEST(ArraysTest, PushAndLen) {
+    env::Environment env = run("a = []; i = 0; while (i < 10) { push(a, i); i = i + 1; } n = len(a); s = len(\"four\");");
+
+    ASSERT_EQ(std::get<int>(env.get("n")), 10);
+    ASSERT_EQ(std::get<int>(env.get("s")), 4);
+}
+
+TEST(ArraysTest, ReferenceSemantics) {
+    env::Environment env = run("a = [1]; b = a; push(b, 2); n = len(a);");
+
+    ASSERT_EQ(std::get<int>(env.get("n")), 2);
+}
+
+TEST(ArraysTest, BulkOperations) {
+    // long enough to exercise both the vector body and the scalar tail of the kernels
+    env::Environment env = run(
+            "a = [5, 0 - 3, 9, 1, 7, 2, 8, 0, 4, 6, 11];"
+            "f = [0.5, 1.5, 2.5, 3.5, 4.5, 5.5];"
+            "s = sum(a); lo = min(a); hi = max(a); d = dot(a, a); fs = sum(f); fd = dot(f, [2, 2, 2, 2, 2, 2]);"
+            "b = scale(a, 2); c = offset(f, 1); sort(a);"
+    );
+
+    ASSERT_EQ(std::get<int>(env.get("s")), 50);
+    ASSERT_EQ(std::get<int>(env.get("lo")), -3);
+    ASSERT_EQ(std::get<int>(env.get("hi")), 11);
+    ASSERT_EQ(std::get<int>(env.get("d")), 406);
+    ASSERT_FLOAT_EQ(std::get<float>(env.get("fs")), 18.0f);
+    ASSERT_FLOAT_EQ(std::get<float>(env.get("fd")), 36.0f);
+
+    ASSERT_EQ(env.get("b"), env::VariantType(types::Array{std::vector<int>{10, -6, 18, 2, 14, 4, 16, 0, 8, 12, 22}}));
+    ASSERT_EQ(env.get("c"), env::VariantType(types::Array{std::vector<float>{1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f}}));
+    ASSERT_EQ(env.get("a"), env::VariantType(types::Array{std::vector<int>{-3, 0, 1, 2, 4, 5, 6, 7, 8, 9, 11}}));
+}
+
+TEST(ArraysTest, BulkOperationsOverflow) {
+    // the sums only overflow in the vector body, or only in the scalar tail
+    env::Environment env = run(
+            "s = sum([2147483647, 1]);"
+            "t = sum([2147483647, 2147483647, 2147483647, 2147483647, 2147483647]);"
+            "n = sum([0 - 2147483647, 0 - 2147483647, 0 - 2, 1]);"
+            "d = dot([100000, 100000], [100000, 100000]);"
+    );
+
+    ASSERT_EQ(env.get("s"), env::VariantType(types::BigInt{2147483648LL}));
+    ASSERT_EQ(env.get("t"), env::VariantType(types::BigInt{5LL * 2147483647}));
+    ASSERT_EQ(env.get("n"), env::VariantType(types::BigInt{-4294967295LL}));
+    ASSERT_EQ(env.get("d"), env::VariantType(types::BigInt{20000000000LL}));
+
+    // more than fits 64 bits: falls back to big ints
+    env = run(
+            "big = [2147483647, 2147483647, 2147483647, 2147483647, 2147483647];"
+            "d = dot(big, big); s = sum([1, 2]); e = dot([3], [4]);"
+    );
+    ASSERT_EQ(types::toBigInt(env.get("d")),
+              types::BigInt::multiply(types::BigInt{5}, types::BigInt{2147483647LL * 2147483647}));
+    ASSERT_EQ(std::get<int>(env.get("s")), 3);
+    ASSERT_EQ(std::get<int>(env.get("e")), 12);
+
+    ASSERT_THROW(run("a = scale([1, 2, 3, 4, 1073741824], 2);"), std::runtime_error);
+    ASSERT_THROW(run("a = scale([1073741824, 2, 3, 4, 5], 2);"), std::runtime_error);
+    ASSERT_THROW(run("a = offset([2147483647, 2, 3, 4, 5], 1);"), std::runtime_error);
+    ASSERT_THROW(run("a = offset([1, 2, 3, 4, 0 - 2147483647], 0 - 2);"), std::runtime_error);
+    ASSERT_EQ(run("a = scale([1073741824, 2, 3, 4, 5], 2.0);").get("a"),
+              env::VariantType(types::Array{std::vector<float>{2147483648.0f, 4, 6, 8, 10}}));
+}
+
+TEST(ArraysTest, OutOfRange) {
+    ASSERT_THROW(run("a = [1, 2]; b = a[2];"), std::runtime_error);
+    ASSERT_THROW(run("a = []; b = min(a);"), std::runtime_error);
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+
+namespace {
+    /**
+     * Runs a program with the tree walker and with the flat evaluator, with and without type inference.
+     */
+    template <typename Check>
+    void runEverywhere(const std::string& input, Check check) {
+        for (bool flatten : {false, true}) {
+            for (bool inferTypes : {false, true}) {
+                env::Environment env;
+                RunOptions options;
+                options.flatten = flatten;
+                options.inferTypes = inferTypes;
+
+                run(input, env, options);
+                check(env);
+            }
+        }
+    }
+}
+
+
+TEST(AssignmentTest, Tokens) {
+    token::Tokenizer tokenizer{"a+=1; b -= 2; c*=d;"};
+    std::vector<token::Token> tokens = tokenizer.getTokens();
+
+    ASSERT_EQ(tokens.size(), 12);
+    ASSERT_EQ(tokens[1].type(), token::TokenType::OPERATOR_ADD_ASSIGN);
+    ASSERT_EQ(tokens[5].type(), token::TokenType::OPERATOR_SUB_ASSIGN);
+    ASSERT_EQ(tokens[9].type(), token::TokenType::OPERATOR_MUL_ASSIGN);
+}
+
+TEST(AssignmentTest, Numbers) {
+    runEverywhere(
+        "a = 10; a += 5; a -= 3; a *= 2 + 1; "
+        "x = 1.5; x *= 2.0; x -= 1; "
+        "n = 3; n += 0.5; "
+        "big = 2147483647; big += 1; "
+        "total = 0; for (i in 0..100) { total += i; }",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("a")), 36);
+            ASSERT_FLOAT_EQ(std::get<float>(env.get("x")), 2.0f);
+            ASSERT_FLOAT_EQ(std::get<float>(env.get("n")), 3.5f);
+            ASSERT_TRUE(std::holds_alternative<types::BigInt>(env.get("big")));
+            ASSERT_EQ(std::get<int>(env.get("total")), 4950);
+        });
+}
+
+TEST(AssignmentTest, StringAppend) {
+    runEverywhere(
+        "s = \"ab\"; for (i in 0..1000) { s += \"xyz\"; } "
+        "t = \"a\"; t *= 3; t += s;",
+        [](env::Environment& env) {
+            std::string expected = "ab";
+            for (int i = 0; i < 1000; i++) {
+                expected += "xyz";
+            }
+
+            ASSERT_EQ(std::get<std::string>(env.get("s")), expected);
+            ASSERT_EQ(std::get<std::string>(env.get("t")), "aaa" + expected);
+        });
+}
+
+TEST(AssignmentTest, WritesEnclosingScope) {
+    runEverywhere(
+        "log = \"\"; count = 0; "
+        "fun note(word) { log += word; count += 1; return 0; } "
+        "note(\"first\"); note(\"second\");",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<std::string>(env.get("log")), "firstsecond");
+            ASSERT_EQ(std::get<int>(env.get("count")), 2);
+        });
+}
+
+TEST(AssignmentTest, ForkKeepsPreludeUnchanged) {
+    env::Environment prelude;
+    run("greeting = \"hello\"; visits = 1;", prelude);
+
+    for (int i = 0; i < 2; i++) {
+        env::Environment request = prelude.fork();
+        run("greeting += \"world\"; greeting += \"again\"; visits += 1;", request);
+
+        ASSERT_EQ(std::get<std::string>(request.get("greeting")), "helloworldagain");
+        ASSERT_EQ(std::get<int>(request.get("visits")), 2);
+    }
+
+    ASSERT_EQ(std::get<std::string>(prelude.get("greeting")), "hello");
+    ASSERT_EQ(std::get<int>(prelude.get("visits")), 1);
+}
+
+TEST(AssignmentTest, AppendCountsAgainstMemoryLimit) {
+    env::Environment env;
+    sandbox::Limits limits{1000000, 4096};
+    RunOptions options;
+    options.limits = &limits;
+
+    ASSERT_THROW(run("s = \"\"; while (true) { s += \"abcdefgh\"; }", env, options), sandbox::MemoryLimitExceeded);
+
+    // the append that did not fit left the string as it was
+    ASSERT_LE(std::get<std::string>(env.get("s")).size(), 4096);
+    ASSERT_EQ(std::get<std::string>(env.get("s")).size() % 8, 0);
+}
+
+TEST(AssignmentTest, Errors) {
+    env::Environment env;
+
+    ASSERT_THROW(run("missing += 1;", env), std::runtime_error);
+    ASSERT_THROW(run("s = \"a\"; s -= 1;", env), std::runtime_error);
+    ASSERT_THROW(run("n = 1; n += \"a\";", env), std::runtime_error);
+}
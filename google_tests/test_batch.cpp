@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/batch.h"
+
+#include <cmath>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+namespace {
+    /**
+     * @return The value of the output after running the script on one row
+     */
+    env::VariantType runRow(const std::string& script, const batch::Table& inputs, size_t row, const std::string& output) {
+        env::Environment env;
+
+        for (const auto& [name, column] : inputs) {
+            env.define(name, column.at(row));
+        }
+
+        run(script, env);
+        return env.get(output);
+    }
+
+    void expectSameAsRows(const std::string& script, const batch::Table& inputs, const batch::Table& results) {
+        for (const auto& [name, column] : results) {
+            for (size_t row = 0; row < column.size(); row++) {
+                env::VariantType expected = runRow(script, inputs, row, name);
+                env::VariantType actual = column.at(row);
+
+                ASSERT_EQ(expected.index(), actual.index()) << name << " in row " << row;
+
+                if (const float* real = std::get_if<float>(&expected)) {
+                    ASSERT_TRUE(*real == std::get<float>(actual) || (std::isnan(*real) && std::isnan(std::get<float>(actual))))
+                        << name << " in row " << row;
+                } else if (const int* integer = std::get_if<int>(&expected)) {
+                    ASSERT_EQ(*integer, std::get<int>(actual)) << name << " in row " << row;
+                } else {
+                    ASSERT_EQ(std::get<bool>(expected), std::get<bool>(actual)) << name << " in row " << row;
+                }
+            }
+        }
+    }
+
+    batch::Table orders(size_t rows) {
+        std::vector<int> prices;
+        std::vector<int> quantities;
+        std::vector<bool> members;
+
+        for (size_t i = 0; i < rows; i++) {
+            prices.push_back(static_cast<int>(i % 97) - 20);
+            quantities.push_back(static_cast<int>(i % 13) + 1);
+            members.push_back(i % 3 == 0);
+        }
+
+        batch::Table table;
+        table.emplace("price", batch::Column{prices});
+        table.emplace("quantity", batch::Column{quantities});
+        table.emplace("member", batch::Column{members});
+
+        return table;
+    }
+}
+
+
+TEST(BatchTest, RunsStraightLineCodeByColumn) {
+    const std::string script =
+        "total = price * quantity; discounted = total - total / 10 + total % 7; "
+        "expensive = total > 500 && !member || total == 0; ratio = price / 3.0 + quantity; same = member == expensive;";
+
+    batch::Table inputs = orders(3000);  // a few blocks and a partial one
+    batch::Report report;
+    batch::Table results = batch::Program{script}.run(inputs, {"discounted", "expensive", "ratio", "same", "price"}, &report);
+
+    ASSERT_EQ(report.columnStatements, 5);
+    ASSERT_EQ(report.rowStatements, 0);
+    ASSERT_EQ(report.fallbackRows, 0);
+
+    ASSERT_EQ(results.at("discounted").type(), ast::StaticType::INT);
+    ASSERT_EQ(results.at("expensive").type(), ast::StaticType::BOOL);
+    ASSERT_EQ(results.at("ratio").type(), ast::StaticType::FLOAT);
+    ASSERT_EQ(results.at("price").ints(), inputs.at("price").ints());
+    ASSERT_EQ(results.at("ratio").size(), 3000);
+
+    expectSameAsRows(script, inputs, results);
+}
+
+TEST(BatchTest, RunsTheRestByRow) {
+    const std::string script = "bonus = 0; score = price * 2; if (score > 50) { bonus = score * quantity; } result = bonus + 1;";
+
+    batch::Table inputs = orders(1500);
+    batch::Report report;
+    batch::Table results = batch::Program{script}.run(inputs, {"result", "score"}, &report);
+
+    ASSERT_EQ(report.columnStatements, 2);
+    ASSERT_EQ(report.rowStatements, 2);
+
+    expectSameAsRows(script, inputs, results);
+}
+
+TEST(BatchTest, RerunsOverflowingBlocksByRow) {
+    const std::string script = "big = price * 100000; back = big / 100000;";
+
+    batch::Table inputs;
+    inputs.emplace("price", batch::Column{std::vector<int>{1, 2, 30000, 4}});
+
+    batch::Report report;
+    batch::Table results = batch::Program{script}.run(inputs, {"back"}, &report);
+
+    ASSERT_EQ(report.fallbackRows, 4);
+    ASSERT_EQ(results.at("back").ints(), (std::vector<int>{1, 2, 30000, 4}));
+
+    // the big int makes the column a float column
+    results = batch::Program{script}.run(inputs, {"big"});
+    ASSERT_EQ(results.at("big").floats(), (std::vector<float>{100000.0f, 200000.0f, 3000000000.0f, 400000.0f}));
+}
+
+TEST(BatchTest, WidensToFloat) {
+    std::vector<int> prices(3000, 1);
+    prices[5] = 30000;
+    batch::Table inputs;
+    inputs.emplace("price", batch::Column{prices});
+
+    // the first block overflows and is run by row, the others are run a column at a time into the float column
+    batch::Table results = batch::Program{"big = price * 100000;"}.run(inputs, {"big"});
+    const std::vector<float>& big = results.at("big").floats();
+
+    ASSERT_EQ(big[0], 100000.0f);
+    ASSERT_EQ(big[5], 3000000000.0f);
+    ASSERT_EQ(big[2999], 100000.0f);
+
+    // ints stored after a float
+    results = batch::Program{"if (price > 2) { mixed = 0.5; } else { mixed = price; }"}.run(inputs, {"mixed"});
+    const std::vector<float>& mixed = results.at("mixed").floats();
+
+    ASSERT_EQ(mixed[0], 1.0f);
+    ASSERT_EQ(mixed[5], 0.5f);
+    ASSERT_EQ(mixed[2999], 1.0f);
+}
+
+TEST(BatchTest, FloatEdgeCases) {
+    const std::string script = "q = x / y; r = x % y; lt = q < 1; ne = q != q;";
+
+    batch::Table inputs;
+    inputs.emplace("x", batch::Column{std::vector<float>{1.0f, -2.5f, 0.0f, 7.5f, 3.0f}});
+    inputs.emplace("y", batch::Column{std::vector<int>{0, 2, 0, -2, 3}});
+
+    batch::Table results = batch::Program{script}.run(inputs, {"q", "r", "lt", "ne"});
+
+    ASSERT_TRUE(std::isinf(results.at("q").floats()[0]));
+    expectSameAsRows(script, inputs, results);
+}
+
+TEST(BatchTest, Errors) {
+    batch::Table inputs;
+    inputs.emplace("x", batch::Column{std::vector<int>{4, 2, 0, 1}});
+
+    try {
+        batch::Program{"y = 8 / x;"}.run(inputs, {"y"});
+        FAIL() << "Expected a division by zero";
+    } catch (const std::runtime_error& e) {
+        ASSERT_NE(std::string{e.what()}.find("Row 2"), std::string::npos);
+    }
+
+    try {
+        batch::Program{"y = \"text\";"}.run(inputs, {"y"});
+        FAIL() << "Expected a string output to be rejected";
+    } catch (const std::runtime_error& e) {
+        ASSERT_STREQ(e.what(), "Row 0: Output y must be a bool, int or float");
+    }
+
+    batch::Table uneven = inputs;
+    uneven.emplace("z", batch::Column{std::vector<int>{1}});
+    ASSERT_THROW(batch::Program{"y = x + z;"}.run(uneven, {"y"}), std::runtime_error);
+
+    ASSERT_THROW(batch::Program{"y = x;"}.run(inputs, {"missing"}), std::runtime_error);
+    ASSERT_THROW(batch::Program{"if (x > 1) { v = 1; } if (x < 2) { v = true; }"}.run(inputs, {"v"}), std::runtime_error);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/io.h"
+
+#include <climits>
+#include <variant>
+
+
+namespace {
+    std::string print(const env::VariantType& value) {
+        std::string output;
+        io::format(output, value, false);
+        return output;
+    }
+}
+
+
+TEST(BigIntTest, Arithmetic) {
+    types::BigInt a = types::BigInt::parse("123456789012345678901234567890");
+    types::BigInt b = types::BigInt::parse("-987654321098765432109876543210");
+
+    ASSERT_EQ(types::BigInt::add(a, b).toString(), "-864197532086419753208641975320");
+    ASSERT_EQ(types::BigInt::subtract(a, b).toString(), "1111111110111111111011111111100");
+    ASSERT_EQ(types::BigInt::multiply(a, b).toString(),
+              "-121932631137021795226185032733622923332237463801111263526900");
+    ASSERT_EQ(types::BigInt::divide(b, a).toString(), "-8");
+    ASSERT_EQ(types::BigInt::remainder(b, a).toString(), "-9000000000900000000090");
+    ASSERT_THROW(types::BigInt::divide(a, types::BigInt{0}), std::runtime_error);
+
+    ASSERT_TRUE(b.compare(a) < 0);
+    ASSERT_EQ(types::BigInt::add(a, types::BigInt::parse("-123456789012345678901234567890")).toString(), "0");
+    ASSERT_EQ(types::BigInt{INT64_MIN}.toString(), "-9223372036854775808");
+    ASSERT_EQ(*types::BigInt{INT64_MIN}.toInt64(), INT64_MIN);
+    ASSERT_FALSE(a.toInt64().has_value());
+}
+
+TEST(BigIntTest, OverflowPromotes) {
+    env::Environment env;
+    run("a = 2147483647 + 1; b = 0 - 2147483647 - 2; c = 65536 * 65536; d = a - 1; e = c / 65536;", env);
+
+    ASSERT_EQ(print(env.get("a")), "2147483648");
+    ASSERT_EQ(print(env.get("b")), "-2147483649");
+    ASSERT_EQ(print(env.get("c")), "4294967296");
+    ASSERT_EQ(env.getType("c"), "int");
+
+    // results that fit an int again are plain ints
+    ASSERT_EQ(std::get<int>(env.get("d")), INT_MAX);
+    ASSERT_EQ(std::get<int>(env.get("e")), 65536);
+}
+
+TEST(BigIntTest, Factorial) {
+    env::Environment env;
+    run("fun fact(n) { if (n < 2) { return 1; } return n * fact(n - 1); } f = fact(30); r = f % 1000000007; big = f > 2147483647;", env);
+
+    ASSERT_EQ(print(env.get("f")), "265252859812191058636308480000000");
+    ASSERT_EQ(std::get<int>(env.get("r")), 109361473);
+    ASSERT_TRUE(std::get<bool>(env.get("big")));
+}
+
+TEST(BigIntTest, Literals) {
+    env::Environment env;
+    run("a = 99999999999999999999; b = a + 1; c = a == 99999999999999999999; d = a + 0.5;", env);
+
+    ASSERT_EQ(print(env.get("b")), "100000000000000000000");
+    ASSERT_TRUE(std::get<bool>(env.get("c")));
+    ASSERT_FLOAT_EQ(std::get<float>(env.get("d")), 1e20f);
+}
+
+TEST(BigIntTest, TypedPathOverflow) {
+    // i is inferred to be an int; the doubling overflows it into a big int part way through the loop
+    env::Environment env;
+    run("x = 1; i = 0; while (i < 40) { x = x * 2; i = i + 1; } y = x / 1099511627776;", env);
+
+    ASSERT_EQ(print(env.get("x")), "1099511627776");
+    ASSERT_EQ(std::get<int>(env.get("y")), 1);
+}
+
+TEST(BigIntTest, EdgeCases) {
+    env::Environment env;
+    run("m = 0 - 2147483647 - 1; a = m / (0 - 1); b = m % (0 - 1);", env);
+
+    ASSERT_EQ(print(env.get("a")), "2147483648");
+    ASSERT_EQ(std::get<int>(env.get("b")), 0);
+    ASSERT_THROW(run("z = 1 / 0;", env), std::runtime_error);
+    ASSERT_THROW(run("z = 1 % 0;", env), std::runtime_error);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <variant>
+
+
+namespace {
+    dce::Report eliminate(const std::string& input, env::Environment& env) {
+        dce::Report report;
+        RunOptions options;
+        options.eliminateDeadCode = true;
+        options.deadCodeReport = &report;
+
+        run(input, env, options);
+
+        return report;
+    }
+}
+
+
+TEST(DeadCodeTest, UnreachableStatements) {
+    env::Environment env;
+    dce::Report report = eliminate(
+        "fun f(n) { return n * 2; print(n); n = 3; } "
+        "i = 0; while (i < 5) { i = i + 1; if (i == 3) { break; i = 100; } continue; i = 50; } "
+        "a = f(4);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 8);
+    ASSERT_EQ(std::get<int>(env.get("i")), 3);
+
+    ASSERT_EQ(report.unreachable, 4);
+    ASSERT_GT(report.nodes, 0);
+    ASSERT_GT(report.bytes, 0);
+}
+
+TEST(DeadCodeTest, UnusedFunctions) {
+    env::Environment env;
+    dce::Report report = eliminate(
+        "fun used(n) { return helper(n) + 1; } "
+        "fun helper(n) { return n * 2; } "
+        "fun unused(n) { return onlyFromUnused(n); } "
+        "fun onlyFromUnused(n) { return n; } "
+        "fun passed(n) { return n; } "
+        "fun apply(g, n) { return g(n); } "
+        "a = used(3); b = apply(passed, 5);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 7);
+    ASSERT_EQ(std::get<int>(env.get("b")), 5);
+    ASSERT_EQ(report.functions, 2);
+    ASSERT_FALSE(env.has("unused"));
+    ASSERT_FALSE(env.has("onlyFromUnused"));
+    ASSERT_TRUE(env.has("helper"));
+}
+
+TEST(DeadCodeTest, DeadAssignments) {
+    env::Environment env;
+    dce::Report report = eliminate(
+        "fun count(n) { unused = n * 3; logged = print(n); total = n + 1; return total; } "
+        "fun setGlobal() { result = 5; } "
+        "result = 0; setGlobal(); a = count(2);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 3);
+    ASSERT_EQ(std::get<int>(env.get("result")), 5);
+
+    // unused is removed, and logged is removed but the call to print is kept
+    ASSERT_EQ(report.assignments, 2);
+    flushOutput();
+}
+
+TEST(DeadCodeTest, DeadAssignmentsStillRaise) {
+    env::Environment env;
+    dce::Report report = eliminate(
+        "fun inert(n) { copy = n; one = 1; half = 0.5; return n; } a = inert(4);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 4);
+    ASSERT_EQ(report.assignments, 3);
+
+    ASSERT_THROW(eliminate("fun divides() { t = 10 / 0; return 1; } a = divides();", env), std::runtime_error);
+    ASSERT_THROW(eliminate("fun undefined() { t = missing; return 1; } a = undefined();", env), std::runtime_error);
+}
+
+TEST(DeadCodeTest, NestedFunctionsPrunedOnParse) {
+    env::Environment env;
+    dce::Report report = eliminate(
+        "fun outer(n) { fun inner(m) { return m + 1; m = 0; } return inner(n); } a = outer(1);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 2);
+    ASSERT_EQ(report.statements(), 0);
+}
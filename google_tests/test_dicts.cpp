@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+
+TEST(DictsTest, LiteralAndIndex) {
+    env::Environment env = run(R"(d = {"one": 1, 2: "two", "three": 3.0}; a = d["one"]; b = d[1 + 1]; n = len(d);)");
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 1);
+    ASSERT_EQ(std::get<std::string>(env.get("b")), "two");
+    ASSERT_EQ(std::get<int>(env.get("n")), 3);
+}
+
+TEST(DictsTest, SetHasRemove) {
+    env::Environment env = run(R"(
+        d = {};
+        d["x"] = 1;
+        set(d, "y", 2);
+        d["x"] = d["x"] + 10;
+        hadY = has(d, "y");
+        removed = remove(d, "y");
+        hasY = has(d, "y");
+        fallback = get(d, "y", 0 - 1);
+    )");
+
+    ASSERT_EQ(std::get<bool>(env.get("hadY")), true);
+    ASSERT_EQ(std::get<bool>(env.get("removed")), true);
+    ASSERT_EQ(std::get<bool>(env.get("hasY")), false);
+    ASSERT_EQ(std::get<int>(env.get("fallback")), -1);
+
+    types::Dict expected;
+    expected.set(std::string("x"), 11);
+    ASSERT_EQ(env.get("d"), env::VariantType(expected));
+}
+
+TEST(DictsTest, ManyKeys) {
+    // grows the table several times and leaves tombstones behind
+    env::Environment env = run(R"(
+        d = {};
+        i = 0;
+        while (i < 3000) { d[i] = i * 2; i = i + 1; }
+        i = 0;
+        while (i < 3000) { if (i % 3 == 0) { remove(d, i); } i = i + 1; }
+        n = len(d);
+        a = d[2999];
+        b = has(d, 2998);
+        c = has(d, 2997);
+    )");
+
+    ASSERT_EQ(std::get<int>(env.get("n")), 2000);
+    ASSERT_EQ(std::get<int>(env.get("a")), 5998);
+    ASSERT_EQ(std::get<bool>(env.get("b")), true);
+    ASSERT_EQ(std::get<bool>(env.get("c")), false);
+}
+
+TEST(DictsTest, Iteration) {
+    env::Environment env = run(R"(
+        d = {"a": 1, "b": 2, "c": 3};
+        remove(d, "b");
+        d["d"] = 4;
+        keys = "";
+        total = 0;
+        i = 0;
+        while (i < len(d)) {
+            keys = keys + key(d, i);
+            total = total + value(d, i);
+            i = i + 1;
+        }
+    )");
+
+    ASSERT_EQ(std::get<std::string>(env.get("keys")), "acd");
+    ASSERT_EQ(std::get<int>(env.get("total")), 8);
+}
+
+TEST(DictsTest, MissingKey) {
+    ASSERT_THROW(run(R"(d = {"a": 1}; b = d["b"];)"), std::runtime_error);
+    ASSERT_THROW(run(R"(d = {}; d[1.5] = 1;)"), std::runtime_error);
+}
+
+TEST(DictsTest, Cycles) {
+    env::Environment env = run(R"(
+        d = {"one": 1};
+        shared = {"d": d};
+        outer = {"first": shared, "second": shared};
+    )");
+
+    ASSERT_THROW(run(R"(d["self"] = d;)", env), std::runtime_error);
+    ASSERT_THROW(run(R"(alias = d; alias["self"] = d;)", env), std::runtime_error);
+    ASSERT_THROW(run(R"(set(d, "outer", outer);)", env), std::runtime_error);
+    ASSERT_THROW(run(R"(inner = shared["d"]; inner["shared"] = shared;)", env), std::runtime_error);
+
+    // nothing was inserted, and the same dictionary can still be held in several places
+    run(R"(n = len(d); copy = {"one": 1}; copy["d"] = d; shared["again"] = d;)", env);
+    ASSERT_EQ(std::get<int>(env.get("n")), 1);
+    ASSERT_EQ(std::get<types::Dict>(env.get("shared")).size(), 2);
+}
+
+TEST(DictsTest, InternedKeysReferenceCounted) {
+    const types::InternedString* first = types::InternedString::intern("interned key");
+    const types::InternedString* second = types::InternedString::intern("interned key");
+    ASSERT_EQ(first, second);
+
+    // a dictionary using the key keeps it alive after the other references are released
+    types::Dict dict;
+    dict.set(std::string("interned key"), 1);
+    types::InternedString::release(first);
+    types::InternedString::release(second);
+
+    types::Dict copy = dict.clone();
+    dict.remove(std::string("interned key"));
+    ASSERT_EQ(std::get<int>(*copy.find(std::string("interned key"))), 1);
+    ASSERT_EQ(std::get<std::string>(copy.keyAt(0)), "interned key");
+}
+
+TEST(DictsTest, KeysAcrossThreads) {
+    std::vector<int> totals(8);
+    std::vector<std::thread> threads;
+
+    // every thread interns and releases the same keys, so strings are freed and interned again concurrently
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&totals, t]() {
+            for (int round = 0; round < 50; round++) {
+                types::Dict dict;
+                for (int i = 0; i < 100; i++) {
+                    dict.set("key" + std::to_string(i), i);
+                }
+
+                types::Dict copy = dict.clone();
+                for (int i = 0; i < 100; i += 2) {
+                    dict.remove("key" + std::to_string(i));
+                }
+
+                totals[t] = static_cast<int>(dict.size() + copy.size());
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int total : totals) {
+        ASSERT_EQ(total, 150);
+    }
+}
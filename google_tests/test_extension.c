@@ -0,0 +1,56 @@
+/* A small extension module loaded by test_native.cpp */
+
+#include "../spl_extension.h"
+
+#include <string.h>
+
+static int fail(spl_value* result, const char* message) {
+    result->type = SPL_VALUE_STRING;
+    result->as.string.data = message;
+    result->as.string.size = strlen(message);
+    return 1;
+}
+
+static int twice(const spl_value* arguments, size_t count, spl_value* result) {
+    if (arguments[0].type != SPL_VALUE_INT) {
+        return fail(result, "twice expects an int");
+    }
+
+    result->type = SPL_VALUE_INT;
+    result->as.integer = arguments[0].as.integer * 2;
+    return 0;
+}
+
+static int shout(const spl_value* arguments, size_t count, spl_value* result) {
+    static _Thread_local char buffer[256];
+
+    if (arguments[0].type != SPL_VALUE_STRING || arguments[0].as.string.size + 1 > sizeof(buffer)) {
+        return fail(result, "shout expects a short string");
+    }
+
+    memcpy(buffer, arguments[0].as.string.data, arguments[0].as.string.size);
+    buffer[arguments[0].as.string.size] = '!';
+
+    result->type = SPL_VALUE_STRING;
+    result->as.string.data = buffer;
+    result->as.string.size = arguments[0].as.string.size + 1;
+    return 0;
+}
+
+static int count_arguments(const spl_value* arguments, size_t count, spl_value* result) {
+    result->type = SPL_VALUE_INT;
+    result->as.integer = (int32_t) count;
+    return 0;
+}
+
+static const spl_function_entry functions[] = {
+        {"twice", 1, twice},
+        {"shout", 1, shout},
+        {"countArguments", -1, count_arguments}
+};
+
+static const spl_extension extension = {SPL_EXTENSION_ABI_VERSION, 3, functions};
+
+SPL_EXPORT const spl_extension* spl_extension_info(void) {
+    return &extension;
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+#include "../interpreter/flat.h"
+
+#include <variant>
+
+
+namespace {
+    env::Environment runFlat(const std::string& input, bool inferTypes = true) {
+        env::Environment env;
+        RunOptions options;
+        options.flatten = true;
+        options.inferTypes = inferTypes;
+
+        run(input, env, options);
+
+        return env;
+    }
+}
+
+
+TEST(FlatTest, PreOrderLayout) {
+    token::Tokenizer tokenizer{"a = 1 + 2 * b; print(a);"};
+    Parser parser{tokenizer.getTokens()};
+    ast::RootNode root = parser.root();
+
+    flat::Program program{root};
+
+    // block, declare, +, 1, *, 2, b, call, a
+    ASSERT_EQ(program.size(), 9);
+    ASSERT_GT(program.memoryUsage(), 0);
+}
+
+TEST(FlatTest, Loops) {
+    for (bool inferTypes : {true, false}) {
+        env::Environment env = runFlat(
+            "total = 0; i = 0; "
+            "while (i < 10) { i = i + 1; if (i == 3) { continue; } if (i == 8) { break; } total = total + i; }",
+            inferTypes);
+
+        ASSERT_EQ(std::get<int>(env.get("total")), 1 + 2 + 4 + 5 + 6 + 7);
+        ASSERT_EQ(std::get<int>(env.get("i")), 8);
+    }
+}
+
+TEST(FlatTest, Branches) {
+    env::Environment env = runFlat(
+        "fun sign(n) { if (n < 0) { return 0 - 1; } elif (n == 0) { return 0; } else { return 1; } } "
+        "a = sign(0 - 5); b = sign(0); c = sign(7); d = !(a == b);");
+
+    ASSERT_EQ(std::get<int>(env.get("a")), -1);
+    ASSERT_EQ(std::get<int>(env.get("b")), 0);
+    ASSERT_EQ(std::get<int>(env.get("c")), 1);
+    ASSERT_TRUE(std::get<bool>(env.get("d")));
+}
+
+TEST(FlatTest, Functions) {
+    env::Environment env = runFlat(
+        "fun fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); } "
+        "fun greet(name) { return \"hello \" + name; } "
+        "a = fib(15); s = greet(\"world\"); f = 1.5 * 2.0;");
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 610);
+    ASSERT_EQ(std::get<std::string>(env.get("s")), "hello world");
+    ASSERT_FLOAT_EQ(std::get<float>(env.get("f")), 3.0f);
+}
+
+TEST(FlatTest, TreeNodes) {
+    env::Environment env = runFlat(
+        "a = [1, 2, 3]; a[1] = 5; d = {\"x\": 4}; total = a[0] + a[1] + a[2] + d[\"x\"];");
+
+    ASSERT_EQ(std::get<int>(env.get("total")), 13);
+}
+
+TEST(FlatTest, BreakInsideCalledFunction) {
+    // as in the tree walker, a break in a function ends the loop it was called from
+    env::Environment env = runFlat("fun stop() { break; } i = 0; while (true) { i = i + 1; stop(); }");
+
+    ASSERT_EQ(std::get<int>(env.get("i")), 1);
+}
+
+TEST(FlatTest, OptionsStillApply) {
+    env::Environment env;
+    sandbox::Limits limits{1000, sandbox::Limits::UNLIMITED_MEMORY};
+    std::unordered_map<std::string, memo::Statistics> statistics;
+    RunOptions options;
+    options.flatten = true;
+    options.limits = &limits;
+    options.memoize = true;
+    options.memoStatistics = &statistics;
+
+    run("fun fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); } a = fib(20);", env, options);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 6765);
+    ASSERT_EQ(statistics["fib"].misses, 21);
+
+    options.memoize = false;
+    ASSERT_THROW(run("while (true) {}", env, options), sandbox::StepLimitExceeded);
+}
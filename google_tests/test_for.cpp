@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+
+namespace {
+    /**
+     * Runs a program with the tree walker and with the flat evaluator, with and without type inference.
+     */
+    template <typename Check>
+    void runEverywhere(const std::string& input, Check check) {
+        for (bool flatten : {false, true}) {
+            for (bool inferTypes : {false, true}) {
+                env::Environment env;
+                RunOptions options;
+                options.flatten = flatten;
+                options.inferTypes = inferTypes;
+
+                run(input, env, options);
+                check(env);
+            }
+        }
+    }
+
+    int runSum(const std::string& loop) {
+        env::Environment env;
+        run("total = 0; " + loop, env);
+
+        return std::get<int>(env.get("total"));
+    }
+}
+
+
+TEST(ForTest, Tokens) {
+    token::Tokenizer tokenizer{"for (index in 0..n step 2)"};
+    std::vector<token::Token> tokens = tokenizer.getTokens();
+
+    ASSERT_EQ(tokens.size(), 10);
+    ASSERT_EQ(tokens[0].type(), token::TokenType::FOR);
+    ASSERT_EQ(tokens[2].type(), token::TokenType::IDENTIFIER);  // "index" starts with "in"
+    ASSERT_EQ(tokens[3].type(), token::TokenType::IN);
+    ASSERT_EQ(tokens[4].value(), "0");
+    ASSERT_EQ(tokens[5].type(), token::TokenType::RANGE);
+    ASSERT_EQ(tokens[6].value(), "n");
+    ASSERT_EQ(tokens[7].value(), "step");
+}
+
+TEST(ForTest, MatchesWhileLoop) {
+    const char* ranges[][3] = {
+        {"0", "10", "1"}, {"3", "17", "4"}, {"10", "0", "0 - 1"}, {"10", "0 - 7", "0 - 3"}, {"5", "5", "1"}, {"5", "2", "1"}
+    };
+
+    for (const auto& range : ranges) {
+        std::string start = range[0];
+        std::string end = range[1];
+        std::string step = range[2];
+        std::string condition = step.find('-') == std::string::npos ? "i < " + end : "i > " + end;
+
+        int expected = runSum("i = " + start + "; while (" + condition + ") { total = total * 3 + i; i = i + (" + step + "); }");
+        int actual = runSum("for (i in " + start + ".." + end + " step " + step + ") { total = total * 3 + i; }");
+
+        ASSERT_EQ(actual, expected) << start << ".." << end << " step " << step;
+    }
+}
+
+TEST(ForTest, Evaluators) {
+    runEverywhere(
+        "total = 0; n = 6; "
+        "for (i in 0..n) { for (j in i..n) { total = total + j; } } "
+        "for (k in 0..10) { if (k == 3) { continue; } if (k == 6) { break; } total = total + 100; }",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("total")), 70 + 500);
+            ASSERT_EQ(std::get<int>(env.get("i")), 6);
+            ASSERT_EQ(std::get<int>(env.get("k")), 6);  // break leaves the counter where it was
+        });
+}
+
+TEST(ForTest, CounterAfterLoop) {
+    runEverywhere(
+        "for (a in 0..10 step 3) { } for (b in 4..2) { } for (c in 2147483640..2147483647 step 5) { }",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("a")), 12);
+            ASSERT_EQ(std::get<int>(env.get("b")), 4);
+            ASSERT_EQ(env.getType("c"), "int");
+            ASSERT_TRUE(std::holds_alternative<types::BigInt>(env.get("c")));  // 2147483650 does not fit an int
+        });
+}
+
+TEST(ForTest, BoundsAreEvaluatedOnce) {
+    runEverywhere(
+        "count = 0; n = 5; for (i in 0..n) { n = n + 1; i = 100; count = count + 1; }",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("count")), 5);
+            ASSERT_EQ(std::get<int>(env.get("n")), 10);
+            ASSERT_EQ(std::get<int>(env.get("i")), 5);
+        });
+}
+
+TEST(ForTest, ReturnFromFunction) {
+    runEverywhere(
+        "fun find(n) { for (i in 1..100) { if (i * i > n) { return i; } } return 0; } "
+        "a = find(50); b = find(100000); step = 2;",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("a")), 8);
+            ASSERT_EQ(std::get<int>(env.get("b")), 0);
+            ASSERT_EQ(std::get<int>(env.get("step")), 2);  // "step" is only a keyword inside a for loop
+        });
+}
+
+TEST(ForTest, Errors) {
+    env::Environment env;
+
+    ASSERT_THROW(run("for (i in 0..1.5) { }", env), std::runtime_error);
+    ASSERT_THROW(run("for (i in 0..10 step 0) { }", env), std::runtime_error);
+    ASSERT_THROW(run("for (1 in 0..10) { }", env), std::runtime_error);
+    ASSERT_THROW(run("for (i in 0) { }", env), std::runtime_error);
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <thread>
+#include <variant>
+#include <vector>
+
+
+namespace {
+    const std::string PRELUDE =
+        "fun scale(x) { return x * factor; } "
+        "factor = 3; counter = 0; "
+        "table = [1, 2, 3]; alias = table; "
+        "config = {\"mode\": \"fast\", \"sizes\": table};";
+}
+
+
+TEST(ForkTest, WritesStayInFork) {
+    env::Environment prelude;
+    run(PRELUDE, prelude);
+
+    env::Environment request = prelude.fork();
+    run("factor = 10; counter = counter + 1; a = scale(2); fresh = 1;", request);
+
+    ASSERT_EQ(std::get<int>(request.get("a")), 20);
+    ASSERT_EQ(std::get<int>(request.get("counter")), 1);
+
+    ASSERT_EQ(std::get<int>(prelude.get("factor")), 3);
+    ASSERT_EQ(std::get<int>(prelude.get("counter")), 0);
+    ASSERT_FALSE(prelude.has("fresh"));
+}
+
+TEST(ForkTest, FunctionsWriteToFork) {
+    env::Environment prelude;
+    run("total = 0; fun add(x) { total = total + x; return total; }", prelude);
+
+    env::Environment request = prelude.fork();
+    run("add(5); add(7);", request);
+
+    ASSERT_EQ(std::get<int>(request.get("total")), 12);
+    ASSERT_EQ(std::get<int>(prelude.get("total")), 0);
+}
+
+TEST(ForkTest, ContainersCopiedOnWrite) {
+    env::Environment prelude;
+    run(PRELUDE, prelude);
+
+    env::Environment request = prelude.fork();
+    run("table[0] = 100; push(alias, 4); sizes = config[\"sizes\"]; first = sizes[0]; config[\"mode\"] = \"slow\";", request);
+
+    // the fork's copies still share with each other like the originals do
+    ASSERT_EQ(std::get<types::Array>(request.get("alias")).size(), 4);
+    ASSERT_EQ(std::get<int>(request.get("first")), 100);
+
+    const types::Array& table = std::get<types::Array>(*prelude.lookup("table"));
+    ASSERT_EQ(table.size(), 3);
+    ASSERT_EQ(table.ints()[0], 1);
+    ASSERT_EQ(types::stringView(*std::get<types::Dict>(prelude.get("config")).find(std::string("mode"))), "fast");
+}
+
+TEST(ForkTest, ReadsShareContainers) {
+    env::Environment prelude;
+    run("table = [1, 2, 3]; lookup = {}; i = 0; while (i < 1000) { lookup[i] = i * 2; i = i + 1; }", prelude);
+
+    env::Environment request = prelude.fork();
+    run("x = table[1] + lookup[42]; n = len(lookup);", request);
+
+    ASSERT_EQ(std::get<int>(request.get("x")), 86);
+    ASSERT_EQ(std::get<int>(request.get("n")), 1000);
+
+    // reading borrowed the containers without copying their elements
+    const types::Array& original = std::get<types::Array>(*prelude.lookup("table"));
+    const types::Array& borrowed = std::get<types::Array>(*request.lookup("table"));
+    ASSERT_NE(borrowed.identity(), original.identity());
+    ASSERT_EQ(borrowed.ints().data(), original.ints().data());
+
+    const types::Dict& originalLookup = std::get<types::Dict>(*prelude.lookup("lookup"));
+    const types::Dict& borrowedLookup = std::get<types::Dict>(*request.lookup("lookup"));
+    ASSERT_EQ(borrowedLookup.find(42), originalLookup.find(42));
+
+    // the first write copies
+    run("table[1] = 20; lookup[42] = 0;", request);
+    ASSERT_NE(borrowed.ints().data(), original.ints().data());
+    ASSERT_EQ(original.ints()[1], 2);
+    ASSERT_EQ(std::get<int>(*originalLookup.find(42)), 84);
+    ASSERT_EQ(std::get<int>(*borrowedLookup.find(42)), 0);
+}
+
+TEST(ForkTest, NestedContainersStayShared) {
+    env::Environment prelude;
+    run("a = [1, 2]; nested = {\"x\": 1}; d = {\"k\": a, \"nested\": nested};", prelude);
+
+    env::Environment request = prelude.fork();
+    run("inner = d[\"k\"]; inner[0] = 9; y = a[0]; held = d[\"nested\"]; held[\"new\"] = 1; n = len(nested);", request);
+
+    // the array and the dictionary in d are still one with the variables in the fork
+    ASSERT_EQ(std::get<int>(request.get("y")), 9);
+    ASSERT_EQ(std::get<int>(request.get("n")), 2);
+
+    ASSERT_EQ(std::get<types::Array>(prelude.get("a")).ints()[0], 1);
+    ASSERT_EQ(std::get<types::Dict>(prelude.get("nested")).size(), 1);
+}
+
+TEST(ForkTest, ClearForgetsBorrowedContainers) {
+    env::Environment prelude;
+    run("table = [1, 2, 3];", prelude);
+
+    env::Environment request = prelude.fork();
+    for (int i = 0; i < 3; i++) {
+        run("push(table, 4); table[0] = table[0] + 10; first = table[0]; n = len(table);", request);
+
+        ASSERT_EQ(std::get<int>(request.get("first")), 11);
+        ASSERT_EQ(std::get<int>(request.get("n")), 4);
+        request.clear();
+    }
+
+    ASSERT_EQ(std::get<types::Array>(prelude.get("table")).size(), 3);
+}
+
+TEST(ForkTest, NestedForks) {
+    env::Environment prelude;
+    run("x = 1;", prelude);
+
+    env::Environment first = prelude.fork();
+    run("x = 2; y = 5;", first);
+
+    env::Environment second = first.fork();
+    run("x = x + 10; y = y + 1;", second);
+
+    ASSERT_EQ(std::get<int>(second.get("x")), 12);
+    ASSERT_EQ(std::get<int>(second.get("y")), 6);
+    ASSERT_EQ(std::get<int>(first.get("x")), 2);
+    ASSERT_EQ(std::get<int>(first.get("y")), 5);
+    ASSERT_EQ(std::get<int>(prelude.get("x")), 1);
+}
+
+TEST(ForkTest, NestedForkBorrowsForItself) {
+    env::Environment prelude;
+    run("table = [1, 2, 3];", prelude);
+
+    env::Environment first = prelude.fork();
+    env::Environment second = first.fork();
+    run("table[0] = 7; x = table[0];", second);
+
+    // the inner fork borrowed the table, without adding it to the fork in between
+    ASSERT_EQ(std::get<int>(second.get("x")), 7);
+    ASSERT_TRUE(first.names().empty());
+    ASSERT_EQ(std::get<types::Array>(first.get("table")).ints()[0], 1);
+}
+
+TEST(ForkTest, ConcurrentForks) {
+    env::Environment prelude;
+    run(PRELUDE, prelude);
+
+    constexpr int THREADS = 8;
+    std::vector<int> results(THREADS);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&prelude, &results, t]() {
+            env::Environment request = prelude.fork();
+            request.set("id", t);
+
+            run("i = 0; while (i < 200) { table[0] = table[0] + id; counter = counter + 1; i = i + 1; } "
+                "result = scale(table[0]) + counter;", request);
+
+            results[t] = std::get<int>(request.get("result"));
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int t = 0; t < THREADS; t++) {
+        ASSERT_EQ(results[t], (1 + 200 * t) * 3 + 200);
+    }
+
+    ASSERT_EQ(std::get<types::Array>(prelude.get("table")).ints()[0], 1);
+    ASSERT_EQ(std::get<int>(prelude.get("counter")), 0);
+}
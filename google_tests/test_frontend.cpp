@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/frontend.h"
+
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+
+namespace {
+    std::string generatedProgram(int statements) {
+        std::string source = "total = 0;\n";
+
+        for (int i = 0; i < statements; i++) {
+            std::string n = std::to_string(i);
+            source += "fun f" + n + "(x) {\n    if (x % 2 == 0) { return x * " + n + "; } else { return x + " + n + "; }\n}\n";
+            source += "v" + n + " = f" + n + "(" + n + "); names" + n + " = {\"k\": \"a;b}\"};\n";
+            source += "total = total + v" + n + ";\n";
+        }
+
+        return source;
+    }
+
+    std::string trim(std::string_view text) {
+        size_t begin = text.find_first_not_of(" \n");
+        size_t end = text.find_last_not_of(" \n");
+
+        return begin == std::string_view::npos ? "" : std::string(text.substr(begin, end - begin + 1));
+    }
+}
+
+
+TEST(FrontendTest, SplitsAtTopLevelStatements) {
+    std::string source = "a = 1; fun f(x) { y = x; return y; }\nif (a == 1) { b = 2; } else { b = 3; } "
+                         "d = {\"k\": 1}; s = \"x;y}\";";
+
+    std::vector<frontend::Chunk> chunks = frontend::split(source, 100);
+    std::vector<std::string> statements;
+    std::string joined;
+
+    for (const frontend::Chunk& chunk : chunks) {
+        statements.push_back(trim(chunk.source));
+        joined += chunk.source;
+    }
+
+    ASSERT_EQ(joined, source);
+    ASSERT_EQ(statements, (std::vector<std::string>{
+        "a = 1;",
+        "fun f(x) { y = x; return y; }",
+        "if (a == 1) { b = 2; } else { b = 3; }",
+        "d = {\"k\": 1};",
+        "s = \"x;y}\";"
+    }));
+
+    // the if statement's chunk starts with the line break after the function
+    ASSERT_EQ(chunks[1].firstColumn, 6);
+    ASSERT_EQ(chunks[2].firstLine, 1);
+    ASSERT_EQ(chunks[3].firstLine, 2);
+}
+
+TEST(FrontendTest, SameProgramOnEveryThreadCount) {
+    std::string source = generatedProgram(200);
+    ast::RootNode sequential = frontend::parse(source, 1);
+
+    for (size_t threads : {2, 4, 8}) {
+        ast::RootNode parallel = frontend::parse(source, threads);
+        ASSERT_EQ(parallel.children().size(), sequential.children().size());
+
+        for (size_t i = 0; i < sequential.children().size(); i++) {
+            ASSERT_EQ(parallel.children()[i]->line(), sequential.children()[i]->line()) << i;
+            ASSERT_EQ(parallel.children()[i]->column(), sequential.children()[i]->column()) << i;
+        }
+
+        env::Environment env;
+        RunOptions options;
+        options.parseThreads = threads;
+        run(source, env, options);
+
+        ASSERT_EQ(std::get<int>(env.get("total")), std::get<int>(run(source).get("total")));
+    }
+}
+
+TEST(FrontendTest, ReportsErrors) {
+    std::string source = generatedProgram(50) + "broken = (1 + 2;\n" + generatedProgram(50);
+
+    EXPECT_THROW(frontend::parse(source, 4), std::runtime_error);
+}
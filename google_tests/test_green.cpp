@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/green.h"
+
+#include <variant>
+
+
+TEST(GreenThreadTest, RunsToCompletion) {
+    green::Scheduler scheduler{4};
+    std::vector<std::shared_ptr<green::Script>> scripts;
+
+    for (int i = 0; i < 100; i++) {
+        scripts.push_back(scheduler.spawn("i = 0; total = 0; while (i < 1000) { total = total + i; i = i + 1; }"));
+    }
+
+    scheduler.wait();
+
+    for (const std::shared_ptr<green::Script>& script : scripts) {
+        ASSERT_EQ(script->state(), green::Script::State::FINISHED);
+        ASSERT_EQ(std::get<int>(script->environment().get("total")), 499500);
+    }
+}
+
+TEST(GreenThreadTest, TimeSlicing) {
+    // more busy scripts than workers: each is suspended after every slice of 100 steps so the others can run
+    green::Scheduler scheduler{2, green::Scheduler::DEFAULT_STACK_SIZE, 100};
+    std::vector<std::shared_ptr<green::Script>> scripts;
+
+    for (int i = 0; i < 8; i++) {
+        scripts.push_back(scheduler.spawn("fun inc(n) { return n + 1; } i = 0; while (i < 5000) { i = inc(i); yield(); }"));
+    }
+
+    scheduler.wait();
+
+    for (const std::shared_ptr<green::Script>& script : scripts) {
+        ASSERT_EQ(std::get<int>(script->environment().get("i")), 5000);
+    }
+}
+
+TEST(GreenThreadTest, ReceiveWaitsForMessages) {
+    green::Scheduler scheduler{2};
+    auto script = scheduler.spawn("total = 0; n = receive(); while (n != 0) { total = total + n; n = receive(); }");
+
+    scheduler.wait();
+    ASSERT_EQ(script->state(), green::Script::State::WAITING);
+
+    scheduler.send(script, 5);
+    scheduler.send(script, 7);
+    scheduler.wait();
+    ASSERT_EQ(script->state(), green::Script::State::WAITING);
+
+    scheduler.send(script, 0);
+    scheduler.wait();
+    ASSERT_EQ(script->state(), green::Script::State::FINISHED);
+    ASSERT_EQ(std::get<int>(script->environment().get("total")), 12);
+}
+
+TEST(GreenThreadTest, ThousandsOfIdleScripts) {
+    green::Scheduler scheduler{4};
+    std::vector<std::shared_ptr<green::Script>> scripts;
+
+    for (int i = 0; i < 5000; i++) {
+        scripts.push_back(scheduler.spawn("fun handle(event) { return event * 2; } result = handle(receive());"));
+    }
+
+    scheduler.wait();
+
+    green::MemoryReport report = scheduler.memoryReport();
+    ASSERT_EQ(report.scripts, 5000);
+    ASSERT_EQ(report.suspended, 5000);
+
+    // a waiting script only holds the few stack pages it has touched
+    ASSERT_LT(report.suspendedBytes / report.suspended, 64 * 1024);
+
+    for (size_t i = 0; i < scripts.size(); i++) {
+        scheduler.send(scripts[i], static_cast<int>(i));
+    }
+    scheduler.wait();
+
+    ASSERT_EQ(std::get<int>(scripts[4999]->environment().get("result")), 9998);
+    ASSERT_EQ(scheduler.memoryReport().scripts, 0);
+}
+
+TEST(GreenThreadTest, ErrorsAndCancellation) {
+    std::shared_ptr<green::Script> failing;
+    std::shared_ptr<green::Script> waiting;
+
+    {
+        green::Scheduler scheduler{1};
+        failing = scheduler.spawn("a = 1 + undefined;");
+        waiting = scheduler.spawn("a = receive();");
+        scheduler.wait();
+
+        ASSERT_EQ(failing->state(), green::Script::State::FAILED);
+        ASSERT_THROW(std::rethrow_exception(failing->error()), std::runtime_error);
+        ASSERT_EQ(waiting->state(), green::Script::State::WAITING);
+    }
+
+    ASSERT_EQ(waiting->state(), green::Script::State::FAILED);
+    ASSERT_THROW(std::rethrow_exception(waiting->error()), green::Cancelled);
+}
+
+TEST(GreenThreadTest, DeepRecursion) {
+    green::Scheduler scheduler{2};
+    std::string count = "fun count(n) { if (n == 0) { return 0; } return count(n - 1) + 1; } ";
+
+    std::shared_ptr<green::Script> deep = scheduler.spawn(count + "a = count(500);");
+    std::shared_ptr<green::Script> unbounded = scheduler.spawn(count + "a = count(0 - 1);");
+    scheduler.wait();
+
+    ASSERT_EQ(deep->state(), green::Script::State::FINISHED);
+    ASSERT_EQ(std::get<int>(deep->environment().get("a")), 500);
+
+    // fails the script before the stack overflows, and the process carries on
+    ASSERT_EQ(unbounded->state(), green::Script::State::FAILED);
+    ASSERT_THROW(std::rethrow_exception(unbounded->error()), sandbox::CallDepthExceeded);
+}
+
+TEST(GreenThreadTest, OutsideScheduler) {
+    ASSERT_EQ(std::get<bool>(run("a = yield();").get("a")), false);
+    ASSERT_THROW(run("a = receive();"), std::runtime_error);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+
+#include <variant>
+
+
+namespace {
+    std::unordered_map<std::string, ast::StaticType> inferTypes(const std::string& input) {
+        token::Tokenizer tokenizer{input};
+        Parser parser{tokenizer.getTokens()};
+        ast::RootNode root = parser.root();
+
+        return inference::inferVariables(root);
+    }
+
+    RunOptions inferring(bool enabled, inference::Report* report = nullptr) {
+        RunOptions options;
+        options.inferTypes = enabled;
+        options.inferenceReport = report;
+        return options;
+    }
+}
+
+
+TEST(InferenceTest, MonomorphicVariables) {
+    auto types = inferTypes("i = 0; x = 1.5; done = false; s = \"a\"; while (i < 10) { i = i + 1; x = x * 2.0; done = i >= 10; }");
+
+    ASSERT_EQ(types["i"], ast::StaticType::INT);
+    ASSERT_EQ(types["x"], ast::StaticType::FLOAT);
+    ASSERT_EQ(types["done"], ast::StaticType::BOOL);
+    ASSERT_EQ(types["s"], ast::StaticType::STRING);
+}
+
+TEST(InferenceTest, PolymorphicVariables) {
+    auto types = inferTypes("a = 1; a = 1.5; b = [1, 2]; c = b[0]; d = len(b); e = e + 1;");
+
+    ASSERT_EQ(types["a"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["b"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["c"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["d"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["e"], ast::StaticType::DYNAMIC);
+}
+
+TEST(InferenceTest, ParametersFromCallSites) {
+    auto types = inferTypes("fun square(n) { return n * n; } fun id(v) { return v; } a = square(3); b = square(4); "
+                            "c = id(1); d = id(2.0); fun escaped(w) { return w; } e = escaped;");
+
+    ASSERT_EQ(types["n"], ast::StaticType::INT);
+    ASSERT_EQ(types["v"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["w"], ast::StaticType::DYNAMIC);
+}
+
+TEST(InferenceTest, UnparsedFunctionBodies) {
+    // the body of bump has not been parsed, so its assignment is only seen by scanning its tokens
+    auto types = inferTypes("count = 0; fun bump() { count = \"a\"; } total = 1; fun read() { return total + 1; }");
+
+    ASSERT_EQ(types["count"], ast::StaticType::DYNAMIC);
+    ASSERT_EQ(types["total"], ast::StaticType::INT);
+
+    env::Environment env = run("fun affine(a, b) { return a * b + 1; } x = affine(2, 3); y = affine(4, 5);");
+
+    ASSERT_EQ(std::get<int>(env.get("x")), 7);
+    ASSERT_EQ(std::get<int>(env.get("y")), 21);
+}
+
+TEST(InferenceTest, Report) {
+    env::Environment env;
+    inference::Report report;
+
+    run("i = 0; total = 0; while (i < 100) { total = total + i % 7; i = i + 1; } s = \"a\" + \"b\";", env, inferring(true, &report));
+
+    ASSERT_EQ(std::get<int>(env.get("total")), 295);
+    ASSERT_EQ(report.operations, 5);
+    ASSERT_EQ(report.specialized, 4);
+    ASSERT_DOUBLE_EQ(report.percentage(), 80.0);
+}
+
+TEST(InferenceTest, SameResultsAsDynamic) {
+    std::string program = "a = 7; b = 2; c = 2.5; q = a / b; r = a % b; f = c * a - b; m = c % 2; "
+                          "lt = a < c; eq = a == 7.0; t = !(lt && eq) || false;";
+
+    env::Environment typed;
+    env::Environment dynamic;
+    run(program, typed, inferring(true));
+    run(program, dynamic, inferring(false));
+
+    for (const char* name : {"q", "r", "f", "m", "lt", "eq", "t"}) {
+        ASSERT_TRUE(typed.get(name) == dynamic.get(name)) << name;
+    }
+
+    ASSERT_EQ(std::get<int>(typed.get("q")), 3);
+    ASSERT_FLOAT_EQ(std::get<float>(typed.get("f")), 15.5f);
+}
+
+TEST(InferenceTest, GuardFallsBack) {
+    // the host sets x to a string before the script assigns it an int, so the typed read has to fall back
+    env::Environment env;
+    env.set("x", std::string("a"));
+
+    run("y = x + \"b\"; x = 1; z = x + 1;", env);
+
+    ASSERT_EQ(std::get<std::string>(env.get("y")), "ab");
+    ASSERT_EQ(std::get<int>(env.get("z")), 2);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <variant>
+
+
+namespace {
+    inlining::Report runInlined(const std::string& input, env::Environment& env) {
+        inlining::Report report;
+        RunOptions options;
+        options.inlineFunctions = true;
+        options.inliningReport = &report;
+
+        run(input, env, options);
+
+        return report;
+    }
+}
+
+
+TEST(InliningTest, SmallFunctions) {
+    env::Environment env;
+    inlining::Report report = runInlined(
+        "fun sq(x) { return x * x; } "
+        "fun hyp(a, b) { s = sq(a) + sq(b); return s; } "
+        "fun fact(n) { if (n < 2) { return 1; } return n * fact(n - 1); } "
+        "total = 0; i = 0; while (i < 10) { total = total + sq(i); i = i + 1; } "
+        "h = hyp(3, 4); f = fact(5);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("total")), 285);
+    ASSERT_EQ(std::get<int>(env.get("h")), 25);
+    ASSERT_EQ(std::get<int>(env.get("f")), 120);
+
+    // fact has control flow and refers to itself, and hyp calls a function that is not a builtin
+    ASSERT_EQ(report.functions, 1);
+    ASSERT_EQ(report.calls, 3);
+
+    // the renamed parameters and locals don't outlive the call
+    ASSERT_FALSE(env.has("$sq$x"));
+    ASSERT_FALSE(env.has("$hyp$s"));
+    ASSERT_FALSE(env.has("s"));
+}
+
+TEST(InliningTest, Renaming) {
+    env::Environment env;
+    runInlined(
+        "fun shift(x) { y = x + offset; return y; } "
+        "x = 10; offset = 5; a = shift(1); b = shift(x);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 6);
+    ASSERT_EQ(std::get<int>(env.get("b")), 15);
+    ASSERT_EQ(std::get<int>(env.get("x")), 10);
+    ASSERT_FALSE(env.has("y"));
+}
+
+TEST(InliningTest, LocalThatExistsInCaller) {
+    // without inlining, the function assigns to the caller's variable
+    env::Environment env;
+    runInlined("fun shift(x) { y = x + 1; return y; } y = 0; a = shift(1);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 2);
+    ASSERT_EQ(std::get<int>(env.get("y")), 2);
+}
+
+TEST(InliningTest, CalleesSeeCallerVariables) {
+    // scoping is dynamic, so g reads h's parameter and sq assigns h's local
+    for (bool inlined : {false, true}) {
+        env::Environment env;
+        RunOptions options;
+        options.inlineFunctions = inlined;
+
+        run("fun g(x) { return x * y; } fun h(y) { return g(2); } a = h(5);", env, options);
+        ASSERT_EQ(std::get<int>(env.get("a")), 10);
+
+        run("fun sq(x) { y = x * x; return y; } fun k() { y = 5; return sq(2) + y; } b = k();", env, options);
+        ASSERT_EQ(std::get<int>(env.get("b")), 8);
+    }
+}
+
+TEST(InliningTest, BuiltinShadowedByFunction) {
+    env::Environment env;
+    runInlined("fun size(s) { return len(s) + 1; } a = size(\"abc\"); fun len(s) { return 10; } b = size(\"abc\");", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 4);
+    ASSERT_EQ(std::get<int>(env.get("b")), 11);
+}
+
+TEST(InliningTest, Rebinding) {
+    env::Environment env;
+    runInlined(
+        "fun twice(x) { return x * 2; } "
+        "fun half(x) { return x / 2; } "
+        "a = twice(8); twice = half; b = twice(8);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 16);
+    ASSERT_EQ(std::get<int>(env.get("b")), 4);
+}
+
+TEST(InliningTest, Heuristics) {
+    env::Environment env;
+    inlining::Report report;
+    RunOptions options;
+    options.inlineFunctions = true;
+    options.inliningReport = &report;
+    options.inliningHeuristics.maxBodyNodes = 4;
+
+    run("fun inc(x) { return x + 1; } fun poly(x) { return x * x + x * 3 + 1; } a = inc(1) + poly(2);", env, options);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 13);
+    ASSERT_EQ(report.functions, 1);
+}
+
+TEST(InliningTest, ArityErrorsStillReported) {
+    env::Environment env;
+    ASSERT_THROW(runInlined("fun sq(x) { return x * x; } a = sq(1, 2);", env), std::runtime_error);
+}
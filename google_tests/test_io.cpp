@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/io.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <variant>
+
+
+namespace {
+    std::string formatted(const env::VariantType& value) {
+        std::string output;
+        io::format(output, value);
+        return output;
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+}
+
+
+TEST(IoTest, Format) {
+    ASSERT_EQ(formatted(42), "42");
+    ASSERT_EQ(formatted(2.5f), "2.5");
+    ASSERT_EQ(formatted(3.0f), "3.0");
+    ASSERT_EQ(formatted(true), "true");
+    ASSERT_EQ(formatted(std::string("text")), "text");
+    ASSERT_EQ(formatted(types::Array{std::vector<int>{1, 2}}), "[1, 2]");
+
+    env::Environment env = run(R"(d = {"a": [0.5], 2: "b"};)");
+    ASSERT_EQ(formatted(env.get("d")), R"({"a": [0.5], 2: "b"})");
+}
+
+TEST(IoTest, OutputBufferFlushes) {
+    std::string path = testing::TempDir() + "spl_output_buffer.txt";
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+
+    {
+        io::OutputBuffer output{fileno(file), 8};
+        output.write("abc");
+        ASSERT_EQ(readFile(path), "");  // still buffered
+
+        output.write("defghij");  // overflows the buffer
+        output.write("0123456789");  // bigger than the buffer
+        output.write("k");
+    }
+
+    std::fclose(file);
+    ASSERT_EQ(readFile(path), "abcdefghij0123456789k");
+}
+
+TEST(IoTest, ReadAllWriteAll) {
+    std::string path = testing::TempDir() + "spl_readall.txt";
+
+    env::Environment env;
+    env.set("path", path);
+    run(R"(
+        written = writeall(path, "hello " + "file");
+        contents = readall(path);
+        size = len(contents);
+        same = contents == "hello file";
+        longer = contents + ".";
+        d = {};
+        d[contents] = 1;
+        found = has(d, "hello file");
+    )", env);
+
+    ASSERT_EQ(std::get<int>(env.get("written")), 10);
+    ASSERT_TRUE(std::holds_alternative<types::StringSlice>(env.get("contents")));
+    ASSERT_EQ(std::get<int>(env.get("size")), 10);
+    ASSERT_EQ(std::get<bool>(env.get("same")), true);
+    ASSERT_EQ(std::get<std::string>(env.get("longer")), "hello file.");
+    ASSERT_EQ(std::get<bool>(env.get("found")), true);
+
+    std::remove(path.c_str());
+    ASSERT_THROW(run("a = readall(\"" + path + "\");"), std::runtime_error);
+}
+
+TEST(IoTest, OverwriteAfterReadAll) {
+    std::string path = testing::TempDir() + "spl_overwrite.txt";
+
+    env::Environment env;
+    env.set("path", path);
+    env.set("original", std::string(60000, 'a') + "hello");
+    run(R"(
+        writeall(path, original);
+        x = readall(path);
+        writeall(path, "short");
+        tail = substr(x, 60000, 5);
+        size = len(x);
+        y = readall(path);
+    )", env);
+
+    ASSERT_EQ(types::stringView(env.get("tail")), "hello");
+    ASSERT_EQ(std::get<int>(env.get("size")), 60005);
+    ASSERT_EQ(types::stringView(env.get("y")), "short");
+
+    // the same length as before: the old value still doesn't change
+    run(R"(
+        writeall(path, "world");
+        z = readall(path);
+    )", env);
+
+    ASSERT_EQ(types::stringView(env.get("y")), "short");
+    ASSERT_EQ(types::stringView(env.get("z")), "world");
+    std::remove(path.c_str());
+}
+
+TEST(IoTest, ReadAsyncWriteAsync) {
+    std::string first = testing::TempDir() + "spl_async_first.txt";
+    std::string second = testing::TempDir() + "spl_async_second.txt";
+
+    env::Environment env;
+    env.set("first", first);
+    env.set("second", second);
+    run(R"(
+        a = writeasync(first, "alpha");
+        b = writeasync(second, "beta");
+        written = a() + b();
+
+        a = readasync(first);
+        b = readasync(second);
+        contents = a() + b();
+        again = a();
+    )", env);
+
+    ASSERT_EQ(std::get<int>(env.get("written")), 9);
+    ASSERT_EQ(std::get<std::string>(env.get("contents")), "alphabeta");
+    ASSERT_TRUE(std::holds_alternative<types::StringSlice>(env.get("again")));
+    ASSERT_EQ(readFile(second), "beta");
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+
+    // the error is reported when the handle is called, not when the read starts
+    run("missing = readasync(first);", env);
+    ASSERT_THROW(run("contents = missing();", env), std::runtime_error);
+}
+
+TEST(IoTest, TaskPoolRunsTasksAtOnce) {
+    io::TaskPool pool{4};
+    std::atomic<int> started{0};
+    std::vector<std::shared_future<env::VariantType>> results;
+
+    // each task waits for all four to start, so they can only finish if they run at the same time
+    for (int i = 0; i < 4; i++) {
+        results.push_back(pool.submit([&started, i]() {
+            started++;
+            while (started < 4) {
+                std::this_thread::yield();
+            }
+
+            return env::VariantType(i);
+        }));
+    }
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(std::get<int>(results[i].get()), i);
+    }
+
+    std::shared_future<env::VariantType> failed = pool.submit([]() -> env::VariantType {
+        throw std::runtime_error("failed");
+    });
+    ASSERT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(IoTest, TaskPoolFinishesQueuedTasks) {
+    std::atomic<int> finished{0};
+
+    {
+        io::TaskPool pool{1};
+
+        for (int i = 0; i < 10; i++) {
+            pool.submit([&finished]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                finished++;
+                return env::VariantType(0);
+            });
+        }
+    }
+
+    ASSERT_EQ(finished, 10);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/isolate.h"
+
+#include <thread>
+#include <variant>
+#include <vector>
+
+
+namespace {
+    const std::unordered_map<std::string, std::string> PROGRAMS = {
+        {"price", "total = 0; i = 0; while (i < quantity) { total = total + unit(i); i = i + 1; }"},
+        {"fail", "x = 1 / 0;"}
+    };
+}
+
+
+TEST(IsolateTest, RunsPreloadedPrograms) {
+    env::Environment prelude = run("base = 10; fun unit(i) { return base + i; }");
+    isolate::Pool pool{prelude, PROGRAMS, isolate::Options{2}};
+
+    {
+        isolate::Lease lease = pool.acquire();
+        lease->environment().set("quantity", 3);
+        lease->run("price");
+
+        ASSERT_EQ(std::get<int>(lease->environment().get("total")), 33);
+        ASSERT_EQ(pool.available(), 1);
+    }
+
+    ASSERT_EQ(pool.available(), 2);
+    ASSERT_FALSE(prelude.has("total"));
+}
+
+TEST(IsolateTest, ResetBetweenRequests) {
+    env::Environment prelude = run("base = 10; fun unit(i) { base = base + 1; return base; }");
+    isolate::Pool pool{prelude, PROGRAMS, isolate::Options{1}};
+
+    for (int request = 0; request < 3; request++) {
+        isolate::Lease lease = pool.acquire();
+
+        ASSERT_FALSE(lease->environment().has("total"));
+        ASSERT_FALSE(lease->environment().has("quantity"));
+
+        lease->environment().set("quantity", 2);
+        lease->run("price");
+
+        // base starts from the prelude's value every time
+        ASSERT_EQ(std::get<int>(lease->environment().get("total")), 23);
+    }
+
+    ASSERT_EQ(std::get<int>(prelude.get("base")), 10);
+}
+
+TEST(IsolateTest, Errors) {
+    env::Environment prelude;
+    isolate::Pool pool{prelude, PROGRAMS, isolate::Options{1}};
+
+    {
+        isolate::Lease lease = pool.acquire();
+        ASSERT_THROW(lease->run("fail"), std::runtime_error);
+        ASSERT_THROW(lease->run("missing"), std::out_of_range);
+    }
+
+    // the isolate came back despite the error
+    ASSERT_EQ(pool.available(), 1);
+
+    ASSERT_THROW((isolate::Pool{prelude, {{"broken", "x = (1;"}}}), std::runtime_error);
+}
+
+TEST(IsolateTest, ConcurrentRequests) {
+    env::Environment prelude = run("base = 10; fun unit(i) { return base + i; }");
+    isolate::Options options;
+    options.isolates = 3;
+    options.flatten = true;
+    isolate::Pool pool{prelude, PROGRAMS, options};
+
+    constexpr int THREADS = 8;
+    std::vector<int> results(THREADS);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&pool, &results, t]() {
+            for (int request = 0; request < 20; request++) {
+                isolate::Lease lease = pool.acquire();
+                lease->environment().set("quantity", t);
+                lease->run("price");
+                results[t] = std::get<int>(lease->environment().get("total"));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int t = 0; t < THREADS; t++) {
+        ASSERT_EQ(results[t], 10 * t + t * (t - 1) / 2);
+    }
+
+    ASSERT_EQ(pool.available(), 3);
+}
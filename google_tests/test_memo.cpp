@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+
+#include <variant>
+
+
+namespace {
+    std::unordered_set<std::string> pureFunctions(const std::string& input) {
+        token::Tokenizer tokenizer{input};
+        Parser parser{tokenizer.getTokens()};
+        ast::RootNode root = parser.root();
+
+        return memo::findPureFunctions(root, env::Environment{});
+    }
+
+    const std::string FIB = "fun fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); } ";
+}
+
+
+TEST(MemoTest, Purity) {
+    auto pure = pureFunctions(FIB +
+        "fun size(s) { return len(s) * 2; } "
+        "fun usesFib(n) { n = n + 1; return fib(n); } "
+        "fun readsGlobal(n) { return n + g; } "
+        "fun writesLocal(n) { t = n; return t; } "
+        "fun prints(n) { print(n); return n; } "
+        "fun callsImpure(n) { return prints(n); } "
+        "fun mutates(a) { a[0] = 1; return a; } "
+        "g = 1;");
+
+    ASSERT_TRUE(pure.count("fib"));
+    ASSERT_TRUE(pure.count("size"));
+    ASSERT_TRUE(pure.count("usesFib"));
+    ASSERT_FALSE(pure.count("readsGlobal"));
+    ASSERT_FALSE(pure.count("writesLocal"));
+    ASSERT_FALSE(pure.count("prints"));
+    ASSERT_FALSE(pure.count("callsImpure"));
+    ASSERT_FALSE(pure.count("mutates"));
+}
+
+TEST(MemoTest, Fibonacci) {
+    env::Environment env;
+    std::unordered_map<std::string, memo::Statistics> statistics;
+    RunOptions options;
+    options.memoize = true;
+    options.memoStatistics = &statistics;
+
+    run(FIB + "a = fib(25); b = fib(25);", env, options);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 75025);
+    ASSERT_EQ(std::get<int>(env.get("b")), 75025);
+
+    // each of fib(0) ... fib(25) misses once. fib(n - 2) hits for n >= 3, and so does the second fib(25)
+    ASSERT_EQ(statistics["fib"].misses, 26);
+    ASSERT_EQ(statistics["fib"].hits, 24);
+    ASSERT_EQ(statistics["fib"].entries, 26);
+}
+
+TEST(MemoTest, NativeShadowsBuiltin) {
+    env::Environment env;
+    int calls = 0;
+    registerFunction(env, "len", 1, [&calls](const std::vector<env::VariantType>&) -> env::VariantType {
+        return ++calls;
+    });
+
+    RunOptions options;
+    options.memoize = true;
+
+    // len is pure as a builtin, but here it is the host's native function, which counts its calls
+    run("fun size(s) { return len(s); } a = size(\"x\"); b = size(\"x\");", env, options);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 1);
+    ASSERT_EQ(std::get<int>(env.get("b")), 2);
+    ASSERT_EQ(calls, 2);
+}
+
+TEST(MemoTest, Bounded) {
+    memo::Cache cache{2};
+    std::string key;
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(memo::Cache::makeKey({i}, key));
+        ASSERT_EQ(cache.find(key), nullptr);
+        cache.insert(key, i * 10);
+    }
+
+    ASSERT_TRUE(memo::Cache::makeKey({0}, key));
+    ASSERT_EQ(cache.find(key), nullptr);  // evicted
+
+    ASSERT_TRUE(memo::Cache::makeKey({2}, key));
+    ASSERT_EQ(std::get<int>(*cache.find(key)), 20);
+
+    ASSERT_FALSE(memo::Cache::makeKey({types::Array{}}, key));
+    ASSERT_EQ(cache.statistics().entries, 2);
+}
+
+TEST(MemoTest, Disabled) {
+    env::Environment env;
+    std::unordered_map<std::string, memo::Statistics> statistics;
+    RunOptions options;
+    options.memoStatistics = &statistics;
+
+    run(FIB + "a = fib(10);", env, options);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 55);
+    ASSERT_TRUE(statistics.empty());
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <variant>
+
+
+TEST(NativeFunctionTest, RegisteredFunction) {
+    env::Environment env;
+    int calls = 0;
+
+    registerFunction(env, "hypot2", 2, [&calls](const std::vector<env::VariantType>& arguments) -> env::VariantType {
+        calls++;
+        int x = std::get<int>(arguments[0]);
+        int y = std::get<int>(arguments[1]);
+        return x * x + y * y;
+    });
+
+    run("fun wrap(n) { return hypot2(n, n + 1); } a = hypot2(3, 4); b = wrap(2);", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 25);
+    ASSERT_EQ(std::get<int>(env.get("b")), 13);
+    ASSERT_EQ(calls, 2);
+}
+
+TEST(NativeFunctionTest, Arity) {
+    env::Environment env;
+    registerFunction(env, "one", 1, [](const std::vector<env::VariantType>& arguments) { return arguments[0]; });
+
+    ASSERT_THROW(run("a = one(1, 2);", env), std::runtime_error);
+}
+
+TEST(NativeFunctionTest, AssignedToVariable) {
+    env::Environment env;
+    registerFunction(env, "answer", 0, [](const std::vector<env::VariantType>&) -> env::VariantType { return 42; });
+
+    run("f = answer; a = f();", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 42);
+}
+
+TEST(NativeFunctionTest, ScriptShadowsBuiltin) {
+    env::Environment env = run("fun len(x) { return 7; } a = len([1, 2]);");
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 7);
+}
+
+#ifdef SPL_TEST_EXTENSION_PATH
+TEST(NativeFunctionTest, Extension) {
+    env::Environment env;
+    loadExtension(env, SPL_TEST_EXTENSION_PATH);
+
+    run(R"(a = twice(21); b = shout("hey"); c = countArguments(1, 2.5, "x");)", env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 42);
+    ASSERT_EQ(std::get<std::string>(env.get("b")), "hey!");
+    ASSERT_EQ(std::get<int>(env.get("c")), 3);
+
+    ASSERT_THROW(run("d = twice(true);", env), std::runtime_error);
+}
+#endif
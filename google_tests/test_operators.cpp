@@ -153,3 +153,19 @@ TEST(OperatorsTest, LessEqual) {
 TEST(OperatorsTest, Combined) {
     env::Environment env = run("b = (!(3 == 4) && true) || false;\n");
 }
+
+TEST(OperatorsTest, Precedence) {
+    test("2 + 3 * 4", 14);
+    test("(2 + 3) * 4", 20);
+    test("10 - 4 - 3", 3);
+    test("100 / 10 / 5", 2);
+    test("1 + 2 < 4 && 5 % 3 == 2", true);
+    test("!false && false", false);
+    test("!(1 < 2) || 3 * 2 >= 6", true);
+    test("len([1, 2 * 3, (4)]) * 2 + 1", 7);
+}
+
+TEST(OperatorsTest, MismatchedParentheses) {
+    EXPECT_THROW(run("a = (1 + 2;\n"), std::runtime_error);
+    EXPECT_THROW(run("a = 1 + ;\n"), std::runtime_error);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/tokenizer.h"
+#include "../interpreter/parser.h"
+
+#include <stdexcept>
+#include <variant>
+
+
+namespace {
+    ast::RootNode parse(const std::string& input) {
+        token::Tokenizer tokenizer{input};
+        Parser parser{tokenizer.getTokens()};
+
+        return parser.root();
+    }
+
+    const ast::FunctionBodyNode& bodyOf(ast::RootNode& root, size_t statement) {
+        auto* function = dynamic_cast<ast::FunctionDefNode*>(root.children()[statement].get());
+
+        if (function == nullptr) {
+            throw std::runtime_error("Statement is not a function definition");
+        }
+
+        return *function->body();
+    }
+}
+
+
+TEST(ParserTest, FunctionBodiesParsedOnFirstCall) {
+    ast::RootNode root = parse("fun f() { return 1; } fun g() { return 2; } a = f();");
+
+    ASSERT_FALSE(bodyOf(root, 0).parsed());
+    ASSERT_FALSE(bodyOf(root, 1).parsed());
+
+    env::Environment env;
+    root.eval(env);
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 1);
+    ASSERT_TRUE(bodyOf(root, 0).parsed());
+    ASSERT_FALSE(bodyOf(root, 1).parsed());
+}
+
+TEST(ParserTest, SyntaxErrorInFunctionBodyReportedOnCall) {
+    env::Environment env = run("fun broken() { return (1 + ; } a = 1;");
+    ASSERT_EQ(std::get<int>(env.get("a")), 1);
+
+    EXPECT_THROW(run("fun broken() { return (1 + ; } a = broken();"), std::runtime_error);
+}
+
+TEST(ParserTest, UnmatchedBrace) {
+    EXPECT_THROW(parse("fun f() { return 1; "), std::runtime_error);
+    EXPECT_THROW(parse("while (true) { a = 1; "), std::runtime_error);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <variant>
+
+
+namespace {
+    RunOptions limitedBy(sandbox::Limits& limits) {
+        RunOptions options;
+        options.limits = &limits;
+        return options;
+    }
+}
+
+
+TEST(SandboxTest, InfiniteLoopStops) {
+    env::Environment env;
+    sandbox::Limits limits{1000, sandbox::Limits::UNLIMITED_MEMORY};
+
+    ASSERT_THROW(run("i = 0; while (true) { i = i + 1; }", env, limitedBy(limits)), sandbox::StepLimitExceeded);
+    ASSERT_EQ(std::get<int>(env.get("i")), 1000);
+    ASSERT_EQ(limits.stepsTaken(), 1000);
+}
+
+TEST(SandboxTest, RecursionCountsSteps) {
+    env::Environment env;
+    sandbox::Limits limits{50, sandbox::Limits::UNLIMITED_MEMORY};
+
+    ASSERT_THROW(run("fun down(n) { return down(n + 1); } down(0);", env, limitedBy(limits)), sandbox::StepLimitExceeded);
+}
+
+TEST(SandboxTest, CallDepth) {
+    env::Environment env;
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, sandbox::Limits::UNLIMITED_MEMORY};
+    limits.limitCallDepth(20);
+
+    std::string count = "fun count(n) { if (n == 0) { return 0; } return count(n - 1) + 1; } ";
+    run(count + "a = count(19);", env, limitedBy(limits));
+    ASSERT_EQ(std::get<int>(env.get("a")), 19);
+
+    ASSERT_THROW(run(count + "b = count(20);", env, limitedBy(limits)), sandbox::CallDepthExceeded);
+
+    // the calls that failed are no longer counted
+    run(count + "c = count(19);", env, limitedBy(limits));
+    ASSERT_EQ(std::get<int>(env.get("c")), 19);
+}
+
+TEST(SandboxTest, YieldToHost) {
+    env::Environment env;
+    sandbox::Limits limits{100, sandbox::Limits::UNLIMITED_MEMORY};
+    int yields = 0;
+
+    // the host gets control back every 100 steps and lets the script run for three more slices
+    limits.onExhausted([&yields]() { return ++yields <= 3; });
+
+    ASSERT_THROW(run("while (true) { }", env, limitedBy(limits)), sandbox::StepLimitExceeded);
+    ASSERT_EQ(yields, 4);
+    ASSERT_EQ(limits.stepsTaken(), 400);
+
+    // finishes within the budget
+    yields = 0;
+    sandbox::Limits enough{100, sandbox::Limits::UNLIMITED_MEMORY};
+    enough.onExhausted([&yields]() { return ++yields <= 3; });
+    run("i = 0; while (i < 250) { i = i + 1; }", env, limitedBy(enough));
+    ASSERT_EQ(std::get<int>(env.get("i")), 250);
+    ASSERT_EQ(yields, 2);
+}
+
+TEST(SandboxTest, MemoryCap) {
+    env::Environment env;
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, 4096};
+
+    ASSERT_THROW(run("s = \"ab\"; while (true) { s = s + s; }", env, limitedBy(limits)), sandbox::MemoryLimitExceeded);
+    ASSERT_LE(std::get<std::string>(env.get("s")).size(), 4096);
+
+    // the environment's memory is released when the run ends
+    ASSERT_EQ(limits.memoryUsed(), 0);
+
+    ASSERT_THROW(run("t = \"ab\" * 1000000000;", env, limitedBy(limits)), sandbox::MemoryLimitExceeded);
+}
+
+TEST(SandboxTest, FunctionScopesRelease) {
+    env::Environment env;
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, 4096};
+
+    // each call's parameters are released when the call returns, so many calls fit in a small cap
+    run("fun pad(s) { return len(s + s); } i = 0; while (i < 1000) { pad(\"abcdefghijklmnop\"); i = i + 1; }",
+        env, limitedBy(limits));
+
+    ASSERT_EQ(std::get<int>(env.get("i")), 1000);
+}
+
+TEST(SandboxTest, ContainersCountAgainstMemoryCap) {
+    env::Environment env;
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, 4096};
+
+    ASSERT_THROW(run("a = [1]; while (true) { push(a, 1); }", env, limitedBy(limits)), sandbox::MemoryLimitExceeded);
+    ASSERT_LT(std::get<types::Array>(env.get("a")).size(), 1024);
+    ASSERT_EQ(limits.memoryUsed(), 0);
+
+    // what the environment already holds counts when limits are attached again
+    sandbox::Limits smaller{sandbox::Limits::UNLIMITED_STEPS, 1024};
+    ASSERT_THROW(run("b = 1;", env, limitedBy(smaller)), sandbox::MemoryLimitExceeded);
+    ASSERT_EQ(smaller.memoryUsed(), 0);
+
+    // strings stored in a dictionary nested in another one count too
+    env::Environment dictEnv;
+    sandbox::Limits dictLimits{sandbox::Limits::UNLIMITED_STEPS, 4096};
+    ASSERT_THROW(run("d = {}; inner = {}; d[\"inner\"] = inner; i = 0; while (true) { inner[i] = \"abcdefghijklmnop\"; i = i + 1; }",
+                     dictEnv, limitedBy(dictLimits)), sandbox::MemoryLimitExceeded);
+    ASSERT_LT(std::get<types::Dict>(dictEnv.get("inner")).size(), 4096 / 16);
+    ASSERT_EQ(dictLimits.memoryUsed(), 0);
+}
+
+TEST(SandboxTest, SplitCountsAgainstMemoryCap) {
+    std::string text;
+    for (int i = 0; i < 5000; i++) {
+        text += "a,";
+    }
+
+    env::Environment env;
+    env.define("text", text);
+    env.define("comma", std::string(","));
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, 64 * 1024};
+
+    ASSERT_THROW(run("parts = split(text, comma);", env, limitedBy(limits)), sandbox::MemoryLimitExceeded);
+    ASSERT_FALSE(env.has("parts"));
+    ASSERT_EQ(limits.memoryUsed(), 0);
+}
+
+TEST(SandboxTest, ForksCountWhatTheyCopy) {
+    env::Environment prelude;
+    run("table = {}; i = 0; while (i < 1000) { table[i] = i; i = i + 1; }", prelude);
+
+    // reading the table borrows it without counting its entries, and the first change copies and counts them
+    env::Environment request = prelude.fork();
+    sandbox::Limits limits{sandbox::Limits::UNLIMITED_STEPS, 4096};
+    run("x = table[1];", request, limitedBy(limits));
+    ASSERT_THROW(run("table[1] = 2;", request, limitedBy(limits)), sandbox::MemoryLimitExceeded);
+    ASSERT_EQ(std::get<int>(*std::get<types::Dict>(prelude.get("table")).find(1)), 1);
+    ASSERT_EQ(limits.memoryUsed(), 0);
+}
@@ -10,3 +10,10 @@ TEST(IfScopeTest, IfScope) {
 }
 
 // todo: write more tests, especially for functions
+
+TEST(FunctionScopeTest, ParametersShadowCaller) {
+    env::Environment env = run("fun f(n) { if (n < 1) { return 0; } return n + f(n - 1); } n = 100; a = f(4);");
+
+    ASSERT_EQ(std::get<int>(env.get("a")), 10);
+    ASSERT_EQ(std::get<int>(env.get("n")), 100);
+}
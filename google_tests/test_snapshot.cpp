@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/snapshot.h"
+#include "../interpreter/tokenizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <variant>
+
+
+namespace {
+    const std::string PRELUDE =
+        "fun fact(n) { if (n < 2) { return 1; } return n * fact(n - 1); } "
+        "fun adder(k) { fun add(x) { return x + k; } return add(1); } "
+        "twice = fact; "
+        "primes = [2, 3, 5, 7]; alias = primes; "
+        "names = {\"one\": 1, 2: \"two\"}; nested = {\"names\": names, \"again\": names}; "
+        "greeting = \"hello\"; ratio = 0.5; flag = true; huge = fact(25);";
+}
+
+
+TEST(SnapshotTest, RoundTrip) {
+    env::Environment original;
+    run(PRELUDE, original);
+
+    env::Environment restored;
+    snapshot::restore(restored, snapshot::save(original));
+
+    run("a = fact(5); b = twice(6); c = adder(2); alias[0] = 11; first = primes[0]; "
+        "inner = nested[\"names\"]; inner[\"one\"] = 10; again = nested[\"again\"]; same = again[\"one\"]; "
+        "big = huge / fact(20);", restored);
+
+    ASSERT_EQ(std::get<int>(restored.get("a")), 120);
+    ASSERT_EQ(std::get<int>(restored.get("b")), 720);
+    ASSERT_EQ(std::get<int>(restored.get("c")), 3);
+    ASSERT_EQ(std::get<int>(restored.get("first")), 11);  // alias and primes still share storage
+    ASSERT_EQ(std::get<int>(restored.get("same")), 10);  // names is stored once and shared
+    ASSERT_EQ(std::get<int>(restored.get("big")), 6375600);
+    ASSERT_EQ(types::stringView(restored.get("greeting")), "hello");
+    ASSERT_FLOAT_EQ(std::get<float>(restored.get("ratio")), 0.5f);
+    ASSERT_TRUE(std::get<bool>(restored.get("flag")));
+
+    // the original is unaffected
+    ASSERT_EQ(std::get<types::Array>(original.get("primes")).ints()[0], 2);
+}
+
+TEST(SnapshotTest, SameSnapshot) {
+    env::Environment first;
+    env::Environment second;
+    run(PRELUDE, first);
+    run(PRELUDE, second);
+
+    ASSERT_EQ(snapshot::save(first), snapshot::save(second));
+}
+
+TEST(SnapshotTest, MappedFile) {
+    env::Environment original;
+    run(PRELUDE, original);
+
+    std::string path = testing::TempDir() + "spl_snapshot.bin";
+    snapshot::saveFile(original, path);
+
+    env::Environment restored;
+    snapshot::restoreFile(restored, path);
+    run("message = greeting + \"there\"; r = fact(4);", restored);
+
+    // strings point into the mapped file
+    ASSERT_TRUE(std::holds_alternative<types::StringSlice>(restored.get("greeting")));
+    ASSERT_EQ(types::stringView(restored.get("message")), "hellothere");
+    ASSERT_EQ(std::get<int>(restored.get("r")), 24);
+}
+
+TEST(SnapshotTest, NativeFunctionsSkipped) {
+    env::Environment original;
+    registerFunction(original, "answer", 0, [](const std::vector<env::VariantType>&) -> env::VariantType { return 42; });
+    run("x = 1; d = {\"f\": answer, \"g\": 2};", original);
+
+    env::Environment restored;
+    snapshot::restore(restored, snapshot::save(original));
+
+    ASSERT_FALSE(restored.has("answer"));
+    ASSERT_EQ(std::get<types::Dict>(restored.get("d")).size(), 1);
+    ASSERT_EQ(std::get<int>(restored.get("x")), 1);
+}
+
+TEST(SnapshotTest, EmptyArrays) {
+    env::Environment original;
+    original.define("ints", types::Array{std::vector<int>{}});
+    original.define("floats", types::Array{std::vector<float>{}});
+
+    env::Environment restored;
+    snapshot::restore(restored, snapshot::save(original));
+
+    ASSERT_EQ(restored.get("ints"), env::VariantType(types::Array{std::vector<int>{}}));
+    ASSERT_EQ(restored.get("floats"), env::VariantType(types::Array{std::vector<float>{}}));
+}
+
+TEST(SnapshotTest, CorruptSnapshot) {
+    env::Environment original;
+    run(PRELUDE, original);
+    std::string data = snapshot::save(original);
+
+    env::Environment restored;
+    ASSERT_THROW(snapshot::restore(restored, std::string_view(data).substr(0, data.size() - 3)), std::runtime_error);
+    ASSERT_THROW(snapshot::restore(restored, "not a snapshot"), std::runtime_error);
+    ASSERT_FALSE(restored.has("fact"));
+    ASSERT_FALSE(restored.has("greeting"));
+}
+
+TEST(SnapshotTest, OutOfRangeTypes) {
+    env::Environment original;
+    run(PRELUDE, original);
+    std::string data = snapshot::save(original);
+
+    // the type of the first token, after the magic number, the version and the token count
+    std::string badToken = data;
+    badToken[8 + 2 * sizeof(uint32_t)] = static_cast<char>(token::TOKEN_TYPE_COUNT);
+
+    env::Environment restored;
+    ASSERT_THROW(snapshot::restore(restored, badToken), std::runtime_error);
+
+    // the element type is the first byte where the snapshots of an int and a float array differ
+    env::Environment ints;
+    env::Environment floats;
+    run("a = [1, 2];", ints);
+    run("a = [1.0, 2.0];", floats);
+    std::string intData = snapshot::save(ints);
+    std::string floatData = snapshot::save(floats);
+    size_t elementType = std::mismatch(intData.begin(), intData.end(), floatData.begin()).first - intData.begin();
+
+    intData[elementType] = 7;
+    ASSERT_THROW(snapshot::restore(restored, intData), std::runtime_error);
+}
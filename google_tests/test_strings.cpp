@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+
+namespace {
+    /**
+     * Runs a program with the tree walker and with the flat evaluator, with and without type inference.
+     */
+    template <typename Check>
+    void runEverywhere(const std::string& input, const std::string& text, Check check) {
+        for (bool flatten : {false, true}) {
+            for (bool inferTypes : {false, true}) {
+                env::Environment env;
+                env.define("text", types::StringSlice::owning(text));
+                env.define("comma", std::string(","));
+
+                RunOptions options;
+                options.flatten = flatten;
+                options.inferTypes = inferTypes;
+
+                run(input, env, options);
+                check(env);
+            }
+        }
+    }
+
+    /**
+     * A buffer that records when it is freed.
+     */
+    class TrackedBuffer : public types::StringBuffer {
+    public:
+        TrackedBuffer(std::string text, bool& freed) : text(std::move(text)), freed(freed) {}
+
+        ~TrackedBuffer() override {
+            freed = true;
+        }
+
+        [[nodiscard]] std::string_view view() const override {
+            return text;
+        }
+
+    private:
+        std::string text;
+        bool& freed;
+    };
+
+    std::string_view viewOf(const env::Environment& env, const std::string& name) {
+        return std::get<types::StringSlice>(env.get(name)).view();
+    }
+}
+
+
+TEST(StringsTest, SubstrSharesBuffer) {
+    env::Environment env;
+    env.define("text", types::StringSlice::owning("hello world"));
+
+    run("word = substr(text, 6, 5); middle = substr(word, 1, 3); empty = substr(text, 11, 0);", env);
+
+    std::string_view text = viewOf(env, "text");
+    ASSERT_EQ(viewOf(env, "word"), "world");
+    ASSERT_EQ(viewOf(env, "middle"), "orl");
+    ASSERT_EQ(viewOf(env, "empty"), "");
+
+    // both slices point into the characters of text instead of holding copies
+    ASSERT_EQ(viewOf(env, "word").data(), text.data() + 6);
+    ASSERT_EQ(viewOf(env, "middle").data(), text.data() + 7);
+}
+
+TEST(StringsTest, SubstrOfString) {
+    runEverywhere(
+        "s = \"abcdef\"; t = substr(s, 2, 3); u = substr(t, 1, 1); n = len(t) + len(u); same = t == \"cde\";", "",
+        [](env::Environment& env) {
+            ASSERT_EQ(viewOf(env, "t"), "cde");
+            ASSERT_EQ(viewOf(env, "u"), "d");
+            ASSERT_EQ(std::get<int>(env.get("n")), 4);
+            ASSERT_TRUE(std::get<bool>(env.get("same")));
+            ASSERT_EQ(std::get<std::string>(env.get("s")), "abcdef");
+        });
+}
+
+TEST(StringsTest, Find) {
+    runEverywhere(
+        "a = find(text, \"c\"); b = find(text, \"c\", 3); c = find(text, \"x\"); d = find(text, \"\", 6); "
+        "e = find(text, \"bc\", 100);",
+        "abcabc",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("a")), 2);
+            ASSERT_EQ(std::get<int>(env.get("b")), 5);
+            ASSERT_EQ(std::get<int>(env.get("c")), -1);
+            ASSERT_EQ(std::get<int>(env.get("d")), 6);
+            ASSERT_EQ(std::get<int>(env.get("e")), -1);
+        });
+}
+
+TEST(StringsTest, Split) {
+    runEverywhere(
+        "parts = split(text, comma); n = len(parts); first = parts[0]; empty = parts[2]; last = parts[4]; "
+        "total = 0; for (i in 0..n) { total += len(parts[i]); } "
+        "whole = split(text, \"x\"); wholeCount = len(whole);",
+        "ab,cd,,efg,",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("n")), 5);
+            ASSERT_EQ(viewOf(env, "first"), "ab");
+            ASSERT_EQ(viewOf(env, "empty"), "");
+            ASSERT_EQ(viewOf(env, "last"), "");
+            ASSERT_EQ(std::get<int>(env.get("total")), 7);
+            ASSERT_EQ(std::get<int>(env.get("wholeCount")), 1);
+
+            // the pieces are slices of text
+            ASSERT_EQ(viewOf(env, "first").data(), viewOf(env, "text").data());
+        });
+}
+
+TEST(StringsTest, ParsingLoop) {
+    runEverywhere(
+        "count = 0; position = 0; "
+        "while (position < len(text)) { "
+        "    next = find(text, comma, position); "
+        "    if (next == 0 - 1) { next = len(text); } "
+        "    word = substr(text, position, next - position); "
+        "    if (word == \"key\") { count += 1; } "
+        "    position = next + 1; "
+        "}",
+        "key,value,key,other,key",
+        [](env::Environment& env) {
+            ASSERT_EQ(std::get<int>(env.get("count")), 3);
+            ASSERT_EQ(viewOf(env, "word"), "key");
+        });
+}
+
+TEST(StringsTest, CompactsSliceOfLargeBuffer) {
+    bool freed = false;
+    std::string contents(1 << 20, 'x');
+    contents.replace(10, 5, "hello");
+
+    env::Environment env;
+    env.define("load", types::NativeFunction{"load", 0, [&](const std::vector<env::VariantType>&) -> env::VariantType {
+        return types::StringSlice{std::make_shared<TrackedBuffer>(contents, freed)};
+    }});
+
+    // nothing else uses the buffer once the slice is stored, so the slice is copied out and the buffer freed
+    run("word = substr(load(), 10, 5);", env);
+    ASSERT_TRUE(freed);
+    ASSERT_EQ(viewOf(env, "word"), "hello");
+
+    // while the whole text is still in a variable, the slice shares its buffer
+    freed = false;
+    run("text = load(); word = substr(text, 10, 5);", env);
+    ASSERT_FALSE(freed);
+    ASSERT_EQ(viewOf(env, "word").data(), viewOf(env, "text").data() + 10);
+
+    // once the text is released, only the short slice uses the buffer, so it is copied out
+    run("text = 0;", env);
+    ASSERT_TRUE(freed);
+    ASSERT_EQ(viewOf(env, "word"), "hello");
+
+    // split pieces share the buffer while one of them holds most of it, and are copied out once it is removed
+    freed = false;
+    run("text = load(); parts = split(text, \"hello\"); text = 0;", env);
+    ASSERT_FALSE(freed);
+    run("remove(parts, 1);", env);
+    ASSERT_TRUE(freed);
+    ASSERT_EQ(std::get<types::StringSlice>(*std::get<types::Dict>(env.get("parts")).find(0)).view(), std::string(10, 'x'));
+
+    // releasing the dictionary that held the pieces leaves the buffer to the piece in a variable
+    freed = false;
+    run("parts = split(load(), \"hello\"); first = parts[0]; parts = 0;", env);
+    ASSERT_TRUE(freed);
+    ASSERT_EQ(viewOf(env, "first"), std::string(10, 'x'));
+
+    // a large slice is worth its buffer, so it is not copied
+    freed = false;
+    run("text = 0; half = substr(load(), 0, 600000);", env);
+    ASSERT_FALSE(freed);
+    ASSERT_EQ(viewOf(env, "half").size(), 600000);
+}
+
+TEST(StringsTest, LongStringsStoredAsSlices) {
+    env::Environment env;
+    env.define("text", std::string(10000, 'a'));
+    env.define("short", std::string("abcdef"));
+
+    // reading and slicing the long string share its buffer; a short one is copied
+    run("word = substr(text, 5, 3); part = substr(short, 1, 2); copy = text;", env);
+    ASSERT_EQ(viewOf(env, "word").data(), viewOf(env, "text").data() + 5);
+    ASSERT_EQ(viewOf(env, "copy").data(), viewOf(env, "text").data());
+    ASSERT_EQ(viewOf(env, "part"), "bc");
+    ASSERT_TRUE(std::holds_alternative<std::string>(env.get("short")));
+
+    // appending turns it back into a string of its own, leaving the copy as it was
+    run("text += \"b\"; n = len(text); m = len(copy);", env);
+    ASSERT_EQ(std::get<std::string>(env.get("text")).size(), 10001);
+    ASSERT_EQ(std::get<int>(env.get("n")), 10001);
+    ASSERT_EQ(std::get<int>(env.get("m")), 10000);
+}
+
+TEST(StringsTest, WastesBuffer) {
+    env::VariantType value = types::StringSlice::owning(std::string(1 << 16, 'a')).substr(5, 10);
+    ASSERT_TRUE(std::get<types::StringSlice>(value).wastesBuffer());
+
+    types::compact(value);
+    ASSERT_FALSE(std::get<types::StringSlice>(value).wastesBuffer());
+    ASSERT_EQ(std::get<types::StringSlice>(value).view(), std::string(10, 'a'));
+
+    // small buffers are never worth copying out of
+    env::VariantType small = types::StringSlice::owning("abcdef").substr(1, 1);
+    ASSERT_FALSE(std::get<types::StringSlice>(small).wastesBuffer());
+}
+
+TEST(StringsTest, Errors) {
+    env::Environment env;
+    env.define("text", types::StringSlice::owning("abc"));
+
+    ASSERT_THROW(run("a = substr(text, 2, 2);", env), std::runtime_error);
+    ASSERT_THROW(run("a = substr(text, 4, 0);", env), std::runtime_error);
+    ASSERT_THROW(run("a = substr(text, 0 - 1, 1);", env), std::runtime_error);
+    ASSERT_THROW(run("a = substr(1, 0, 1);", env), std::runtime_error);
+    ASSERT_THROW(run("a = find(text);", env), std::runtime_error);
+    ASSERT_THROW(run("a = find(text, 1);", env), std::runtime_error);
+    ASSERT_THROW(run("a = split(text, \"\");", env), std::runtime_error);
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include "../spl.h"
+#include "../interpreter/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+namespace {
+    class TraceTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            trace::clear();
+            trace::enable();
+        }
+
+        void TearDown() override {
+            trace::disable();
+            trace::clear();
+        }
+
+        /**
+         * @return The threads that recorded anything since the test started
+         */
+        static std::vector<trace::Thread> recorded() {
+            std::vector<trace::Thread> threads = trace::decode(trace::save());
+
+            threads.erase(std::remove_if(threads.begin(), threads.end(), [](const trace::Thread& thread) {
+                return thread.records.empty();
+            }), threads.end());
+
+            return threads;
+        }
+
+        static size_t count(const trace::Thread& thread, trace::Event event) {
+            return std::count_if(thread.records.begin(), thread.records.end(), [event](const trace::Record& record) {
+                return record.event == event;
+            });
+        }
+
+        static std::string readFile(const std::string& path) {
+            std::ifstream file{path, std::ios::binary};
+            std::stringstream contents;
+            contents << file.rdbuf();
+
+            return contents.str();
+        }
+    };
+
+    const std::string PROGRAM =
+        "fun next(x) { return x + 1; }\n"
+        "i = 0;\n"
+        "while (i < 3) { i = next(i); }";
+
+    const std::string FAILING =
+        "a = 1;\n"
+        "fun broken() { return 1 / 0; }\n"
+        "b = broken();";
+}
+
+
+TEST_F(TraceTest, RecordsStatementsCallsAndIterations) {
+    for (bool flatten : {false, true}) {
+        trace::clear();
+
+        RunOptions options;
+        options.flatten = flatten;
+
+        env::Environment env;
+        run(PROGRAM, env, options);
+
+        std::vector<trace::Thread> threads = recorded();
+        ASSERT_EQ(threads.size(), 1);
+
+        const trace::Thread& thread = threads[0];
+        ASSERT_EQ(thread.recorded, thread.records.size());
+        ASSERT_EQ(count(thread, trace::Event::ITERATION), 3);
+        ASSERT_EQ(count(thread, trace::Event::CALL), 3);
+        ASSERT_EQ(count(thread, trace::Event::RETURN), 3);
+        ASSERT_EQ(count(thread, trace::Event::ERROR), 0);
+
+        // the statements of the program, then of the loop body and the function on every iteration
+        ASSERT_EQ(count(thread, trace::Event::STATEMENT), 3 + 3 * 2);
+        ASSERT_EQ(thread.records[0].event, trace::Event::STATEMENT);
+        ASSERT_EQ(thread.records[1].line, thread.records[0].line + 1);  // i = 0, located at i
+        ASSERT_EQ(thread.records[3].event, trace::Event::ITERATION);
+        ASSERT_EQ(thread.records[3].line, thread.records[2].line);
+    }
+}
+
+TEST_F(TraceTest, RecordsErrorsWhereTheyUnwind) {
+    for (bool flatten : {false, true}) {
+        trace::clear();
+
+        RunOptions options;
+        options.flatten = flatten;
+
+        env::Environment env;
+        ASSERT_THROW(run(FAILING, env, options), std::runtime_error);
+
+        std::vector<trace::Thread> threads = recorded();
+        ASSERT_EQ(threads.size(), 1);
+
+        const std::vector<trace::Record>& records = threads[0].records;
+        ASSERT_GE(records.size(), 2);
+        ASSERT_EQ(count(threads[0], trace::Event::RETURN), 0);
+
+        // the return statement inside the function first, then the declaration that called it
+        const trace::Record& inner = records[records.size() - 2];
+        const trace::Record& outer = records[records.size() - 1];
+        ASSERT_EQ(inner.event, trace::Event::ERROR);
+        ASSERT_EQ(outer.event, trace::Event::ERROR);
+        ASSERT_EQ(inner.line + 1, outer.line);
+    }
+}
+
+TEST_F(TraceTest, KeepsTheMostRecentEvents) {
+    run("i = 0; while (i < 10000) { i = i + 1; }");
+
+    std::vector<trace::Thread> threads = recorded();
+    ASSERT_EQ(threads.size(), 1);
+    ASSERT_GT(threads[0].recorded, threads[0].records.size());
+    ASSERT_EQ(threads[0].records.back().event, trace::Event::STATEMENT);
+}
+
+TEST_F(TraceTest, DisabledRecordsNothing) {
+    trace::disable();
+    run(PROGRAM);
+
+    ASSERT_TRUE(recorded().empty());
+}
+
+TEST_F(TraceTest, RecordsEachThreadSeparately) {
+    std::vector<std::thread> threads;
+    std::atomic<int> finished{0};
+
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&finished]() {
+            run(PROGRAM);
+            finished++;
+
+            // a thread that exits hands its buffer to the next thread, so keep them all alive until all have run
+            while (finished < 4) {
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<trace::Thread> traced = recorded();
+    ASSERT_EQ(traced.size(), 4);
+
+    for (const trace::Thread& thread : traced) {
+        ASSERT_EQ(count(thread, trace::Event::CALL), 3);
+    }
+}
+
+TEST_F(TraceTest, SavesOnError) {
+    std::string path = testing::TempDir() + "spl_trace_on_error";
+
+    RunOptions options;
+    options.traceOnError = path;
+
+    env::Environment env;
+    ASSERT_THROW(run(FAILING, env, options), std::runtime_error);
+
+    std::vector<trace::Thread> threads = trace::decode(readFile(path));
+    std::remove(path.c_str());
+
+    ASSERT_FALSE(threads.empty());
+    ASSERT_NE(trace::format(threads).find("error at line"), std::string::npos);
+}
+
+TEST_F(TraceTest, DumpsOnSignal) {
+    std::string path = testing::TempDir() + "spl_trace_on_signal";
+    trace::dumpOnSignal(SIGUSR1, path);
+
+    run(PROGRAM);
+    std::raise(SIGUSR1);
+    std::signal(SIGUSR1, SIG_DFL);
+
+    std::vector<trace::Thread> threads = trace::decode(readFile(path));
+    std::remove(path.c_str());
+
+    ASSERT_FALSE(threads.empty());
+}
+
+TEST_F(TraceTest, RejectsInvalidTraces) {
+    ASSERT_THROW(trace::decode("not a trace"), std::runtime_error);
+
+    std::string saved = trace::save();
+    ASSERT_THROW(trace::decode(std::string_view{saved}.substr(0, saved.size() - 1)), std::runtime_error);
+}
@@ -0,0 +1,178 @@
+#include "array.h"
+#include "sandbox.h"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+namespace {
+    // ints and floats take the same space, so promoting an array doesn't change what it counts against limits
+    constexpr size_t ELEMENT_BYTES = sizeof(int);
+    static_assert(sizeof(float) == ELEMENT_BYTES);
+}
+
+
+types::Array::Cell::Cell(std::shared_ptr<Storage> storage) : storage(std::move(storage)) {}
+
+types::Array::Cell::~Cell() {
+    if (account != nullptr) {
+        account->refund(charged);
+    }
+}
+
+types::Array::Array(ElementType type)
+    : cell(std::make_shared<Cell>(std::make_shared<Storage>(Storage{type, {}, {}}))) {}
+
+types::Array::Array(std::vector<int> values)
+    : cell(std::make_shared<Cell>(std::make_shared<Storage>(Storage{ElementType::INT, std::move(values), {}}))) {}
+
+types::Array::Array(std::vector<float> values)
+    : cell(std::make_shared<Cell>(std::make_shared<Storage>(Storage{ElementType::FLOAT, {}, std::move(values)}))) {}
+
+types::ElementType types::Array::elementType() const {
+    return cell->storage->type;
+}
+
+size_t types::Array::size() const {
+    const Storage& storage = *cell->storage;
+    return storage.type == ElementType::INT ? storage.ints.size() : storage.floats.size();
+}
+
+const std::vector<int>& types::Array::ints() const {
+    return cell->storage->ints;
+}
+
+const std::vector<float>& types::Array::floats() const {
+    return cell->storage->floats;
+}
+
+std::vector<int>& types::Array::mutableInts() {
+    return writable().ints;
+}
+
+std::vector<float>& types::Array::mutableFloats() {
+    return writable().floats;
+}
+
+void types::Array::push(int value) {
+    Storage& storage = writable();
+    recharge((size() + 1) * ELEMENT_BYTES);
+
+    if (storage.type == ElementType::FLOAT) {
+        storage.floats.push_back(static_cast<float>(value));
+    } else {
+        storage.ints.push_back(value);
+    }
+}
+
+void types::Array::push(float value) {
+    promote();
+    Storage& storage = writable();
+    recharge((size() + 1) * ELEMENT_BYTES);
+
+    storage.floats.push_back(value);
+}
+
+void types::Array::set(size_t index, int value) {
+    checkIndex(index);
+    Storage& storage = writable();
+
+    if (storage.type == ElementType::FLOAT) {
+        storage.floats[index] = static_cast<float>(value);
+    } else {
+        storage.ints[index] = value;
+    }
+}
+
+void types::Array::set(size_t index, float value) {
+    checkIndex(index);
+    promote();
+
+    writable().floats[index] = value;
+}
+
+void types::Array::promote() {
+    if (cell->storage->type == ElementType::FLOAT) {
+        return;
+    }
+
+    Storage& storage = writable();
+    storage.floats.assign(storage.ints.begin(), storage.ints.end());
+    storage.ints.clear();
+    storage.ints.shrink_to_fit();
+    storage.type = ElementType::FLOAT;
+}
+
+types::Array types::Array::clone() const {
+    if (cell->storage->type == ElementType::FLOAT) {
+        return Array{cell->storage->floats};
+    }
+
+    return Array{cell->storage->ints};
+}
+
+types::Array types::Array::borrow() const {
+    Array borrowed;
+    borrowed.cell->storage = cell->storage;
+
+    return borrowed;
+}
+
+void types::Array::attach(const std::shared_ptr<sandbox::Account>& account) const {
+    if (cell->account == account || (cell->account != nullptr && cell->account->isOpen())) {
+        return;
+    }
+
+    // whatever a closed account counted is already released
+    cell->account = account;
+    cell->charged = 0;
+
+    // the elements of a borrowed array are counted by the array that owns them until they are copied
+    recharge(cell->storage.use_count() > 1 ? 0 : size() * ELEMENT_BYTES);
+}
+
+const void* types::Array::identity() const {
+    return cell.get();
+}
+
+bool types::Array::operator==(const Array& other) const {
+    const Storage& storage = *cell->storage;
+    const Storage& otherStorage = *other.cell->storage;
+
+    if (storage.type != otherStorage.type) {
+        return false;
+    }
+
+    return storage.type == ElementType::INT ? storage.ints == otherStorage.ints : storage.floats == otherStorage.floats;
+}
+
+types::Array::Storage& types::Array::writable() {
+    // only cells own storage, so a count above one means a borrowed array still shares it
+    if (cell->storage.use_count() > 1) {
+        recharge(size() * ELEMENT_BYTES);
+        cell->storage = std::make_shared<Storage>(*cell->storage);
+    }
+
+    return *cell->storage;
+}
+
+void types::Array::recharge(size_t bytes) const {
+    if (cell->account == nullptr) {
+        return;
+    }
+
+    if (bytes > cell->charged) {
+        cell->account->charge(bytes - cell->charged);
+    } else {
+        cell->account->refund(cell->charged - bytes);
+    }
+
+    cell->charged = bytes;
+}
+
+void types::Array::checkIndex(size_t index) const {
+    if (index >= size()) {
+        throw std::runtime_error("Array index " + std::to_string(index) + " out of range for array of size " + std::to_string(size()));
+    }
+}
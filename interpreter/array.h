@@ -0,0 +1,143 @@
+#ifndef SPL_ARRAY_H
+#define SPL_ARRAY_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace sandbox {
+    class Account;
+}
+
+namespace types {
+    /**
+     * The type of the elements stored in an array. An array always stores its elements contiguously as one of these
+     * types so the bulk builtins can run over raw memory.
+     */
+    enum class ElementType {
+        INT,
+        FLOAT
+    };
+
+    /**
+     * A growable array of ints or floats. Arrays have reference semantics: copying an Array (e.g., by assigning it to
+     * another variable or passing it to a function) shares the underlying storage.
+     *
+     * An int array is promoted to a float array when a float is stored in it.
+     *
+     * A borrowed array (see borrow) is a separate array that shares the elements of the original until either of them
+     * is changed; the one that changes copies the elements first.
+     */
+    class Array {
+    public:
+        explicit Array(ElementType type = ElementType::INT);
+        explicit Array(std::vector<int> values);
+        explicit Array(std::vector<float> values);
+
+        [[nodiscard]] ElementType elementType() const;
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @return The int storage. Only valid if elementType() is ElementType::INT
+         */
+        [[nodiscard]] const std::vector<int>& ints() const;
+
+        /**
+         * @return The float storage. Only valid if elementType() is ElementType::FLOAT
+         */
+        [[nodiscard]] const std::vector<float>& floats() const;
+
+        /**
+         * @return The int storage for changing the elements in place, copied first if it is shared with a borrowed
+         * array. Only valid if elementType() is ElementType::INT
+         */
+        [[nodiscard]] std::vector<int>& mutableInts();
+
+        /**
+         * @return The float storage for changing the elements in place (see mutableInts). Only valid if elementType()
+         * is ElementType::FLOAT
+         */
+        [[nodiscard]] std::vector<float>& mutableFloats();
+
+        void push(int value);
+        void push(float value);
+
+        /**
+         * Sets the element at the given index.
+         * @throws std::runtime_error if the index is out of range
+         */
+        void set(size_t index, int value);
+        void set(size_t index, float value);
+
+        /**
+         * Converts an int array into a float array. Does nothing if the array already stores floats.
+         */
+        void promote();
+
+        /**
+         * @return A new array with its own copy of the elements
+         */
+        [[nodiscard]] Array clone() const;
+
+        /**
+         * @return A new array with the same elements, which are only copied when this array or the new one is changed.
+         * Takes constant time
+         */
+        [[nodiscard]] Array borrow() const;
+
+        /**
+         * Counts the elements against the account, and the elements added later as they are added (see
+         * env::Environment::attachLimits). Elements still shared with a borrowed array are counted once one of them
+         * copies them. Does nothing if the array is already counted against an open account.
+         * @throws sandbox::MemoryLimitExceeded if the elements don't fit
+         */
+        void attach(const std::shared_ptr<sandbox::Account>& account) const;
+
+        /**
+         * @return An address that identifies the shared storage. Copies of an array have the same identity
+         */
+        [[nodiscard]] const void* identity() const;
+
+        /**
+         * Two arrays are equal if they hold the same element type and the same elements.
+         */
+        bool operator==(const Array& other) const;
+
+    private:
+        struct Storage {
+            ElementType type;
+            std::vector<int> ints;
+            std::vector<float> floats;
+        };
+
+        /**
+         * Copies of an array share its cell. Borrowed arrays have cells of their own that point to the same storage.
+         */
+        struct Cell {
+            explicit Cell(std::shared_ptr<Storage> storage);
+            ~Cell();
+
+            std::shared_ptr<Storage> storage;
+            std::shared_ptr<sandbox::Account> account;  // nullptr if the array is not counted against limits
+            size_t charged = 0;  // the bytes of the storage counted against the account
+        };
+
+        /**
+         * @return The storage, copied first if another cell shares it
+         * @throws sandbox::MemoryLimitExceeded if the copy does not fit
+         */
+        Storage& writable();
+
+        /**
+         * Counts the given number of bytes against the account in place of what was counted before.
+         * @throws sandbox::MemoryLimitExceeded if they don't fit. Nothing changes in that case
+         */
+        void recharge(size_t bytes) const;
+
+        void checkIndex(size_t index) const;
+
+        std::shared_ptr<Cell> cell;
+    };
+}
+
+#endif  // SPL_ARRAY_H
@@ -1,10 +1,118 @@
 #include "ast.h"
 #include "control_flow.h"
+#include "builtins.h"
+#include "memo.h"
+#include "sandbox.h"
+#include "parser.h"
+#include "trace.h"
 
 #include <stdexcept>
 #include <utility>
 #include <memory>
 #include <cmath>
+#include <climits>
+
+
+namespace {
+    /**
+     * Records an event at the position of a statement. Declarations have no token of their own, so they are recorded
+     * at the variable they assign.
+     */
+    void traceStatement(trace::Event event, const std::shared_ptr<ast::ASTNode>& statement) {
+        if (!trace::enabled()) {
+            return;
+        }
+
+        const token::Token& at = statement->token().type() == token::TokenType::INVALID && !statement->children().empty()
+                                 ? statement->children()[0]->token() : statement->token();
+
+        trace::record(event, static_cast<int32_t>(at.line()), static_cast<int32_t>(at.column()));
+    }
+
+    /**
+     * Checks that an evaluated index can be used to index an array.
+     */
+    size_t toArrayIndex(const env::VariantType& index) {
+        if (!std::holds_alternative<int>(index)) {
+            throw std::runtime_error("Array index must be an int");
+        }
+
+        if (std::get<int>(index) < 0) {
+            throw std::runtime_error("Array index must not be negative");
+        }
+
+        return static_cast<size_t>(std::get<int>(index));
+    }
+
+    /**
+     * Arithmetic and comparisons where an operand is a big int, or where int arithmetic overflowed.
+     */
+    env::VariantType bigIntegerOperation(token::TokenType operation, const types::BigInt& left, const types::BigInt& right) {
+        switch (operation) {
+            case token::TokenType::OPERATOR_ADD:
+                return types::normalize(types::BigInt::add(left, right));
+            case token::TokenType::OPERATOR_SUB:
+                return types::normalize(types::BigInt::subtract(left, right));
+            case token::TokenType::OPERATOR_MUL:
+                return types::normalize(types::BigInt::multiply(left, right));
+            case token::TokenType::OPERATOR_DIV:
+                return types::normalize(types::BigInt::divide(left, right));
+            case token::TokenType::OPERATOR_MOD:
+                return types::normalize(types::BigInt::remainder(left, right));
+            case token::TokenType::OPERATOR_EQ:
+                return left.compare(right) == 0;
+            case token::TokenType::OPERATOR_NOT_EQ:
+                return left.compare(right) != 0;
+            case token::TokenType::OPERATOR_LESS:
+                return left.compare(right) < 0;
+            case token::TokenType::OPERATOR_LESS_EQ:
+                return left.compare(right) <= 0;
+            case token::TokenType::OPERATOR_GREATER:
+                return left.compare(right) > 0;
+            case token::TokenType::OPERATOR_GREATER_EQ:
+                return left.compare(right) >= 0;
+            default:
+                throw std::runtime_error("Invalid types for operation");
+        }
+    }
+
+    /**
+     * Checks that repeating a string fits under the memory cap before building it.
+     */
+    void reserveRepeat(const env::Environment& env, std::string_view text, int count) {
+        if (env.limits() != nullptr && count > 0) {
+            // in 64 bits so large counts can't wrap around
+            uint64_t bytes = static_cast<uint64_t>(text.size()) * static_cast<uint64_t>(count);
+            env.limits()->reserve(bytes > SIZE_MAX ? SIZE_MAX : static_cast<size_t>(bytes));
+        }
+    }
+
+    /**
+     * Thrown when a variable read by a typed expression does not hold the type the inference pass proved for it.
+     * Caught by TypedExpressionNode::eval, which then evaluates the expression dynamically.
+     */
+    struct TypeGuardFailure {};
+
+    template <typename T>
+    bool compareValues(token::TokenType operation, T left, T right) {
+        switch (operation) {
+            case token::TokenType::OPERATOR_EQ:
+                return left == right;
+            case token::TokenType::OPERATOR_NOT_EQ:
+                return left != right;
+            case token::TokenType::OPERATOR_LESS:
+                return left < right;
+            case token::TokenType::OPERATOR_LESS_EQ:
+                return left <= right;
+            case token::TokenType::OPERATOR_GREATER:
+                return left > right;
+            case token::TokenType::OPERATOR_GREATER_EQ:
+                return left >= right;
+            default:
+                throw std::runtime_error("Unexpected token when evaluating typed comparison");
+        }
+    }
+}
 
 const token::Token& ast::ASTNode::token() const {
     return nodeToken;
@@ -29,7 +137,14 @@ ast::ASTNode::ASTNode(const token::Token& token, std::vector<std::shared_ptr<AST
 
 env::VariantType ast::RootNode::eval(env::Environment& env) const {
     for (const std::shared_ptr<ast::ASTNode>& child : nodeChildren) {
-        child->eval(env);
+        traceStatement(trace::Event::STATEMENT, child);
+
+        try {
+            child->eval(env);
+        } catch (const std::runtime_error&) {
+            traceStatement(trace::Event::ERROR, child);
+            throw;
+        }
     }
 
     return {};
@@ -44,7 +159,7 @@ env::VariantType ast::DeclarationNode::eval(env::Environment& env) const {
     token::Token identifier = nodeChildren[0]->token();
     env::VariantType value = nodeChildren[1]->eval(env);
 
-    env.set(identifier.value(), value);
+    env.set(identifier.value(), std::move(value));
 
     return {};
 }
@@ -52,6 +167,39 @@ env::VariantType ast::DeclarationNode::eval(env::Environment& env) const {
 ast::DeclarationNode::DeclarationNode(std::vector<std::shared_ptr<ASTNode>> children)
     : ASTNode(token::Token(), std::move(children)) {}
 
+ast::CompoundAssignmentNode::CompoundAssignmentNode(std::vector<std::shared_ptr<ASTNode>> children)
+    : DeclarationNode(std::move(children)) {}
+
+env::VariantType ast::CompoundAssignmentNode::eval(env::Environment& env) const {
+    const std::string& name = nodeChildren[0]->token().value();
+    ASTNode& operation = *nodeChildren[1];  // name <operator> operand, possibly specialized by type inference
+    token::TokenType type = operation.token().type();
+    env::VariantType operand = operation.children()[1]->eval(env);
+
+    if (type == token::TokenType::OPERATOR_ADD && types::isString(operand) && env.append(name, types::stringView(operand))) {
+        return {};
+    }
+
+    env::VariantType* variable = env.assignable(name);
+
+    if (variable != nullptr && (std::holds_alternative<int>(*variable) || std::holds_alternative<float>(*variable))) {
+        env::VariantType result = ExpressionNode::applyOperator(type, *variable, std::move(operand), env);
+
+        // a big int is counted against the memory limits, so it is assigned normally
+        if (std::holds_alternative<int>(result) || std::holds_alternative<float>(result)) {
+            *variable = result;
+            return {};
+        }
+
+        env.set(name, std::move(result));
+        return {};
+    }
+
+    env.set(name, ExpressionNode::applyOperator(type, env.get(name), std::move(operand), env));
+
+    return {};
+}
+
 env::VariantType ast::IfNode::eval(env::Environment& env) const {
     bool foundTrueCondition = false;
 
@@ -80,7 +228,7 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
             case token::TokenType::IDENTIFIER:
                 return env.get(nodeToken.value());
             case token::TokenType::LITERAL_INT:
-                return std::stoi(nodeToken.value());
+                return types::parseInteger(nodeToken.value());
             case token::TokenType::LITERAL_FLOAT:
                 return std::stof(nodeToken.value());
             case token::TokenType::LITERAL_BOOL:
@@ -103,6 +251,64 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
     env::VariantType left = nodeChildren[0]->eval(env);
     env::VariantType right = nodeChildren[1]->eval(env);
 
+    return applyOperator(nodeToken.type(), std::move(left), std::move(right), env);
+}
+
+env::VariantType ast::ExpressionNode::applyOperator(token::TokenType operation, env::VariantType left, env::VariantType right,
+                                                    const env::Environment& env) {
+    // ints stay ints unless the result overflows, which is checked without branching on the operands first
+    if (std::holds_alternative<int>(left) && std::holds_alternative<int>(right)) {
+        int l = std::get<int>(left);
+        int r = std::get<int>(right);
+        int result;
+
+        switch (operation) {
+            case token::TokenType::OPERATOR_ADD:
+                if (!__builtin_add_overflow(l, r, &result)) {
+                    return result;
+                }
+                return bigIntegerOperation(operation, types::BigInt{l}, types::BigInt{r});
+            case token::TokenType::OPERATOR_SUB:
+                if (!__builtin_sub_overflow(l, r, &result)) {
+                    return result;
+                }
+                return bigIntegerOperation(operation, types::BigInt{l}, types::BigInt{r});
+            case token::TokenType::OPERATOR_MUL:
+                if (!__builtin_mul_overflow(l, r, &result)) {
+                    return result;
+                }
+                return bigIntegerOperation(operation, types::BigInt{l}, types::BigInt{r});
+            case token::TokenType::OPERATOR_DIV:
+                if (r == 0) {
+                    throw std::runtime_error("Division by zero");
+                }
+                if (l == INT_MIN && r == -1) {
+                    return bigIntegerOperation(operation, types::BigInt{l}, types::BigInt{r});
+                }
+                return l / r;
+            case token::TokenType::OPERATOR_MOD:
+                if (r == 0) {
+                    throw std::runtime_error("Division by zero");
+                }
+                // INT_MIN % -1 overflows
+                return r == -1 ? 0 : l % r;
+            default:
+                break;
+        }
+    } else if (std::holds_alternative<types::BigInt>(left) || std::holds_alternative<types::BigInt>(right)) {
+        if (types::isInteger(left) && types::isInteger(right)) {
+            return bigIntegerOperation(operation, types::toBigInt(left), types::toBigInt(right));
+        }
+
+        // mixed with a float, a big int is a float like an int is
+        if (const types::BigInt* big = std::get_if<types::BigInt>(&left)) {
+            left = big->toFloat();
+        }
+        if (const types::BigInt* big = std::get_if<types::BigInt>(&right)) {
+            right = big->toFloat();
+        }
+    }
+
     auto applyOperation = [](env::VariantType left, env::VariantType right, auto op) {
         bool leftInt = std::holds_alternative<int>(left);
         bool rightInt = std::holds_alternative<int>(right);
@@ -126,26 +332,41 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
         }
     };
 
-    switch (nodeToken.type()) {
+    switch (operation) {
         case token::TokenType::OPERATOR_ADD:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) + std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                std::string_view leftString = types::stringView(left);
+                std::string_view rightString = types::stringView(right);
+
+                if (env.limits() != nullptr) {
+                    env.limits()->reserve(leftString.size() + rightString.size());
+                }
+
+                std::string result;
+                result.reserve(leftString.size() + rightString.size());
+                result.append(leftString).append(rightString);
+
+                return result;
             }
 
             return applyOperation(left, right, std::plus<>{});
         case token::TokenType::OPERATOR_SUB:
             return applyOperation(left, right, std::minus<>{});
         case token::TokenType::OPERATOR_MUL:
-            if (std::holds_alternative<std::string>(left) && std::holds_alternative<int>(right)) {
+            if (types::isString(left) && std::holds_alternative<int>(right)) {
+                reserveRepeat(env, types::stringView(left), std::get<int>(right));
+
                 std::string result;
                 for (int i = 0; i < std::get<int>(right); i++) {
-                    result += std::get<std::string>(left);
+                    result += types::stringView(left);
                 }
                 return result;
-            } else if (std::holds_alternative<int>(left) && std::holds_alternative<std::string>(right)) {
+            } else if (std::holds_alternative<int>(left) && types::isString(right)) {
+                reserveRepeat(env, types::stringView(right), std::get<int>(left));
+
                 std::string result;
                 for (int i = 0; i < std::get<int>(left); i++) {
-                    result += std::get<std::string>(right);
+                    result += types::stringView(right);
                 }
                 return result;
             }
@@ -154,8 +375,8 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
         case token::TokenType::OPERATOR_DIV:
             return applyOperation(left, right, std::divides<>{});
         case token::TokenType::OPERATOR_EQ:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) == std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) == types::stringView(right);
             }
 
             return applyOperation(left, right, std::equal_to<>{});
@@ -164,26 +385,26 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
         case token::TokenType::OPERATOR_BOOL_OR:
             return applyOperation(left, right, std::logical_or<>{});
         case token::TokenType::OPERATOR_LESS:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) < std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) < types::stringView(right);
             }
 
             return applyOperation(left, right, std::less<>{});
         case token::TokenType::OPERATOR_LESS_EQ:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) <= std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) <= types::stringView(right);
             }
 
             return applyOperation(left, right, std::less_equal<>{});
         case token::TokenType::OPERATOR_GREATER:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) > std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) > types::stringView(right);
             }
 
             return applyOperation(left, right, std::greater<>{});
         case token::TokenType::OPERATOR_GREATER_EQ:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) >= std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) >= types::stringView(right);
             }
 
             return applyOperation(left, right, std::greater_equal<>{});
@@ -200,8 +421,8 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
                 }
             });
         case token::TokenType::OPERATOR_NOT_EQ:
-            if (std::holds_alternative<std::string>(left) || std::holds_alternative<std::string>(right)) {
-                return std::get<std::string>(left) != std::get<std::string>(right);
+            if (types::isString(left) || types::isString(right)) {
+                return types::stringView(left) != types::stringView(right);
             }
 
             return applyOperation(left, right, std::not_equal_to<>{});
@@ -213,47 +434,392 @@ env::VariantType ast::ExpressionNode::eval(env::Environment& env) const {
 ast::ExpressionNode::ExpressionNode(const token::Token& token, std::vector<std::shared_ptr<ASTNode>> children)
     : ASTNode(token, std::move(children)) {}
 
+ast::TypedExpressionNode::TypedExpressionNode(const token::Token& token, std::vector<std::shared_ptr<ASTNode>> children,
+                                              StaticType type)
+    : ExpressionNode(token, std::move(children)), resultType(type), operandType(type), left(nullptr), right(nullptr),
+      intValue(0), floatValue(0), boolValue(false) {
+
+    switch (nodeToken.type()) {
+        case token::TokenType::IDENTIFIER:
+            name = nodeToken.value();
+            break;
+        case token::TokenType::LITERAL_INT:
+            intValue = std::stoi(nodeToken.value());
+            break;
+        case token::TokenType::LITERAL_FLOAT:
+            floatValue = std::stof(nodeToken.value());
+            break;
+        case token::TokenType::LITERAL_BOOL:
+            boolValue = nodeToken.value() == "true";
+            break;
+        default:
+            break;
+    }
+
+    if (!nodeChildren.empty()) {
+        left = static_cast<const TypedExpressionNode*>(nodeChildren[0].get());
+        operandType = left->type();
+    }
+
+    if (nodeChildren.size() > 1) {
+        right = static_cast<const TypedExpressionNode*>(nodeChildren[1].get());
+
+        if (right->type() == StaticType::FLOAT) {
+            operandType = StaticType::FLOAT;
+        }
+    }
+}
+
+env::VariantType ast::TypedExpressionNode::eval(env::Environment& env) const {
+    try {
+        switch (resultType) {
+            case StaticType::INT:
+                return evalInt(env);
+            case StaticType::FLOAT:
+                return evalFloat(env);
+            default:
+                return evalBool(env);
+        }
+    } catch (const TypeGuardFailure&) {
+        // typed expressions have no side effects, so evaluating again from the start is safe
+        return ExpressionNode::eval(env);
+    }
+}
+
+ast::StaticType ast::TypedExpressionNode::type() const {
+    return resultType;
+}
+
+int ast::TypedExpressionNode::evalInt(env::Environment& env) const {
+    switch (nodeToken.type()) {
+        case token::TokenType::LITERAL_INT:
+            return intValue;
+        case token::TokenType::IDENTIFIER: {
+            const env::VariantType* value = env.lookup(name);
+            const int* typed = value != nullptr ? std::get_if<int>(value) : nullptr;
+
+            if (typed == nullptr) {
+                throw TypeGuardFailure{};
+            }
+
+            return *typed;
+        }
+        // results that don't fit an int, and division by zero, are left to the dynamic path
+        case token::TokenType::OPERATOR_ADD: {
+            int result;
+            if (__builtin_add_overflow(left->evalInt(env), right->evalInt(env), &result)) {
+                throw TypeGuardFailure{};
+            }
+            return result;
+        }
+        case token::TokenType::OPERATOR_SUB: {
+            int result;
+            if (__builtin_sub_overflow(left->evalInt(env), right->evalInt(env), &result)) {
+                throw TypeGuardFailure{};
+            }
+            return result;
+        }
+        case token::TokenType::OPERATOR_MUL: {
+            int result;
+            if (__builtin_mul_overflow(left->evalInt(env), right->evalInt(env), &result)) {
+                throw TypeGuardFailure{};
+            }
+            return result;
+        }
+        case token::TokenType::OPERATOR_DIV: {
+            int l = left->evalInt(env);
+            int r = right->evalInt(env);
+            if (r == 0 || (l == INT_MIN && r == -1)) {
+                throw TypeGuardFailure{};
+            }
+            return l / r;
+        }
+        case token::TokenType::OPERATOR_MOD: {
+            int l = left->evalInt(env);
+            int r = right->evalInt(env);
+            if (r == 0) {
+                throw TypeGuardFailure{};
+            }
+            return r == -1 ? 0 : l % r;
+        }
+        default:
+            throw std::runtime_error("Unexpected token when evaluating int expression");
+    }
+}
+
+float ast::TypedExpressionNode::evalFloat(env::Environment& env) const {
+    switch (nodeToken.type()) {
+        case token::TokenType::LITERAL_FLOAT:
+            return floatValue;
+        case token::TokenType::IDENTIFIER: {
+            const env::VariantType* value = env.lookup(name);
+            const float* typed = value != nullptr ? std::get_if<float>(value) : nullptr;
+
+            if (typed == nullptr) {
+                throw TypeGuardFailure{};
+            }
+
+            return *typed;
+        }
+        case token::TokenType::OPERATOR_ADD:
+            return evalAsFloat(left, env) + evalAsFloat(right, env);
+        case token::TokenType::OPERATOR_SUB:
+            return evalAsFloat(left, env) - evalAsFloat(right, env);
+        case token::TokenType::OPERATOR_MUL:
+            return evalAsFloat(left, env) * evalAsFloat(right, env);
+        case token::TokenType::OPERATOR_DIV:
+            return evalAsFloat(left, env) / evalAsFloat(right, env);
+        case token::TokenType::OPERATOR_MOD:
+            return std::fmod(evalAsFloat(left, env), evalAsFloat(right, env));
+        default:
+            throw std::runtime_error("Unexpected token when evaluating float expression");
+    }
+}
+
+bool ast::TypedExpressionNode::evalBool(env::Environment& env) const {
+    switch (nodeToken.type()) {
+        case token::TokenType::LITERAL_BOOL:
+            return boolValue;
+        case token::TokenType::IDENTIFIER: {
+            const env::VariantType* value = env.lookup(name);
+            const bool* typed = value != nullptr ? std::get_if<bool>(value) : nullptr;
+
+            if (typed == nullptr) {
+                throw TypeGuardFailure{};
+            }
+
+            return *typed;
+        }
+        case token::TokenType::OPERATOR_UNARY_NOT:
+            return !left->evalBool(env);
+        case token::TokenType::OPERATOR_BOOL_AND: {
+            // both sides are evaluated, like ExpressionNode::eval does
+            bool leftValue = left->evalBool(env);
+            bool rightValue = right->evalBool(env);
+            return leftValue && rightValue;
+        }
+        case token::TokenType::OPERATOR_BOOL_OR: {
+            bool leftValue = left->evalBool(env);
+            bool rightValue = right->evalBool(env);
+            return leftValue || rightValue;
+        }
+        default:
+            return evalComparison(env);
+    }
+}
+
+float ast::TypedExpressionNode::evalAsFloat(const TypedExpressionNode* operand, env::Environment& env) {
+    if (operand->type() == StaticType::INT) {
+        return static_cast<float>(operand->evalInt(env));
+    }
+
+    return operand->evalFloat(env);
+}
+
+bool ast::TypedExpressionNode::evalComparison(env::Environment& env) const {
+    switch (operandType) {
+        case StaticType::INT:
+            return compareValues(nodeToken.type(), left->evalInt(env), right->evalInt(env));
+        case StaticType::FLOAT:
+            return compareValues(nodeToken.type(), evalAsFloat(left, env), evalAsFloat(right, env));
+        default:
+            return compareValues(nodeToken.type(), left->evalBool(env), right->evalBool(env));
+    }
+}
+
 ast::FunctionCallNode::FunctionCallNode(const token::FunctionCallToken& token) : ExpressionNode(token, {}) {
     for (const std::shared_ptr<ast::ExpressionNode>& argument : token.arguments()) {
         nodeChildren.push_back(std::static_pointer_cast<ast::ExpressionNode>(argument));
     }
 }
 
+std::vector<env::VariantType> ast::FunctionCallNode::evalArguments(env::Environment& env) const {
+    std::vector<env::VariantType> arguments;
+    arguments.reserve(nodeChildren.size());
+
+    for (const std::shared_ptr<ASTNode>& argument : nodeChildren) {
+        arguments.push_back(argument->eval(env));
+    }
+
+    return arguments;
+}
+
 env::VariantType ast::FunctionCallNode::eval(env::Environment& env) const {
-    std::string functionName = nodeToken.value();
+    struct NodeArguments : Arguments {
+        explicit NodeArguments(const FunctionCallNode& node) : node(node) {}
+
+        std::vector<env::VariantType> evaluate(env::Environment& env) const override {
+            return node.evalArguments(env);
+        }
 
-    if (env.getType(functionName) != "function") {
+        const FunctionCallNode& node;
+    };
+
+    auto line = static_cast<int32_t>(nodeToken.line());
+    auto column = static_cast<int32_t>(nodeToken.column());
+
+    trace::record(trace::Event::CALL, line, column);
+    env::VariantType result = call(nodeToken.value(), nodeChildren.size(), NodeArguments{*this}, env);
+    trace::record(trace::Event::RETURN, line, column);
+
+    return result;
+}
+
+env::VariantType ast::FunctionCallNode::call(const std::string& functionName, size_t argumentCount, const Arguments& arguments,
+                                             env::Environment& env) {
+    if (!env.has(functionName)) {
+        const types::NativeFunction* builtin = builtins::lookup(functionName);
+
+        if (builtin != nullptr) {
+            return builtin->call(arguments.evaluate(env));
+        }
+    }
+
+    env::VariantType callee = env.get(functionName);
+
+    // native functions are called straight from the caller's environment
+    if (std::holds_alternative<types::NativeFunction>(callee)) {
+        return std::get<types::NativeFunction>(callee).call(arguments.evaluate(env));
+    }
+
+    if (!std::holds_alternative<types::Function>(callee)) {
         throw std::runtime_error("Function " + functionName + " is not a function");
     }
 
-    types::Function functionBody = std::get<types::Function>(env.get(functionName));
+    const types::Function& functionBody = std::get<types::Function>(callee);
 
-    if (functionBody.parameters().size() != nodeChildren.size()) {
-        throw std::runtime_error("Function " + functionName + " expects " + std::to_string(functionBody.parameters().size()) + " arguments, but got " + std::to_string(nodeChildren.size()));
+    if (functionBody.parameters().size() != argumentCount) {
+        throw std::runtime_error("Function " + functionName + " expects " + std::to_string(functionBody.parameters().size()) + " arguments, but got " + std::to_string(argumentCount));
     }
 
+    std::vector<env::VariantType> values = arguments.evaluate(env);
+    const std::shared_ptr<memo::Cache>& cache = functionBody.cache();
+    std::string key;
+
+    if (cache == nullptr || !memo::Cache::makeKey(values, key)) {
+        return callFunction(functionBody, std::move(values), env);
+    }
+
+    if (const env::VariantType* cached = cache->find(key)) {
+        return *cached;
+    }
+
+    env::VariantType result = callFunction(functionBody, std::move(values), env);
+    cache->insert(std::move(key), result);
+
+    return result;
+}
+
+env::VariantType ast::FunctionCallNode::callFunction(const types::Function& function, std::vector<env::VariantType> arguments,
+                                                     env::Environment& env) {
+    struct Depth {
+        explicit Depth(sandbox::Limits* limits) : limits(limits) {
+            if (limits != nullptr) {
+                limits->step();
+                limits->enter();
+            }
+        }
+
+        ~Depth() {
+            if (limits != nullptr) {
+                limits->leave();
+            }
+        }
+
+        sandbox::Limits* limits;
+    };
+
+    Depth depth{env.limits()};
     env::Environment functionScope{env};
 
-    for (size_t i = 0; i < functionBody.parameters().size(); i++) {
-        functionScope.set(functionBody.parameters()[i], nodeChildren[i]->eval(env));
+    for (size_t i = 0; i < function.parameters().size(); i++) {
+        functionScope.define(function.parameters()[i], std::move(arguments[i]));
     }
 
     try {
-        functionBody.body()->eval(functionScope);
+        return function.body()->eval(functionScope);
     } catch (const control::ReturnException& e) {
         return e.value();
     }
+}
+
+ast::FunctionBodyNode::FunctionBodyNode(std::shared_ptr<const std::vector<token::Token>> source, size_t begin, size_t end)
+    : sourceTokens(std::move(source)), beginIndex(begin), endIndex(end), isParsed(false) {}
+
+env::VariantType ast::FunctionBodyNode::eval(env::Environment& env) const {
+    root().eval(env);
 
     return 0;  // todo: implement a null type
 }
 
+ast::RootNode& ast::FunctionBodyNode::root() const {
+    if (!isParsed.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(parseMutex);
+
+        if (!isParsed.load(std::memory_order_relaxed)) {
+            Parser parser{sourceTokens, beginIndex, endIndex};
+            parsedRoot = std::make_shared<RootNode>(parser.root());
+
+            for (const ParseHook& hook : parseHooks) {
+                hook(*parsedRoot);
+            }
+
+            parseHooks.clear();
+
+            isParsed.store(true, std::memory_order_release);
+        }
+    }
+
+    return *parsedRoot;
+}
+
+bool ast::FunctionBodyNode::parsed() const {
+    return isParsed.load(std::memory_order_acquire);
+}
+
+ast::FunctionBodyNode::TokenIterator ast::FunctionBodyNode::tokensBegin() const {
+    return sourceTokens->begin() + static_cast<std::ptrdiff_t>(beginIndex);
+}
+
+ast::FunctionBodyNode::TokenIterator ast::FunctionBodyNode::tokensEnd() const {
+    return sourceTokens->begin() + static_cast<std::ptrdiff_t>(endIndex);
+}
+
+void ast::FunctionBodyNode::onParse(ParseHook hook) {
+    std::lock_guard<std::mutex> lock(parseMutex);
+
+    if (isParsed.load(std::memory_order_relaxed)) {
+        hook(*parsedRoot);
+        return;
+    }
+
+    parseHooks.push_back(std::move(hook));
+}
+
+
 env::VariantType ast::FunctionDefNode::eval(env::Environment& env) const {
-    env.set(nodeToken.value(), types::Function{arguments, functionBody});
+    env.set(nodeToken.value(), types::Function{arguments, functionBody, resultCache});
 
     return {};
 }
 
-ast::FunctionDefNode::FunctionDefNode(const token::Token& identifier, std::vector<std::string> args, std::shared_ptr<ASTNode> body) {
+void ast::FunctionDefNode::memoize(std::shared_ptr<memo::Cache> cache) {
+    resultCache = std::move(cache);
+}
+
+const std::vector<std::string>& ast::FunctionDefNode::parameters() const {
+    return arguments;
+}
+
+const std::shared_ptr<ast::FunctionBodyNode>& ast::FunctionDefNode::body() const {
+    return functionBody;
+}
+
+const std::shared_ptr<memo::Cache>& ast::FunctionDefNode::cache() const {
+    return resultCache;
+}
+
+ast::FunctionDefNode::FunctionDefNode(const token::Token& identifier, std::vector<std::string> args, std::shared_ptr<FunctionBodyNode> body) {
     if (identifier.type() != token::TokenType::IDENTIFIER) {
         throw std::runtime_error("FunctionDefNode must be constructed with an identifier token");
     }
@@ -287,7 +853,15 @@ ast::WhileNode::WhileNode(const token::Token &token, std::shared_ptr<ASTNode> co
 }
 
 env::VariantType ast::WhileNode::eval(env::Environment &env) const {
+    sandbox::Limits* limits = env.limits();
+
     while (std::get<bool>(nodeChildren[0]->eval(env))) {
+        if (limits != nullptr) {
+            limits->step();
+        }
+
+        trace::record(trace::Event::ITERATION, static_cast<int32_t>(nodeToken.line()), static_cast<int32_t>(nodeToken.column()));
+
         try {
             nodeChildren[1]->eval(env);
         } catch (const control::ContinueException &) {
@@ -299,3 +873,167 @@ env::VariantType ast::WhileNode::eval(env::Environment &env) const {
 
     return {};
 }
+
+ast::ForNode::Range ast::ForNode::Range::of(const env::VariantType& first, const env::VariantType& end,
+                                            const env::VariantType& step) {
+    if (!std::holds_alternative<int>(first) || !std::holds_alternative<int>(end) || !std::holds_alternative<int>(step)) {
+        throw std::runtime_error("For loop bounds and step must be ints");
+    }
+
+    if (std::get<int>(step) == 0) {
+        throw std::runtime_error("For loop step must not be zero");
+    }
+
+    return {std::get<int>(first), std::get<int>(end), std::get<int>(step)};
+}
+
+ast::ForNode::ForNode(const token::Token& token, std::shared_ptr<DeclarationNode> initialization,
+                      std::shared_ptr<ASTNode> end, std::shared_ptr<ASTNode> step, std::shared_ptr<ASTNode> body) {
+    nodeToken = token;
+    nodeChildren = {std::move(initialization), std::move(end), std::move(step), std::move(body)};
+}
+
+env::VariantType ast::ForNode::counterValue(int64_t value) {
+    if (value >= INT_MIN && value <= INT_MAX) {
+        return static_cast<int>(value);
+    }
+
+    return types::BigInt{value};
+}
+
+env::VariantType ast::ForNode::eval(env::Environment& env) const {
+    const std::string& counter = nodeChildren[0]->children()[0]->token().value();
+    Range range = Range::of(nodeChildren[0]->children()[1]->eval(env), nodeChildren[1]->eval(env), nodeChildren[2]->eval(env));
+    sandbox::Limits* limits = env.limits();
+
+    // the values in the range fit an int, only the one past the end may not
+    int64_t value = range.first;
+    for (; range.contains(value); value += range.step) {
+        if (limits != nullptr) {
+            limits->step();
+        }
+
+        trace::record(trace::Event::ITERATION, static_cast<int32_t>(nodeToken.line()), static_cast<int32_t>(nodeToken.column()));
+        env.set(counter, static_cast<int>(value));
+
+        try {
+            nodeChildren[3]->eval(env);
+        } catch (const control::ContinueException &) {
+            continue;
+        } catch (const control::BreakException &) {
+            return {};
+        }
+    }
+
+    env.set(counter, counterValue(value));
+
+    return {};
+}
+
+ast::ArrayLiteralNode::ArrayLiteralNode(const token::ArrayLiteralToken& token) : ExpressionNode(token, {}) {
+    for (const std::shared_ptr<ast::ExpressionNode>& element : token.elements()) {
+        nodeChildren.push_back(element);
+    }
+}
+
+env::VariantType ast::ArrayLiteralNode::eval(env::Environment& env) const {
+    types::Array array;
+
+    for (const std::shared_ptr<ASTNode>& child : nodeChildren) {
+        env::VariantType element = child->eval(env);
+
+        if (std::holds_alternative<int>(element)) {
+            array.push(std::get<int>(element));
+        } else if (std::holds_alternative<float>(element)) {
+            array.push(std::get<float>(element));
+        } else {
+            throw std::runtime_error("Arrays can only hold ints and floats");
+        }
+    }
+
+    return array;
+}
+
+ast::DictLiteralNode::DictLiteralNode(const token::DictLiteralToken& token) : ExpressionNode(token, {}) {
+    for (const token::DictLiteralToken::Entry& entry : token.entries()) {
+        nodeChildren.push_back(entry.first);
+        nodeChildren.push_back(entry.second);
+    }
+}
+
+env::VariantType ast::DictLiteralNode::eval(env::Environment& env) const {
+    types::Dict dict;
+
+    for (size_t i = 0; i + 1 < nodeChildren.size(); i += 2) {
+        env::VariantType key = nodeChildren[i]->eval(env);
+        dict.set(key, nodeChildren[i + 1]->eval(env));
+    }
+
+    return dict;
+}
+
+ast::IndexNode::IndexNode(const token::IndexToken& token) : ExpressionNode(token, {token.index()}) {}
+
+env::VariantType ast::IndexNode::eval(env::Environment& env) const {
+    env::VariantType container = env.get(nodeToken.value());
+    env::VariantType key = nodeChildren[0]->eval(env);
+
+    if (std::holds_alternative<types::Dict>(container)) {
+        const env::VariantType* value = std::get<types::Dict>(container).find(key);
+
+        if (value == nullptr) {
+            throw std::runtime_error("Key not found in dictionary " + nodeToken.value());
+        }
+
+        return *value;
+    }
+
+    if (!std::holds_alternative<types::Array>(container)) {
+        throw std::runtime_error("Variable " + nodeToken.value() + " cannot be indexed");
+    }
+
+    const types::Array& array = std::get<types::Array>(container);
+    size_t index = toArrayIndex(key);
+
+    if (index >= array.size()) {
+        throw std::runtime_error("Array index " + std::to_string(index) + " out of range for array of size " + std::to_string(array.size()));
+    }
+
+    if (array.elementType() == types::ElementType::INT) {
+        return array.ints()[index];
+    }
+
+    return array.floats()[index];
+}
+
+ast::IndexAssignmentNode::IndexAssignmentNode(const token::Token& identifier, std::shared_ptr<ASTNode> index,
+                                              std::shared_ptr<ASTNode> value)
+    : ASTNode(identifier, {std::move(index), std::move(value)}) {}
+
+env::VariantType ast::IndexAssignmentNode::eval(env::Environment& env) const {
+    env::VariantType container = env.get(nodeToken.value());
+    env::VariantType key = nodeChildren[0]->eval(env);
+    env::VariantType value = nodeChildren[1]->eval(env);
+
+    if (std::holds_alternative<types::Dict>(container)) {
+        std::get<types::Dict>(container).set(key, std::move(value));
+        return {};
+    }
+
+    if (!std::holds_alternative<types::Array>(container)) {
+        throw std::runtime_error("Variable " + nodeToken.value() + " cannot be indexed");
+    }
+
+    types::Array& array = std::get<types::Array>(container);
+    size_t index = toArrayIndex(key);
+
+    if (std::holds_alternative<int>(value)) {
+        array.set(index, std::get<int>(value));
+    } else if (std::holds_alternative<float>(value)) {
+        array.set(index, std::get<float>(value));
+    } else {
+        throw std::runtime_error("Arrays can only hold ints and floats");
+    }
+
+    return {};
+}
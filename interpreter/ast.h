@@ -5,6 +5,10 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <cstdint>
 
 // Forward declarations
 namespace env {
@@ -24,6 +28,19 @@ namespace token {
 
 
 namespace ast {
+    /**
+     * The type of an expression as proven by the type inference pass. UNKNOWN is only used while the pass is running;
+     * DYNAMIC means the type could not be proven.
+     */
+    enum class StaticType {
+        UNKNOWN,
+        BOOL,
+        INT,
+        FLOAT,
+        STRING,
+        DYNAMIC
+    };
+
     class ASTNode {
     public:
         ASTNode();
@@ -65,15 +82,106 @@ namespace ast {
         env::VariantType eval(env::Environment& env) const override;
     };
 
+    /**
+     * A compound assignment, e.g., s += "x". Stored as the declaration s = s + "x", so the passes that look at
+     * assignments (type inference, dead code elimination, memoization) treat it as one.
+     *
+     * It is evaluated in place instead: the operand is evaluated first, then a string is appended to in its own buffer,
+     * which takes amortized constant time per character where s = s + "x" copies the whole string, and an int or float
+     * is updated without looking the variable up twice. Other values, and variables a fork inherited, are assigned the
+     * result of the operator as the declaration would.
+     */
+    class CompoundAssignmentNode : public DeclarationNode {
+    public:
+        explicit CompoundAssignmentNode(std::vector<std::shared_ptr<ASTNode>> children);
+
+        env::VariantType eval(env::Environment& env) const override;
+    };
+
+    /**
+     * The body of a function definition. Loading a program only matches the body's braces: the statements are parsed
+     * the first time the function is called, so functions that are never called cost almost nothing. A syntax error in
+     * the body is reported when it is parsed.
+     */
+    class FunctionBodyNode : public ASTNode {
+    public:
+        using TokenIterator = std::vector<token::Token>::const_iterator;
+
+        /**
+         * Called on the body right after it is parsed, e.g., to specialize it with the types inferred for the program.
+         */
+        using ParseHook = std::function<void(RootNode&)>;
+
+        /**
+         * @param source The tokens of the whole program
+         * @param begin The index of the first token of the body, after the opening brace
+         * @param end The index of the closing brace
+         */
+        FunctionBodyNode(std::shared_ptr<const std::vector<token::Token>> source, size_t begin, size_t end);
+
+        /**
+         * Runs the body. A return statement throws control::ReturnException with the function's result.
+         * @return The result of a function that ends without returning. Other bodies (see flat.h) may return the
+         * function's result directly instead of throwing
+         */
+        env::VariantType eval(env::Environment& env) const override;
+
+        /**
+         * Parses the body if it has not been parsed yet. Safe to call from several threads.
+         * @throws std::runtime_error if the body has a syntax error
+         * @return The parsed statements
+         */
+        [[nodiscard]] RootNode& root() const;
+
+        [[nodiscard]] bool parsed() const;
+
+        /**
+         * The tokens of the body, for analyses that only need to scan a body that has not been parsed.
+         */
+        [[nodiscard]] TokenIterator tokensBegin() const;
+        [[nodiscard]] TokenIterator tokensEnd() const;
+
+        /**
+         * Adds a hook run after the body is parsed. Hooks run in the order they were added. If the body has already been
+         * parsed, the hook runs immediately.
+         */
+        void onParse(ParseHook hook);
+
+    private:
+        std::shared_ptr<const std::vector<token::Token>> sourceTokens;
+        size_t beginIndex;
+        size_t endIndex;
+
+        mutable std::mutex parseMutex;  // guards parsedRoot and parseHooks while parsing
+        mutable std::atomic<bool> isParsed;
+        mutable std::shared_ptr<RootNode> parsedRoot;
+        mutable std::vector<ParseHook> parseHooks;
+    };
+
     class FunctionDefNode : public ASTNode {
     public:
-        explicit FunctionDefNode(const token::Token& identifier, std::vector<std::string> args, std::shared_ptr<ASTNode> body);
+        explicit FunctionDefNode(const token::Token& identifier, std::vector<std::string> args, std::shared_ptr<FunctionBodyNode> body);
 
         env::VariantType eval(env::Environment& env) const override;
 
+        [[nodiscard]] const std::vector<std::string>& parameters() const;
+        [[nodiscard]] const std::shared_ptr<FunctionBodyNode>& body() const;
+
+        /**
+         * @return The result cache given by memoize, or nullptr if the function is not memoized
+         */
+        [[nodiscard]] const std::shared_ptr<memo::Cache>& cache() const;
+
+        /**
+         * Caches the results of calls to the function. Only valid for pure functions (see memo.h).
+         * @param cache The cache shared by every function value this definition creates
+         */
+        void memoize(std::shared_ptr<memo::Cache> cache);
+
     private:
         std::vector<std::string> arguments;
-        std::shared_ptr<ASTNode> functionBody;
+        std::shared_ptr<FunctionBodyNode> functionBody;
+        std::shared_ptr<memo::Cache> resultCache;
     };
 
     class ControlFlowNode : public ASTNode {
@@ -98,12 +206,61 @@ namespace ast {
         env::VariantType eval(env::Environment& env) const override;
     };
 
+    /**
+     * A counted loop, for (i in start..end step step) { ... }. The children are the assignment of the start to the
+     * counter, the end, the step (a literal 1 if none was given) and the body.
+     *
+     * The range excludes the end and the step may be negative, counting down. The bounds and the step are evaluated
+     * once, before the first iteration, and the counter is kept as a native integer, so the loop does not evaluate a
+     * condition or an increment through the tree on every iteration. The counter variable is assigned the next value
+     * before each iteration; assigning to it in the body does not change which values the loop runs over. Once the
+     * loop ends without a break, the counter holds the first value past the range, as after the equivalent while loop.
+     */
+    class ForNode : public ASTNode {
+    public:
+        /**
+         * The values a counted loop runs over.
+         */
+        struct Range {
+            int64_t first;
+            int64_t end;
+            int64_t step;
+
+            /**
+             * @throws std::runtime_error if a bound or the step is not an int, or the step is zero
+             */
+            static Range of(const env::VariantType& first, const env::VariantType& end, const env::VariantType& step);
+
+            [[nodiscard]] bool contains(int64_t value) const {
+                return step > 0 ? value < end : value > end;
+            }
+        };
+
+        explicit ForNode(const token::Token& token, std::shared_ptr<DeclarationNode> initialization,
+                         std::shared_ptr<ASTNode> end, std::shared_ptr<ASTNode> step, std::shared_ptr<ASTNode> body);
+
+        env::VariantType eval(env::Environment& env) const override;
+
+        /**
+         * @return The counter's value, an int or, past the end of a range near the limits of an int, a big int
+         */
+        static env::VariantType counterValue(int64_t value);
+    };
+
     class ExpressionNode : public ASTNode {
     public:
         ExpressionNode() = default;
         explicit ExpressionNode(const token::Token& token, std::vector<std::shared_ptr<ASTNode>> children);
 
         env::VariantType eval(env::Environment& env) const override;
+
+        /**
+         * Applies a binary operator to two evaluated operands.
+         * @param env The environment, for the memory cap on the strings the operator builds
+         * @throws std::runtime_error if the operator does not apply to the operand types
+         */
+        static env::VariantType applyOperator(token::TokenType operation, env::VariantType left, env::VariantType right,
+                                              const env::Environment& env);
     };
 
     class FunctionCallNode : public ExpressionNode {
@@ -118,6 +275,128 @@ namespace ast {
         explicit FunctionCallNode(const token::FunctionCallToken& token);
 
         env::VariantType eval(env::Environment& env) const override;
+
+        /**
+         * The arguments of a call, evaluated only once the callee has been found and checked.
+         */
+        class Arguments {
+        public:
+            virtual ~Arguments() = default;
+            virtual std::vector<env::VariantType> evaluate(env::Environment& env) const = 0;
+        };
+
+        /**
+         * Calls a builtin, native or SPL function by name, the way a call expression does.
+         * @param functionName The name of the function
+         * @param argumentCount The number of arguments, checked against the function's parameters before evaluating them
+         * @param arguments Evaluates the arguments in the caller's environment
+         * @param env The caller's environment
+         * @return The value the function returned
+         */
+        static env::VariantType call(const std::string& functionName, size_t argumentCount, const Arguments& arguments,
+                                     env::Environment& env);
+
+    private:
+        /**
+         * Evaluates the arguments in the caller's environment.
+         */
+        std::vector<env::VariantType> evalArguments(env::Environment& env) const;
+
+        /**
+         * Runs the body of an SPL function in a new scope.
+         */
+        static env::VariantType callFunction(const types::Function& function, std::vector<env::VariantType> arguments,
+                                             env::Environment& env);
+    };
+
+    /**
+     * An expression whose type, and the types of all of its operands, were proven by the type inference pass
+     * (see inference.h). Evaluates on native ints, floats and bools and only wraps the final result in a VariantType.
+     *
+     * Typed expressions only contain literals, variable reads and operators, so they have no side effects. If a
+     * variable turns out to hold another type at runtime (e.g., it was set by the host before the script ran), the
+     * node falls back to ExpressionNode::eval.
+     */
+    class TypedExpressionNode : public ExpressionNode {
+    public:
+        /**
+         * @param token The token of the expression being specialized
+         * @param children The operands of the expression. Each child must be a TypedExpressionNode
+         * @param type The proven type of the expression. Must be BOOL, INT or FLOAT
+         */
+        TypedExpressionNode(const token::Token& token, std::vector<std::shared_ptr<ASTNode>> children, StaticType type);
+
+        env::VariantType eval(env::Environment& env) const override;
+
+        [[nodiscard]] StaticType type() const;
+
+        int evalInt(env::Environment& env) const;
+        float evalFloat(env::Environment& env) const;
+        bool evalBool(env::Environment& env) const;
+
+    private:
+        /**
+         * Evaluates an INT or FLOAT operand as a float
+         */
+        static float evalAsFloat(const TypedExpressionNode* operand, env::Environment& env);
+
+        /**
+         * Evaluates a comparison operator on operands of operandType
+         */
+        bool evalComparison(env::Environment& env) const;
+
+        StaticType resultType;
+        StaticType operandType;  // the type the operator works on. Equal to resultType except for comparisons
+        std::string name;  // for variable reads
+        const TypedExpressionNode* left;  // owned by nodeChildren
+        const TypedExpressionNode* right;
+        int intValue;  // for literals
+        float floatValue;
+        bool boolValue;
+    };
+
+    class ArrayLiteralNode : public ExpressionNode {
+    public:
+        /**
+         * Construct an ArrayLiteralNode from the array literal pseudo-token.
+         * @param token The array literal token. Each element becomes a child of this node.
+         */
+        explicit ArrayLiteralNode(const token::ArrayLiteralToken& token);
+
+        env::VariantType eval(env::Environment& env) const override;
+    };
+
+    class DictLiteralNode : public ExpressionNode {
+    public:
+        /**
+         * Construct a DictLiteralNode from the dictionary literal pseudo-token.
+         * @param token The dictionary literal token. The children of this node alternate between key and value.
+         */
+        explicit DictLiteralNode(const token::DictLiteralToken& token);
+
+        env::VariantType eval(env::Environment& env) const override;
+    };
+
+    class IndexNode : public ExpressionNode {
+    public:
+        /**
+         * Construct an IndexNode from the index pseudo-token.
+         * @param token The index token. Contains the name of the indexed variable; its index/key expression is the only child.
+         */
+        explicit IndexNode(const token::IndexToken& token);
+
+        env::VariantType eval(env::Environment& env) const override;
+    };
+
+    /**
+     * Assigns to one element of an array or dictionary (e.g., values[i] = 5;). The token is the identifier of the array, the first
+     * child is the index expression and the second child is the value expression.
+     */
+    class IndexAssignmentNode : public ASTNode {
+    public:
+        explicit IndexAssignmentNode(const token::Token& identifier, std::shared_ptr<ASTNode> index, std::shared_ptr<ASTNode> value);
+
+        env::VariantType eval(env::Environment& env) const override;
     };
 }
 
@@ -0,0 +1,698 @@
+#include "batch.h"
+
+#include "frontend.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+
+
+namespace {
+    // rows per block: the registers of one block stay in cache while its instructions run
+    constexpr size_t BLOCK_ROWS = 1024;
+
+    enum class Operation {
+        LOAD,  // copies an input column
+        CONSTANT,
+        TO_FLOAT,
+        NOT,
+        AND,
+        OR,
+        ARITHMETIC,
+        COMPARE
+    };
+
+    struct Instruction {
+        Operation operation = Operation::LOAD;
+        // the type of the operands of ARITHMETIC and COMPARE, otherwise of the result
+        ast::StaticType type = ast::StaticType::UNKNOWN;
+        token::TokenType operatorType = token::TokenType::INVALID;  // for ARITHMETIC and COMPARE
+        uint32_t target = 0;
+        uint32_t left = 0;
+        uint32_t right = 0;
+        const batch::Column* input = nullptr;  // for LOAD
+        env::VariantType constant = 0;  // for CONSTANT
+    };
+
+    /**
+     * The values of one expression for a block of rows.
+     */
+    struct Register {
+        ast::StaticType type;
+        std::vector<int> ints;
+        std::vector<float> floats;
+        std::vector<uint8_t> bools;
+    };
+
+    bool isNumber(ast::StaticType type) {
+        return type == ast::StaticType::INT || type == ast::StaticType::FLOAT;
+    }
+
+    std::optional<simd::Comparison> comparison(token::TokenType type) {
+        switch (type) {
+            case token::TokenType::OPERATOR_LESS:
+                return simd::Comparison::LESS;
+            case token::TokenType::OPERATOR_LESS_EQ:
+                return simd::Comparison::LESS_EQ;
+            case token::TokenType::OPERATOR_GREATER:
+                return simd::Comparison::GREATER;
+            case token::TokenType::OPERATOR_GREATER_EQ:
+                return simd::Comparison::GREATER_EQ;
+            case token::TokenType::OPERATOR_EQ:
+                return simd::Comparison::EQ;
+            case token::TokenType::OPERATOR_NOT_EQ:
+                return simd::Comparison::NOT_EQ;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    bool isArithmetic(token::TokenType type) {
+        return type == token::TokenType::OPERATOR_ADD || type == token::TokenType::OPERATOR_SUB
+               || type == token::TokenType::OPERATOR_MUL || type == token::TokenType::OPERATOR_DIV
+               || type == token::TokenType::OPERATOR_MOD;
+    }
+
+    /**
+     * Compiles the statements of a script that can run a column at a time into instructions over registers. Follows the
+     * typing rules of ast::ExpressionNode::applyOperator, giving up on anything whose result could be a string or a big
+     * int or could throw for other reasons than integer overflow and division by zero.
+     */
+    class Compiler {
+    public:
+        explicit Compiler(const batch::Table& inputs) : inputs(inputs) {}
+
+        /**
+         * Compiles an assignment.
+         * @return false, with nothing compiled, if the statement cannot run a column at a time
+         */
+        bool compileStatement(ast::ASTNode& statement) {
+            if (typeid(statement) != typeid(ast::DeclarationNode)) {
+                return false;
+            }
+
+            size_t instructionCount = instructions.size();
+            size_t registerCount = registers.size();
+            std::unordered_map<std::string, uint32_t> previous = variables;
+
+            std::optional<uint32_t> value = compileExpression(*statement.children()[1]);
+
+            if (!value) {
+                instructions.resize(instructionCount);
+                registers.resize(registerCount);
+                variables = std::move(previous);
+
+                return false;
+            }
+
+            variables[statement.children()[0]->token().value()] = *value;
+            return true;
+        }
+
+        /**
+         * @return The register holding a variable, loading it if it is an input that has not been read yet
+         */
+        std::optional<uint32_t> variable(const std::string& name) {
+            if (auto it = variables.find(name); it != variables.end()) {
+                return it->second;
+            }
+
+            auto input = inputs.find(name);
+            if (input == inputs.end()) {
+                return std::nullopt;
+            }
+
+            Instruction load{Operation::LOAD, input->second.type()};
+            load.input = &input->second;
+
+            uint32_t target = emit(std::move(load));
+            variables[name] = target;
+
+            return target;
+        }
+
+        std::vector<Instruction> instructions;
+        std::vector<ast::StaticType> registers;
+        std::unordered_map<std::string, uint32_t> variables;  // the register holding each variable's latest value
+
+    private:
+        std::optional<uint32_t> compileExpression(ast::ASTNode& node) {
+            // literals of other kinds (arrays, dictionaries, calls, ...) are subclasses
+            if (typeid(node) != typeid(ast::ExpressionNode)) {
+                return std::nullopt;
+            }
+
+            std::vector<std::shared_ptr<ast::ASTNode>>& children = node.children();
+            const token::Token& token = node.token();
+
+            if (children.empty()) {
+                return compileLeaf(token);
+            }
+
+            if (children.size() == 1) {
+                std::optional<uint32_t> operand = compileExpression(*children[0]);
+
+                if (!operand || token.type() != token::TokenType::OPERATOR_UNARY_NOT || registers[*operand] != ast::StaticType::BOOL) {
+                    return std::nullopt;
+                }
+
+                Instruction negate{Operation::NOT, ast::StaticType::BOOL};
+                negate.left = *operand;
+                return emit(std::move(negate));
+            }
+
+            std::optional<uint32_t> left = compileExpression(*children[0]);
+            std::optional<uint32_t> right = left ? compileExpression(*children[1]) : std::nullopt;
+
+            if (!right) {
+                return std::nullopt;
+            }
+
+            ast::StaticType leftType = registers[*left];
+            ast::StaticType rightType = registers[*right];
+
+            if (leftType == ast::StaticType::BOOL && rightType == ast::StaticType::BOOL) {
+                Instruction logic{Operation::AND, ast::StaticType::BOOL};
+                logic.left = *left;
+                logic.right = *right;
+
+                switch (token.type()) {
+                    case token::TokenType::OPERATOR_BOOL_AND:
+                        return emit(std::move(logic));
+                    case token::TokenType::OPERATOR_BOOL_OR:
+                        logic.operation = Operation::OR;
+                        return emit(std::move(logic));
+                    case token::TokenType::OPERATOR_EQ:
+                    case token::TokenType::OPERATOR_NOT_EQ:
+                        // a bool equals another bool when their xor is false
+                        logic.operation = Operation::COMPARE;
+                        logic.operatorType = token.type();
+                        return emit(std::move(logic));
+                    default:
+                        return std::nullopt;
+                }
+            }
+
+            if (!isNumber(leftType) || !isNumber(rightType) || (!isArithmetic(token.type()) && !comparison(token.type()))) {
+                return std::nullopt;
+            }
+
+            // mixed with a float, an int is converted to a float
+            ast::StaticType operandType = leftType == ast::StaticType::INT && rightType == ast::StaticType::INT
+                                          ? ast::StaticType::INT : ast::StaticType::FLOAT;
+
+            if (operandType == ast::StaticType::FLOAT) {
+                left = toFloat(*left);
+                right = toFloat(*right);
+            }
+
+            bool compare = comparison(token.type()).has_value();
+
+            Instruction operation{compare ? Operation::COMPARE : Operation::ARITHMETIC, operandType, token.type()};
+            operation.left = *left;
+            operation.right = *right;
+
+            return emit(std::move(operation), compare ? ast::StaticType::BOOL : operandType);
+        }
+
+        std::optional<uint32_t> compileLeaf(const token::Token& token) {
+            Instruction constant{Operation::CONSTANT};
+
+            switch (token.type()) {
+                case token::TokenType::IDENTIFIER:
+                    return variable(token.value());
+                case token::TokenType::LITERAL_INT:
+                    constant.constant = types::parseInteger(token.value());
+
+                    if (!std::holds_alternative<int>(constant.constant)) {
+                        return std::nullopt;  // a big int
+                    }
+
+                    constant.type = ast::StaticType::INT;
+                    break;
+                case token::TokenType::LITERAL_FLOAT:
+                    constant.constant = std::stof(token.value());
+                    constant.type = ast::StaticType::FLOAT;
+                    break;
+                case token::TokenType::LITERAL_BOOL:
+                    constant.constant = token.value() == "true";
+                    constant.type = ast::StaticType::BOOL;
+                    break;
+                default:
+                    return std::nullopt;
+            }
+
+            return emit(std::move(constant));
+        }
+
+        uint32_t toFloat(uint32_t value) {
+            if (registers[value] == ast::StaticType::FLOAT) {
+                return value;
+            }
+
+            Instruction convert{Operation::TO_FLOAT, ast::StaticType::FLOAT};
+            convert.left = value;
+            return emit(std::move(convert));
+        }
+
+        uint32_t emit(Instruction instruction) {
+            ast::StaticType type = instruction.type;
+            return emit(std::move(instruction), type);
+        }
+
+        uint32_t emit(Instruction instruction, ast::StaticType resultType) {
+            instruction.target = static_cast<uint32_t>(registers.size());
+            registers.push_back(resultType);
+            instructions.push_back(std::move(instruction));
+
+            return instructions.back().target;
+        }
+
+        const batch::Table& inputs;
+    };
+
+    bool divide(const int* left, const int* right, int* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (right[i] == 0 || (left[i] == INT_MIN && right[i] == -1)) {
+                return false;
+            }
+
+            out[i] = left[i] / right[i];
+        }
+
+        return true;
+    }
+
+    bool modulo(const int* left, const int* right, int* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (right[i] == 0) {
+                return false;
+            }
+
+            // INT_MIN % -1 overflows
+            out[i] = right[i] == -1 ? 0 : left[i] % right[i];
+        }
+
+        return true;
+    }
+
+    bool arithmetic(token::TokenType operation, const int* left, const int* right, int* out, size_t count) {
+        switch (operation) {
+            case token::TokenType::OPERATOR_ADD:
+                return simd::add(left, right, out, count);
+            case token::TokenType::OPERATOR_SUB:
+                return simd::subtract(left, right, out, count);
+            case token::TokenType::OPERATOR_MUL:
+                return simd::multiply(left, right, out, count);
+            case token::TokenType::OPERATOR_DIV:
+                return divide(left, right, out, count);
+            default:
+                return modulo(left, right, out, count);
+        }
+    }
+
+    void arithmetic(token::TokenType operation, const float* left, const float* right, float* out, size_t count) {
+        switch (operation) {
+            case token::TokenType::OPERATOR_ADD:
+                simd::add(left, right, out, count);
+                break;
+            case token::TokenType::OPERATOR_SUB:
+                simd::subtract(left, right, out, count);
+                break;
+            case token::TokenType::OPERATOR_MUL:
+                simd::multiply(left, right, out, count);
+                break;
+            case token::TokenType::OPERATOR_DIV:
+                simd::divide(left, right, out, count);
+                break;
+            default:
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = std::fmod(left[i], right[i]);
+                }
+                break;
+        }
+    }
+
+    /**
+     * Runs an instruction on the first count rows of the registers.
+     * @param begin The row of the block's first row in the inputs
+     * @return false if an int operation overflowed or divided by zero
+     */
+    bool execute(const Instruction& instruction, std::vector<Register>& registers, size_t begin, size_t count) {
+        Register& target = registers[instruction.target];
+        const Register& left = registers[instruction.left];
+        const Register& right = registers[instruction.right];
+
+        switch (instruction.operation) {
+            case Operation::LOAD:
+                switch (target.type) {
+                    case ast::StaticType::INT:
+                        std::memcpy(target.ints.data(), instruction.input->ints().data() + begin, count * sizeof(int));
+                        break;
+                    case ast::StaticType::FLOAT:
+                        std::memcpy(target.floats.data(), instruction.input->floats().data() + begin, count * sizeof(float));
+                        break;
+                    default:
+                        std::memcpy(target.bools.data(), instruction.input->bools().data() + begin, count);
+                        break;
+                }
+                return true;
+
+            case Operation::CONSTANT:
+                // constant for every block, so only the first block fills it
+                if (begin == 0) {
+                    if (const int* value = std::get_if<int>(&instruction.constant)) {
+                        std::fill(target.ints.begin(), target.ints.end(), *value);
+                    } else if (const float* real = std::get_if<float>(&instruction.constant)) {
+                        std::fill(target.floats.begin(), target.floats.end(), *real);
+                    } else {
+                        std::fill(target.bools.begin(), target.bools.end(), std::get<bool>(instruction.constant));
+                    }
+                }
+                return true;
+
+            case Operation::TO_FLOAT:
+                simd::toFloat(left.ints.data(), target.floats.data(), count);
+                return true;
+
+            case Operation::NOT:
+                for (size_t i = 0; i < count; i++) {
+                    target.bools[i] = left.bools[i] ^ 1;
+                }
+                return true;
+
+            case Operation::AND:
+                for (size_t i = 0; i < count; i++) {
+                    target.bools[i] = left.bools[i] & right.bools[i];
+                }
+                return true;
+
+            case Operation::OR:
+                for (size_t i = 0; i < count; i++) {
+                    target.bools[i] = left.bools[i] | right.bools[i];
+                }
+                return true;
+
+            case Operation::ARITHMETIC:
+                if (instruction.type == ast::StaticType::INT) {
+                    return arithmetic(instruction.operatorType, left.ints.data(), right.ints.data(), target.ints.data(), count);
+                }
+
+                arithmetic(instruction.operatorType, left.floats.data(), right.floats.data(), target.floats.data(), count);
+                return true;
+
+            case Operation::COMPARE:
+                if (instruction.type == ast::StaticType::INT) {
+                    simd::compare(*comparison(instruction.operatorType), left.ints.data(), right.ints.data(), target.bools.data(), count);
+                } else if (instruction.type == ast::StaticType::FLOAT) {
+                    simd::compare(*comparison(instruction.operatorType), left.floats.data(), right.floats.data(), target.bools.data(), count);
+                } else {
+                    uint8_t equal = instruction.operatorType == token::TokenType::OPERATOR_EQ;
+
+                    for (size_t i = 0; i < count; i++) {
+                        target.bools[i] = (left.bools[i] ^ right.bools[i]) ^ equal;
+                    }
+                }
+                return true;
+        }
+
+        return true;
+    }
+
+    env::VariantType valueAt(const Register& value, size_t row) {
+        switch (value.type) {
+            case ast::StaticType::INT:
+                return value.ints[row];
+            case ast::StaticType::FLOAT:
+                return value.floats[row];
+            default:
+                return value.bools[row] != 0;
+        }
+    }
+
+    /**
+     * The output columns, created with the type of the first value stored in them. An int column becomes a float column
+     * once a float or a big int is stored in it, as int arithmetic would promote the ints.
+     */
+    class Results {
+    public:
+        Results(const std::vector<std::string>& names, size_t rows) : columns(names.size()), names(names), rows(rows) {}
+
+        void store(size_t output, size_t row, const env::VariantType& value) {
+            if (const int* integer = std::get_if<int>(&value)) {
+                if (widened(output)) {
+                    column<float>(output)[row] = static_cast<float>(*integer);
+                } else {
+                    column<int>(output)[row] = *integer;
+                }
+            } else if (const float* real = std::get_if<float>(&value)) {
+                widen(output);
+                column<float>(output)[row] = *real;
+            } else if (const auto* big = std::get_if<types::BigInt>(&value)) {
+                widen(output);
+                column<float>(output)[row] = big->toFloat();
+            } else if (const bool* boolean = std::get_if<bool>(&value)) {
+                column<uint8_t>(output)[row] = *boolean;
+            } else {
+                // the caller adds the row
+                throw std::runtime_error("Output " + names[output] + " must be a bool, int or float");
+            }
+        }
+
+        void store(size_t output, size_t begin, const Register& value, size_t count) {
+            switch (value.type) {
+                case ast::StaticType::INT:
+                    if (widened(output)) {
+                        simd::toFloat(value.ints.data(), column<float>(output).data() + begin, count);
+                    } else {
+                        std::memcpy(column<int>(output).data() + begin, value.ints.data(), count * sizeof(int));
+                    }
+                    break;
+                case ast::StaticType::FLOAT:
+                    std::memcpy(column<float>(output).data() + begin, value.floats.data(), count * sizeof(float));
+                    break;
+                default:
+                    std::memcpy(column<uint8_t>(output).data() + begin, value.bools.data(), count);
+                    break;
+            }
+        }
+
+        std::vector<std::optional<batch::Column::Values>> columns;
+
+    private:
+        /**
+         * @return True if the output is a float column, so ints stored in it are converted
+         */
+        bool widened(size_t output) const {
+            return columns[output] && std::holds_alternative<std::vector<float>>(*columns[output]);
+        }
+
+        /**
+         * Turns an int column into a float column.
+         */
+        void widen(size_t output) {
+            if (columns[output]) {
+                if (auto* ints = std::get_if<std::vector<int>>(&*columns[output])) {
+                    std::vector<float> floats(ints->size());
+                    simd::toFloat(ints->data(), floats.data(), ints->size());
+                    columns[output] = std::move(floats);
+                }
+            }
+        }
+
+        template<typename T>
+        std::vector<T>& column(size_t output) {
+            if (!columns[output]) {
+                columns[output] = std::vector<T>(rows);
+            }
+
+            if (auto* values = std::get_if<std::vector<T>>(&*columns[output])) {
+                return *values;
+            }
+
+            throw std::runtime_error("Output " + names[output] + " has different types in different rows");
+        }
+
+        const std::vector<std::string>& names;
+        size_t rows;
+    };
+}
+
+
+batch::Column::Column(std::vector<int> values) : values(std::move(values)) {}
+
+batch::Column::Column(std::vector<float> values) : values(std::move(values)) {}
+
+batch::Column::Column(const std::vector<bool>& values) : values(std::vector<uint8_t>(values.begin(), values.end())) {}
+
+batch::Column::Column(Values values) : values(std::move(values)) {}
+
+ast::StaticType batch::Column::type() const {
+    switch (values.index()) {
+        case 0:
+            return ast::StaticType::INT;
+        case 1:
+            return ast::StaticType::FLOAT;
+        default:
+            return ast::StaticType::BOOL;
+    }
+}
+
+size_t batch::Column::size() const {
+    return std::visit([](const auto& column) { return column.size(); }, values);
+}
+
+const std::vector<int>& batch::Column::ints() const {
+    return std::get<std::vector<int>>(values);
+}
+
+const std::vector<float>& batch::Column::floats() const {
+    return std::get<std::vector<float>>(values);
+}
+
+const std::vector<uint8_t>& batch::Column::bools() const {
+    return std::get<std::vector<uint8_t>>(values);
+}
+
+env::VariantType batch::Column::at(size_t row) const {
+    switch (values.index()) {
+        case 0:
+            return ints()[row];
+        case 1:
+            return floats()[row];
+        default:
+            return bools()[row] != 0;
+    }
+}
+
+
+batch::Program::Program(const std::string& source) : root(frontend::parse(source)), statements(root.children()) {}
+
+batch::Table batch::Program::run(const Table& inputs, const std::vector<std::string>& outputs, Report* report) const {
+    size_t rows = inputs.empty() ? 0 : inputs.begin()->second.size();
+
+    for (const auto& [name, column] : inputs) {
+        if (column.size() != rows) {
+            throw std::runtime_error("Input " + name + " has " + std::to_string(column.size()) + " rows, but another input has "
+                                     + std::to_string(rows));
+        }
+    }
+
+    Compiler compiler{inputs};
+    size_t columnStatements = 0;
+
+    while (columnStatements < statements.size() && compiler.compileStatement(*statements[columnStatements])) {
+        columnStatements++;
+    }
+
+    ast::RootNode rowProgram{std::vector<std::shared_ptr<ast::ASTNode>>(statements.begin() + static_cast<std::ptrdiff_t>(columnStatements), statements.end())};
+    bool rowStatements = columnStatements < statements.size();
+
+    // the registers that hold the outputs, if the whole script runs a column at a time
+    std::vector<uint32_t> outputRegisters;
+    if (!rowStatements) {
+        for (const std::string& output : outputs) {
+            std::optional<uint32_t> value = compiler.variable(output);
+
+            if (!value) {
+                throw std::runtime_error("Output " + output + " is not assigned by the script");
+            }
+
+            outputRegisters.push_back(*value);
+        }
+    }
+
+    std::vector<Register> registers(compiler.registers.size());
+    for (size_t i = 0; i < registers.size(); i++) {
+        registers[i].type = compiler.registers[i];
+
+        switch (registers[i].type) {
+            case ast::StaticType::INT:
+                registers[i].ints.resize(BLOCK_ROWS);
+                break;
+            case ast::StaticType::FLOAT:
+                registers[i].floats.resize(BLOCK_ROWS);
+                break;
+            default:
+                registers[i].bools.resize(BLOCK_ROWS);
+                break;
+        }
+    }
+
+    Results results{outputs, rows};
+    env::Environment rowEnv;
+    size_t fallbackRows = 0;
+
+    // runs part of the script on one row, with the inputs and the given variables defined
+    auto runRow = [&](size_t row, const ast::RootNode& program, const std::unordered_map<std::string, uint32_t>* variables, size_t blockRow) {
+        rowEnv.clear();
+
+        for (const auto& [name, column] : inputs) {
+            rowEnv.define(name, column.at(row));
+        }
+
+        if (variables != nullptr) {
+            for (const auto& [name, value] : *variables) {
+                rowEnv.define(name, valueAt(registers[value], blockRow));
+            }
+        }
+
+        try {
+            program.eval(rowEnv);
+
+            for (size_t i = 0; i < outputs.size(); i++) {
+                results.store(i, row, rowEnv.get(outputs[i]));
+            }
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error("Row " + std::to_string(row) + ": " + e.what());
+        }
+    };
+
+    for (size_t begin = 0; begin < rows; begin += BLOCK_ROWS) {
+        size_t count = std::min(BLOCK_ROWS, rows - begin);
+        bool vectorized = true;
+
+        for (const Instruction& instruction : compiler.instructions) {
+            if (!execute(instruction, registers, begin, count)) {
+                vectorized = false;
+                break;
+            }
+        }
+
+        if (!vectorized) {
+            for (size_t row = begin; row < begin + count; row++) {
+                runRow(row, root, nullptr, 0);
+            }
+
+            fallbackRows += count;
+        } else if (rowStatements) {
+            for (size_t row = begin; row < begin + count; row++) {
+                runRow(row, rowProgram, &compiler.variables, row - begin);
+            }
+        } else {
+            for (size_t i = 0; i < outputs.size(); i++) {
+                results.store(i, begin, registers[outputRegisters[i]], count);
+            }
+        }
+    }
+
+    if (report != nullptr) {
+        report->columnStatements = columnStatements;
+        report->rowStatements = statements.size() - columnStatements;
+        report->fallbackRows = fallbackRows;
+    }
+
+    Table table;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        // no rows, so no types seen: an empty int column
+        table.emplace(outputs[i], Column{results.columns[i] ? std::move(*results.columns[i]) : Column::Values{std::vector<int>{}}});
+    }
+
+    return table;
+}
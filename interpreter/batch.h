@@ -0,0 +1,98 @@
+#ifndef SPL_BATCH_H
+#define SPL_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "ast.h"
+
+/**
+ * Runs one script over many rows of input at once, e.g., to evaluate a rule for every record of a table.
+ *
+ * The inputs are columns: contiguous arrays of ints, floats or bools, one element per row. The script's leading
+ * assignments of arithmetic, comparisons and boolean logic over the inputs are run a column at a time with the SIMD
+ * kernels in simd.h. The statements after the first one that can't be run that way (a loop, a call, a string, ...) run
+ * once per row with the tree walker, seeing the inputs and the variables assigned so far. Either way, every row gets the
+ * result running the script on that row alone would give: a block of rows where an int operation overflows or divides
+ * by zero is run again one row at a time.
+ *
+ * An output column has the type of the output's values. An output that is an int in some rows and a float or a big int
+ * in others, e.g., because a product overflowed, becomes a float column.
+ */
+namespace batch {
+    /**
+     * The values of one variable for every row.
+     */
+    class Column {
+    public:
+        using Values = std::variant<std::vector<int>, std::vector<float>, std::vector<uint8_t>>;
+
+        explicit Column(std::vector<int> values);
+        explicit Column(std::vector<float> values);
+        explicit Column(const std::vector<bool>& values);
+
+        /**
+         * @return BOOL, INT or FLOAT
+         */
+        [[nodiscard]] ast::StaticType type() const;
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @throws std::bad_variant_access if the column holds another type
+         */
+        [[nodiscard]] const std::vector<int>& ints() const;
+        [[nodiscard]] const std::vector<float>& floats() const;
+
+        /**
+         * @return One byte per row, 1 for true and 0 for false
+         */
+        [[nodiscard]] const std::vector<uint8_t>& bools() const;
+
+        [[nodiscard]] env::VariantType at(size_t row) const;
+
+    private:
+        friend class Program;
+
+        explicit Column(Values values);
+
+        Values values;
+    };
+
+    using Table = std::unordered_map<std::string, Column>;
+
+    struct Report {
+        size_t columnStatements = 0;  // leading statements run a column at a time
+        size_t rowStatements = 0;  // statements run once per row
+        size_t fallbackRows = 0;  // rows run one at a time because a column operation overflowed or divided by zero
+    };
+
+    class Program {
+    public:
+        /**
+         * @throws std::runtime_error if the source cannot be tokenized or parsed
+         */
+        explicit Program(const std::string& source);
+
+        /**
+         * Runs the script once for every row of the inputs.
+         * @param inputs The input variables. All columns must have the same number of rows
+         * @param outputs The variables to collect after each row
+         * @param report If set, receives which parts of the script ran a column at a time
+         * @return A column for each output
+         * @throws std::runtime_error if the inputs differ in length, the script fails on a row, or an output is not a
+         * bool, int, big int or float, or is a bool in some rows and a number in others
+         */
+        Table run(const Table& inputs, const std::vector<std::string>& outputs, Report* report = nullptr) const;
+
+    private:
+        ast::RootNode root;
+        std::vector<std::shared_ptr<ast::ASTNode>> statements;  // the root's statements, for compiling
+    };
+}
+
+#endif  // SPL_BATCH_H
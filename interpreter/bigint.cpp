@@ -0,0 +1,362 @@
+#include "environment.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+    using Digits = std::vector<uint32_t>;
+
+    constexpr uint64_t BASE = uint64_t{1} << 32;
+    constexpr uint32_t DECIMAL_CHUNK = 1000000000;  // the largest power of 10 that fits in a digit
+    constexpr int DECIMAL_CHUNK_DIGITS = 9;
+
+    void trim(Digits& digits) {
+        while (!digits.empty() && digits.back() == 0) {
+            digits.pop_back();
+        }
+    }
+
+    int compareMagnitudes(const Digits& left, const Digits& right) {
+        if (left.size() != right.size()) {
+            return left.size() < right.size() ? -1 : 1;
+        }
+
+        for (size_t i = left.size(); i-- > 0;) {
+            if (left[i] != right[i]) {
+                return left[i] < right[i] ? -1 : 1;
+            }
+        }
+
+        return 0;
+    }
+
+    Digits addMagnitudes(const Digits& left, const Digits& right) {
+        const Digits& longer = left.size() >= right.size() ? left : right;
+        const Digits& shorter = left.size() >= right.size() ? right : left;
+
+        Digits sum;
+        sum.reserve(longer.size() + 1);
+        uint64_t carry = 0;
+
+        for (size_t i = 0; i < longer.size(); i++) {
+            uint64_t digit = uint64_t{longer[i]} + (i < shorter.size() ? shorter[i] : 0) + carry;
+            sum.push_back(static_cast<uint32_t>(digit));
+            carry = digit >> 32;
+        }
+
+        if (carry != 0) {
+            sum.push_back(static_cast<uint32_t>(carry));
+        }
+
+        return sum;
+    }
+
+    /**
+     * @param larger Must not be smaller than smaller
+     */
+    Digits subtractMagnitudes(const Digits& larger, const Digits& smaller) {
+        Digits difference;
+        difference.reserve(larger.size());
+        int64_t borrow = 0;
+
+        for (size_t i = 0; i < larger.size(); i++) {
+            int64_t digit = int64_t{larger[i]} - (i < smaller.size() ? smaller[i] : 0) - borrow;
+            borrow = digit < 0;
+            difference.push_back(static_cast<uint32_t>(digit + (borrow ? static_cast<int64_t>(BASE) : 0)));
+        }
+
+        trim(difference);
+        return difference;
+    }
+
+    Digits multiplyMagnitudes(const Digits& left, const Digits& right) {
+        if (left.empty() || right.empty()) {
+            return {};
+        }
+
+        Digits product(left.size() + right.size(), 0);
+
+        for (size_t i = 0; i < left.size(); i++) {
+            uint64_t carry = 0;
+
+            for (size_t j = 0; j < right.size(); j++) {
+                uint64_t digit = uint64_t{left[i]} * right[j] + product[i + j] + carry;
+                product[i + j] = static_cast<uint32_t>(digit);
+                carry = digit >> 32;
+            }
+
+            product[i + right.size()] = static_cast<uint32_t>(carry);
+        }
+
+        trim(product);
+        return product;
+    }
+
+    /**
+     * Divides by a single digit in place.
+     * @return The remainder
+     */
+    uint32_t divideBySmall(Digits& digits, uint32_t divisor) {
+        uint64_t remainder = 0;
+
+        for (size_t i = digits.size(); i-- > 0;) {
+            uint64_t current = (remainder << 32) | digits[i];
+            digits[i] = static_cast<uint32_t>(current / divisor);
+            remainder = current % divisor;
+        }
+
+        trim(digits);
+        return static_cast<uint32_t>(remainder);
+    }
+
+    /**
+     * Long division, one bit at a time. Slow for huge numbers, but script integers rarely grow that large.
+     */
+    std::pair<Digits, Digits> divideMagnitudes(const Digits& dividend, const Digits& divisor) {
+        if (divisor.size() == 1) {
+            Digits quotient = dividend;
+            uint32_t remainder = divideBySmall(quotient, divisor[0]);
+
+            return {std::move(quotient), remainder != 0 ? Digits{remainder} : Digits{}};
+        }
+
+        Digits quotient(dividend.size(), 0);
+        Digits remainder;
+
+        for (size_t bit = dividend.size() * 32; bit-- > 0;) {
+            // remainder = remainder * 2 + the next bit of the dividend
+            uint32_t carry = (dividend[bit / 32] >> (bit % 32)) & 1;
+            for (uint32_t& digit : remainder) {
+                uint32_t next = digit >> 31;
+                digit = (digit << 1) | carry;
+                carry = next;
+            }
+            if (carry != 0) {
+                remainder.push_back(carry);
+            }
+
+            if (compareMagnitudes(remainder, divisor) >= 0) {
+                remainder = subtractMagnitudes(remainder, divisor);
+                quotient[bit / 32] |= uint32_t{1} << (bit % 32);
+            }
+        }
+
+        trim(quotient);
+        return {std::move(quotient), std::move(remainder)};
+    }
+
+    Digits fromUnsigned(uint64_t value) {
+        Digits digits;
+
+        while (value != 0) {
+            digits.push_back(static_cast<uint32_t>(value));
+            value >>= 32;
+        }
+
+        return digits;
+    }
+}
+
+
+types::BigInt::BigInt(int64_t value)
+    // negating in unsigned arithmetic is defined for INT64_MIN too
+    : BigInt(value < 0, fromUnsigned(value < 0 ? ~static_cast<uint64_t>(value) + 1 : static_cast<uint64_t>(value))) {}
+
+types::BigInt::BigInt(bool negative, std::vector<uint32_t> digits)
+    : negative(negative && !digits.empty()), magnitude(std::make_shared<const Digits>(std::move(digits))) {}
+
+types::BigInt types::BigInt::parse(std::string_view text) {
+    bool negative = !text.empty() && text[0] == '-';
+    size_t start = negative ? 1 : 0;
+
+    if (start == text.size()) {
+        throw std::runtime_error("Invalid integer: " + std::string(text));
+    }
+
+    Digits digits;
+
+    for (size_t i = start; i < text.size(); i += DECIMAL_CHUNK_DIGITS) {
+        size_t length = std::min<size_t>(DECIMAL_CHUNK_DIGITS, text.size() - i);
+        uint64_t chunk = 0;
+        uint64_t scale = 1;
+
+        for (size_t j = i; j < i + length; j++) {
+            if (text[j] < '0' || text[j] > '9') {
+                throw std::runtime_error("Invalid integer: " + std::string(text));
+            }
+
+            chunk = chunk * 10 + static_cast<uint64_t>(text[j] - '0');
+            scale *= 10;
+        }
+
+        // digits = digits * scale + chunk
+        uint64_t carry = chunk;
+        for (uint32_t& digit : digits) {
+            uint64_t current = uint64_t{digit} * scale + carry;
+            digit = static_cast<uint32_t>(current);
+            carry = current >> 32;
+        }
+        if (carry != 0) {
+            digits.push_back(static_cast<uint32_t>(carry));
+        }
+    }
+
+    trim(digits);
+    return BigInt{negative, std::move(digits)};
+}
+
+types::BigInt types::BigInt::fromDigits(bool negative, std::vector<uint32_t> digits) {
+    trim(digits);
+    return BigInt{negative, std::move(digits)};
+}
+
+types::BigInt types::BigInt::add(const BigInt& left, const BigInt& right) {
+    if (left.negative == right.negative) {
+        return BigInt{left.negative, addMagnitudes(*left.magnitude, *right.magnitude)};
+    }
+
+    // the signs differ: subtract the smaller magnitude from the larger, and keep the sign of the larger
+    if (compareMagnitudes(*left.magnitude, *right.magnitude) >= 0) {
+        return BigInt{left.negative, subtractMagnitudes(*left.magnitude, *right.magnitude)};
+    }
+
+    return BigInt{right.negative, subtractMagnitudes(*right.magnitude, *left.magnitude)};
+}
+
+types::BigInt types::BigInt::subtract(const BigInt& left, const BigInt& right) {
+    BigInt negated = right;
+    negated.negative = !right.negative && !right.isZero();
+
+    return add(left, negated);
+}
+
+types::BigInt types::BigInt::multiply(const BigInt& left, const BigInt& right) {
+    return BigInt{left.negative != right.negative, multiplyMagnitudes(*left.magnitude, *right.magnitude)};
+}
+
+types::BigInt types::BigInt::divide(const BigInt& left, const BigInt& right) {
+    if (right.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+
+    return BigInt{left.negative != right.negative, divideMagnitudes(*left.magnitude, *right.magnitude).first};
+}
+
+types::BigInt types::BigInt::remainder(const BigInt& left, const BigInt& right) {
+    if (right.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+
+    return BigInt{left.negative, divideMagnitudes(*left.magnitude, *right.magnitude).second};
+}
+
+int types::BigInt::compare(const BigInt& other) const {
+    if (negative != other.negative) {
+        return negative ? -1 : 1;
+    }
+
+    int magnitudes = compareMagnitudes(*magnitude, *other.magnitude);
+    return negative ? -magnitudes : magnitudes;
+}
+
+bool types::BigInt::operator==(const BigInt& other) const {
+    return compare(other) == 0;
+}
+
+bool types::BigInt::isNegative() const {
+    return negative;
+}
+
+bool types::BigInt::isZero() const {
+    return magnitude->empty();
+}
+
+std::optional<int64_t> types::BigInt::toInt64() const {
+    if (magnitude->size() > 2) {
+        return std::nullopt;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = magnitude->size(); i-- > 0;) {
+        value = (value << 32) | (*magnitude)[i];
+    }
+
+    uint64_t limit = negative ? uint64_t{1} << 63 : (uint64_t{1} << 63) - 1;
+    if (value > limit) {
+        return std::nullopt;
+    }
+
+    return negative ? static_cast<int64_t>(~value + 1) : static_cast<int64_t>(value);
+}
+
+float types::BigInt::toFloat() const {
+    double value = 0;
+
+    for (size_t i = magnitude->size(); i-- > 0;) {
+        value = value * static_cast<double>(BASE) + (*magnitude)[i];
+    }
+
+    return static_cast<float>(negative ? -value : value);
+}
+
+std::string types::BigInt::toString() const {
+    if (isZero()) {
+        return "0";
+    }
+
+    Digits remaining = *magnitude;
+    std::vector<uint32_t> chunks;  // base 10^9, least significant first
+
+    while (!remaining.empty()) {
+        chunks.push_back(divideBySmall(remaining, DECIMAL_CHUNK));
+    }
+
+    std::string text = negative ? "-" : "";
+    text += std::to_string(chunks.back());
+
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        std::string chunk = std::to_string(chunks[i]);
+        text.append(DECIMAL_CHUNK_DIGITS - chunk.size(), '0');
+        text += chunk;
+    }
+
+    return text;
+}
+
+const std::vector<uint32_t>& types::BigInt::digits() const {
+    return *magnitude;
+}
+
+size_t types::BigInt::heapBytes() const {
+    return sizeof(Digits) + magnitude->capacity() * sizeof(uint32_t);
+}
+
+
+env::VariantType types::normalize(const BigInt& value) {
+    std::optional<int64_t> small = value.toInt64();
+
+    if (small && *small >= INT_MIN && *small <= INT_MAX) {
+        return static_cast<int>(*small);
+    }
+
+    return value;
+}
+
+env::VariantType types::parseInteger(const std::string& text) {
+    return normalize(BigInt::parse(text));
+}
+
+bool types::isInteger(const env::VariantType& value) {
+    return std::holds_alternative<int>(value) || std::holds_alternative<BigInt>(value);
+}
+
+types::BigInt types::toBigInt(const env::VariantType& value) {
+    if (const int* small = std::get_if<int>(&value)) {
+        return BigInt{*small};
+    }
+
+    return std::get<BigInt>(value);
+}
@@ -0,0 +1,109 @@
+#ifndef SPL_BIGINT_H
+#define SPL_BIGINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// This header is included by environment.h after env::VariantType is declared
+
+namespace types {
+    /**
+     * An arbitrary-precision integer, for the results of integer arithmetic that overflow an int. Scripts see big ints
+     * as ints: arithmetic on ints stays on plain ints, and only switches to a BigInt when a result doesn't fit. Results
+     * that fit an int again are turned back into ints (see normalize).
+     *
+     * The digits are immutable and shared between copies, so copying a BigInt does not allocate.
+     */
+    class BigInt {
+    public:
+        explicit BigInt(int64_t value);
+
+        /**
+         * Parses a decimal integer with an optional leading '-'.
+         * @throws std::runtime_error if the text is not an integer
+         */
+        static BigInt parse(std::string_view text);
+
+        /**
+         * @param negative The sign. Ignored for zero
+         * @param digits The magnitude in base 2^32, least significant digit first, as returned by digits()
+         */
+        static BigInt fromDigits(bool negative, std::vector<uint32_t> digits);
+
+        static BigInt add(const BigInt& left, const BigInt& right);
+        static BigInt subtract(const BigInt& left, const BigInt& right);
+        static BigInt multiply(const BigInt& left, const BigInt& right);
+
+        /**
+         * Divides, rounding toward zero like int division does.
+         * @throws std::runtime_error if the divisor is zero
+         */
+        static BigInt divide(const BigInt& left, const BigInt& right);
+
+        /**
+         * The remainder of divide, which has the sign of the dividend like int % does.
+         * @throws std::runtime_error if the divisor is zero
+         */
+        static BigInt remainder(const BigInt& left, const BigInt& right);
+
+        /**
+         * @return A negative number, zero or a positive number if this is less than, equal to or greater than other
+         */
+        [[nodiscard]] int compare(const BigInt& other) const;
+        bool operator==(const BigInt& other) const;
+
+        [[nodiscard]] bool isNegative() const;
+        [[nodiscard]] bool isZero() const;
+
+        /**
+         * @return The value, or nothing if it does not fit in 64 bits
+         */
+        [[nodiscard]] std::optional<int64_t> toInt64() const;
+        [[nodiscard]] float toFloat() const;
+        [[nodiscard]] std::string toString() const;
+
+        /**
+         * @return The magnitude in base 2^32, least significant digit first. Empty for zero
+         */
+        [[nodiscard]] const std::vector<uint32_t>& digits() const;
+
+        /**
+         * @return The bytes of heap memory the digits use
+         */
+        [[nodiscard]] size_t heapBytes() const;
+
+    private:
+        BigInt(bool negative, std::vector<uint32_t> magnitude);
+
+        bool negative;
+        std::shared_ptr<const std::vector<uint32_t>> magnitude;
+    };
+
+    /**
+     * @return The value as an int if it fits in one, otherwise as a BigInt
+     */
+    env::VariantType normalize(const BigInt& value);
+
+    /**
+     * Parses an integer literal.
+     * @return An int if the literal fits in one, otherwise a BigInt
+     */
+    env::VariantType parseInteger(const std::string& text);
+
+    /**
+     * @return True if the value is an int or a BigInt
+     */
+    [[nodiscard]] bool isInteger(const env::VariantType& value);
+
+    /**
+     * @return An int or BigInt as a BigInt
+     */
+    [[nodiscard]] BigInt toBigInt(const env::VariantType& value);
+}
+
+#endif  // SPL_BIGINT_H
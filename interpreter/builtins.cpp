@@ -0,0 +1,492 @@
+#include "builtins.h"
+
+#include "array.h"
+#include "simd.h"
+#include "io.h"
+#include "green.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace {
+    const types::Array& expectArray(const std::string& name, const env::VariantType& value) {
+        if (!std::holds_alternative<types::Array>(value)) {
+            throw std::runtime_error("Function " + name + " expects an array");
+        }
+
+        return std::get<types::Array>(value);
+    }
+
+    const types::Dict& expectDict(const std::string& name, const env::VariantType& value) {
+        if (!std::holds_alternative<types::Dict>(value)) {
+            throw std::runtime_error("Function " + name + " expects a dictionary");
+        }
+
+        return std::get<types::Dict>(value);
+    }
+
+    size_t expectPosition(const std::string& name, const env::VariantType& value) {
+        if (!std::holds_alternative<int>(value) || std::get<int>(value) < 0) {
+            throw std::runtime_error("Function " + name + " expects a non-negative int position");
+        }
+
+        return static_cast<size_t>(std::get<int>(value));
+    }
+
+    std::string_view expectString(const std::string& name, const env::VariantType& value) {
+        if (!types::isString(value)) {
+            throw std::runtime_error("Function " + name + " expects a string");
+        }
+
+        return types::stringView(value);
+    }
+
+    void expectNonEmpty(const std::string& name, const types::Array& array) {
+        if (array.size() == 0) {
+            throw std::runtime_error("Function " + name + " called on an empty array");
+        }
+    }
+
+    std::vector<float> toFloats(const types::Array& array) {
+        if (array.elementType() == types::ElementType::FLOAT) {
+            return array.floats();
+        }
+
+        return std::vector<float>(array.ints().begin(), array.ints().end());
+    }
+
+    env::VariantType len(const std::vector<env::VariantType>& arguments) {
+        if (types::isString(arguments[0])) {
+            return static_cast<int>(types::stringView(arguments[0]).size());
+        }
+
+        if (std::holds_alternative<types::Dict>(arguments[0])) {
+            return static_cast<int>(std::get<types::Dict>(arguments[0]).size());
+        }
+
+        return static_cast<int>(expectArray("len", arguments[0]).size());
+    }
+
+    /**
+     * substr(text, start, count): the count characters from start on, as a slice. A slice is sliced again, which
+     * takes constant time and does not allocate; only the part of a std::string is copied, into a buffer of its own.
+     * Long strings are slices once they are stored in a variable (see types::share), so slicing one repeatedly doesn't
+     * copy it every time.
+     */
+    env::VariantType substr(const std::vector<env::VariantType>& arguments) {
+        size_t size = expectString("substr", arguments[0]).size();
+        size_t start = expectPosition("substr", arguments[1]);
+        size_t count = expectPosition("substr", arguments[2]);
+
+        if (start > size || count > size - start) {
+            throw std::runtime_error("Function substr called with a range past the end of the string");
+        }
+
+        if (const auto* slice = std::get_if<types::StringSlice>(&arguments[0])) {
+            return slice->substr(start, count);
+        }
+
+        return types::StringSlice::owning(std::string(types::stringView(arguments[0]).substr(start, count)));
+    }
+
+    /**
+     * find(text, needle) or find(text, needle, from): the position of the first needle at or after from, or -1.
+     */
+    env::VariantType find(const std::vector<env::VariantType>& arguments) {
+        if (arguments.size() != 2 && arguments.size() != 3) {
+            throw std::runtime_error("Function find expects 2 or 3 arguments, but got " + std::to_string(arguments.size()));
+        }
+
+        std::string_view text = expectString("find", arguments[0]);
+        std::string_view needle = expectString("find", arguments[1]);
+        size_t from = arguments.size() == 3 ? expectPosition("find", arguments[2]) : 0;
+
+        size_t position = text.find(needle, from);
+        return position == std::string_view::npos ? -1 : static_cast<int>(position);
+    }
+
+    /**
+     * split(text, separator): the pieces between separators, as a dictionary from 0, 1, ... to slices of the text.
+     * A dictionary since arrays only hold numbers. A std::string is copied into one buffer for the pieces to share;
+     * long strings stored in variables are slices already (see types::share).
+     */
+    env::VariantType split(const std::vector<env::VariantType>& arguments) {
+        expectString("split", arguments[0]);
+        std::string_view separator = expectString("split", arguments[1]);
+
+        if (separator.empty()) {
+            throw std::runtime_error("Function split expects a non-empty separator");
+        }
+
+        types::StringSlice text = types::toSlice(arguments[0]);
+        std::string_view view = text.view();
+        types::Dict pieces;
+
+        size_t start = 0;
+        for (int index = 0; ; index++) {
+            size_t end = view.find(separator, start);
+
+            if (end == std::string_view::npos) {
+                pieces.set(index, text.substr(start, view.size() - start));
+                return pieces;
+            }
+
+            pieces.set(index, text.substr(start, end - start));
+            start = end + separator.size();
+        }
+    }
+
+    env::VariantType push(const std::vector<env::VariantType>& arguments) {
+        types::Array array = expectArray("push", arguments[0]);
+
+        if (std::holds_alternative<int>(arguments[1])) {
+            array.push(std::get<int>(arguments[1]));
+        } else if (std::holds_alternative<float>(arguments[1])) {
+            array.push(std::get<float>(arguments[1]));
+        } else {
+            throw std::runtime_error("Arrays can only hold ints and floats");
+        }
+
+        return static_cast<int>(array.size());
+    }
+
+    /**
+     * An int, or a big int if the value doesn't fit one, like the result of int arithmetic.
+     */
+    env::VariantType integer(int64_t value) {
+        if (value >= INT_MIN && value <= INT_MAX) {
+            return static_cast<int>(value);
+        }
+
+        return types::BigInt{value};
+    }
+
+    env::VariantType sum(const std::vector<env::VariantType>& arguments) {
+        const types::Array& array = expectArray("sum", arguments[0]);
+
+        if (array.elementType() == types::ElementType::INT) {
+            return integer(simd::sum(array.ints().data(), array.size()));
+        }
+
+        return simd::sum(array.floats().data(), array.size());
+    }
+
+    env::VariantType min(const std::vector<env::VariantType>& arguments) {
+        const types::Array& array = expectArray("min", arguments[0]);
+        expectNonEmpty("min", array);
+
+        if (array.elementType() == types::ElementType::INT) {
+            return simd::min(array.ints().data(), array.size());
+        }
+
+        return simd::min(array.floats().data(), array.size());
+    }
+
+    env::VariantType max(const std::vector<env::VariantType>& arguments) {
+        const types::Array& array = expectArray("max", arguments[0]);
+        expectNonEmpty("max", array);
+
+        if (array.elementType() == types::ElementType::INT) {
+            return simd::max(array.ints().data(), array.size());
+        }
+
+        return simd::max(array.floats().data(), array.size());
+    }
+
+    env::VariantType dot(const std::vector<env::VariantType>& arguments) {
+        const types::Array& left = expectArray("dot", arguments[0]);
+        const types::Array& right = expectArray("dot", arguments[1]);
+
+        if (left.size() != right.size()) {
+            throw std::runtime_error("Function dot expects arrays of the same size");
+        }
+
+        if (left.elementType() == types::ElementType::INT && right.elementType() == types::ElementType::INT) {
+            const std::vector<int>& leftInts = left.ints();
+            const std::vector<int>& rightInts = right.ints();
+            int64_t result;
+
+            if (simd::dot(leftInts.data(), rightInts.data(), left.size(), result)) {
+                return integer(result);
+            }
+
+            // only sums of huge products overflow 64 bits, so the big int path is rarely taken
+            types::BigInt total{0};
+            for (size_t i = 0; i < left.size(); i++) {
+                total = types::BigInt::add(total, types::BigInt{static_cast<int64_t>(leftInts[i]) * rightInts[i]});
+            }
+
+            return types::normalize(total);
+        }
+
+        if (left.elementType() == types::ElementType::FLOAT && right.elementType() == types::ElementType::FLOAT) {
+            return simd::dot(left.floats().data(), right.floats().data(), left.size());
+        }
+
+        // mixed element types: widen the int side into a temporary
+        std::vector<float> leftFloats = toFloats(left);
+        std::vector<float> rightFloats = toFloats(right);
+
+        return simd::dot(leftFloats.data(), rightFloats.data(), left.size());
+    }
+
+    env::VariantType sort(const std::vector<env::VariantType>& arguments) {
+        types::Array array = expectArray("sort", arguments[0]);
+
+        if (array.elementType() == types::ElementType::INT) {
+            std::vector<int>& ints = array.mutableInts();
+            std::sort(ints.begin(), ints.end());
+        } else {
+            std::vector<float>& floats = array.mutableFloats();
+            std::sort(floats.begin(), floats.end());
+        }
+
+        return array;
+    }
+
+    /**
+     * Shared implementation of scale and offset. Returns a new array, promoted to floats if the scalar is a float.
+     * Arrays can't hold big ints, so an int element that overflows is an error.
+     */
+    template <typename IntKernel, typename FloatKernel>
+    env::VariantType mapScalar(const std::string& name, const std::vector<env::VariantType>& arguments,
+                               IntKernel intKernel, FloatKernel floatKernel) {
+        types::Array result = expectArray(name, arguments[0]).clone();
+
+        if (std::holds_alternative<float>(arguments[1])) {
+            result.promote();
+        } else if (!std::holds_alternative<int>(arguments[1])) {
+            throw std::runtime_error("Function " + name + " expects an int or float scalar");
+        }
+
+        if (result.elementType() == types::ElementType::INT) {
+            if (!intKernel(result.mutableInts().data(), result.size(), std::get<int>(arguments[1]))) {
+                throw std::runtime_error("Function " + name + " overflowed an int element; use a float scalar instead");
+            }
+        } else {
+            float scalar = std::holds_alternative<int>(arguments[1])
+                ? static_cast<float>(std::get<int>(arguments[1]))
+                : std::get<float>(arguments[1]);
+
+            floatKernel(result.mutableFloats().data(), result.size(), scalar);
+        }
+
+        return result;
+    }
+
+    env::VariantType scale(const std::vector<env::VariantType>& arguments) {
+        return mapScalar("scale", arguments,
+                         [](int* data, size_t size, int scalar) { return simd::scale(data, size, scalar); },
+                         [](float* data, size_t size, float scalar) { simd::scale(data, size, scalar); });
+    }
+
+    env::VariantType offset(const std::vector<env::VariantType>& arguments) {
+        return mapScalar("offset", arguments,
+                         [](int* data, size_t size, int scalar) { return simd::offset(data, size, scalar); },
+                         [](float* data, size_t size, float scalar) { simd::offset(data, size, scalar); });
+    }
+
+    /**
+     * get(dict, key) or get(dict, key, default). Without a default, a missing key is an error.
+     */
+    env::VariantType get(const std::vector<env::VariantType>& arguments) {
+        if (arguments.size() != 2 && arguments.size() != 3) {
+            throw std::runtime_error("Function get expects 2 or 3 arguments, but got " + std::to_string(arguments.size()));
+        }
+
+        const env::VariantType* value = expectDict("get", arguments[0]).find(arguments[1]);
+
+        if (value != nullptr) {
+            return *value;
+        } else if (arguments.size() == 3) {
+            return arguments[2];
+        }
+
+        throw std::runtime_error("Key not found in dictionary");
+    }
+
+    env::VariantType set(const std::vector<env::VariantType>& arguments) {
+        types::Dict dict = expectDict("set", arguments[0]);
+
+        dict.set(arguments[1], arguments[2]);
+
+        return arguments[2];
+    }
+
+    env::VariantType has(const std::vector<env::VariantType>& arguments) {
+        return expectDict("has", arguments[0]).find(arguments[1]) != nullptr;
+    }
+
+    env::VariantType remove(const std::vector<env::VariantType>& arguments) {
+        types::Dict dict = expectDict("remove", arguments[0]);
+
+        return dict.remove(arguments[1]);
+    }
+
+    /**
+     * key(dict, i): the key of the i-th entry, in insertion order. Together with value and len this is how scripts
+     * iterate over a dictionary.
+     */
+    env::VariantType key(const std::vector<env::VariantType>& arguments) {
+        return expectDict("key", arguments[0]).keyAt(expectPosition("key", arguments[1]));
+    }
+
+    env::VariantType value(const std::vector<env::VariantType>& arguments) {
+        return expectDict("value", arguments[0]).valueAt(expectPosition("value", arguments[1]));
+    }
+
+    /**
+     * print(a, b, ...): writes the arguments separated by spaces and followed by a newline to the buffered standard
+     * output.
+     */
+    env::VariantType print(const std::vector<env::VariantType>& arguments) {
+        thread_local std::string line;
+        line.clear();
+
+        for (size_t i = 0; i < arguments.size(); i++) {
+            if (i > 0) {
+                line += ' ';
+            }
+
+            io::format(line, arguments[i]);
+        }
+        line += '\n';
+
+        io::standardOutput().write(line);
+
+        return 0;
+    }
+
+    env::VariantType flush(const std::vector<env::VariantType>&) {
+        io::standardOutput().flush();
+
+        return 0;
+    }
+
+    std::string expectPath(const std::string& name, const env::VariantType& value) {
+        if (!types::isString(value)) {
+            throw std::runtime_error("Function " + name + " expects a path string");
+        }
+
+        return std::string(types::stringView(value));
+    }
+
+    env::VariantType readall(const std::vector<env::VariantType>& arguments) {
+        return io::readAll(expectPath("readall", arguments[0]));
+    }
+
+    env::VariantType writeall(const std::vector<env::VariantType>& arguments) {
+        if (!types::isString(arguments[1])) {
+            throw std::runtime_error("Function writeall expects string contents");
+        }
+
+        return static_cast<int>(io::writeAll(expectPath("writeall", arguments[0]), types::stringView(arguments[1])));
+    }
+
+    /**
+     * Wraps the result of a background task in a handle: a native function that waits for the task when it is called
+     * and returns its result, or throws its error. Calling it again returns the same result.
+     */
+    types::NativeFunction makeHandle(const std::string& name, std::shared_future<env::VariantType> result) {
+        return types::NativeFunction{name, 0, [result = std::move(result)](const std::vector<env::VariantType>&) {
+            return result.get();
+        }};
+    }
+
+    /**
+     * readasync(path): starts reading a file in the background. Calling the returned handle gives what readall would.
+     */
+    env::VariantType readasync(const std::vector<env::VariantType>& arguments) {
+        return makeHandle("readasync", io::readAllAsync(expectPath("readasync", arguments[0])));
+    }
+
+    /**
+     * writeasync(path, contents): starts writing a file in the background. Calling the returned handle gives what
+     * writeall would.
+     */
+    env::VariantType writeasync(const std::vector<env::VariantType>& arguments) {
+        if (!types::isString(arguments[1])) {
+            throw std::runtime_error("Function writeasync expects string contents");
+        }
+
+        std::string path = expectPath("writeasync", arguments[0]);
+        return makeHandle("writeasync", io::writeAllAsync(path, std::string(types::stringView(arguments[1]))));
+    }
+
+    /**
+     * yield(): lets other scripts run. Returns true if the script is run by a scheduler (see green.h).
+     */
+    env::VariantType yieldScript(const std::vector<env::VariantType>&) {
+        return green::yield();
+    }
+
+    /**
+     * receive(): waits for the next message the host sends to the script.
+     */
+    env::VariantType receive(const std::vector<env::VariantType>&) {
+        return green::receive();
+    }
+
+    std::unordered_map<std::string, types::NativeFunction> makeBuiltins() {
+        std::unordered_map<std::string, types::NativeFunction> functions;
+
+        auto add = [&functions](const std::string& name, int arity, types::NativeFunction::Implementation implementation) {
+            functions.emplace(name, types::NativeFunction{name, arity, std::move(implementation)});
+        };
+
+        add("len",        1, len);
+        add("substr",     3, substr);
+        add("find",       types::NativeFunction::VARIADIC, find);
+        add("split",      2, split);
+        add("push",       2, push);
+        add("sum",        1, sum);
+        add("min",        1, min);
+        add("max",        1, max);
+        add("dot",        2, dot);
+        add("sort",       1, sort);
+        add("scale",      2, scale);
+        add("offset",     2, offset);
+        add("get",        types::NativeFunction::VARIADIC, get);
+        add("set",        3, set);
+        add("has",        2, has);
+        add("remove",     2, remove);
+        add("key",        2, key);
+        add("value",      2, value);
+        add("print",      types::NativeFunction::VARIADIC, print);
+        add("flush",      0, flush);
+        add("readall",    1, readall);
+        add("writeall",   2, writeall);
+        add("readasync",  1, readasync);
+        add("writeasync", 2, writeasync);
+        add("yield",      0, yieldScript);
+        add("receive",    0, receive);
+
+        return functions;
+    }
+
+    const std::unordered_map<std::string, types::NativeFunction> builtinFunctions = makeBuiltins();
+
+    const std::unordered_set<std::string> pureBuiltins = {
+        "len", "substr", "find", "split", "sum", "min", "max", "dot", "scale", "offset", "get", "has", "key", "value"
+    };
+}
+
+
+const types::NativeFunction* builtins::lookup(const std::string& name) {
+    auto it = builtinFunctions.find(name);
+
+    if (it == builtinFunctions.end()) {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+bool builtins::isPure(const std::string& name) {
+    return pureBuiltins.count(name) > 0;
+}
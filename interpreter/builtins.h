@@ -0,0 +1,29 @@
+#ifndef SPL_BUILTINS_H
+#define SPL_BUILTINS_H
+
+#include <string>
+#include <vector>
+
+#include "environment.h"
+
+/**
+ * Native functions that are always available to scripts without being registered in the environment. A variable with
+ * the same name (e.g., a function defined in the script) shadows the builtin.
+ */
+namespace builtins {
+    /**
+     * Looks up a builtin function by name.
+     * @param name The name of the function
+     * @return The builtin, or nullptr if there is no builtin with that name
+     */
+    [[nodiscard]] const types::NativeFunction* lookup(const std::string& name);
+
+    /**
+     * @param name The name of a builtin function
+     * @return True if the builtin neither modifies its arguments nor does I/O, so its result only depends on the
+     * values of its arguments
+     */
+    [[nodiscard]] bool isPure(const std::string& name);
+}
+
+#endif  // SPL_BUILTINS_H
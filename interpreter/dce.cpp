@@ -0,0 +1,306 @@
+#include "dce.h"
+
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+
+namespace {
+    using Names = std::unordered_set<std::string>;
+    using Functions = std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>>;
+
+    /**
+     * What the pass knows about the whole program. Shared with the hooks that prune function bodies parsed later.
+     */
+    struct Facts {
+        Names live;  // functions that can be called
+        Names reads;  // names read anywhere in the program
+        Names globals;  // names assigned outside of functions
+    };
+
+    // the bookkeeping of make_shared: a vtable pointer and the two reference counts
+    constexpr size_t CONTROL_BLOCK_BYTES = sizeof(void*) + 2 * sizeof(int);
+
+    template <typename... Nodes>
+    size_t objectSize(const ast::ASTNode& node) {
+        size_t size = sizeof(ast::ASTNode);
+        static_cast<void>(((typeid(node) == typeid(Nodes) ? (size = sizeof(Nodes), true) : false) || ...));
+
+        return size;
+    }
+
+    size_t stringBytes(const std::string& text) {
+        static const size_t inlineCapacity = std::string().capacity();
+        return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+    }
+
+    /**
+     * Counts one node, without what is below it.
+     */
+    void measureNode(ast::ASTNode& node, dce::Report& report) {
+        report.nodes++;
+        report.bytes += CONTROL_BLOCK_BYTES + stringBytes(node.token().value())
+                        + node.children().capacity() * sizeof(std::shared_ptr<ast::ASTNode>)
+                        + objectSize<ast::RootNode, ast::DeclarationNode, ast::CompoundAssignmentNode, ast::FunctionBodyNode,
+                                     ast::FunctionDefNode, ast::ControlFlowNode, ast::IfNode, ast::WhileNode, ast::ForNode,
+                                     ast::ExpressionNode, ast::FunctionCallNode, ast::TypedExpressionNode,
+                                     ast::ArrayLiteralNode, ast::DictLiteralNode, ast::IndexNode,
+                                     ast::IndexAssignmentNode>(node);
+    }
+
+    /**
+     * Counts a node and everything below it, including the body of a function definition.
+     */
+    void measure(ast::ASTNode& node, dce::Report& report) {
+        measureNode(node, report);
+
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            for (const std::string& parameter : function->parameters()) {
+                report.bytes += sizeof(std::string) + stringBytes(parameter);
+            }
+
+            measureNode(*function->body(), report);
+
+            if (function->body()->parsed()) {
+                measure(function->body()->root(), report);
+            }
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            measure(*child, report);
+        }
+    }
+
+    void collectReads(ast::ASTNode& node, Names& reads, Functions* deferred);
+
+    /**
+     * Collects the names read in a function body. A body that has not been parsed is scanned for every identifier.
+     */
+    void collectBodyReads(const ast::FunctionBodyNode& body, Names& reads) {
+        if (body.parsed()) {
+            collectReads(body.root(), reads, nullptr);
+            return;
+        }
+
+        for (auto it = body.tokensBegin(); it != body.tokensEnd(); ++it) {
+            if (it->type() == token::TokenType::IDENTIFIER) {
+                reads.insert(it->value());
+            }
+        }
+    }
+
+    /**
+     * Collects the names read by the code: variables, called functions and indexed collections.
+     * @param deferred If set, function definitions are collected here instead of reading their bodies
+     */
+    void collectReads(ast::ASTNode& node, Names& reads, Functions* deferred) {
+        if (auto* declaration = dynamic_cast<ast::DeclarationNode*>(&node)) {
+            // the first child is the assigned identifier, which is not a read
+            collectReads(*declaration->children()[1], reads, deferred);
+            return;
+        }
+
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            if (deferred != nullptr) {
+                (*deferred)[function->token().value()].push_back(function);
+            } else {
+                collectBodyReads(*function->body(), reads);
+            }
+
+            return;
+        }
+
+        bool named = dynamic_cast<ast::FunctionCallNode*>(&node) != nullptr || dynamic_cast<ast::IndexNode*>(&node) != nullptr
+                     || dynamic_cast<ast::IndexAssignmentNode*>(&node) != nullptr;
+        bool variable = dynamic_cast<ast::ExpressionNode*>(&node) != nullptr && node.children().empty()
+                        && node.token().type() == token::TokenType::IDENTIFIER;
+
+        if (named || variable) {
+            reads.insert(node.token().value());
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            collectReads(*child, reads, deferred);
+        }
+    }
+
+    /**
+     * Collects the names assigned outside of functions, which the host can read once the program has run.
+     */
+    void collectGlobals(ast::ASTNode& node, Names& globals) {
+        if (dynamic_cast<ast::FunctionDefNode*>(&node) != nullptr) {
+            return;
+        }
+
+        if (dynamic_cast<ast::DeclarationNode*>(&node) != nullptr) {
+            globals.insert(node.children()[0]->token().value());
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            collectGlobals(*child, globals);
+        }
+    }
+
+    /**
+     * Finds the functions reachable from the code outside of functions, and parses their bodies.
+     * @param reads Receives the names read by that code and by the reachable functions
+     */
+    Names findLiveFunctions(ast::ASTNode& root, Names& reads) {
+        Functions functions;
+        collectReads(root, reads, &functions);
+
+        Names live;
+        std::vector<std::string> pending{reads.begin(), reads.end()};
+
+        while (!pending.empty()) {
+            std::string name = std::move(pending.back());
+            pending.pop_back();
+
+            auto definitions = functions.find(name);
+            if (definitions == functions.end() || !live.insert(name).second) {
+                continue;
+            }
+
+            Names bodyReads;
+            for (ast::FunctionDefNode* definition : definitions->second) {
+                // parsed now so its dead code is counted; it will most likely be called anyway
+                static_cast<void>(definition->body()->root());
+                collectBodyReads(*definition->body(), bodyReads);
+            }
+
+            for (const std::string& read : bodyReads) {
+                if (!live.count(read)) {
+                    pending.push_back(read);
+                }
+
+                reads.insert(read);
+            }
+        }
+
+        return live;
+    }
+
+    /**
+     * @param parameters The parameters of the function the value is evaluated in, which are always defined
+     * @return Whether evaluating the value can't raise an error or have an effect: it is a literal or a parameter
+     */
+    bool isInert(ast::ASTNode& value, const Names& parameters) {
+        if ((typeid(value) != typeid(ast::ExpressionNode) && typeid(value) != typeid(ast::TypedExpressionNode))
+            || !value.children().empty()) {
+            return false;
+        }
+
+        switch (value.token().type()) {
+            case token::TokenType::LITERAL_INT:
+            case token::TokenType::LITERAL_FLOAT:
+            case token::TokenType::LITERAL_BOOL:
+            case token::TokenType::LITERAL_STRING:
+                return true;
+            case token::TokenType::IDENTIFIER:
+                return parameters.count(value.token().value()) > 0;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Removes the dead statements of one block.
+     * @param parameters The parameters of the function the block is in, or nullptr outside of functions
+     */
+    void pruneBlock(ast::RootNode& block, const Names* parameters, const Facts& facts, dce::Report& report) {
+        std::vector<std::shared_ptr<ast::ASTNode>>& statements = block.children();
+        std::vector<std::shared_ptr<ast::ASTNode>> kept;
+        bool reachable = true;
+
+        for (std::shared_ptr<ast::ASTNode>& statement : statements) {
+            if (!reachable) {
+                report.unreachable++;
+                measure(*statement, report);
+                continue;
+            }
+
+            if (parameters == nullptr && typeid(*statement) == typeid(ast::FunctionDefNode)
+                && !facts.live.count(statement->token().value())) {
+                report.functions++;
+                measure(*statement, report);
+                continue;
+            }
+
+            if (parameters != nullptr && typeid(*statement) == typeid(ast::DeclarationNode)) {
+                std::string name = statement->children()[0]->token().value();
+
+                if (!facts.reads.count(name) && !facts.globals.count(name)) {
+                    std::shared_ptr<ast::ASTNode> value = statement->children()[1];
+                    report.assignments++;
+
+                    // a value that could raise an error, e.g., 10 / 0, or call a function is still evaluated
+                    if (isInert(*value, *parameters)) {
+                        measure(*statement, report);
+                    } else {
+                        measureNode(*statement, report);
+                        measureNode(*statement->children()[0], report);
+                        kept.push_back(std::move(value));
+                    }
+
+                    continue;
+                }
+            }
+
+            if (typeid(*statement) == typeid(ast::ControlFlowNode)) {
+                reachable = false;
+            }
+
+            kept.push_back(std::move(statement));
+        }
+
+        statements = std::move(kept);
+    }
+
+    void prune(ast::ASTNode& node, const Names* parameters, const std::shared_ptr<const Facts>& facts, dce::Report& report) {
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            const std::shared_ptr<ast::FunctionBodyNode>& body = function->body();
+            auto names = std::make_shared<const Names>(function->parameters().begin(), function->parameters().end());
+
+            if (body->parsed()) {
+                prune(body->root(), names.get(), facts, report);
+            } else {
+                body->onParse([facts, names](ast::RootNode& root) {
+                    dce::Report unreported;
+                    prune(root, names.get(), facts, unreported);
+                });
+            }
+
+            return;
+        }
+
+        if (auto* block = dynamic_cast<ast::RootNode*>(&node)) {
+            pruneBlock(*block, parameters, *facts, report);
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            prune(*child, parameters, facts, report);
+        }
+    }
+}
+
+
+size_t dce::Report::statements() const {
+    return unreachable + functions + assignments;
+}
+
+dce::Report dce::eliminate(ast::ASTNode& root) {
+    auto facts = std::make_shared<Facts>();
+
+    // names only read by functions that are removed don't keep assignments alive
+    facts->live = findLiveFunctions(root, facts->reads);
+    collectGlobals(root, facts->globals);
+
+    Report report;
+    prune(root, nullptr, facts, report);
+
+    return report;
+}
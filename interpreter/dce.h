@@ -0,0 +1,42 @@
+#ifndef SPL_DCE_H
+#define SPL_DCE_H
+
+#include <cstddef>
+
+#include "ast.h"
+
+/**
+ * Dead code elimination over the whole program. Removes:
+ * - statements after a return, break or continue in the same block
+ * - function definitions outside of functions whose name is never referenced
+ * - assignments inside functions to names that are never read anywhere and never assigned outside of a function. Unless
+ *   the assigned value is a literal or a parameter of the function, it is kept as a statement, so the functions it
+ *   calls and the errors it raises still happen
+ *
+ * The program is assumed to be the whole program: a function that only the host or a later script calls, or a variable
+ * that only the host reads and that is only assigned inside a function, is removed.
+ *
+ * The bodies of the functions that are kept are parsed by the pass (see ast::FunctionBodyNode), so a syntax error in
+ * one is reported before the program runs. Functions defined inside them are only scanned for every identifier they
+ * contain, and are pruned when they are first parsed.
+ */
+namespace dce {
+    struct Report {
+        size_t unreachable = 0;  // statements after a return, break or continue
+        size_t functions = 0;  // function definitions that were never referenced
+        size_t assignments = 0;  // assignments to locals that are never read
+        size_t nodes = 0;  // AST nodes removed, including everything below the removed statements
+        size_t bytes = 0;  // estimated heap memory of the removed nodes
+
+        [[nodiscard]] size_t statements() const;
+    };
+
+    /**
+     * Removes the dead code of a program.
+     * @param root The root of the program. Modified in place
+     * @return What was removed, not counting inside functions defined inside other functions
+     */
+    Report eliminate(ast::ASTNode& root);
+}
+
+#endif  // SPL_DCE_H
@@ -0,0 +1,619 @@
+#include "environment.h"
+#include "sandbox.h"
+
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+
+namespace {
+    constexpr int32_t EMPTY_SLOT = -1;
+    constexpr int32_t DELETED_SLOT = -2;
+    constexpr size_t MIN_CAPACITY = 8;
+
+    /**
+     * Finalizer from splitmix64 so sequential int keys spread over the whole table
+     */
+    size_t hashInt(int value) {
+        uint64_t x = static_cast<uint64_t>(static_cast<uint32_t>(value));
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<size_t>(x ^ (x >> 31));
+    }
+
+    /**
+     * A key that is being looked up. Borrows the string instead of interning it, so lookups don't allocate.
+     */
+    struct LookupKey {
+        bool isString;
+        int integer;
+        std::string_view text;
+        size_t hash;
+    };
+
+    LookupKey makeLookupKey(const env::VariantType& key) {
+        if (std::holds_alternative<int>(key)) {
+            return {false, std::get<int>(key), {}, hashInt(std::get<int>(key))};
+        }
+
+        if (types::isString(key)) {
+            std::string_view text = types::stringView(key);
+            return {true, 0, text, types::InternedString::hash(text)};
+        }
+
+        throw std::runtime_error("Dictionary keys must be ints or strings");
+    }
+
+    bool isContainer(const env::VariantType& value) {
+        return std::holds_alternative<types::Array>(value) || std::holds_alternative<types::Dict>(value);
+    }
+
+    constexpr size_t POOL_SHARDS = 64;
+
+    /**
+     * One part of the pool of interned strings, holding the strings whose hash falls into it.
+     */
+    struct PoolShard {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, const types::InternedString*> strings;  // keyed by views into the strings
+    };
+
+    PoolShard& poolShard(size_t hash) {
+        // never destroyed, so dictionaries in static variables can still release their keys at exit
+        static auto* shards = new PoolShard[POOL_SHARDS];
+        return shards[hash % POOL_SHARDS];
+    }
+}
+
+
+types::InternedString::InternedString(std::string text, size_t hash)
+    : text(std::move(text)), textHash(hash), references(1) {}
+
+const types::InternedString* types::InternedString::intern(std::string_view text) {
+    size_t textHash = hash(text);
+    PoolShard& shard = poolShard(textHash);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.strings.find(text);
+    if (it != shard.strings.end()) {
+        retain(it->second);
+        return it->second;
+    }
+
+    const auto* interned = new InternedString(std::string(text), textHash);
+    shard.strings.emplace(interned->str(), interned);
+
+    return interned;
+}
+
+void types::InternedString::retain(const InternedString* string) {
+    string->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void types::InternedString::release(const InternedString* string) {
+    // the last reference is only dropped under the shard's lock, so intern can't hand out a string that is being freed
+    size_t count = string->references.load(std::memory_order_relaxed);
+    while (count > 1) {
+        if (string->references.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+
+    PoolShard& shard = poolShard(string->textHash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (string->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        shard.strings.erase(string->str());
+        delete string;
+    }
+}
+
+size_t types::InternedString::hash(std::string_view text) {
+    return std::hash<std::string_view>{}(text);
+}
+
+const std::string& types::InternedString::str() const {
+    return text;
+}
+
+size_t types::InternedString::hash() const {
+    return textHash;
+}
+
+
+struct types::Dict::Storage {
+    /**
+     * The key half of an entry. Values are kept in a parallel vector so probing only touches these 24-byte records.
+     */
+    struct Entry {
+        const InternedString* string;  // nullptr for int keys. Live entries hold a reference to it
+        size_t hash;
+        int integer;
+        bool removed;
+    };
+
+    /**
+     * One slot of the index table. Kept to 8 bytes so a probe sequence usually stays inside one cache line; the
+     * hash fragment lets most mismatches be rejected without touching the entry.
+     */
+    struct Slot {
+        uint32_t fragment;
+        int32_t entry;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<env::VariantType> values;
+    std::vector<Slot> slots = std::vector<Slot>(MIN_CAPACITY, Slot{0, EMPTY_SLOT});
+    size_t removedCount = 0;
+    size_t deletedSlots = 0;
+    size_t bytes = 0;  // the memory of the live entries, as counted against limits (see entryBytes)
+
+    Storage() = default;
+
+    Storage(const Storage& other)
+        : entries(other.entries), values(other.values), slots(other.slots), removedCount(other.removedCount),
+          deletedSlots(other.deletedSlots), bytes(other.bytes) {
+        for (const Entry& entry : entries) {
+            if (!entry.removed && entry.string != nullptr) {
+                InternedString::retain(entry.string);
+            }
+        }
+    }
+
+    Storage& operator=(const Storage&) = delete;
+
+    ~Storage() {
+        for (const Entry& entry : entries) {
+            if (!entry.removed && entry.string != nullptr) {
+                InternedString::release(entry.string);
+            }
+        }
+    }
+
+    /**
+     * The memory an entry holds: its key and value, the two slots it gets in a table kept at most half full, the
+     * characters of a string key and the payload of the value.
+     */
+    static size_t entryBytes(size_t keyLength, const env::VariantType& value) {
+        return sizeof(Entry) + sizeof(env::VariantType) + 2 * sizeof(Slot) + keyLength + env::payloadBytes(value);
+    }
+
+    static bool matches(const Entry& entry, const LookupKey& key) {
+        if (entry.hash != key.hash || entry.removed) {
+            return false;
+        }
+
+        if (key.isString) {
+            return entry.string != nullptr && entry.string->str() == key.text;
+        }
+
+        return entry.string == nullptr && entry.integer == key.integer;
+    }
+
+    /**
+     * Finds the slot holding the key, or the slot where it should be inserted if it is missing.
+     * @return The slot index and whether the key was found
+     */
+    [[nodiscard]] std::pair<size_t, bool> probe(const LookupKey& key) const {
+        size_t mask = slots.size() - 1;
+        size_t index = key.hash & mask;
+        auto fragment = static_cast<uint32_t>(key.hash);
+        size_t firstDeleted = slots.size();
+
+        while (true) {
+            const Slot& slot = slots[index];
+
+            if (slot.entry == EMPTY_SLOT) {
+                return {firstDeleted != slots.size() ? firstDeleted : index, false};
+            }
+
+            if (slot.entry == DELETED_SLOT) {
+                if (firstDeleted == slots.size()) {
+                    firstDeleted = index;
+                }
+            } else if (slot.fragment == fragment && matches(entries[slot.entry], key)) {
+                return {index, true};
+            }
+
+            index = (index + 1) & mask;
+        }
+    }
+
+    /**
+     * Drops removed entries and rebuilds the index table with room for at least minLive entries.
+     */
+    void rebuild(size_t minLive) {
+        if (removedCount > 0) {
+            std::vector<Entry> liveEntries;
+            std::vector<env::VariantType> liveValues;
+            liveEntries.reserve(entries.size() - removedCount);
+            liveValues.reserve(entries.size() - removedCount);
+
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (!entries[i].removed) {
+                    liveEntries.push_back(entries[i]);
+                    liveValues.push_back(std::move(values[i]));
+                }
+            }
+
+            entries = std::move(liveEntries);
+            values = std::move(liveValues);
+            removedCount = 0;
+        }
+
+        size_t capacity = MIN_CAPACITY;
+        while (capacity < minLive * 2) {
+            capacity *= 2;
+        }
+
+        slots.assign(capacity, Slot{0, EMPTY_SLOT});
+        deletedSlots = 0;
+
+        size_t mask = capacity - 1;
+        for (size_t i = 0; i < entries.size(); i++) {
+            size_t index = entries[i].hash & mask;
+            while (slots[index].entry != EMPTY_SLOT) {
+                index = (index + 1) & mask;
+            }
+
+            slots[index] = Slot{static_cast<uint32_t>(entries[i].hash), static_cast<int32_t>(i)};
+        }
+    }
+
+    void compact() {
+        if (removedCount > 0) {
+            rebuild(entries.size() - removedCount);
+        }
+    }
+};
+
+
+struct types::Dict::Cell {
+    explicit Cell(std::shared_ptr<Storage> storage) : storage(std::move(storage)) {}
+
+    ~Cell() {
+        if (account != nullptr) {
+            account->refund(charged);
+        }
+    }
+
+    std::shared_ptr<Storage> storage;
+    bool borrowed = false;  // the table is still the one of the dictionary this was borrowed from, containers and all
+    std::weak_ptr<Borrows> borrows;  // where to borrow those containers from when the table is copied
+    std::shared_ptr<sandbox::Account> account;  // nullptr if the dictionary is not counted against limits
+    size_t charged = 0;  // the bytes of the table counted against the account
+};
+
+
+types::Dict::Dict() : cell(std::make_shared<Cell>(std::make_shared<Storage>())) {}
+
+size_t types::Dict::size() const {
+    return cell->storage->entries.size() - cell->storage->removedCount;
+}
+
+const env::VariantType* types::Dict::find(const env::VariantType& key) const {
+    LookupKey lookupKey = makeLookupKey(key);
+    auto [slot, found] = cell->storage->probe(lookupKey);
+
+    if (!found) {
+        return nullptr;
+    }
+
+    int32_t entry = cell->storage->slots[slot].entry;
+
+    // a container in a borrowed table belongs to the original; own() borrows it. Entries keep their places in the copy
+    if (cell->borrowed && isContainer(cell->storage->values[entry])) {
+        own();
+    }
+
+    return &cell->storage->values[entry];
+}
+
+void types::Dict::set(const env::VariantType& key, env::VariantType value) {
+    if (const auto* dict = std::get_if<Dict>(&value); dict != nullptr && dict->reaches(identity())) {
+        throw std::runtime_error("A dictionary can't contain itself");
+    }
+
+    compact(value);
+    share(value);
+    own();
+
+    Storage& storage = *cell->storage;
+    LookupKey lookupKey = makeLookupKey(key);
+    auto [slot, found] = storage.probe(lookupKey);
+
+    if (cell->account != nullptr) {
+        env::attach(value, cell->account);
+    }
+
+    // counted before anything changes, so a value that doesn't fit leaves the dictionary as it was
+    if (found) {
+        env::VariantType& current = storage.values[storage.slots[slot].entry];
+        size_t bytes = storage.bytes - env::payloadBytes(current) + env::payloadBytes(value);
+        recharge(bytes);
+
+        storage.bytes = bytes;
+        release(std::exchange(current, std::move(value)));
+        return;
+    }
+
+    size_t bytes = storage.bytes + Storage::entryBytes(lookupKey.text.size(), value);
+    recharge(bytes);
+    storage.bytes = bytes;
+
+    // keep the table at most half full, counting tombstones since they lengthen probe sequences too
+    size_t used = storage.entries.size() - storage.removedCount + storage.deletedSlots;
+    if ((used + 1) * 2 > storage.slots.size()) {
+        storage.rebuild(size() + 1);
+        slot = storage.probe(lookupKey).first;
+    }
+
+    if (storage.slots[slot].entry == DELETED_SLOT) {
+        storage.deletedSlots--;
+    }
+
+    const InternedString* string = lookupKey.isString ? InternedString::intern(lookupKey.text) : nullptr;
+    storage.entries.push_back(Storage::Entry{string, lookupKey.hash, lookupKey.integer, false});
+    storage.values.push_back(std::move(value));
+    storage.slots[slot] = Storage::Slot{static_cast<uint32_t>(lookupKey.hash), static_cast<int32_t>(storage.entries.size() - 1)};
+}
+
+bool types::Dict::remove(const env::VariantType& key) {
+    auto [slot, found] = cell->storage->probe(makeLookupKey(key));
+
+    if (!found) {
+        return false;
+    }
+
+    own();
+    Storage& storage = *cell->storage;
+
+    int32_t entry = storage.slots[slot].entry;
+    const InternedString* string = storage.entries[entry].string;
+    storage.bytes -= Storage::entryBytes(string != nullptr ? string->str().size() : 0, storage.values[entry]);
+    recharge(storage.bytes);
+
+    storage.entries[entry].removed = true;
+    env::VariantType released = std::exchange(storage.values[entry], env::VariantType{});
+
+    if (string != nullptr) {
+        InternedString::release(string);
+    }
+
+    storage.slots[slot].entry = DELETED_SLOT;
+    storage.deletedSlots++;
+    storage.removedCount++;
+
+    if (storage.removedCount * 2 > storage.entries.size()) {
+        storage.compact();
+    }
+
+    release(std::move(released));
+    return true;
+}
+
+env::VariantType types::Dict::keyAt(size_t position) const {
+    // positions count live entries only, so drop the removed ones first, in a table of its own
+    if (cell->storage->removedCount > 0) {
+        own();
+        cell->storage->compact();
+    }
+
+    const Storage& storage = *cell->storage;
+
+    if (position >= storage.entries.size()) {
+        throw std::runtime_error("Dictionary position " + std::to_string(position) + " out of range for dictionary of size " + std::to_string(size()));
+    }
+
+    const Storage::Entry& entry = storage.entries[position];
+    if (entry.string != nullptr) {
+        return entry.string->str();
+    }
+
+    return entry.integer;
+}
+
+env::VariantType types::Dict::valueAt(size_t position) const {
+    if (cell->storage->removedCount > 0) {
+        own();
+        cell->storage->compact();
+    }
+
+    if (position >= cell->storage->entries.size()) {
+        throw std::runtime_error("Dictionary position " + std::to_string(position) + " out of range for dictionary of size " + std::to_string(size()));
+    }
+
+    if (cell->borrowed && isContainer(cell->storage->values[position])) {
+        own();
+    }
+
+    return cell->storage->values[position];
+}
+
+void types::Dict::forEachValue(const std::function<void(const env::VariantType&)>& visit) const {
+    const Storage& storage = *cell->storage;
+
+    for (size_t i = 0; i < storage.entries.size(); i++) {
+        if (!storage.entries[i].removed) {
+            visit(storage.values[i]);
+        }
+    }
+}
+
+void types::Dict::updateValues(const std::function<void(env::VariantType&)>& update) {
+    own();
+    Storage& storage = *cell->storage;
+
+    for (size_t i = 0; i < storage.entries.size(); i++) {
+        if (!storage.entries[i].removed) {
+            update(storage.values[i]);
+        }
+    }
+}
+
+bool types::Dict::isLastReference() const {
+    return cell.use_count() == 1;
+}
+
+types::Dict types::Dict::clone() const {
+    // the containers in the copy are shared with this dictionary, so they must be borrowed ones
+    if (cell->borrowed) {
+        own();
+    }
+
+    // copies the table as it is, without compacting it first, so cloning never writes to this dictionary
+    Dict copy;
+    copy.cell->storage = std::make_shared<Storage>(*cell->storage);
+
+    return copy;
+}
+
+types::Dict types::Dict::borrow(const std::shared_ptr<Borrows>& borrows) const {
+    Dict borrowed;
+    borrowed.cell->storage = cell->storage;
+    borrowed.cell->borrowed = true;
+    borrowed.cell->borrows = borrows;
+
+    return borrowed;
+}
+
+void types::Dict::attach(const std::shared_ptr<sandbox::Account>& account) const {
+    // also stops at dictionaries that contain themselves
+    if (cell->account == account || (cell->account != nullptr && cell->account->isOpen())) {
+        return;
+    }
+
+    // whatever a closed account counted is already released
+    cell->account = account;
+    cell->charged = 0;
+
+    // a borrowed table and its containers are counted by the dictionary that owns them until own() copies them
+    if (cell->borrowed) {
+        return;
+    }
+
+    recharge(cell->storage.use_count() > 1 ? 0 : cell->storage->bytes);
+
+    for (const env::VariantType& value : cell->storage->values) {
+        env::attach(value, account);
+    }
+}
+
+bool types::Dict::reaches(const void* target) const {
+    std::vector<const Dict*> pending{this};
+    std::unordered_set<const void*> visited;  // dictionaries held in several places are only visited once
+
+    while (!pending.empty()) {
+        const Dict* dict = pending.back();
+        pending.pop_back();
+
+        if (dict->identity() == target) {
+            return true;
+        }
+
+        // a borrowed table holds the containers of the original, which its own copies are made from
+        for (const env::VariantType& value : dict->cell->storage->values) {
+            const auto* nested = std::get_if<Dict>(&value);
+
+            if (nested != nullptr && visited.insert(nested->identity()).second) {
+                pending.push_back(nested);
+            }
+        }
+    }
+
+    return false;
+}
+
+const void* types::Dict::identity() const {
+    return cell.get();
+}
+
+bool types::Dict::operator==(const Dict& other) const {
+    if (size() != other.size()) {
+        return false;
+    }
+
+    const Storage& storage = *cell->storage;
+    const Storage& otherStorage = *other.cell->storage;
+
+    for (size_t i = 0; i < storage.entries.size(); i++) {
+        const Storage::Entry& entry = storage.entries[i];
+        if (entry.removed) {
+            continue;
+        }
+
+        LookupKey key{entry.string != nullptr, entry.integer, entry.string != nullptr ? std::string_view(entry.string->str()) : std::string_view(), entry.hash};
+        auto [slot, found] = otherStorage.probe(key);
+
+        if (!found || !(otherStorage.values[otherStorage.slots[slot].entry] == storage.values[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void types::Dict::own() const {
+    if (cell->borrowed) {
+        recharge(cell->storage->bytes);
+        auto copy = std::make_shared<Storage>(*cell->storage);
+
+        // the fork that borrowed this dictionary may be gone; its containers are then borrowed on their own
+        std::shared_ptr<Borrows> borrows = cell->borrows.lock();
+        if (borrows == nullptr) {
+            borrows = std::make_shared<Borrows>();
+        }
+
+        for (env::VariantType& value : copy->values) {
+            if (isContainer(value)) {
+                value = Borrows::borrow(borrows, value);
+
+                if (cell->account != nullptr) {
+                    env::attach(value, cell->account);
+                }
+            }
+        }
+
+        cell->storage = std::move(copy);
+        cell->borrowed = false;
+        cell->borrows.reset();
+    } else if (cell->storage.use_count() > 1) {
+        // only cells own tables, so a count above one means a borrowed dictionary still shares this one
+        recharge(cell->storage->bytes);
+        cell->storage = std::make_shared<Storage>(*cell->storage);
+    }
+}
+
+void types::Dict::release(env::VariantType value) {
+    std::vector<std::shared_ptr<const StringBuffer>> buffers = heldBuffers(value);
+    if (buffers.empty()) {
+        return;
+    }
+
+    value = env::VariantType{};
+
+    std::vector<env::VariantType*> stored;
+    updateValues([&stored](env::VariantType& entry) {
+        stored.push_back(&entry);
+    });
+
+    compactSlices(std::move(buffers), stored);
+}
+
+void types::Dict::recharge(size_t bytes) const {
+    if (cell->account == nullptr) {
+        return;
+    }
+
+    if (bytes > cell->charged) {
+        cell->account->charge(bytes - cell->charged);
+    } else {
+        cell->account->refund(cell->charged - bytes);
+    }
+
+    cell->charged = bytes;
+}
@@ -0,0 +1,192 @@
+#ifndef SPL_DICT_H
+#define SPL_DICT_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// This header is included by environment.h after env::VariantType is declared
+
+namespace sandbox {
+    class Account;
+}
+
+namespace types {
+    /**
+     * A string stored once in a process-wide pool, so two keys with the same text point to the same InternedString.
+     * Interned strings are reference counted: each dictionary entry with a string key holds a reference, and the
+     * string is freed when the last one is released.
+     *
+     * The pool is split into shards by hash, each with its own lock, so threads interning different keys rarely wait
+     * for each other. Lookups never intern.
+     */
+    class InternedString {
+    public:
+        /**
+         * Returns the pooled copy of the text with a reference for the caller, adding it to the pool if needed.
+         * Thread-safe.
+         */
+        static const InternedString* intern(std::string_view text);
+
+        /**
+         * Adds a reference to a string the caller already holds one to. Thread-safe and lock-free.
+         */
+        static void retain(const InternedString* string);
+
+        /**
+         * Drops a reference, freeing the string if it was the last one. Thread-safe; only locks when the last
+         * reference is dropped.
+         */
+        static void release(const InternedString* string);
+
+        /**
+         * The hash used for string keys. Does not allocate.
+         */
+        static size_t hash(std::string_view text);
+
+        [[nodiscard]] const std::string& str() const;
+        [[nodiscard]] size_t hash() const;
+
+    private:
+        InternedString(std::string text, size_t hash);
+
+        std::string text;
+        size_t textHash;
+        mutable std::atomic<size_t> references;
+    };
+
+    class Borrows;
+
+    /**
+     * A dictionary keyed by ints and strings. Uses open addressing with linear probing over a compact index table;
+     * the entries themselves live in a separate vector in insertion order, which is also the iteration order.
+     *
+     * Like arrays, dictionaries have reference semantics: copies share the same table. Tables are reference counted,
+     * so a dictionary can't hold itself, directly or through other dictionaries: such a cycle would never be freed.
+     *
+     * A borrowed dictionary (see borrow) shares the table of the original until either of them is changed, or until
+     * an array or dictionary is read from it. Then it copies the table, borrowing the containers in it.
+     */
+    class Dict {
+    public:
+        Dict();
+
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Looks up a key. Does not allocate.
+         * @throws std::runtime_error if the key is not an int or a string
+         * @return A pointer to the value, or nullptr if the key is not in the dictionary
+         */
+        [[nodiscard]] const env::VariantType* find(const env::VariantType& key) const;
+
+        /**
+         * Inserts or overwrites the value for a key. If the value is a dictionary, the dictionaries it holds are
+         * visited to check that it doesn't hold this one.
+         * @throws std::runtime_error if the key is not an int or a string, or the value is or holds this dictionary
+         */
+        void set(const env::VariantType& key, env::VariantType value);
+
+        /**
+         * Removes a key.
+         * @return True if the key was in the dictionary
+         */
+        bool remove(const env::VariantType& key);
+
+        /**
+         * Gets the key of the i-th entry in insertion order.
+         * @throws std::runtime_error if the position is out of range
+         */
+        [[nodiscard]] env::VariantType keyAt(size_t position) const;
+
+        /**
+         * Gets the value of the i-th entry in insertion order.
+         * @throws std::runtime_error if the position is out of range
+         */
+        [[nodiscard]] env::VariantType valueAt(size_t position) const;
+
+        /**
+         * Calls the function with the value of every entry, in insertion order, without copying them.
+         */
+        void forEachValue(const std::function<void(const env::VariantType&)>& visit) const;
+
+        /**
+         * Calls the function with the value of every entry, which it may change in place as long as the memory the value
+         * holds stays the same (see env::payloadBytes), e.g., to replace a slice with a copy of its characters.
+         */
+        void updateValues(const std::function<void(env::VariantType&)>& update);
+
+        /**
+         * @return True if no other copy of this dictionary exists, so it is freed with this one
+         */
+        [[nodiscard]] bool isLastReference() const;
+
+        /**
+         * @return A new dictionary with its own copy of the entries. Arrays and dictionaries stored in it are still shared
+         */
+        [[nodiscard]] Dict clone() const;
+
+        /**
+         * @param borrows Where the arrays and dictionaries in this dictionary are borrowed from once the new one copies
+         * the table. Only weakly referenced; if it is gone by then, they are borrowed separately
+         * @return A new dictionary with the same entries, which are only copied when needed (see Dict). Takes constant
+         * time
+         */
+        [[nodiscard]] Dict borrow(const std::shared_ptr<Borrows>& borrows) const;
+
+        /**
+         * Counts the entries against the account, along with the arrays and dictionaries stored in them, and the
+         * entries set later as they are set (see Array::attach). Does nothing if the dictionary is already counted
+         * against an open account.
+         * @throws sandbox::MemoryLimitExceeded if the entries don't fit
+         */
+        void attach(const std::shared_ptr<sandbox::Account>& account) const;
+
+        /**
+         * @return An address that identifies the shared table. Copies of a dictionary have the same identity
+         */
+        [[nodiscard]] const void* identity() const;
+
+        /**
+         * Two dictionaries are equal if they hold the same keys mapped to equal values, in any order.
+         */
+        bool operator==(const Dict& other) const;
+
+    private:
+        struct Storage;
+        struct Cell;
+
+        /**
+         * Gives this dictionary a table of its own if it shares one, borrowing the containers in a borrowed table.
+         * Used before changing the table and before handing out containers from a borrowed one.
+         */
+        void own() const;
+
+        /**
+         * Counts the given number of bytes against the account in place of what was counted before.
+         * @throws sandbox::MemoryLimitExceeded if they don't fit. Nothing changes in that case
+         */
+        void recharge(size_t bytes) const;
+
+        /**
+         * Called with a value that was overwritten or removed. Frees a buffer it held a large part of if only short
+         * slices in this dictionary still use it (see types::compactSlices).
+         */
+        void release(env::VariantType value);
+
+        /**
+         * @return True if this dictionary has the given identity, or holds one that does, directly or through other
+         * dictionaries
+         */
+        [[nodiscard]] bool reaches(const void* target) const;
+
+        std::shared_ptr<Cell> cell;
+    };
+}
+
+#endif  // SPL_DICT_H
@@ -1,19 +1,165 @@
 #include "environment.h"
+#include "sandbox.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <utility>
 
-env::Environment::Environment() : parent(nullptr) {}
 
-env::Environment::Environment(Environment& parent) : parent(&parent) {}
+size_t env::payloadBytes(const VariantType& value) {
+    if (const std::string* text = std::get_if<std::string>(&value)) {
+        return text->size();
+    }
+
+    if (const types::StringSlice* slice = std::get_if<types::StringSlice>(&value)) {
+        return slice->view().size();
+    }
+
+    if (const types::BigInt* integer = std::get_if<types::BigInt>(&value)) {
+        return integer->heapBytes();
+    }
+
+    return 0;
+}
+
+void env::attach(const VariantType& value, const std::shared_ptr<sandbox::Account>& account) {
+    if (const auto* array = std::get_if<types::Array>(&value)) {
+        array->attach(account);
+    } else if (const auto* dict = std::get_if<types::Dict>(&value)) {
+        dict->attach(account);
+    }
+}
+
+env::Environment::Environment() : parent(nullptr), isFork(false), attachedLimits(nullptr), chargedBytes(0) {}
+
+env::Environment::Environment(Environment& parent)
+    : parent(&parent), isFork(false), attachedLimits(parent.attachedLimits), account(parent.account), chargedBytes(0) {}
+
+env::Environment::Environment(Environment& parent, ForkTag)
+    : parent(&parent), isFork(true), attachedLimits(parent.attachedLimits), account(parent.account), chargedBytes(0) {}
+
+env::Environment::~Environment() {
+    if (account == nullptr) {
+        return;
+    }
+
+    account->refund(chargedBytes);
+
+    // the containers of the environment that attached the limits may outlive it, but must not outlive the limits
+    if (parent == nullptr || parent->account != account) {
+        account->close();
+    }
+}
+
+void env::Environment::attachLimits(sandbox::Limits* limits) {
+    if (account != nullptr) {
+        account->close();
+    }
+
+    attachedLimits = limits;
+    account = limits != nullptr ? std::make_shared<sandbox::Account>(limits) : nullptr;
+    chargedBytes = 0;
+
+    if (account == nullptr) {
+        return;
+    }
+
+    try {
+        for (const auto& [name, value] : variables) {
+            size_t bytes = name.size() + sizeof(VariantType) + payloadBytes(value);
+            account->charge(bytes);
+            chargedBytes += bytes;
+
+            attach(value, account);
+        }
+    } catch (...) {
+        attachLimits(nullptr);
+        throw;
+    }
+}
+
+sandbox::Limits* env::Environment::limits() const {
+    return attachedLimits;
+}
+
+void env::Environment::assignCharged(const std::string& name, VariantType value) {
+    auto it = variables.find(name);
+
+    size_t oldBytes = it != variables.end() ? name.size() + sizeof(VariantType) + payloadBytes(it->second) : 0;
+    size_t newBytes = name.size() + sizeof(VariantType) + payloadBytes(value);
+
+    attach(value, account);
+
+    if (newBytes > oldBytes) {
+        account->charge(newBytes - oldBytes);
+        chargedBytes += newBytes - oldBytes;
+    } else {
+        size_t released = std::min(oldBytes - newBytes, chargedBytes);
+        account->refund(released);
+        chargedBytes -= released;
+    }
+
+    if (it != variables.end()) {
+        release(std::exchange(it->second, std::move(value)));
+    } else {
+        variables.emplace(name, std::move(value));
+    }
+}
+
+void env::Environment::release(VariantType value) {
+    if (!std::holds_alternative<types::StringSlice>(value) && !std::holds_alternative<types::Dict>(value)) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<const types::StringBuffer>> buffers = types::heldBuffers(value);
+    if (buffers.empty()) {
+        return;
+    }
+
+    value = VariantType{};
+
+    std::vector<VariantType*> stored;
+    for (Environment* current = this; current != nullptr; current = current->isFork ? nullptr : current->parent) {
+        for (auto& [name, variable] : current->variables) {
+            stored.push_back(&variable);
+        }
+    }
+
+    types::compactSlices(std::move(buffers), stored);
+}
+
+env::Environment env::Environment::fork() {
+    return Environment{*this, ForkTag{}};
+}
 
 void env::Environment::set(const std::string& name, VariantType value) {
-    if (has(name) && !variables.count(name)) {
+    // a fork assigns its own variable instead of writing to the environment it was forked from
+    if (!isFork && !variables.count(name) && has(name)) {
         parent->set(name, std::move(value));
         return;
     }
 
-    variables[name] = std::move(value);
+    types::compact(value);
+    types::share(value);
+
+    if (account != nullptr) {
+        assignCharged(name, std::move(value));
+        return;
+    }
+
+    release(std::exchange(variables[name], std::move(value)));
+}
+
+void env::Environment::define(const std::string& name, VariantType value) {
+    types::compact(value);
+    types::share(value);
+
+    if (account != nullptr) {
+        assignCharged(name, std::move(value));
+        return;
+    }
+
+    release(std::exchange(variables[name], std::move(value)));
 }
 
 bool env::Environment::has(const std::string& name) const {
@@ -31,44 +177,197 @@ bool env::Environment::has(const std::string& name) const {
 }
 
 env::VariantType env::Environment::get(const std::string& name) const {
+    const VariantType* value = find(name);
+
+    if (value == nullptr) {
+        throw std::runtime_error("Variable not found: " + name);
+    }
+
+    return *value;
+}
+
+const env::VariantType* env::Environment::lookup(const std::string& name) const {
+    return find(name);
+}
+
+env::VariantType* env::Environment::assignable(const std::string& name) {
+    Environment* owner;
+    return assignable(name, owner);
+}
+
+env::VariantType* env::Environment::assignable(const std::string& name, Environment*& owner) {
+    for (Environment* current = this; current != nullptr; current = current->parent) {
+        auto it = current->variables.find(name);
+        if (it != current->variables.end()) {
+            owner = current;
+            return &it->second;
+        }
+
+        // set would define the fork's own variable rather than change the one it inherited
+        if (current->isFork) {
+            return nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+bool env::Environment::append(const std::string& name, std::string_view text) {
+    Environment* owner;
+    VariantType* variable = assignable(name, owner);
+
+    if (variable == nullptr || !types::isString(*variable)) {
+        return false;
+    }
+
+    // a long string is stored as a slice (see types::share), which is copied into a string of its own once, so the
+    // appends after this one take amortized constant time again
+    if (const auto* slice = std::get_if<types::StringSlice>(variable)) {
+        *variable = std::string(slice->view());
+    }
+
+    auto* string = std::get_if<std::string>(variable);
+
+    if (owner->account != nullptr) {
+        owner->account->charge(text.size());
+        owner->chargedBytes += text.size();
+    }
+
+    string->append(text);
+
+    return true;
+}
+
+const env::VariantType* env::Environment::find(const std::string& name) const {
     // use an iterative approach so clang-tidy doesn't complain about recursion
     const Environment* current = this;
+    const Environment* fork = nullptr;  // the nearest fork passed on the way up
 
     while (current != nullptr) {
         auto it = current->variables.find(name);
         if (it != current->variables.end()) {
-            return it->second;
+            bool container = std::holds_alternative<types::Array>(it->second) || std::holds_alternative<types::Dict>(it->second);
+            return fork != nullptr && container ? fork->borrowInherited(name, it->second) : &it->second;
+        }
+
+        if (current->isFork && fork == nullptr) {
+            fork = current;
         }
 
         current = current->parent;
     }
 
-    throw std::runtime_error("Variable not found: " + name);
+    return nullptr;
+}
+
+const env::VariantType* env::Environment::borrowInherited(const std::string& name, const VariantType& value) const {
+    if (borrows == nullptr) {
+        borrows = std::make_shared<types::Borrows>();
+    }
+
+    VariantType borrowed = types::Borrows::borrow(borrows, value);
+
+    // the borrowed container is counted like any other variable of the fork, and its elements once it copies them
+    if (account != nullptr) {
+        size_t bytes = name.size() + sizeof(VariantType);
+        account->charge(bytes);
+        chargedBytes += bytes;
+
+        attach(borrowed, account);
+    }
+
+    return &variables.insert_or_assign(name, std::move(borrowed)).first->second;
 }
 
 void env::Environment::remove(const std::string &name) {
-    variables.erase(name);
+    auto it = variables.find(name);
+
+    if (it == variables.end()) {
+        return;
+    }
+
+    if (account != nullptr) {
+        size_t released = std::min(name.size() + sizeof(VariantType) + payloadBytes(it->second), chargedBytes);
+        account->refund(released);
+        chargedBytes -= released;
+    }
+
+    VariantType value = std::move(it->second);
+    variables.erase(it);
+    release(std::move(value));
+}
+
+void env::Environment::clear() {
+    if (account != nullptr) {
+        account->refund(chargedBytes);
+        chargedBytes = 0;
+    }
+
+    // clear keeps the bucket array, unlike assigning an empty map
+    variables.clear();
+    borrows = nullptr;  // what the next run borrows must start from the originals again
+}
+
+std::vector<std::string> env::Environment::names() const {
+    std::vector<std::string> result;
+    result.reserve(variables.size());
+
+    for (const auto& [name, value] : variables) {
+        result.push_back(name);
+    }
+
+    return result;
 }
 
 std::string env::Environment::getType(const std::string& name) const {
     return std::visit([](const auto& val) -> std::string {
         using T = std::decay_t<decltype(val)>;
-        if constexpr (std::is_same_v<T, int>) {
+        if constexpr (std::is_same_v<T, int> || std::is_same_v<T, types::BigInt>) {
             return "int";
         } else if constexpr (std::is_same_v<T, float>) {
             return "float";
-        } else if constexpr (std::is_same_v<T, std::string>) {
+        } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, types::StringSlice>) {
             return "string";
         } else if constexpr (std::is_same<T, types::Function>::value) {
             return "function";
+        } else if constexpr (std::is_same_v<T, types::Array>) {
+            return "array";
+        } else if constexpr (std::is_same_v<T, types::Dict>) {
+            return "dict";
+        } else if constexpr (std::is_same_v<T, types::NativeFunction>) {
+            return "native function";
         } else {
             throw std::runtime_error("Unknown type");
         }
     }, get(name));
 }
 
-types::Function::Function(std::vector<std::string> parameters, std::shared_ptr<ast::ASTNode> body)
-    : functionParameters(std::move(parameters)), functionBody(std::move(body)) {}
+env::VariantType types::Borrows::borrow(const std::shared_ptr<Borrows>& borrows, const env::VariantType& value) {
+    const void* identity;
+
+    if (const auto* array = std::get_if<Array>(&value)) {
+        identity = array->identity();
+    } else if (const auto* dict = std::get_if<Dict>(&value)) {
+        identity = dict->identity();
+    } else {
+        return value;
+    }
+
+    auto it = borrows->borrowed.find(identity);
+    if (it != borrows->borrowed.end()) {
+        return it->second;
+    }
+
+    env::VariantType borrowed = std::holds_alternative<Array>(value)
+        ? env::VariantType{std::get<Array>(value).borrow()}
+        : env::VariantType{std::get<Dict>(value).borrow(borrows)};
+
+    return borrows->borrowed.emplace(identity, std::move(borrowed)).first->second;
+}
+
+types::Function::Function(std::vector<std::string> parameters, std::shared_ptr<ast::ASTNode> body,
+                          std::shared_ptr<memo::Cache> cache)
+    : functionParameters(std::move(parameters)), functionBody(std::move(body)), resultCache(std::move(cache)) {}
 
 const std::vector<std::string>& types::Function::parameters() const {
     return functionParameters;
@@ -78,6 +377,10 @@ const std::shared_ptr<ast::ASTNode>& types::Function::body() const {
     return functionBody;
 }
 
+const std::shared_ptr<memo::Cache>& types::Function::cache() const {
+    return resultCache;
+}
+
 bool types::Function::operator==(const types::Function& other) const {
     return functionParameters == other.functionParameters && functionBody == other.functionBody;
 }
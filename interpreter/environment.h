@@ -3,39 +3,140 @@
 
 #include <variant>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <unordered_map>
 #include <memory>
 
+#include "array.h"
+
 // Forward declarations
 namespace ast {
     class ASTNode;
 }
 
+namespace memo {
+    class Cache;
+}
+
+namespace sandbox {
+    class Limits;
+    class Account;
+}
+
 namespace types {
     class Function {
     public:
-        Function(std::vector<std::string> parameters, std::shared_ptr<ast::ASTNode> body);
+        /**
+         * @param parameters The names of the parameters
+         * @param body The body of the function
+         * @param cache The result cache if the function is pure and memoized, otherwise nullptr (see memo.h)
+         */
+        Function(std::vector<std::string> parameters, std::shared_ptr<ast::ASTNode> body,
+                 std::shared_ptr<memo::Cache> cache = nullptr);
 
         [[nodiscard]] const std::vector<std::string>& parameters() const;
         [[nodiscard]] const std::shared_ptr<ast::ASTNode>& body() const;
+        [[nodiscard]] const std::shared_ptr<memo::Cache>& cache() const;
 
         bool operator==(const Function& other) const;
 
     private:
         std::vector<std::string> functionParameters;
         std::shared_ptr<ast::ASTNode> functionBody;
+        std::shared_ptr<memo::Cache> resultCache;
+    };
+
+    // defined in their own headers, which need VariantType
+    class Dict;
+    class NativeFunction;
+    class StringSlice;
+    class BigInt;
+}
+
+namespace env {
+    using VariantType = std::variant<bool, int, float, std::string, types::Function, types::Array, types::Dict, types::NativeFunction, types::StringSlice, types::BigInt>;
+}
+
+#include "dict.h"
+#include "native_function.h"
+#include "string_slice.h"
+#include "bigint.h"
+
+namespace types {
+    /**
+     * The arrays and dictionaries an environment has borrowed (see env::Environment::fork), by the identity of the
+     * original. Borrowing a container again gives the same borrowed container, so containers that share an array
+     * still share the borrowed one.
+     */
+    class Borrows {
+    public:
+        /**
+         * @return The borrowed version of an array or dictionary, or the value itself if it is neither
+         */
+        static env::VariantType borrow(const std::shared_ptr<Borrows>& borrows, const env::VariantType& value);
+
+    private:
+        std::unordered_map<const void*, env::VariantType> borrowed;
     };
 }
 
 namespace env {
-    using VariantType = std::variant<bool, int, float, std::string, types::Function>;
+    /**
+     * @return The memory a value holds outside of the variable that stores it, as counted against limits: the
+     * characters of a string and the digits of a big int. Arrays and dictionaries count their elements themselves (see
+     * attach)
+     */
+    size_t payloadBytes(const VariantType& value);
+
+    /**
+     * Counts an array or dictionary against the account (see types::Array::attach). Does nothing for other values.
+     * @throws sandbox::MemoryLimitExceeded if it does not fit
+     */
+    void attach(const VariantType& value, const std::shared_ptr<sandbox::Account>& account);
 
     class Environment {
     public:
         Environment();
         Environment(Environment& parent);
+        ~Environment();
+
+        /**
+         * Creates an environment that starts with the variables of this one without copying them, e.g., to run each
+         * request in isolation after a shared prelude. Forking takes constant time.
+         *
+         * The fork reads the variables of this environment in place. Assigning to one of them defines the fork's own
+         * variable instead, and the first time the fork reads an array or dictionary of this environment, it borrows
+         * it: the fork gets an array or dictionary of its own, which shares the elements until the fork first changes
+         * them (see types::Array::borrow). Reading a large lookup table therefore takes constant time. Containers are
+         * borrowed once, so variables that share an array still share the borrowed one. Nothing the fork does changes
+         * this environment.
+         *
+         * This environment must outlive its forks and must not change while they exist. Under that condition, forks
+         * can run on several threads at once. Memoized functions share their result caches with the forks, so don't
+         * memoize a prelude whose forks run concurrently. Limits are inherited; attach separate limits to forks that
+         * run concurrently.
+         */
+        [[nodiscard]] Environment fork();
+
+        /**
+         * Makes the environment (and the environments created from it, e.g., function scopes) count memory and steps
+         * against the limits. Memory counted against previous limits is released.
+         *
+         * The memory of the variables is counted, including what the environment already holds, and so are the
+         * elements of the arrays and dictionaries stored in it, as they grow: pushing to an array or setting an entry
+         * of a dictionary throws sandbox::MemoryLimitExceeded once the cap is reached.
+         * @param limits The limits, or nullptr to stop counting. Must outlive the environment or be detached first
+         * @throws sandbox::MemoryLimitExceeded if what the environment already holds does not fit. No limits are
+         * attached then
+         */
+        void attachLimits(sandbox::Limits* limits);
+
+        /**
+         * @return The limits the environment counts against, or nullptr if it is not limited
+         */
+        [[nodiscard]] sandbox::Limits* limits() const;
 
         /**
          * Sets a variable in the environment
@@ -44,6 +145,14 @@ namespace env {
          */
         void set(const std::string& name, VariantType value);
 
+        /**
+         * Sets a variable in this environment, shadowing any variable with the same name in the parent environments.
+         * Used for function parameters.
+         * @param name The name of the variable
+         * @param value The value of the variable
+         */
+        void define(const std::string& name, VariantType value);
+
         /**
          * Gets a variable from the environment. Throws an exception if the variable is not in the environment
          * @param name The name of the variable
@@ -51,12 +160,40 @@ namespace env {
          */
         VariantType get(const std::string& name) const;
 
+        /**
+         * Looks up a variable without copying it.
+         * @param name The name of the variable
+         * @return A pointer to the value of the variable, or nullptr if the variable is not in the environment. The
+         * pointer is invalidated when the variable is removed
+         */
+        const VariantType* lookup(const std::string& name) const;
+
+        /**
+         * Finds the variable that set would change, so it can be updated in place, e.g., to add to an int without
+         * looking it up twice. Changes made through the pointer are not counted against the limits, so only use it to
+         * store values that hold no memory of their own (bools, ints and floats).
+         * @return The variable, or nullptr if it is not in the environment or set would define a new variable instead
+         * (when a fork assigns a variable it inherited). The pointer is invalidated when a variable is added or removed
+         */
+        VariantType* assignable(const std::string& name);
+
+        /**
+         * Appends to a string variable in its own buffer, which takes amortized constant time per character instead of
+         * copying the whole string.
+         * @return False, changing nothing, if the variable is not a std::string that set would change (see assignable)
+         * @throws sandbox::MemoryLimitExceeded if the longer string does not fit. The variable is left unchanged
+         */
+        bool append(const std::string& name, std::string_view text);
+
         /**
          * Gets the type of a variable in the environment as a string. Possible types:
-         * - "int"
+         * - "int" (int or types::BigInt)
          * - "float"
-         * - "string"
+         * - "string" (std::string or types::StringSlice)
          * - "ast" (an ast::ASTNode shared_ptr. Used for function definitions)
+         * - "array"
+         * - "dict"
+         * - "native function"
          *
          * @throws std::runtime_error if the variable is not in the environment
          * @param name The name of the variable
@@ -77,9 +214,60 @@ namespace env {
          */
         void remove(const std::string& name);
 
+        /**
+         * Removes every variable of this environment, keeping the memory of its table for the variables defined next.
+         * A fork is reset to the state it was forked in.
+         */
+        void clear();
+
+        /**
+         * @return The names of the variables in this environment, not including those of the parent environments, in no
+         * particular order
+         */
+        [[nodiscard]] std::vector<std::string> names() const;
+
     private:
-        std::unordered_map<std::string, VariantType> variables;
+        struct ForkTag {};
+
+        Environment(Environment& parent, ForkTag);
+
+        /**
+         * Looks up a variable, borrowing arrays and dictionaries that a fork reads from the environment it was forked
+         * from.
+         */
+        const VariantType* find(const std::string& name) const;
+
+        /**
+         * Borrows an array or dictionary of the environment this fork was forked from.
+         * @return The borrowed container, stored as a variable of this environment
+         */
+        const VariantType* borrowInherited(const std::string& name, const VariantType& value) const;
+
+        /**
+         * @param owner Receives the environment that holds the variable
+         */
+        VariantType* assignable(const std::string& name, Environment*& owner);
+
+        /**
+         * Called with the value of a variable that was overwritten or removed. Frees a buffer it held a large part of if
+         * only short slices in the variables the script can still reach use it (see types::compactSlices). Stops at the
+         * nearest fork, which must not change the environment it was forked from.
+         */
+        void release(VariantType value);
+
+        /**
+         * Assigns a variable in this environment and counts the change in memory it uses against the limits.
+         * @throws sandbox::MemoryLimitExceeded if the new value does not fit. The variable is left unchanged
+         */
+        void assignCharged(const std::string& name, VariantType value);
+
+        mutable std::unordered_map<std::string, VariantType> variables;  // forks add the containers they borrow (see fork)
         Environment* parent;  // may be nullptr
+        bool isFork;  // set and find stop sharing the parent's variables at this environment
+        mutable std::shared_ptr<types::Borrows> borrows;  // the containers a fork has borrowed, nullptr until it borrows one
+        sandbox::Limits* attachedLimits;  // may be nullptr
+        std::shared_ptr<sandbox::Account> account;  // the memory counted against attachedLimits, nullptr if not limited
+        mutable size_t chargedBytes;  // memory counted against the account for this environment's own variables
     };
 }
 
@@ -0,0 +1,102 @@
+#include "extension.h"
+
+#include "../spl_extension.h"
+
+#include <dlfcn.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+    /**
+     * Converts an interpreter value to an ABI value. The returned value borrows string data from the input.
+     */
+    spl_value toAbiValue(const std::string& functionName, const env::VariantType& value) {
+        spl_value result{};
+
+        if (std::holds_alternative<bool>(value)) {
+            result.type = SPL_VALUE_BOOL;
+            result.as.boolean = std::get<bool>(value) ? 1 : 0;
+        } else if (std::holds_alternative<int>(value)) {
+            result.type = SPL_VALUE_INT;
+            result.as.integer = std::get<int>(value);
+        } else if (std::holds_alternative<float>(value)) {
+            result.type = SPL_VALUE_FLOAT;
+            result.as.floating = std::get<float>(value);
+        } else if (types::isString(value)) {
+            std::string_view text = types::stringView(value);
+            result.type = SPL_VALUE_STRING;
+            result.as.string.data = text.data();
+            result.as.string.size = text.size();
+        } else {
+            throw std::runtime_error("Function " + functionName + " only accepts bools, ints, floats and strings");
+        }
+
+        return result;
+    }
+
+    env::VariantType fromAbiValue(const std::string& functionName, const spl_value& value) {
+        switch (value.type) {
+            case SPL_VALUE_BOOL:
+                return value.as.boolean != 0;
+            case SPL_VALUE_INT:
+                return static_cast<int>(value.as.integer);
+            case SPL_VALUE_FLOAT:
+                return value.as.floating;
+            case SPL_VALUE_STRING:
+                return std::string(value.as.string.data, value.as.string.size);
+            default:
+                throw std::runtime_error("Function " + functionName + " returned a value of unknown type");
+        }
+    }
+}
+
+
+void extension::load(env::Environment& env, const std::string& path) {
+    void* rawHandle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+    if (rawHandle == nullptr) {
+        throw std::runtime_error("Could not load extension " + path + ": " + dlerror());
+    }
+
+    // every registered function holds a reference, so the module is unloaded once the last one is gone
+    std::shared_ptr<void> handle{rawHandle, [](void* h) { dlclose(h); }};
+
+    auto info = reinterpret_cast<spl_extension_info_fn>(dlsym(rawHandle, SPL_EXTENSION_ENTRY_POINT));
+    if (info == nullptr) {
+        throw std::runtime_error("Extension " + path + " does not export " SPL_EXTENSION_ENTRY_POINT);
+    }
+
+    const spl_extension* module = info();
+    if (module == nullptr || module->abi_version != SPL_EXTENSION_ABI_VERSION) {
+        throw std::runtime_error("Extension " + path + " was built for an incompatible ABI version");
+    }
+
+    for (size_t i = 0; i < module->function_count; i++) {
+        const spl_function_entry& entry = module->functions[i];
+        std::string name = entry.name;
+        spl_native_fn function = entry.function;
+
+        env.set(name, types::NativeFunction{name, entry.arity, [handle, name, function](const std::vector<env::VariantType>& arguments) {
+            std::vector<spl_value> abiArguments;
+            abiArguments.reserve(arguments.size());
+
+            for (const env::VariantType& argument : arguments) {
+                abiArguments.push_back(toAbiValue(name, argument));
+            }
+
+            spl_value result{};
+            if (function(abiArguments.data(), abiArguments.size(), &result) != 0) {
+                std::string message = result.type == SPL_VALUE_STRING
+                    ? std::string(result.as.string.data, result.as.string.size)
+                    : "extension function failed";
+
+                throw std::runtime_error("Function " + name + ": " + message);
+            }
+
+            return fromAbiValue(name, result);
+        }});
+    }
+}
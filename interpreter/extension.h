@@ -0,0 +1,23 @@
+#ifndef SPL_EXTENSION_LOADER_H
+#define SPL_EXTENSION_LOADER_H
+
+#include <string>
+
+#include "environment.h"
+
+/**
+ * Loads extension modules: shared objects implementing the C ABI in spl_extension.h.
+ */
+namespace extension {
+    /**
+     * Loads the shared object at the given path and registers each of its functions in the environment as a
+     * types::NativeFunction. The shared object stays loaded for as long as any of its functions is referenced.
+     *
+     * @throws std::runtime_error if the module cannot be loaded or was built against another ABI version
+     * @param env The environment to register the functions in
+     * @param path The path of the shared object
+     */
+    void load(env::Environment& env, const std::string& path);
+}
+
+#endif  // SPL_EXTENSION_LOADER_H
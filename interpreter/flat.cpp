@@ -0,0 +1,414 @@
+#include "flat.h"
+
+#include "control_flow.h"
+#include "sandbox.h"
+#include "trace.h"
+
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+
+
+namespace {
+    bool isLiteral(token::TokenType type) {
+        return type == token::TokenType::LITERAL_INT || type == token::TokenType::LITERAL_FLOAT
+               || type == token::TokenType::LITERAL_BOOL || type == token::TokenType::LITERAL_STRING;
+    }
+
+    /**
+     * @return The value of a literal, as ast::ExpressionNode evaluates it
+     */
+    env::VariantType decode(const token::Token& literal) {
+        switch (literal.type()) {
+            case token::TokenType::LITERAL_INT:
+                return types::parseInteger(literal.value());
+            case token::TokenType::LITERAL_FLOAT:
+                return std::stof(literal.value());
+            case token::TokenType::LITERAL_BOOL:
+                return literal.value() == "true";
+            default:
+                return literal.value();
+        }
+    }
+}
+
+/**
+ * Evaluates the operands of a CALL node as the arguments of the call.
+ */
+class flat::Program::Arguments : public ast::FunctionCallNode::Arguments {
+public:
+    Arguments(const Program& program, uint32_t call) : program(program), call(call) {}
+
+    std::vector<env::VariantType> evaluate(env::Environment& env) const override {
+        return program.evaluateOperands(call, env);
+    }
+
+private:
+    const Program& program;
+    uint32_t call;
+};
+
+
+flat::Program::Program(ast::ASTNode& root) {
+    uint32_t index = append(Kind::BLOCK, 0, root);
+
+    for (const std::shared_ptr<ast::ASTNode>& statement : root.children()) {
+        flatten(statement);
+    }
+
+    ends[index] = static_cast<uint32_t>(kinds.size());
+    nameIndex.clear();
+}
+
+void flat::Program::run(env::Environment& env) const {
+    env::VariantType returned;
+
+    if (execute(0, env, returned) == Signal::RETURN) {
+        throw control::ReturnException(std::move(returned));
+    }
+}
+
+env::VariantType flat::Program::call(env::Environment& env) const {
+    env::VariantType returned;
+
+    switch (execute(0, env, returned)) {
+        case Signal::RETURN:
+            return returned;
+        case Signal::BREAK:
+            throw control::BreakException();
+        case Signal::CONTINUE:
+            throw control::ContinueException();
+        default:
+            return 0;  // todo: implement a null type
+    }
+}
+
+size_t flat::Program::size() const {
+    return kinds.size();
+}
+
+size_t flat::Program::memoryUsage() const {
+    size_t bytes = sizeof(Program);
+
+    bytes += kinds.capacity() * sizeof(Kind);
+    bytes += ends.capacity() * sizeof(uint32_t);
+    bytes += payloads.capacity() * sizeof(uint32_t);
+    bytes += lines.capacity() * sizeof(int32_t);
+    bytes += columns.capacity() * sizeof(int32_t);
+    bytes += constants.capacity() * sizeof(env::VariantType);
+    bytes += names.capacity() * sizeof(std::string);
+    bytes += treeNodes.capacity() * sizeof(std::shared_ptr<ast::ASTNode>);
+    bytes += functions.capacity() * sizeof(std::shared_ptr<ast::FunctionDefNode>);
+    bytes += functionBodies.capacity() * sizeof(std::shared_ptr<FunctionBody>);
+
+    for (const std::string& name : names) {
+        bytes += name.capacity() > sizeof(std::string) ? name.capacity() : 0;
+    }
+
+    for (const std::shared_ptr<FunctionBody>& body : functionBodies) {
+        bytes += body->memoryUsage();
+    }
+
+    return bytes;
+}
+
+void flat::Program::flatten(const std::shared_ptr<ast::ASTNode>& node) {
+    ast::ASTNode& tree = *node;
+    const std::type_info& type = typeid(tree);
+    std::vector<std::shared_ptr<ast::ASTNode>>& children = tree.children();
+    uint32_t index;
+
+    if (type == typeid(ast::RootNode) || type == typeid(ast::IfNode) || type == typeid(ast::WhileNode)) {
+        Kind kind = type == typeid(ast::RootNode) ? Kind::BLOCK : type == typeid(ast::IfNode) ? Kind::IF : Kind::WHILE;
+        index = append(kind, 0, tree);
+
+        for (const std::shared_ptr<ast::ASTNode>& child : children) {
+            flatten(child);
+        }
+    } else if (type == typeid(ast::ForNode)) {
+        const std::vector<std::shared_ptr<ast::ASTNode>>& initialization = children[0]->children();
+        index = append(Kind::FOR, intern(initialization[0]->token().value()), tree);
+        flatten(initialization[1]);
+
+        for (size_t i = 1; i < children.size(); i++) {
+            flatten(children[i]);
+        }
+    } else if (type == typeid(ast::DeclarationNode)) {
+        // a declaration has no token of its own, so it is located at the variable it assigns
+        index = append(Kind::DECLARE, intern(children[0]->token().value()), *children[0]);
+        flatten(children[1]);
+    } else if (type == typeid(ast::ControlFlowNode)) {
+        switch (tree.token().type()) {
+            case token::TokenType::RETURN:
+                index = append(Kind::RETURN, 0, tree);
+                flatten(children[0]);
+                break;
+            case token::TokenType::BREAK:
+                index = append(Kind::BREAK, 0, tree);
+                break;
+            default:
+                index = append(Kind::CONTINUE, 0, tree);
+                break;
+        }
+    } else if (type == typeid(ast::FunctionDefNode)) {
+        auto definition = std::static_pointer_cast<ast::FunctionDefNode>(node);
+        index = append(Kind::FUNCTION, static_cast<uint32_t>(functions.size()), tree);
+
+        functionBodies.push_back(std::make_shared<FunctionBody>(definition->body()));
+        functions.push_back(std::move(definition));
+    } else if (type == typeid(ast::FunctionCallNode)) {
+        index = append(Kind::CALL, intern(tree.token().value()), tree);
+
+        for (const std::shared_ptr<ast::ASTNode>& argument : children) {
+            flatten(argument);
+        }
+    } else if (type == typeid(ast::ExpressionNode) && children.size() == 2) {
+        index = append(Kind::BINARY, static_cast<uint32_t>(tree.token().type()), tree);
+        flatten(children[0]);
+        flatten(children[1]);
+    } else if (type == typeid(ast::ExpressionNode) && children.size() == 1
+               && tree.token().type() == token::TokenType::OPERATOR_UNARY_NOT) {
+        index = append(Kind::NOT, 0, tree);
+        flatten(children[0]);
+    } else if (type == typeid(ast::ExpressionNode) && children.empty() && tree.token().type() == token::TokenType::IDENTIFIER) {
+        index = append(Kind::VARIABLE, intern(tree.token().value()), tree);
+    } else if (type == typeid(ast::ExpressionNode) && children.empty() && isLiteral(tree.token().type())) {
+        // decoded once here instead of on every evaluation
+        index = append(Kind::CONSTANT, static_cast<uint32_t>(constants.size()), tree);
+        constants.push_back(decode(tree.token()));
+    } else {
+        index = append(Kind::TREE, static_cast<uint32_t>(treeNodes.size()), tree);
+        treeNodes.push_back(node);
+    }
+
+    ends[index] = static_cast<uint32_t>(kinds.size());
+}
+
+uint32_t flat::Program::append(Kind kind, uint32_t payload, const ast::ASTNode& node) {
+    kinds.push_back(kind);
+    ends.push_back(0);  // set once the operands have been appended
+    payloads.push_back(payload);
+    lines.push_back(static_cast<int32_t>(node.token().line()));
+    columns.push_back(static_cast<int32_t>(node.token().column()));
+
+    return static_cast<uint32_t>(kinds.size() - 1);
+}
+
+uint32_t flat::Program::intern(const std::string& name) {
+    auto [it, inserted] = nameIndex.emplace(name, static_cast<uint32_t>(names.size()));
+
+    if (inserted) {
+        names.push_back(name);
+    }
+
+    return it->second;
+}
+
+flat::Program::Signal flat::Program::execute(uint32_t node, env::Environment& env, env::VariantType& returned) const {
+    switch (kinds[node]) {
+        case Kind::BLOCK:
+            for (uint32_t statement = node + 1; statement < ends[node]; statement = ends[statement]) {
+                trace::record(trace::Event::STATEMENT, lines[statement], columns[statement]);
+                Signal signal;
+
+                try {
+                    signal = execute(statement, env, returned);
+                } catch (const std::runtime_error&) {
+                    trace::record(trace::Event::ERROR, lines[statement], columns[statement]);
+                    throw;
+                }
+
+                if (signal != Signal::NONE) {
+                    return signal;
+                }
+            }
+
+            return Signal::NONE;
+
+        case Kind::DECLARE:
+            env.set(names[payloads[node]], evaluate(node + 1, env));
+            return Signal::NONE;
+
+        case Kind::IF:
+            for (uint32_t condition = node + 1; condition < ends[node]; condition = ends[ends[condition]]) {
+                // an operand without a block after it is the else block
+                if (ends[condition] == ends[node]) {
+                    return execute(condition, env, returned);
+                }
+
+                if (std::get<bool>(evaluate(condition, env))) {
+                    return execute(ends[condition], env, returned);
+                }
+            }
+
+            return Signal::NONE;
+
+        case Kind::WHILE: {
+            uint32_t condition = node + 1;
+            uint32_t body = ends[condition];
+            sandbox::Limits* limits = env.limits();
+
+            while (std::get<bool>(evaluate(condition, env))) {
+                if (limits != nullptr) {
+                    limits->step();
+                }
+
+                trace::record(trace::Event::ITERATION, lines[node], columns[node]);
+
+                Signal signal;
+
+                // a function called from the body can still break out of the loop, like in the tree walker
+                try {
+                    signal = execute(body, env, returned);
+                } catch (const control::ContinueException&) {
+                    continue;
+                } catch (const control::BreakException&) {
+                    break;
+                }
+
+                if (signal == Signal::BREAK) {
+                    break;
+                }
+
+                if (signal == Signal::RETURN) {
+                    return signal;
+                }
+            }
+
+            return Signal::NONE;
+        }
+
+        case Kind::FOR: {
+            uint32_t start = node + 1;
+            uint32_t end = ends[start];
+            uint32_t step = ends[end];
+            uint32_t body = ends[step];
+            const std::string& counter = names[payloads[node]];
+            auto range = ast::ForNode::Range::of(evaluate(start, env), evaluate(end, env), evaluate(step, env));
+            sandbox::Limits* limits = env.limits();
+
+            int64_t value = range.first;
+            for (; range.contains(value); value += range.step) {
+                if (limits != nullptr) {
+                    limits->step();
+                }
+
+                trace::record(trace::Event::ITERATION, lines[node], columns[node]);
+                env.set(counter, static_cast<int>(value));
+
+                Signal signal;
+
+                try {
+                    signal = execute(body, env, returned);
+                } catch (const control::ContinueException&) {
+                    continue;
+                } catch (const control::BreakException&) {
+                    return Signal::NONE;
+                }
+
+                if (signal == Signal::BREAK) {
+                    return Signal::NONE;
+                }
+
+                if (signal == Signal::RETURN) {
+                    return signal;
+                }
+            }
+
+            env.set(counter, ast::ForNode::counterValue(value));
+
+            return Signal::NONE;
+        }
+
+        case Kind::RETURN:
+            returned = evaluate(node + 1, env);
+            return Signal::RETURN;
+
+        case Kind::BREAK:
+            return Signal::BREAK;
+
+        case Kind::CONTINUE:
+            return Signal::CONTINUE;
+
+        case Kind::FUNCTION: {
+            const ast::FunctionDefNode& definition = *functions[payloads[node]];
+            env.set(definition.token().value(), types::Function{definition.parameters(), functionBodies[payloads[node]], definition.cache()});
+
+            return Signal::NONE;
+        }
+
+        default:
+            evaluate(node, env);
+            return Signal::NONE;
+    }
+}
+
+env::VariantType flat::Program::evaluate(uint32_t node, env::Environment& env) const {
+    switch (kinds[node]) {
+        case Kind::CONSTANT:
+            return constants[payloads[node]];
+
+        case Kind::VARIABLE:
+            return env.get(names[payloads[node]]);
+
+        case Kind::NOT:
+            return !std::get<bool>(evaluate(node + 1, env));
+
+        case Kind::BINARY: {
+            uint32_t left = node + 1;
+            env::VariantType leftValue = evaluate(left, env);
+            env::VariantType rightValue = evaluate(ends[left], env);
+
+            return ast::ExpressionNode::applyOperator(static_cast<token::TokenType>(payloads[node]), std::move(leftValue),
+                                                      std::move(rightValue), env);
+        }
+
+        case Kind::CALL: {
+            size_t argumentCount = 0;
+            for (uint32_t argument = node + 1; argument < ends[node]; argument = ends[argument]) {
+                argumentCount++;
+            }
+
+            trace::record(trace::Event::CALL, lines[node], columns[node]);
+            env::VariantType result = ast::FunctionCallNode::call(names[payloads[node]], argumentCount, Arguments{*this, node}, env);
+            trace::record(trace::Event::RETURN, lines[node], columns[node]);
+
+            return result;
+        }
+
+        case Kind::TREE:
+            return treeNodes[payloads[node]]->eval(env);
+
+        default:
+            throw std::runtime_error("Statement used as an expression at line " + std::to_string(lines[node]));
+    }
+}
+
+std::vector<env::VariantType> flat::Program::evaluateOperands(uint32_t node, env::Environment& env) const {
+    std::vector<env::VariantType> values;
+
+    for (uint32_t operand = node + 1; operand < ends[node]; operand = ends[operand]) {
+        values.push_back(evaluate(operand, env));
+    }
+
+    return values;
+}
+
+
+flat::FunctionBody::FunctionBody(std::shared_ptr<ast::FunctionBodyNode> body) : treeBody(std::move(body)) {}
+
+env::VariantType flat::FunctionBody::eval(env::Environment& env) const {
+    std::call_once(flattened, [this]() {
+        program = std::make_unique<Program>(treeBody->root());
+    });
+
+    return program->call(env);
+}
+
+size_t flat::FunctionBody::memoryUsage() const {
+    return program ? program->memoryUsage() : 0;
+}
+
+const std::shared_ptr<ast::FunctionBodyNode>& flat::FunctionBody::tree() const {
+    return treeBody;
+}
@@ -0,0 +1,147 @@
+#ifndef SPL_FLAT_H
+#define SPL_FLAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+
+/**
+ * A flat layout of the AST: the nodes of a program are stored in pre-order in parallel arrays (kind, subtree end,
+ * payload and source position) instead of as heap objects linked by shared_ptrs. The operands of a node directly follow
+ * it, so walking an expression reads consecutive memory, and the fields the evaluator needs on every node share cache
+ * lines with those of the neighbouring nodes.
+ *
+ * Literals are decoded once, when the program is flattened. Nodes without a flat form (collection literals, indexing
+ * and typed expressions, see inference.h) are kept as references to the tree and evaluated by it. Function bodies are
+ * flattened the first time the function is called.
+ */
+namespace flat {
+    enum class Kind : uint8_t {
+        BLOCK,  // operands: statements
+        DECLARE,  // payload: name. Operands: the value
+        IF,  // operands: condition, block, condition, block, ..., and an optional else block
+        WHILE,  // operands: condition, block
+        FOR,  // payload: name of the counter. Operands: start, end, step, block
+        RETURN,  // operands: the value
+        BREAK,
+        CONTINUE,
+        FUNCTION,  // payload: function definition
+        CONSTANT,  // payload: constant
+        VARIABLE,  // payload: name
+        NOT,  // operands: the operand
+        BINARY,  // payload: the operator's TokenType. Operands: left, right
+        CALL,  // payload: name. Operands: arguments
+        TREE  // payload: tree node, evaluated by the tree walker
+    };
+
+    class FunctionBody;
+
+    class Program {
+    public:
+        /**
+         * Flattens a block of statements, e.g., the root of a program.
+         */
+        explicit Program(ast::ASTNode& root);
+
+        /**
+         * Runs the program.
+         * @throws control::BreakException, control::ContinueException or control::ReturnException if a break, continue
+         * or return is not inside a loop or function, as the tree walker does
+         */
+        void run(env::Environment& env) const;
+
+        /**
+         * Runs the program as the body of a function. Unlike the tree walker, a return statement does not throw: it
+         * ends the program with the returned value, which saves unwinding the stack on every call.
+         * @return The returned value, or 0 if the program ends without returning
+         */
+        env::VariantType call(env::Environment& env) const;
+
+        /**
+         * @return The number of nodes
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @return The bytes used by the node arrays and payload tables, including those of the function bodies
+         * flattened so far, but not the tree nodes kept by reference
+         */
+        [[nodiscard]] size_t memoryUsage() const;
+
+    private:
+        /**
+         * What a statement asks of the loop or function around it.
+         */
+        enum class Signal {
+            NONE,
+            BREAK,
+            CONTINUE,
+            RETURN
+        };
+
+        class Arguments;
+
+        /**
+         * Appends a node and its subtree in pre-order.
+         */
+        void flatten(const std::shared_ptr<ast::ASTNode>& node);
+        uint32_t append(Kind kind, uint32_t payload, const ast::ASTNode& node);
+        uint32_t intern(const std::string& name);
+
+        /**
+         * Runs a statement.
+         * @param returned Receives the value of a return statement, signalled by Signal::RETURN
+         */
+        Signal execute(uint32_t node, env::Environment& env, env::VariantType& returned) const;
+        env::VariantType evaluate(uint32_t node, env::Environment& env) const;
+        std::vector<env::VariantType> evaluateOperands(uint32_t node, env::Environment& env) const;
+
+        // one entry per node, in pre-order
+        std::vector<Kind> kinds;
+        std::vector<uint32_t> ends;  // one past the last node of the subtree. The first operand is the next node
+        std::vector<uint32_t> payloads;
+        std::vector<int32_t> lines;
+        std::vector<int32_t> columns;
+
+        std::vector<env::VariantType> constants;
+        std::vector<std::string> names;
+        std::vector<std::shared_ptr<ast::ASTNode>> treeNodes;
+        std::vector<std::shared_ptr<ast::FunctionDefNode>> functions;
+        std::vector<std::shared_ptr<FunctionBody>> functionBodies;  // one per function
+
+        std::unordered_map<std::string, uint32_t> nameIndex;  // only used while flattening
+    };
+
+    /**
+     * The body of a function defined in a flat program. Flattens the function's parsed body the first time it is run.
+     */
+    class FunctionBody : public ast::ASTNode {
+    public:
+        explicit FunctionBody(std::shared_ptr<ast::FunctionBodyNode> body);
+
+        env::VariantType eval(env::Environment& env) const override;
+
+        /**
+         * @return The memory usage of the flattened body, or 0 if it has not been flattened yet
+         */
+        [[nodiscard]] size_t memoryUsage() const;
+
+        /**
+         * @return The tree body that is flattened
+         */
+        [[nodiscard]] const std::shared_ptr<ast::FunctionBodyNode>& tree() const;
+
+    private:
+        std::shared_ptr<ast::FunctionBodyNode> treeBody;
+        mutable std::once_flag flattened;
+        mutable std::unique_ptr<Program> program;
+    };
+}
+
+#endif  // SPL_FLAT_H
@@ -0,0 +1,175 @@
+#include "frontend.h"
+
+#include "tokenizer.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+
+namespace {
+    /**
+     * Chunks per thread. With more chunks than threads, a thread that finishes its chunks early takes more, so one slow
+     * chunk does not hold the others up.
+     */
+    constexpr size_t CHUNKS_PER_THREAD = 4;
+
+    /**
+     * Checks whether a closing brace at top level ends its statement, i.e., it is not followed by an elif or else
+     * branch, or by more of an expression (e.g., the ; after a dictionary literal).
+     * @param source The source code
+     * @param pos The position right after the brace
+     */
+    bool endsStatement(std::string_view source, size_t pos) {
+        while (pos < source.size() && std::isspace(static_cast<unsigned char>(source[pos]))) {
+            pos++;
+        }
+
+        if (pos == source.size()) {
+            return true;
+        }
+
+        if (!std::isalnum(static_cast<unsigned char>(source[pos]))) {
+            return false;
+        }
+
+        size_t end = pos;
+        while (end < source.size() && std::isalnum(static_cast<unsigned char>(source[end]))) {
+            end++;
+        }
+
+        std::string_view word = source.substr(pos, end - pos);
+        return word != "elif" && word != "else";
+    }
+
+    ast::RootNode parseChunk(const frontend::Chunk& chunk) {
+        token::Tokenizer tokenizer{chunk.source, chunk.firstLine, chunk.firstColumn};
+        Parser parser{tokenizer.getTokens()};
+
+        return parser.root();
+    }
+}
+
+
+std::vector<frontend::Chunk> frontend::split(std::string_view source, size_t parts) {
+    std::vector<Chunk> chunks;
+    parts = std::max<size_t>(parts, 1);
+
+    size_t targetSize = source.size() / parts;
+    size_t chunkStart = 0;
+    size_t chunkLine = 1;
+    size_t chunkColumn = 0;
+
+    size_t line = 1;
+    size_t lineStart = 0;
+    int depth = 0;
+    bool inString = false;
+
+    for (size_t i = 0; i < source.size() && chunks.size() + 1 < parts; i++) {
+        char ch = source[i];
+
+        if (ch == '\n') {
+            line++;
+            lineStart = i + 1;
+        }
+
+        if (inString) {
+            inString = ch != '"';
+            continue;
+        }
+
+        switch (ch) {
+            case '"':
+                inString = true;
+                break;
+            case '(':
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ')':
+            case ']':
+            case '}':
+                depth--;
+                break;
+            default:
+                break;
+        }
+
+        bool boundary = depth == 0 && (ch == ';' || (ch == '}' && endsStatement(source, i + 1)));
+
+        if (boundary && i + 1 - chunkStart >= targetSize) {
+            chunks.push_back(Chunk{source.substr(chunkStart, i + 1 - chunkStart), chunkLine, chunkColumn});
+
+            chunkStart = i + 1;
+            chunkLine = line;
+            chunkColumn = chunkStart - lineStart;
+        }
+    }
+
+    if (chunkStart < source.size() || chunks.empty()) {
+        chunks.push_back(Chunk{source.substr(chunkStart), chunkLine, chunkColumn});
+    }
+
+    return chunks;
+}
+
+ast::RootNode frontend::parse(std::string_view source, size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (threads == 1) {
+        return parseChunk(Chunk{source, 1, 0});
+    }
+
+    std::vector<Chunk> chunks = split(source, threads * CHUNKS_PER_THREAD);
+    std::vector<ast::RootNode> roots(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::atomic<size_t> next{0};
+
+    auto work = [&chunks, &roots, &errors, &next]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            try {
+                roots[i] = parseChunk(chunks[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, chunks.size()); i++) {
+        try {
+            workers.emplace_back(work);
+        } catch (const std::system_error&) {
+            break;  // parse on the threads that did start
+        }
+    }
+
+    work();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    ast::RootNode root;
+    for (ast::RootNode& part : roots) {
+        for (std::shared_ptr<ast::ASTNode>& statement : part.children()) {
+            root.children().push_back(std::move(statement));
+        }
+    }
+
+    return root;
+}
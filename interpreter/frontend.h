@@ -0,0 +1,46 @@
+#ifndef SPL_FRONTEND_H
+#define SPL_FRONTEND_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "ast.h"
+
+/**
+ * The front end for large sources: splits a source at top-level statement boundaries, then tokenizes and parses the
+ * pieces on several threads. The statements are stitched back together in source order, so the result is the same as
+ * parsing the whole source on one thread.
+ */
+namespace frontend {
+    /**
+     * A run of whole top-level statements.
+     */
+    struct Chunk {
+        std::string_view source;
+        size_t firstLine;  // the line number of the first line of the chunk in the whole source
+        size_t firstColumn;  // the number of characters before the chunk on its first line
+    };
+
+    /**
+     * Splits a source into about the given number of chunks of similar size. Chunks only end after a top-level ; or after
+     * the closing brace of a top-level block, so every statement is in one chunk. Only scans characters, so it is much
+     * cheaper than tokenizing.
+     * @param source The source code. The chunks point into it
+     * @param parts The number of chunks to aim for. Small sources may give fewer
+     * @return The chunks, in source order. Together they cover the whole source
+     */
+    std::vector<Chunk> split(std::string_view source, size_t parts);
+
+    /**
+     * Tokenizes and parses a source.
+     * @param source The source code
+     * @param threads The number of threads to parse on. 1 parses on the calling thread; 0 uses one per hardware thread
+     * @throws std::runtime_error if the source cannot be tokenized or parsed. If several chunks fail, the error of the
+     * first one in the source is thrown
+     * @return The root of the program
+     */
+    ast::RootNode parse(std::string_view source, size_t threads = 1);
+}
+
+#endif  // SPL_FRONTEND_H
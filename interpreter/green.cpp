@@ -0,0 +1,472 @@
+#include "green.h"
+
+#include "tokenizer.h"
+#include "parser.h"
+#include "inference.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+namespace {
+    /**
+     * The script the current worker thread is running. Only read before a script suspends: after it is resumed, it
+     * may be running on another thread.
+     */
+    thread_local green::Script* runningScript = nullptr;
+
+    size_t pageSize() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+}
+
+
+green::Script::Script(ast::RootNode program, size_t stackSize, uint64_t timeSlice)
+    : program(std::move(program)), limits(timeSlice, sandbox::Limits::UNLIMITED_MEMORY),
+      stack(nullptr), stackBytes(0), context(), returnContext(nullptr), currentState(State::READY),
+      requestedState(State::READY), started(false), cancelled(false) {
+
+    size_t page = pageSize();
+    stackBytes = (stackSize + page - 1) / page * page + page;
+
+    // pages are only backed by memory once the script touches them
+    stack = mmap(nullptr, stackBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        throw std::runtime_error("Could not allocate a stack for the script");
+    }
+
+    // the lowest page is a guard page, so a stack overflow faults instead of corrupting other memory
+    mprotect(stack, page, PROT_NONE);
+
+    getcontext(&context);
+    context.uc_stack.ss_sp = static_cast<char*>(stack) + page;
+    context.uc_stack.ss_size = stackBytes - page;
+    context.uc_link = nullptr;
+
+    // makecontext only passes ints, so the pointer is split in two
+    auto address = reinterpret_cast<uintptr_t>(this);
+    makecontext(&context, reinterpret_cast<void (*)()>(&Script::trampoline), 2,
+                static_cast<uint32_t>(static_cast<uint64_t>(address) >> 32), static_cast<uint32_t>(address));
+
+    limits.onExhausted([this]() {
+        suspend(State::READY);
+        return true;
+    });
+
+    limits.limitCallDepth(stackSize / Scheduler::STACK_PER_CALL);
+}
+
+green::Script::~Script() {
+    if (stack != nullptr) {
+        munmap(stack, stackBytes);
+    }
+}
+
+green::Script::State green::Script::state() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return currentState;
+}
+
+std::exception_ptr green::Script::error() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failure;
+}
+
+env::Environment& green::Script::environment() {
+    return variables;
+}
+
+size_t green::Script::memoryUsage() const {
+    size_t bytes = sizeof(Script);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stack == nullptr) {
+        return bytes;
+    }
+
+    size_t page = pageSize();
+    size_t pages = stackBytes / page - 1;
+    std::vector<unsigned char> resident(pages);
+
+    if (mincore(static_cast<char*>(stack) + page, pages * page, resident.data()) == 0) {
+        for (unsigned char flags : resident) {
+            bytes += (flags & 1) ? page : 0;
+        }
+    }
+
+    return bytes;
+}
+
+void green::Script::trampoline(uint32_t high, uint32_t low) {
+    auto* script = reinterpret_cast<Script*>((static_cast<uintptr_t>(high) << 32) | low);
+    std::exception_ptr error;
+
+    try {
+        bool cancel;
+        {
+            std::lock_guard<std::mutex> lock(script->mutex);
+            cancel = script->cancelled;
+        }
+
+        if (cancel) {
+            throw Cancelled();
+        }
+
+        script->variables.attachLimits(&script->limits);
+        script->program.eval(script->variables);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    script->variables.attachLimits(nullptr);
+
+    {
+        std::lock_guard<std::mutex> lock(script->mutex);
+        script->failure = error;
+        script->requestedState = error ? State::FAILED : State::FINISHED;
+    }
+
+    error = nullptr;
+
+    // the worker frees the stack; this context is never resumed
+    swapcontext(&script->context, script->returnContext);
+}
+
+void green::Script::suspend(State next) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requestedState = next;
+    }
+
+    swapcontext(&context, returnContext);
+
+    // resumed, possibly on another worker
+    bool cancel;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancel = cancelled;
+    }
+
+    if (cancel) {
+        throw Cancelled();
+    }
+}
+
+
+green::Scheduler::Scheduler(size_t workerCount, size_t stackSize, uint64_t timeSlice)
+    : stackSize(stackSize), timeSlice(timeSlice), queued(0), active(0), stopping(false), nextWorker(0) {
+
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers[i]->thread = std::thread(&Scheduler::run, this, i);
+    }
+}
+
+green::Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    idle.notify_all();
+
+    for (const std::unique_ptr<Worker>& worker : workers) {
+        worker->thread.join();
+    }
+
+    // unwind the scripts that have not finished, so the objects on their stacks are destroyed
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    for (const std::shared_ptr<Script>& script : scripts) {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> scriptLock(script->mutex);
+                if (script->currentState == Script::State::FINISHED || script->currentState == Script::State::FAILED) {
+                    break;
+                }
+
+                script->cancelled = true;
+            }
+
+            Script::State next = switchTo(script.get());
+
+            std::lock_guard<std::mutex> scriptLock(script->mutex);
+            if (next == Script::State::FINISHED || next == Script::State::FAILED) {
+                script->currentState = next;
+                munmap(script->stack, script->stackBytes);
+                script->stack = nullptr;
+            }
+        }
+    }
+}
+
+std::shared_ptr<green::Script> green::Scheduler::spawn(const std::string& source) {
+    token::Tokenizer tokenizer{source};
+    Parser parser{tokenizer.getTokens()};
+    ast::RootNode root = parser.root();
+    inference::specialize(root);
+
+    std::shared_ptr<Script> script{new Script(std::move(root), stackSize, timeSlice)};
+
+    {
+        std::lock_guard<std::mutex> lock(scriptsMutex);
+        scripts.push_back(script);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        active++;
+    }
+
+    enqueue(script.get(), nextWorker++ % workers.size());
+
+    return script;
+}
+
+void green::Scheduler::send(const std::shared_ptr<Script>& script, env::VariantType message) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(script->mutex);
+        script->messages.push_back(std::move(message));
+
+        wake = script->currentState == Script::State::WAITING;
+        if (wake) {
+            script->currentState = Script::State::READY;
+        }
+    }
+
+    if (wake) {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            active++;
+        }
+
+        enqueue(script.get(), nextWorker++ % workers.size());
+    }
+}
+
+void green::Scheduler::wait() {
+    {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        settled.wait(lock, [this]() { return active == 0; });
+    }
+
+    // drop the scheduler's references to finished scripts
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    std::vector<std::shared_ptr<Script>> unfinished;
+
+    for (std::shared_ptr<Script>& script : scripts) {
+        Script::State state = script->state();
+
+        if (state != Script::State::FINISHED && state != Script::State::FAILED) {
+            unfinished.push_back(std::move(script));
+        }
+    }
+
+    scripts = std::move(unfinished);
+}
+
+green::MemoryReport green::Scheduler::memoryReport() const {
+    MemoryReport report;
+
+    std::lock_guard<std::mutex> lock(scriptsMutex);
+    for (const std::shared_ptr<Script>& script : scripts) {
+        bool suspended;
+        {
+            std::lock_guard<std::mutex> scriptLock(script->mutex);
+            Script::State state = script->currentState;
+
+            if (state == Script::State::FINISHED || state == Script::State::FAILED) {
+                continue;
+            }
+
+            suspended = script->started && (state == Script::State::READY || state == Script::State::WAITING);
+        }
+
+        report.scripts++;
+
+        if (suspended) {
+            report.suspended++;
+            report.suspendedBytes += script->memoryUsage();
+        }
+    }
+
+    return report;
+}
+
+size_t green::Scheduler::workerCount() const {
+    return workers.size();
+}
+
+void green::Scheduler::enqueue(Script* script, size_t preferredWorker) {
+    {
+        std::lock_guard<std::mutex> lock(workers[preferredWorker]->mutex);
+        workers[preferredWorker]->queue.push_back(script);
+    }
+
+    queued++;
+
+    // taking the lock orders this with a worker checking queued before it sleeps, so the wakeup can't be lost
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+    }
+    idle.notify_one();
+}
+
+green::Script* green::Scheduler::take(size_t worker) {
+    {
+        Worker& own = *workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.queue.empty()) {
+            Script* script = own.queue.front();
+            own.queue.pop_front();
+            queued--;
+            return script;
+        }
+    }
+
+    // steal from the back of the other queues, starting with the next worker so thieves spread out
+    for (size_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = *workers[(worker + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.queue.empty()) {
+            Script* script = victim.queue.back();
+            victim.queue.pop_back();
+            queued--;
+            return script;
+        }
+    }
+
+    return nullptr;
+}
+
+void green::Scheduler::run(size_t worker) {
+    while (true) {
+        Script* script = take(worker);
+
+        if (script != nullptr) {
+            resume(script, worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [this]() { return stopping || queued > 0; });
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+green::Script::State green::Scheduler::switchTo(Script* script) {
+    ucontext_t workerContext;
+
+    {
+        std::lock_guard<std::mutex> lock(script->mutex);
+        script->currentState = Script::State::RUNNING;
+        script->requestedState = Script::State::RUNNING;
+        script->started = true;
+    }
+
+    script->returnContext = &workerContext;
+    runningScript = script;
+
+    swapcontext(&workerContext, &script->context);
+
+    runningScript = nullptr;
+
+    std::lock_guard<std::mutex> lock(script->mutex);
+    return script->requestedState;
+}
+
+void green::Scheduler::resume(Script* script, size_t worker) {
+    Script::State next = switchTo(script);
+
+    std::unique_lock<std::mutex> lock(script->mutex);
+
+    switch (next) {
+        case Script::State::READY:
+            script->currentState = Script::State::READY;
+            lock.unlock();
+            enqueue(script, worker);
+            return;
+        case Script::State::WAITING:
+            // a message may have arrived between the script deciding to wait and now
+            if (!script->messages.empty()) {
+                script->currentState = Script::State::READY;
+                lock.unlock();
+                enqueue(script, worker);
+                return;
+            }
+
+            script->currentState = Script::State::WAITING;
+            break;
+        default:
+            script->currentState = next;
+            munmap(script->stack, script->stackBytes);
+            script->stack = nullptr;
+            break;
+    }
+
+    lock.unlock();
+    deactivate();
+}
+
+void green::Scheduler::deactivate() {
+    bool settledNow;
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        active--;
+        settledNow = active == 0;
+    }
+
+    if (settledNow) {
+        settled.notify_all();
+    }
+}
+
+
+bool green::yield() {
+    Script* script = runningScript;
+
+    if (script == nullptr) {
+        return false;
+    }
+
+    script->suspend(Script::State::READY);
+    return true;
+}
+
+env::VariantType green::receive() {
+    Script* script = runningScript;
+
+    if (script == nullptr) {
+        throw std::runtime_error("receive can only be called from a script run by a scheduler");
+    }
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(script->mutex);
+
+            if (!script->messages.empty()) {
+                env::VariantType message = std::move(script->messages.front());
+                script->messages.pop_front();
+                return message;
+            }
+        }
+
+        script->suspend(Script::State::WAITING);
+    }
+}
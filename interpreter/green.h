@@ -0,0 +1,226 @@
+#ifndef SPL_GREEN_H
+#define SPL_GREEN_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ucontext.h>
+
+#include "ast.h"
+#include "sandbox.h"
+
+/**
+ * Green threads: scripts that run on their own small stacks and can be suspended and resumed, multiplexed over a fixed
+ * pool of worker threads by a work-stealing scheduler.
+ *
+ * A script is suspended when it calls yield() or receive(), and every time it has taken a time slice of steps (see
+ * sandbox.h), so a busy script can't starve the others. A suspended script can be resumed on any worker.
+ */
+namespace green {
+    class Scheduler;
+
+    bool yield();
+    env::VariantType receive();
+
+    class Script {
+    public:
+        enum class State {
+            READY,  // waiting for a worker
+            RUNNING,
+            WAITING,  // called receive() with no messages queued
+            FINISHED,
+            FAILED
+        };
+
+        Script(const Script&) = delete;
+        Script& operator=(const Script&) = delete;
+        ~Script();
+
+        [[nodiscard]] State state() const;
+
+        /**
+         * @return The error the script failed with, or nullptr if it has not failed
+         */
+        [[nodiscard]] std::exception_ptr error() const;
+
+        /**
+         * The variables of the script. Only safe to use while the script is not READY or RUNNING.
+         */
+        [[nodiscard]] env::Environment& environment();
+
+        /**
+         * @return The memory the script uses while suspended: the pages of its stack that have been touched, plus the
+         * script's own bookkeeping. Variables and the AST are not included
+         */
+        [[nodiscard]] size_t memoryUsage() const;
+
+    private:
+        friend class Scheduler;
+        friend bool yield();
+        friend env::VariantType receive();
+
+        Script(ast::RootNode program, size_t stackSize, uint64_t timeSlice);
+
+        /**
+         * Entry point of the script's stack. Runs the program and switches back to the worker when it is done.
+         */
+        static void trampoline(uint32_t high, uint32_t low);
+
+        /**
+         * Switches from the script back to the worker that is running it. Returns when a worker resumes the script.
+         * @throws Cancelled if the scheduler is being destroyed
+         */
+        void suspend(State next);
+
+        ast::RootNode program;
+        env::Environment variables;
+        sandbox::Limits limits;
+
+        void* stack;
+        size_t stackBytes;  // including the guard page
+        ucontext_t context;
+        ucontext_t* returnContext;  // the context of the worker running the script
+
+        mutable std::mutex mutex;  // guards everything below
+        State currentState;
+        State requestedState;  // set by the script before it suspends; applied by the worker
+        std::deque<env::VariantType> messages;
+        std::exception_ptr failure;
+        bool started;
+        bool cancelled;
+    };
+
+    struct MemoryReport {
+        size_t scripts = 0;  // scripts that have not finished
+        size_t suspended = 0;  // scripts that are READY or WAITING and have run before
+        size_t suspendedBytes = 0;  // total memoryUsage() of the suspended scripts
+    };
+
+    class Scheduler {
+    public:
+        static constexpr size_t DEFAULT_STACK_SIZE = 8 * 1024 * 1024;
+        static constexpr uint64_t DEFAULT_TIME_SLICE = 10000;
+
+        // the stack a script may use per nested function call. A call takes about 2 KiB, more with nested expressions
+        static constexpr size_t STACK_PER_CALL = 8 * 1024;
+
+        /**
+         * @param workers The number of worker threads. 0 uses one per hardware thread
+         * @param stackSize The size of each script's stack. Stack pages are only backed by memory once touched. A
+         * script whose calls nest deeper than stackSize / STACK_PER_CALL fails with sandbox::CallDepthExceeded instead
+         * of overflowing the stack
+         * @param timeSlice The number of steps a script runs before it is suspended to let others run
+         */
+        explicit Scheduler(size_t workers = 0, size_t stackSize = DEFAULT_STACK_SIZE, uint64_t timeSlice = DEFAULT_TIME_SLICE);
+
+        /**
+         * Stops the workers. Scripts that have not finished are cancelled: their stacks are unwound and they become
+         * FAILED.
+         */
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        /**
+         * Parses a script and queues it to run.
+         * @throws std::runtime_error if the script cannot be parsed
+         */
+        std::shared_ptr<Script> spawn(const std::string& source);
+
+        /**
+         * Queues a message for a script. The script receives it by calling receive(), and is woken if it is WAITING.
+         */
+        void send(const std::shared_ptr<Script>& script, env::VariantType message);
+
+        /**
+         * Blocks until every script has finished or is WAITING.
+         */
+        void wait();
+
+        [[nodiscard]] MemoryReport memoryReport() const;
+
+        [[nodiscard]] size_t workerCount() const;
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Script*> queue;
+            std::thread thread;
+        };
+
+        void enqueue(Script* script, size_t preferredWorker);
+
+        /**
+         * Takes a script from the worker's own queue, or steals one from another worker.
+         * @return The script, or nullptr if every queue is empty
+         */
+        Script* take(size_t worker);
+
+        void run(size_t worker);
+
+        /**
+         * Runs a script on the calling thread until it suspends or ends.
+         * @return The state the script asked for when it suspended
+         */
+        static Script::State switchTo(Script* script);
+
+        /**
+         * Runs a script until it suspends or ends, then requeues, parks or retires it.
+         */
+        void resume(Script* script, size_t worker);
+
+        /**
+         * Marks a script that was READY or RUNNING as no longer active.
+         */
+        void deactivate();
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        size_t stackSize;
+        uint64_t timeSlice;
+
+        mutable std::mutex scriptsMutex;
+        std::vector<std::shared_ptr<Script>> scripts;
+
+        std::mutex idleMutex;
+        std::condition_variable idle;  // workers wait here for work
+        std::condition_variable settled;  // wait() waits here for active to reach 0
+        std::atomic<size_t> queued;  // scripts in the queues
+        size_t active;  // scripts that are READY or RUNNING. Guarded by idleMutex
+        bool stopping;  // guarded by idleMutex
+        std::atomic<size_t> nextWorker;
+    };
+
+    /**
+     * Thrown inside a script when its scheduler is destroyed before it finishes, to unwind its stack.
+     */
+    class Cancelled : public std::runtime_error {
+    public:
+        Cancelled() : std::runtime_error("Script cancelled") {}
+    };
+
+    /**
+     * Suspends the script running on this thread and queues it behind the other ready scripts. Used by the yield
+     * builtin.
+     * @return False if this thread is not running a script, in which case nothing happens
+     */
+    bool yield();
+
+    /**
+     * Takes the next message sent to the script running on this thread, suspending the script until one arrives.
+     * Used by the receive builtin.
+     * @throws std::runtime_error if this thread is not running a script
+     */
+    env::VariantType receive();
+}
+
+#endif  // SPL_GREEN_H
@@ -0,0 +1,374 @@
+#include "inference.h"
+
+#include <typeinfo>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+
+namespace {
+    using ast::StaticType;
+    using TypeTable = std::unordered_map<std::string, StaticType>;
+
+    bool isNumeric(StaticType type) {
+        return type == StaticType::INT || type == StaticType::FLOAT;
+    }
+
+    bool isUnboxed(StaticType type) {
+        return type == StaticType::BOOL || isNumeric(type);
+    }
+
+    /**
+     * Joins two types: UNKNOWN joined with anything is the other type, and two different types are DYNAMIC.
+     * Ints and floats are not merged, since a variable holding either would still need a runtime check.
+     */
+    StaticType join(StaticType left, StaticType right) {
+        if (left == StaticType::UNKNOWN) {
+            return right;
+        }
+
+        if (right == StaticType::UNKNOWN || left == right) {
+            return left;
+        }
+
+        return StaticType::DYNAMIC;
+    }
+
+    /**
+     * Plain expressions are literals, variable reads and operators. Function calls, indexing and collection literals
+     * are subclasses of ExpressionNode and are never typed.
+     */
+    bool isPlainExpression(const ast::ASTNode& node) {
+        return typeid(node) == typeid(ast::ExpressionNode) || typeid(node) == typeid(ast::TypedExpressionNode);
+    }
+
+    StaticType binaryType(token::TokenType operation, StaticType left, StaticType right) {
+        bool numeric = isNumeric(left) && isNumeric(right);
+        StaticType arithmetic = left == StaticType::INT && right == StaticType::INT ? StaticType::INT : StaticType::FLOAT;
+
+        switch (operation) {
+            case token::TokenType::OPERATOR_ADD:
+                if (left == StaticType::STRING && right == StaticType::STRING) {
+                    return StaticType::STRING;
+                }
+
+                return numeric ? arithmetic : StaticType::DYNAMIC;
+            case token::TokenType::OPERATOR_MUL:
+                if ((left == StaticType::STRING && right == StaticType::INT) || (left == StaticType::INT && right == StaticType::STRING)) {
+                    return StaticType::STRING;
+                }
+
+                return numeric ? arithmetic : StaticType::DYNAMIC;
+            case token::TokenType::OPERATOR_SUB:
+            case token::TokenType::OPERATOR_DIV:
+            case token::TokenType::OPERATOR_MOD:
+                return numeric ? arithmetic : StaticType::DYNAMIC;
+            case token::TokenType::OPERATOR_EQ:
+            case token::TokenType::OPERATOR_NOT_EQ:
+                if (left == right && (left == StaticType::BOOL || left == StaticType::STRING)) {
+                    return StaticType::BOOL;
+                }
+
+                return numeric ? StaticType::BOOL : StaticType::DYNAMIC;
+            case token::TokenType::OPERATOR_LESS:
+            case token::TokenType::OPERATOR_LESS_EQ:
+            case token::TokenType::OPERATOR_GREATER:
+            case token::TokenType::OPERATOR_GREATER_EQ:
+                if (left == StaticType::STRING && right == StaticType::STRING) {
+                    return StaticType::BOOL;
+                }
+
+                return numeric ? StaticType::BOOL : StaticType::DYNAMIC;
+            case token::TokenType::OPERATOR_BOOL_AND:
+            case token::TokenType::OPERATOR_BOOL_OR:
+                return left == StaticType::BOOL && right == StaticType::BOOL ? StaticType::BOOL : StaticType::DYNAMIC;
+            default:
+                return StaticType::DYNAMIC;
+        }
+    }
+
+    /**
+     * Computes the type of an expression from the current variable types.
+     */
+    StaticType typeOf(ast::ASTNode& node, const TypeTable& types) {
+        if (!isPlainExpression(node)) {
+            return StaticType::DYNAMIC;
+        }
+
+        std::vector<std::shared_ptr<ast::ASTNode>>& children = node.children();
+
+        if (children.empty()) {
+            switch (node.token().type()) {
+                case token::TokenType::LITERAL_INT:
+                    // a literal too large for an int is a big int
+                    return std::holds_alternative<int>(types::parseInteger(node.token().value())) ? StaticType::INT : StaticType::DYNAMIC;
+                case token::TokenType::LITERAL_FLOAT:
+                    return StaticType::FLOAT;
+                case token::TokenType::LITERAL_BOOL:
+                    return StaticType::BOOL;
+                case token::TokenType::LITERAL_STRING:
+                    return StaticType::STRING;
+                case token::TokenType::IDENTIFIER: {
+                    // variables the program never assigns come from the host or are builtins
+                    auto it = types.find(node.token().value());
+                    return it != types.end() ? it->second : StaticType::DYNAMIC;
+                }
+                default:
+                    return StaticType::DYNAMIC;
+            }
+        }
+
+        if (children.size() == 1) {
+            StaticType operand = typeOf(*children[0], types);
+
+            if (operand == StaticType::UNKNOWN) {
+                return StaticType::UNKNOWN;
+            }
+
+            bool isNot = node.token().type() == token::TokenType::OPERATOR_UNARY_NOT;
+            return isNot && operand == StaticType::BOOL ? StaticType::BOOL : StaticType::DYNAMIC;
+        }
+
+        StaticType left = typeOf(*children[0], types);
+        StaticType right = typeOf(*children[1], types);
+
+        if (left == StaticType::DYNAMIC || right == StaticType::DYNAMIC) {
+            return StaticType::DYNAMIC;
+        }
+
+        if (left == StaticType::UNKNOWN || right == StaticType::UNKNOWN) {
+            return StaticType::UNKNOWN;
+        }
+
+        return binaryType(node.token().type(), left, right);
+    }
+
+    /**
+     * Everything in the program that can give a variable a value.
+     */
+    struct Program {
+        std::vector<std::pair<std::string, ast::ASTNode*>> declarations;
+        std::unordered_map<std::string, std::vector<const ast::FunctionDefNode*>> functions;
+        std::vector<ast::FunctionCallNode*> calls;
+        std::unordered_set<std::string> reads;  // names read as values, e.g. a function passed as an argument
+        std::unordered_set<std::string> opaque;  // names assigned in function bodies that have not been parsed
+    };
+
+    /**
+     * Collects what a function body that has not been parsed can do from its tokens alone. Names assigned in it, and the
+     * names and parameters of functions defined in it, can hold anything; every other name counts as read, so the
+     * functions it calls are not typed from the call sites that are visible.
+     */
+    void scan(const ast::FunctionBodyNode& body, Program& program) {
+        bool inHeader = false;  // between the keyword of a nested function and its body
+
+        for (auto it = body.tokensBegin(); it != body.tokensEnd(); ++it) {
+            if (it->type() == token::TokenType::FUNCTION_DEF) {
+                inHeader = true;
+            } else if (it->type() == token::TokenType::OPEN_BRACE) {
+                inHeader = false;
+            }
+
+            if (it->type() != token::TokenType::IDENTIFIER) {
+                continue;
+            }
+
+            auto next = it + 1;
+            token::TokenType nextType = next != body.tokensEnd() ? next->type() : token::TokenType::INVALID;
+
+            // assigned by =, a compound assignment, or as the counter of a for loop
+            bool assigned = inHeader || nextType == token::TokenType::OPERATOR_DEFINE || nextType == token::TokenType::IN
+                            || nextType == token::TokenType::OPERATOR_ADD_ASSIGN
+                            || nextType == token::TokenType::OPERATOR_SUB_ASSIGN
+                            || nextType == token::TokenType::OPERATOR_MUL_ASSIGN;
+
+            (assigned ? program.opaque : program.reads).insert(it->value());
+        }
+    }
+
+    void collect(ast::ASTNode& node, Program& program) {
+        if (auto* declaration = dynamic_cast<ast::DeclarationNode*>(&node)) {
+            // the first child is the assigned identifier, which is not a read
+            program.declarations.emplace_back(declaration->children()[0]->token().value(), declaration->children()[1].get());
+            collect(*declaration->children()[1], program);
+            return;
+        } else if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            program.functions[function->token().value()].push_back(function);
+
+            if (function->body()->parsed()) {
+                collect(function->body()->root(), program);
+            } else {
+                scan(*function->body(), program);
+            }
+        } else if (auto* call = dynamic_cast<ast::FunctionCallNode*>(&node)) {
+            program.calls.push_back(call);
+        } else if (isPlainExpression(node) && node.children().empty() && node.token().type() == token::TokenType::IDENTIFIER) {
+            program.reads.insert(node.token().value());
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            collect(*child, program);
+        }
+    }
+
+    /**
+     * Rewrites the expression in slot and everything below it. Returns true if slot now holds a TypedExpressionNode.
+     */
+    bool rewrite(std::shared_ptr<ast::ASTNode>& slot, const std::shared_ptr<const TypeTable>& types, inference::Report& report) {
+        ast::ASTNode& node = *slot;
+
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            const std::shared_ptr<ast::FunctionBodyNode>& body = function->body();
+
+            if (body->parsed()) {
+                for (std::shared_ptr<ast::ASTNode>& child : body->root().children()) {
+                    rewrite(child, types, report);
+                }
+            } else {
+                // the types hold for the body too, since its assignments were scanned
+                body->onParse([types](ast::RootNode& root) {
+                    inference::Report unreported;
+
+                    for (std::shared_ptr<ast::ASTNode>& child : root.children()) {
+                        rewrite(child, types, unreported);
+                    }
+                });
+            }
+
+            return false;
+        }
+
+        if (dynamic_cast<ast::DeclarationNode*>(&node) != nullptr) {
+            rewrite(node.children()[1], types, report);
+            return false;
+        }
+
+        bool childrenTyped = true;
+        for (std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            childrenTyped = rewrite(child, types, report) && childrenTyped;
+        }
+
+        if (!isPlainExpression(node)) {
+            return false;
+        }
+
+        bool isOperation = !node.children().empty();
+        if (isOperation) {
+            report.operations++;
+        }
+
+        if (typeid(node) == typeid(ast::TypedExpressionNode)) {
+            report.specialized += isOperation;
+            return true;
+        }
+
+        StaticType type = typeOf(node, *types);
+        if (!childrenTyped || !isUnboxed(type)) {
+            return false;
+        }
+
+        slot = std::make_shared<ast::TypedExpressionNode>(node.token(), node.children(), type);
+        report.specialized += isOperation;
+
+        return true;
+    }
+}
+
+
+double inference::Report::percentage() const {
+    if (operations == 0) {
+        return 0;
+    }
+
+    return 100.0 * static_cast<double>(specialized) / static_cast<double>(operations);
+}
+
+std::unordered_map<std::string, ast::StaticType> inference::inferVariables(ast::ASTNode& root) {
+    Program program;
+    collect(root, program);
+
+    TypeTable types;
+
+    for (const auto& [name, value] : program.declarations) {
+        types[name] = StaticType::UNKNOWN;
+    }
+
+    for (const std::string& name : program.opaque) {
+        types[name] = StaticType::DYNAMIC;
+    }
+
+    // parameters can be typed from the call sites only if every call to the function is visible
+    std::unordered_map<std::string, const ast::FunctionDefNode*> directFunctions;
+
+    for (const auto& [name, definitions] : program.functions) {
+        bool direct = definitions.size() == 1 && !types.count(name) && !program.reads.count(name);
+
+        for (const ast::FunctionDefNode* definition : definitions) {
+            for (const std::string& parameter : definition->parameters()) {
+                types[parameter] = direct ? join(types[parameter], StaticType::UNKNOWN) : StaticType::DYNAMIC;
+            }
+        }
+
+        if (direct) {
+            directFunctions.emplace(name, definitions[0]);
+        }
+    }
+
+    for (const auto& [name, definitions] : program.functions) {
+        types[name] = StaticType::DYNAMIC;
+    }
+
+    // the types only ever move up from UNKNOWN to a concrete type to DYNAMIC, so this terminates
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        auto assign = [&types, &changed](const std::string& name, StaticType type) {
+            StaticType joined = join(types[name], type);
+
+            if (joined != types[name]) {
+                types[name] = joined;
+                changed = true;
+            }
+        };
+
+        for (const auto& [name, value] : program.declarations) {
+            assign(name, typeOf(*value, types));
+        }
+
+        for (ast::FunctionCallNode* call : program.calls) {
+            auto it = directFunctions.find(call->token().value());
+            if (it == directFunctions.end()) {
+                continue;
+            }
+
+            const std::vector<std::string>& parameters = it->second->parameters();
+            std::vector<std::shared_ptr<ast::ASTNode>>& arguments = call->children();
+
+            for (size_t i = 0; i < parameters.size(); i++) {
+                // a call with the wrong number of arguments fails at runtime, but is still visible here
+                assign(parameters[i], i < arguments.size() ? typeOf(*arguments[i], types) : StaticType::DYNAMIC);
+            }
+        }
+    }
+
+    // variables that are only ever assigned from themselves (or from parameters of functions that are never called)
+    for (auto& [name, type] : types) {
+        if (type == StaticType::UNKNOWN) {
+            type = StaticType::DYNAMIC;
+        }
+    }
+
+    return types;
+}
+
+inference::Report inference::specialize(ast::ASTNode& root) {
+    auto types = std::make_shared<const TypeTable>(inferVariables(root));
+    Report report;
+
+    for (std::shared_ptr<ast::ASTNode>& child : root.children()) {
+        rewrite(child, types, report);
+    }
+
+    return report;
+}
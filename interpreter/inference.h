@@ -0,0 +1,48 @@
+#ifndef SPL_INFERENCE_H
+#define SPL_INFERENCE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <cstddef>
+
+#include "ast.h"
+
+/**
+ * Static type inference. Proves which variables only ever hold one of bool, int or float and rewrites the expressions
+ * built from them into TypedExpressionNodes, which evaluate without dispatching on VariantType.
+ *
+ * Variables are typed by name over the whole program rather than per scope, since functions can assign to variables
+ * of the scopes they are called from. A function's parameters are typed from the arguments at its call sites as long as
+ * the function is only ever called directly by name.
+ *
+ * Function bodies that have not been parsed yet (see ast::FunctionBodyNode) are only scanned for the names they assign
+ * and read, and are specialized when they are first parsed.
+ */
+namespace inference {
+    struct Report {
+        size_t operations = 0;  // operator nodes in the parsed code of the program
+        size_t specialized = 0;  // operator nodes rewritten into typed expressions
+
+        /**
+         * @return The percentage of operations that were specialized, or 0 if the program has no operations
+         */
+        [[nodiscard]] double percentage() const;
+    };
+
+    /**
+     * Infers the type of every variable assigned in the program.
+     * @param root The root of the program
+     * @return The type of each variable. Variables whose type could not be proven are DYNAMIC
+     */
+    std::unordered_map<std::string, ast::StaticType> inferVariables(ast::ASTNode& root);
+
+    /**
+     * Rewrites every expression whose type is proven into a TypedExpressionNode.
+     * @param root The root of the program. Modified in place
+     * @return How many operations were specialized
+     */
+    Report specialize(ast::ASTNode& root);
+}
+
+#endif  // SPL_INFERENCE_H
@@ -0,0 +1,316 @@
+#include "inlining.h"
+
+#include "builtins.h"
+#include "sandbox.h"
+
+#include <stdexcept>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+
+namespace {
+    using Bodies = std::unordered_map<std::string, std::shared_ptr<const inlining::Body>>;
+    using Renames = std::unordered_map<std::string, std::string>;
+
+    /**
+     * Removes the renamed variables of an inlined body from the environment once it has run, including when it throws.
+     */
+    class Bindings {
+    public:
+        Bindings(env::Environment& env, const std::vector<std::string>& names) : env(env), names(names) {}
+
+        ~Bindings() {
+            for (const std::string& name : names) {
+                env.remove(name);
+            }
+        }
+
+    private:
+        env::Environment& env;
+        const std::vector<std::string>& names;
+    };
+
+    /**
+     * Collects the function definitions outside of functions.
+     */
+    void collectFunctions(ast::ASTNode& node, std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>>& functions) {
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            functions[function->token().value()].push_back(function);
+            return;
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            collectFunctions(*child, functions);
+        }
+    }
+
+    std::string rename(const std::string& name, const Renames& renames) {
+        auto it = renames.find(name);
+        return it == renames.end() ? name : it->second;
+    }
+
+    /**
+     * Copies an expression of a body, renaming the parameters and locals.
+     * @param nodes Incremented for every node copied
+     * @param builtins Receives the builtins the expression calls
+     * @return The copy, or nullptr if the expression can't be inlined
+     */
+    std::shared_ptr<ast::ExpressionNode> copyExpression(ast::ASTNode& node, const std::string& function,
+                                                        const Renames& renames, size_t& nodes,
+                                                        std::vector<std::string>& builtins) {
+        const token::Token& token = node.token();
+        std::vector<std::shared_ptr<ast::ExpressionNode>> children;
+        nodes++;
+
+        // the name of the function can be rebound inside the body, so any mention of it counts as recursion
+        if (token.type() == token::TokenType::IDENTIFIER && token.value() == function) {
+            return nullptr;
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            std::shared_ptr<ast::ExpressionNode> copy = copyExpression(*child, function, renames, nodes, builtins);
+
+            if (copy == nullptr) {
+                return nullptr;
+            }
+
+            children.push_back(std::move(copy));
+        }
+
+        if (typeid(node) == typeid(ast::FunctionCallNode)) {
+            // an SPL function called from the body would see the renamed variables instead of the ones it can read and
+            // assign without inlining, so only builtins can be called (including no function passed as a parameter)
+            if (renames.count(token.value()) || builtins::lookup(token.value()) == nullptr) {
+                return nullptr;
+            }
+
+            builtins.push_back(token.value());
+            return std::make_shared<ast::FunctionCallNode>(
+                token::FunctionCallToken{token.value(), token.line(), token.column(), std::move(children)});
+        }
+
+        if (typeid(node) != typeid(ast::ExpressionNode)) {
+            return nullptr;
+        }
+
+        if (token.type() == token::TokenType::IDENTIFIER) {
+            token::Token renamed{token::TokenType::IDENTIFIER, rename(token.value(), renames), token.line(), token.column()};
+            return std::make_shared<ast::ExpressionNode>(renamed, std::vector<std::shared_ptr<ast::ASTNode>>{});
+        }
+
+        return std::make_shared<ast::ExpressionNode>(token, std::vector<std::shared_ptr<ast::ASTNode>>{children.begin(), children.end()});
+    }
+
+    /**
+     * Renames the body of a function for inlining.
+     * @return The renamed body, or nullptr if the function can't be inlined
+     */
+    std::shared_ptr<const inlining::Body> makeBody(const ast::FunctionDefNode& definition, const inlining::Heuristics& heuristics) {
+        const std::shared_ptr<ast::FunctionBodyNode>& functionBody = definition.body();
+
+        if (static_cast<size_t>(functionBody->tokensEnd() - functionBody->tokensBegin()) > heuristics.maxBodyTokens) {
+            return nullptr;
+        }
+
+        ast::RootNode* root;
+        try {
+            root = &functionBody->root();
+        } catch (const std::runtime_error&) {
+            // the syntax error is reported when the function is called, as without inlining
+            return nullptr;
+        }
+
+        std::vector<std::shared_ptr<ast::ASTNode>>& statements = root->children();
+        if (statements.empty() || typeid(*statements.back()) != typeid(ast::ControlFlowNode)
+            || statements.back()->token().type() != token::TokenType::RETURN) {
+            return nullptr;
+        }
+
+        const std::string& function = definition.token().value();
+        auto body = std::make_shared<inlining::Body>();
+        body->original = functionBody;
+        Renames renames;
+
+        // a name no script can use, since identifiers start with a letter
+        auto add = [&function, &renames, &body](const std::string& name) {
+            std::string renamed = "$" + function + "$" + name;
+            renames.emplace(name, renamed);
+            body->renamed.push_back(renamed);
+            return renamed;
+        };
+
+        for (const std::string& parameter : definition.parameters()) {
+            body->parameters.push_back(add(parameter));
+        }
+
+        for (size_t i = 0; i + 1 < statements.size(); i++) {
+            if (typeid(*statements[i]) == typeid(ast::DeclarationNode)) {
+                std::string name = statements[i]->children()[0]->token().value();
+
+                if (!renames.count(name)) {
+                    body->locals.push_back(name);
+                    add(name);
+                }
+            }
+        }
+
+        size_t nodes = 1;  // the return statement
+
+        for (size_t i = 0; i + 1 < statements.size(); i++) {
+            ast::ASTNode& statement = *statements[i];
+
+            if (typeid(statement) == typeid(ast::DeclarationNode)) {
+                const token::Token& target = statement.children()[0]->token();
+                std::shared_ptr<ast::ExpressionNode> value = copyExpression(*statement.children()[1], function, renames, nodes,
+                                                                            body->builtins);
+
+                if (value == nullptr) {
+                    return nullptr;
+                }
+
+                token::Token renamed{token::TokenType::IDENTIFIER, rename(target.value(), renames), target.line(), target.column()};
+                auto identifier = std::make_shared<ast::ExpressionNode>(renamed, std::vector<std::shared_ptr<ast::ASTNode>>{});
+                body->statements.push_back(std::make_shared<ast::DeclarationNode>(std::vector<std::shared_ptr<ast::ASTNode>>{identifier, value}));
+                nodes += 2;
+            } else {
+                std::shared_ptr<ast::ExpressionNode> expression = copyExpression(statement, function, renames, nodes, body->builtins);
+
+                if (expression == nullptr) {
+                    return nullptr;
+                }
+
+                body->statements.push_back(std::move(expression));
+            }
+        }
+
+        body->result = copyExpression(*statements.back()->children()[0], function, renames, nodes, body->builtins);
+
+        if (body->result == nullptr || nodes > heuristics.maxBodyNodes) {
+            return nullptr;
+        }
+
+        return body;
+    }
+
+    void rewrite(std::shared_ptr<ast::ASTNode>& slot, const std::shared_ptr<const Bodies>& bodies, inlining::Report& report) {
+        ast::ASTNode& node = *slot;
+
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            const std::shared_ptr<ast::FunctionBodyNode>& body = function->body();
+
+            if (body->parsed()) {
+                for (std::shared_ptr<ast::ASTNode>& child : body->root().children()) {
+                    rewrite(child, bodies, report);
+                }
+            } else {
+                body->onParse([bodies](ast::RootNode& root) {
+                    inlining::Report unreported;
+
+                    for (std::shared_ptr<ast::ASTNode>& child : root.children()) {
+                        rewrite(child, bodies, unreported);
+                    }
+                });
+            }
+
+            return;
+        }
+
+        for (std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            rewrite(child, bodies, report);
+        }
+
+        if (typeid(node) != typeid(ast::FunctionCallNode)) {
+            return;
+        }
+
+        auto inlined = bodies->find(node.token().value());
+
+        // a call with the wrong number of arguments is left to report the error
+        if (inlined == bodies->end() || inlined->second->parameters.size() != node.children().size()) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<ast::ExpressionNode>> arguments;
+        for (const std::shared_ptr<ast::ASTNode>& argument : node.children()) {
+            arguments.push_back(std::static_pointer_cast<ast::ExpressionNode>(argument));
+        }
+
+        token::FunctionCallToken token{node.token().value(), node.token().line(), node.token().column(), std::move(arguments)};
+        slot = std::make_shared<inlining::InlinedCallNode>(token, inlined->second);
+        report.calls++;
+    }
+}
+
+
+inlining::InlinedCallNode::InlinedCallNode(const token::FunctionCallToken& token, std::shared_ptr<const Body> body)
+    : FunctionCallNode(token), inlinedBody(std::move(body)) {}
+
+env::VariantType inlining::InlinedCallNode::eval(env::Environment& env) const {
+    const env::VariantType* callee = env.lookup(nodeToken.value());
+    const auto* function = callee != nullptr ? std::get_if<types::Function>(callee) : nullptr;
+    bool inlinable = function != nullptr && function->body() == inlinedBody->original;
+
+    for (size_t i = 0; inlinable && i < inlinedBody->locals.size(); i++) {
+        inlinable = !env.has(inlinedBody->locals[i]);
+    }
+
+    for (size_t i = 0; inlinable && i < inlinedBody->builtins.size(); i++) {
+        const env::VariantType* shadow = env.lookup(inlinedBody->builtins[i]);
+        inlinable = shadow == nullptr || !std::holds_alternative<types::Function>(*shadow);
+    }
+
+    if (!inlinable) {
+        return FunctionCallNode::eval(env);
+    }
+
+    // still counts as a call against the step budget
+    if (env.limits() != nullptr) {
+        env.limits()->step();
+    }
+
+    std::vector<env::VariantType> values;
+    values.reserve(nodeChildren.size());
+
+    for (const std::shared_ptr<ast::ASTNode>& argument : nodeChildren) {
+        values.push_back(argument->eval(env));
+    }
+
+    Bindings bindings{env, inlinedBody->renamed};
+
+    for (size_t i = 0; i < values.size(); i++) {
+        env.define(inlinedBody->parameters[i], std::move(values[i]));
+    }
+
+    for (const std::shared_ptr<ast::ASTNode>& statement : inlinedBody->statements) {
+        statement->eval(env);
+    }
+
+    return inlinedBody->result->eval(env);
+}
+
+inlining::Report inlining::inlineFunctions(ast::ASTNode& root, const Heuristics& heuristics) {
+    std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>> functions;
+    collectFunctions(root, functions);
+
+    auto bodies = std::make_shared<Bodies>();
+
+    for (const auto& [name, definitions] : functions) {
+        if (definitions.size() != 1) {
+            continue;
+        }
+
+        if (std::shared_ptr<const Body> body = makeBody(*definitions[0], heuristics)) {
+            bodies->emplace(name, std::move(body));
+        }
+    }
+
+    Report report;
+    report.functions = bodies->size();
+
+    for (std::shared_ptr<ast::ASTNode>& child : root.children()) {
+        rewrite(child, bodies, report);
+    }
+
+    return report;
+}
@@ -0,0 +1,72 @@
+#ifndef SPL_INLINING_H
+#define SPL_INLINING_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+
+/**
+ * Inlining of small functions. A call to a small function is replaced by the body of the function, with the parameters
+ * and locals renamed to names no script can use, so the body runs in the caller's environment without a new scope, an
+ * argument vector or a return exception.
+ *
+ * A function can be inlined if it is defined once, outside of other functions, does not refer to itself, and its body
+ * is a few assignments and expression statements followed by a return. Only plain expressions and calls to builtins
+ * can appear in the body: no control flow, collection literals or indexing. Scoping is dynamic, so a function called
+ * from the body could read or assign the variables of the function being inlined, which are renamed; builtins can't.
+ *
+ * Functions are variables, so a script can rebind the name of an inlined function. Every inlined call checks that the
+ * name is still bound to the inlined function, and that none of its locals already exists in the caller's environment
+ * (the function would assign to it instead of to a local, see env::Environment::set), and that no builtin the body
+ * calls is shadowed by an SPL function. If any check fails, the function is called normally.
+ */
+namespace inlining {
+    struct Heuristics {
+        size_t maxBodyTokens = 64;  // larger bodies are not parsed to be considered
+        size_t maxBodyNodes = 24;  // AST nodes in the body, return statement included
+    };
+
+    struct Report {
+        size_t functions = 0;  // functions that could be inlined
+        size_t calls = 0;  // call sites they were inlined into, in the parsed code of the program
+    };
+
+    /**
+     * The renamed body of an inlinable function.
+     */
+    struct Body {
+        std::shared_ptr<ast::FunctionBodyNode> original;  // the body the function's name must still be bound to
+        std::vector<std::string> parameters;  // renamed
+        std::vector<std::string> locals;  // the original names of the locals, which must not exist in the caller
+        std::vector<std::string> renamed;  // the renamed parameters and locals, removed once the body has run
+        std::vector<std::string> builtins;  // the builtins the body calls, which must not be shadowed by SPL functions
+        std::vector<std::shared_ptr<ast::ASTNode>> statements;  // everything before the return
+        std::shared_ptr<ast::ASTNode> result;  // the returned expression
+    };
+
+    /**
+     * A call whose callee was inlined. Falls back to a normal call if the function's name has been rebound.
+     */
+    class InlinedCallNode : public ast::FunctionCallNode {
+    public:
+        InlinedCallNode(const token::FunctionCallToken& token, std::shared_ptr<const Body> body);
+
+        env::VariantType eval(env::Environment& env) const override;
+
+    private:
+        std::shared_ptr<const Body> inlinedBody;
+    };
+
+    /**
+     * Inlines small functions into their call sites.
+     * @param root The root of the program. Modified in place
+     * @param heuristics Which functions are small enough
+     * @return How many functions and calls were inlined
+     */
+    Report inlineFunctions(ast::ASTNode& root, const Heuristics& heuristics = Heuristics{});
+}
+
+#endif  // SPL_INLINING_H
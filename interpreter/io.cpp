@@ -0,0 +1,329 @@
+#include "io.h"
+
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+    /**
+     * A read-only memory mapping of a whole file, unmapped when the last slice into it goes away.
+     */
+    class MappedBuffer : public types::StringBuffer {
+    public:
+        MappedBuffer(void* address, size_t size) : address(address), size(size) {}
+
+        ~MappedBuffer() override {
+            munmap(address, size);
+        }
+
+        [[nodiscard]] std::string_view view() const override {
+            return {static_cast<const char*>(address), size};
+        }
+
+    private:
+        void* address;
+        size_t size;
+    };
+
+    /**
+     * Closes a file descriptor when it goes out of scope.
+     */
+    class FileDescriptor {
+    public:
+        explicit FileDescriptor(int fd) : fd(fd) {}
+
+        ~FileDescriptor() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+        [[nodiscard]] int get() const {
+            return fd;
+        }
+
+    private:
+        int fd;
+    };
+
+    void writeFully(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::runtime_error(std::string("Could not write output: ") + std::strerror(errno));
+            }
+
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    /**
+     * Maps a whole file into memory as a string slice.
+     * @param flags Added to the flags of mmap, e.g., MAP_POPULATE to read the pages in right away
+     */
+    env::VariantType mapFile(const std::string& path, int flags) {
+        FileDescriptor file{open(path.c_str(), O_RDONLY)};
+
+        if (file.get() < 0) {
+            throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+        }
+
+        struct stat status{};
+        if (fstat(file.get(), &status) != 0) {
+            throw std::runtime_error("Could not read " + path + ": " + std::strerror(errno));
+        }
+
+        // mmap can't map zero bytes
+        if (status.st_size == 0) {
+            return std::string();
+        }
+
+        auto size = static_cast<size_t>(status.st_size);
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | flags, file.get(), 0);
+
+        if (address == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + path + ": " + std::strerror(errno));
+        }
+
+        return types::StringSlice{std::make_shared<MappedBuffer>(address, size)};
+    }
+
+    template <typename T>
+    void appendNumber(std::string& output, T value) {
+        char digits[32];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        output.append(digits, end);
+
+        // keep floats recognizable: print 3.0 rather than 3
+        if constexpr (std::is_floating_point_v<T>) {
+            if (std::string_view(digits, end - digits).find_first_of(".eEn") == std::string_view::npos) {
+                output += ".0";
+            }
+        }
+    }
+}
+
+
+io::OutputBuffer::OutputBuffer(int fd, size_t capacity) : fd(fd), buffer(capacity), used(0) {}
+
+io::OutputBuffer::~OutputBuffer() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+        // nowhere left to report the error
+    }
+}
+
+void io::OutputBuffer::write(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (used + text.size() > buffer.size()) {
+        flushLocked();
+
+        // too big to be worth buffering
+        if (text.size() >= buffer.size()) {
+            writeFully(fd, text.data(), text.size());
+            return;
+        }
+    }
+
+    std::memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+}
+
+void io::OutputBuffer::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushLocked();
+}
+
+void io::OutputBuffer::flushLocked() {
+    size_t size = used;
+    used = 0;
+
+    writeFully(fd, buffer.data(), size);
+}
+
+io::OutputBuffer& io::standardOutput() {
+    // function-local static: destroyed, and therefore flushed, at normal program exit
+    static OutputBuffer output{STDOUT_FILENO};
+    return output;
+}
+
+void io::format(std::string& output, const env::VariantType& value, bool quoteStrings) {
+    if (std::holds_alternative<bool>(value)) {
+        output += std::get<bool>(value) ? "true" : "false";
+    } else if (std::holds_alternative<int>(value)) {
+        appendNumber(output, std::get<int>(value));
+    } else if (const types::BigInt* integer = std::get_if<types::BigInt>(&value)) {
+        output += integer->toString();
+    } else if (std::holds_alternative<float>(value)) {
+        appendNumber(output, std::get<float>(value));
+    } else if (types::isString(value)) {
+        if (quoteStrings) {
+            output += '"';
+            output += types::stringView(value);
+            output += '"';
+        } else {
+            output += types::stringView(value);
+        }
+    } else if (std::holds_alternative<types::Array>(value)) {
+        const types::Array& array = std::get<types::Array>(value);
+
+        output += '[';
+        for (size_t i = 0; i < array.size(); i++) {
+            if (i > 0) {
+                output += ", ";
+            }
+
+            if (array.elementType() == types::ElementType::INT) {
+                appendNumber(output, array.ints()[i]);
+            } else {
+                appendNumber(output, array.floats()[i]);
+            }
+        }
+        output += ']';
+    } else if (std::holds_alternative<types::Dict>(value)) {
+        const types::Dict& dict = std::get<types::Dict>(value);
+
+        output += '{';
+        for (size_t i = 0; i < dict.size(); i++) {
+            if (i > 0) {
+                output += ", ";
+            }
+
+            format(output, dict.keyAt(i), true);
+            output += ": ";
+            format(output, dict.valueAt(i), true);
+        }
+        output += '}';
+    } else if (std::holds_alternative<types::NativeFunction>(value)) {
+        output += "<native function " + std::get<types::NativeFunction>(value).name() + ">";
+    } else {
+        output += "<function>";
+    }
+}
+
+env::VariantType io::readAll(const std::string& path) {
+    return mapFile(path, 0);
+}
+
+size_t io::writeAll(const std::string& path, std::string_view contents) {
+    // truncating the file in place would pull the pages out from under strings readAll mapped from it (reading them
+    // would raise SIGBUS), so the contents go into a new file that replaces the old one, which stays until unmapped
+    std::string temporary = path + ".XXXXXX";
+    FileDescriptor file{mkstemp(temporary.data())};
+
+    if (file.get() < 0) {
+        throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+    }
+
+    try {
+        struct stat status{};
+        mode_t mode = stat(path.c_str(), &status) == 0 ? status.st_mode & 07777 : 0644;
+
+        if (fchmod(file.get(), mode) != 0) {
+            throw std::runtime_error("Could not write " + path + ": " + std::strerror(errno));
+        }
+
+        writeFully(file.get(), contents.data(), contents.size());
+
+        if (rename(temporary.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not replace " + path + ": " + std::strerror(errno));
+        }
+    } catch (const std::runtime_error&) {
+        unlink(temporary.c_str());
+        throw;
+    }
+
+    return contents.size();
+}
+
+io::TaskPool::TaskPool(size_t threads) : stopping(false) {
+    if (threads == 0) {
+        throw std::runtime_error("A task pool needs at least one thread");
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        this->threads.emplace_back(&TaskPool::work, this);
+    }
+}
+
+io::TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    queued.notify_all();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::shared_future<env::VariantType> io::TaskPool::submit(std::function<env::VariantType()> task) {
+    std::packaged_task<env::VariantType()> packaged{std::move(task)};
+    std::shared_future<env::VariantType> result = packaged.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(packaged));
+    }
+
+    queued.notify_one();
+
+    return result;
+}
+
+void io::TaskPool::work() {
+    while (true) {
+        std::packaged_task<env::VariantType()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            if (tasks.empty()) {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        // the task stores its result or exception in its future
+        task();
+    }
+}
+
+io::TaskPool& io::backgroundPool() {
+    static TaskPool pool;
+    return pool;
+}
+
+std::shared_future<env::VariantType> io::readAllAsync(const std::string& path, TaskPool& pool) {
+    return pool.submit([path]() { return mapFile(path, MAP_POPULATE); });
+}
+
+std::shared_future<env::VariantType> io::writeAllAsync(const std::string& path, std::string contents, TaskPool& pool) {
+    return pool.submit([path, contents = std::move(contents)]() {
+        return env::VariantType(static_cast<int>(writeAll(path, contents)));
+    });
+}
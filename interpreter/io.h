@@ -0,0 +1,140 @@
+#ifndef SPL_IO_H
+#define SPL_IO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <thread>
+#include <cstddef>
+
+#include "environment.h"
+
+/**
+ * Output and file I/O used by the print, flush, readall, writeall, readasync and writeasync builtins.
+ */
+namespace io {
+    /**
+     * Collects output in a large user-space buffer and writes it to a file descriptor in big chunks. Output is written
+     * when the buffer fills up, when flush() is called, and when the buffer is destroyed. Thread-safe.
+     */
+    class OutputBuffer {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 256 * 1024;
+
+        explicit OutputBuffer(int fd, size_t capacity = DEFAULT_CAPACITY);
+        ~OutputBuffer();
+
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+        void write(std::string_view text);
+        void flush();
+
+    private:
+        /**
+         * Writes everything in the buffer to the file descriptor. Expects the mutex to be held.
+         */
+        void flushLocked();
+
+        int fd;
+        std::vector<char> buffer;
+        size_t used;
+        std::mutex mutex;
+    };
+
+    /**
+     * @return The buffer for standard output. It is flushed when the program exits normally
+     */
+    OutputBuffer& standardOutput();
+
+    /**
+     * Appends the printed form of a value to the output string. Numbers are formatted with std::to_chars.
+     * @param output The string to append to
+     * @param value The value to format
+     * @param quoteStrings Whether strings are quoted. Used for strings inside arrays and dictionaries
+     */
+    void format(std::string& output, const env::VariantType& value, bool quoteStrings = false);
+
+    /**
+     * Maps a file into memory and returns its contents as a read-only string slice, without copying them. writeAll
+     * replaces files rather than rewriting them, so the slice keeps the old contents, but the file must not be truncated
+     * in place by other programs while the slice is alive.
+     * @throws std::runtime_error if the file cannot be read
+     */
+    env::VariantType readAll(const std::string& path);
+
+    /**
+     * Replaces the contents of a file, using as few write calls as possible. The contents are written to a temporary
+     * file in the same directory, which is then renamed over the file, so a slice readAll returned still sees the old
+     * contents.
+     * @throws std::runtime_error if the file cannot be written
+     * @return The number of bytes written
+     */
+    size_t writeAll(const std::string& path, std::string_view contents);
+
+    /**
+     * Background threads that run file reads and writes, so a script can start several and wait for them later instead
+     * of stalling on each in turn. The threads make ordinary blocking system calls, so this works on any POSIX system
+     * without asynchronous I/O support from the kernel. Thread-safe.
+     */
+    class TaskPool {
+    public:
+        static constexpr size_t DEFAULT_THREADS = 8;
+
+        /**
+         * @throws std::runtime_error if threads is 0
+         */
+        explicit TaskPool(size_t threads = DEFAULT_THREADS);
+
+        /**
+         * Runs the tasks still queued, then stops the threads.
+         */
+        ~TaskPool();
+
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        /**
+         * Queues a task. Tasks start in the order they were submitted.
+         * @return The result of the task, or the exception it threw
+         */
+        std::shared_future<env::VariantType> submit(std::function<env::VariantType()> task);
+
+    private:
+        void work();
+
+        std::mutex mutex;
+        std::condition_variable queued;
+        std::deque<std::packaged_task<env::VariantType()>> tasks;
+        bool stopping;
+        std::vector<std::thread> threads;
+    };
+
+    /**
+     * @return The pool the readasync and writeasync builtins use. Started on first use, with
+     * TaskPool::DEFAULT_THREADS threads
+     */
+    TaskPool& backgroundPool();
+
+    /**
+     * Reads a file on a pool thread. Like readAll, the file is memory-mapped, but its pages are read in on the pool
+     * thread, so using the contents does not wait for the disk.
+     * @return The contents, as readAll returns them, or the std::runtime_error readAll throws
+     */
+    std::shared_future<env::VariantType> readAllAsync(const std::string& path, TaskPool& pool = backgroundPool());
+
+    /**
+     * Replaces the contents of a file on a pool thread. Reads and writes of the same file that are running at the same
+     * time are not ordered.
+     * @return The number of bytes written, as an int, or the std::runtime_error writeAll throws
+     */
+    std::shared_future<env::VariantType> writeAllAsync(const std::string& path, std::string contents,
+                                                       TaskPool& pool = backgroundPool());
+}
+
+#endif  // SPL_IO_H
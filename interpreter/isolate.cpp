@@ -0,0 +1,99 @@
+#include "isolate.h"
+
+#include "frontend.h"
+#include "inference.h"
+
+#include <stdexcept>
+#include <utility>
+
+
+isolate::Isolate::Isolate(const Pool& pool, env::Environment& prelude) : pool(pool), variables(prelude.fork()) {}
+
+env::Environment& isolate::Isolate::environment() {
+    return variables;
+}
+
+void isolate::Isolate::run(const std::string& program) {
+    const Pool::Program& prepared = pool.programs.at(program);
+
+    if (prepared.flattened != nullptr) {
+        prepared.flattened->run(variables);
+    } else {
+        prepared.tree->eval(variables);
+    }
+}
+
+
+isolate::Lease::Lease(Pool& pool, Isolate* isolate) : pool(&pool), isolate(isolate) {}
+
+isolate::Lease::Lease(Lease&& other) noexcept : pool(other.pool), isolate(other.isolate) {
+    other.pool = nullptr;
+}
+
+isolate::Lease::~Lease() {
+    if (pool != nullptr) {
+        pool->release(isolate);
+    }
+}
+
+isolate::Isolate& isolate::Lease::operator*() const {
+    return *isolate;
+}
+
+isolate::Isolate* isolate::Lease::operator->() const {
+    return isolate;
+}
+
+
+isolate::Pool::Pool(env::Environment& prelude, const std::unordered_map<std::string, std::string>& sources, const Options& options) {
+    if (options.isolates == 0) {
+        throw std::runtime_error("An isolate pool needs at least one isolate");
+    }
+
+    for (const auto& [name, source] : sources) {
+        Program program;
+        program.tree = std::make_shared<ast::RootNode>(frontend::parse(source));
+
+        if (options.inferTypes) {
+            inference::specialize(*program.tree);
+        }
+
+        if (options.flatten) {
+            program.flattened = std::make_unique<flat::Program>(*program.tree);
+        }
+
+        programs.emplace(name, std::move(program));
+    }
+
+    for (size_t i = 0; i < options.isolates; i++) {
+        isolates.push_back(std::unique_ptr<Isolate>(new Isolate(*this, prelude)));
+        free.push_back(isolates.back().get());
+    }
+}
+
+isolate::Lease isolate::Pool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    returned.wait(lock, [this]() { return !free.empty(); });
+
+    Isolate* isolate = free.back();
+    free.pop_back();
+
+    return Lease{*this, isolate};
+}
+
+size_t isolate::Pool::available() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return free.size();
+}
+
+void isolate::Pool::release(Isolate* isolate) {
+    // reset outside the lock, so other requests can acquire and release meanwhile
+    isolate->variables.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.push_back(isolate);
+    }
+
+    returned.notify_one();
+}
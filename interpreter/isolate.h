@@ -0,0 +1,131 @@
+#ifndef SPL_ISOLATE_H
+#define SPL_ISOLATE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.h"
+#include "flat.h"
+
+/**
+ * A pool of ready-to-run interpreter contexts for serving many short requests with low latency.
+ *
+ * The request scripts are tokenized, parsed and specialized once, when the pool is created, and every isolate runs the
+ * same parsed programs. Each isolate is a fork of a shared prelude environment (see env::Environment::fork), so a
+ * request sees the prelude's functions and constants but can't change them. When a request is done its isolate is reset
+ * by clearing the fork's variables, which keeps the fork's hash table allocated for the next request.
+ *
+ * Memoized functions share their caches between threads, which is not safe, so the programs are not memoized.
+ */
+namespace isolate {
+    class Pool;
+
+    struct Options {
+        size_t isolates = 4;  // contexts kept ready, which is how many requests can run at once
+        bool inferTypes = true;  // specialize the programs (see inference.h)
+        bool flatten = false;  // run flat copies of the programs (see flat.h)
+    };
+
+    /**
+     * An interpreter context handed out by a pool.
+     */
+    class Isolate {
+    public:
+        Isolate(const Isolate&) = delete;
+        Isolate& operator=(const Isolate&) = delete;
+
+        /**
+         * The variables of the current request. Set the request's inputs here before running, and read its results
+         * afterwards.
+         */
+        [[nodiscard]] env::Environment& environment();
+
+        /**
+         * Runs one of the pool's programs.
+         * @throws std::out_of_range if the pool has no program with this name
+         */
+        void run(const std::string& program);
+
+    private:
+        friend class Pool;
+
+        Isolate(const Pool& pool, env::Environment& prelude);
+
+        const Pool& pool;
+        env::Environment variables;
+    };
+
+    /**
+     * An isolate on loan from a pool. The isolate is reset and returned to the pool when the lease is destroyed.
+     */
+    class Lease {
+    public:
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease();
+
+        Isolate& operator*() const;
+        Isolate* operator->() const;
+
+    private:
+        friend class Pool;
+
+        Lease(Pool& pool, Isolate* isolate);
+
+        Pool* pool;  // nullptr once moved from
+        Isolate* isolate;
+    };
+
+    class Pool {
+    public:
+        /**
+         * @param prelude The environment every isolate starts from, e.g., with the prelude's functions and the native
+         * functions registered. Must outlive the pool and must not change while the pool exists
+         * @param programs The request scripts by name
+         * @param options How many isolates to keep and how to prepare the programs
+         * @throws std::runtime_error if a program cannot be parsed
+         */
+        Pool(env::Environment& prelude, const std::unordered_map<std::string, std::string>& programs, const Options& options = Options{});
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        /**
+         * Takes a free isolate, waiting for one to be returned if they are all in use. Thread-safe.
+         */
+        Lease acquire();
+
+        /**
+         * @return The number of isolates not in use
+         */
+        [[nodiscard]] size_t available() const;
+
+    private:
+        friend class Isolate;
+        friend class Lease;
+
+        struct Program {
+            std::shared_ptr<ast::RootNode> tree;
+            std::unique_ptr<flat::Program> flattened;  // nullptr if the pool does not flatten
+        };
+
+        /**
+         * Resets an isolate and puts it back in the free list.
+         */
+        void release(Isolate* isolate);
+
+        std::unordered_map<std::string, Program> programs;
+        std::vector<std::unique_ptr<Isolate>> isolates;
+
+        mutable std::mutex mutex;  // guards free
+        std::condition_variable returned;
+        std::vector<Isolate*> free;
+    };
+}
+
+#endif  // SPL_ISOLATE_H
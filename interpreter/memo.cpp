@@ -0,0 +1,231 @@
+#include "memo.h"
+
+#include "builtins.h"
+
+
+namespace {
+    /**
+     * What a function body does, as far as purity is concerned.
+     */
+    struct FunctionInfo {
+        const ast::FunctionDefNode* definition;
+        std::vector<std::string> callees;  // functions called by name
+        bool pure;
+    };
+
+    /**
+     * Checks the parts of a function body that make it impure on their own, and collects the functions it calls.
+     * @return False if the body is impure regardless of what it calls
+     */
+    bool checkBody(ast::ASTNode& node, const std::unordered_set<std::string>& parameters, FunctionInfo& info) {
+        if (dynamic_cast<ast::FunctionDefNode*>(&node) != nullptr || dynamic_cast<ast::IndexAssignmentNode*>(&node) != nullptr) {
+            return false;
+        }
+
+        if (auto* declaration = dynamic_cast<ast::DeclarationNode*>(&node)) {
+            // assigning to any other name could write to the caller's scope
+            if (!parameters.count(declaration->children()[0]->token().value())) {
+                return false;
+            }
+
+            return checkBody(*declaration->children()[1], parameters, info);
+        }
+
+        if (auto* call = dynamic_cast<ast::FunctionCallNode*>(&node)) {
+            const std::string& name = call->token().value();
+
+            if (parameters.count(name)) {
+                return false;
+            }
+
+            info.callees.push_back(name);
+        } else if (dynamic_cast<ast::IndexNode*>(&node) != nullptr) {
+            if (!parameters.count(node.token().value())) {
+                return false;
+            }
+        } else if (dynamic_cast<ast::ExpressionNode*>(&node) != nullptr && node.children().empty()
+                   && node.token().type() == token::TokenType::IDENTIFIER) {
+            if (!parameters.count(node.token().value())) {
+                return false;
+            }
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            if (!checkBody(*child, parameters, info)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Collects every function definition and every name assigned with a declaration
+     */
+    void collect(ast::ASTNode& node, std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>>& functions,
+                 std::unordered_set<std::string>& assigned) {
+        if (auto* function = dynamic_cast<ast::FunctionDefNode*>(&node)) {
+            functions[function->token().value()].push_back(function);
+
+            for (const std::string& parameter : function->parameters()) {
+                assigned.insert(parameter);
+            }
+
+            collect(function->body()->root(), functions, assigned);
+        } else if (dynamic_cast<ast::DeclarationNode*>(&node) != nullptr) {
+            assigned.insert(node.children()[0]->token().value());
+        }
+
+        for (const std::shared_ptr<ast::ASTNode>& child : node.children()) {
+            collect(*child, functions, assigned);
+        }
+    }
+
+    template <typename T>
+    void appendBytes(std::string& key, char tag, const T& value) {
+        key += tag;
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+
+memo::Cache::Cache(size_t capacity) : maxEntries(capacity), hits(0), misses(0) {}
+
+bool memo::Cache::makeKey(const std::vector<env::VariantType>& arguments, std::string& key) {
+    key.clear();
+
+    for (const env::VariantType& argument : arguments) {
+        if (const int* integer = std::get_if<int>(&argument)) {
+            appendBytes(key, 'i', *integer);
+        } else if (const types::BigInt* big = std::get_if<types::BigInt>(&argument)) {
+            appendBytes(key, 'n', big->isNegative());
+            appendBytes(key, 'n', big->digits().size());
+            key.append(reinterpret_cast<const char*>(big->digits().data()), big->digits().size() * sizeof(uint32_t));
+        } else if (const float* real = std::get_if<float>(&argument)) {
+            appendBytes(key, 'f', *real);
+        } else if (const bool* boolean = std::get_if<bool>(&argument)) {
+            appendBytes(key, 'b', *boolean);
+        } else if (types::isString(argument)) {
+            std::string_view text = types::stringView(argument);
+            appendBytes(key, 's', text.size());
+            key.append(text);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const env::VariantType* memo::Cache::find(const std::string& key) {
+    auto it = index.find(key);
+
+    if (it == index.end()) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    recency.splice(recency.begin(), recency, it->second);
+
+    return &it->second->second;
+}
+
+void memo::Cache::insert(std::string key, const env::VariantType& result) {
+    bool scalar = types::isInteger(result) || std::holds_alternative<float>(result)
+                  || std::holds_alternative<bool>(result) || types::isString(result);
+
+    if (!scalar || maxEntries == 0 || index.count(key)) {
+        return;
+    }
+
+    if (index.size() >= maxEntries) {
+        index.erase(recency.back().first);
+        recency.pop_back();
+    }
+
+    // slices are copied out so cached results don't keep whole files alive
+    env::VariantType stored = types::isString(result) ? env::VariantType(std::string(types::stringView(result))) : result;
+
+    recency.emplace_front(std::move(key), std::move(stored));
+    index.emplace(recency.front().first, recency.begin());
+}
+
+memo::Statistics memo::Cache::statistics() const {
+    return Statistics{hits, misses, index.size()};
+}
+
+std::unordered_set<std::string> memo::findPureFunctions(ast::ASTNode& root, const env::Environment& env) {
+    std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>> functions;
+    std::unordered_set<std::string> assigned;
+    collect(root, functions, assigned);
+
+    std::unordered_map<std::string, FunctionInfo> candidates;
+
+    for (const auto& [name, definitions] : functions) {
+        // calls by this name must always reach this definition
+        if (definitions.size() != 1 || assigned.count(name)) {
+            continue;
+        }
+
+        const ast::FunctionDefNode* definition = definitions[0];
+        std::unordered_set<std::string> parameters(definition->parameters().begin(), definition->parameters().end());
+
+        FunctionInfo info{definition, {}, true};
+        info.pure = checkBody(definition->body()->root(), parameters, info);
+
+        candidates.emplace(name, std::move(info));
+    }
+
+    // a function calling an impure or unknown function is impure; repeat until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (auto& [name, info] : candidates) {
+            if (!info.pure) {
+                continue;
+            }
+
+            for (const std::string& callee : info.callees) {
+                auto it = candidates.find(callee);
+                // builtins are only called when no function or variable of the same name shadows them
+                bool pureBuiltin = !functions.count(callee) && !env.has(callee) && builtins::lookup(callee) != nullptr
+                                   && builtins::isPure(callee);
+
+                if (!pureBuiltin && (it == candidates.end() || !it->second.pure)) {
+                    info.pure = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::unordered_set<std::string> pure;
+    for (const auto& [name, info] : candidates) {
+        if (info.pure) {
+            pure.insert(name);
+        }
+    }
+
+    return pure;
+}
+
+std::unordered_map<std::string, std::shared_ptr<memo::Cache>> memo::memoize(ast::ASTNode& root, const env::Environment& env,
+                                                                            size_t capacity) {
+    std::unordered_set<std::string> pure = findPureFunctions(root, env);
+    std::unordered_map<std::string, std::vector<ast::FunctionDefNode*>> functions;
+    std::unordered_set<std::string> assigned;
+    collect(root, functions, assigned);
+
+    std::unordered_map<std::string, std::shared_ptr<Cache>> caches;
+
+    for (const std::string& name : pure) {
+        auto cache = std::make_shared<Cache>(capacity);
+        functions[name][0]->memoize(cache);
+        caches.emplace(name, std::move(cache));
+    }
+
+    return caches;
+}
@@ -0,0 +1,88 @@
+#ifndef SPL_MEMO_H
+#define SPL_MEMO_H
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+#include "ast.h"
+
+/**
+ * Memoization of pure SPL functions. A function is pure if it only reads its own parameters, only assigns to its own
+ * parameters and only calls pure functions (itself included) and builtins without side effects. Calls to a pure
+ * function with the same argument values always return the same result, so the result can be cached.
+ */
+namespace memo {
+    struct Statistics {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t entries = 0;
+    };
+
+    /**
+     * A bounded result cache for one function. When full, the least recently used result is evicted.
+     *
+     * Only calls whose arguments and result are all bools, ints, floats or strings are cached: arrays and
+     * dictionaries have reference semantics, so they can change between calls and must not be shared between callers.
+     */
+    class Cache {
+    public:
+        explicit Cache(size_t capacity);
+
+        /**
+         * Encodes the arguments of a call as a cache key.
+         * @param arguments The evaluated arguments
+         * @param key Receives the key
+         * @return False if the arguments cannot be cached
+         */
+        static bool makeKey(const std::vector<env::VariantType>& arguments, std::string& key);
+
+        /**
+         * Looks up the result for a key and counts a hit or a miss.
+         * @return The cached result, or nullptr on a miss. Valid until the next call to insert
+         */
+        const env::VariantType* find(const std::string& key);
+
+        /**
+         * Caches a result. Results that cannot be cached are ignored.
+         */
+        void insert(std::string key, const env::VariantType& result);
+
+        [[nodiscard]] Statistics statistics() const;
+
+    private:
+        using Entry = std::pair<std::string, env::VariantType>;
+
+        size_t maxEntries;
+        std::list<Entry> recency;  // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t hits;
+        size_t misses;
+    };
+
+    /**
+     * Finds the functions of a program that are pure.
+     * @param root The root of the program
+     * @param env The environment the program runs in. A variable in it shadows a builtin of the same name, so calling
+     * such a name (e.g. a native function the host registered as "len") is not a call to a pure builtin
+     * @return The names of the pure functions
+     */
+    std::unordered_set<std::string> findPureFunctions(ast::ASTNode& root, const env::Environment& env);
+
+    /**
+     * Gives every pure function in the program a result cache.
+     * @param root The root of the program
+     * @param env The environment the program runs in (see findPureFunctions)
+     * @param capacity The maximum number of results cached per function
+     * @return The cache of each memoized function, by function name
+     */
+    std::unordered_map<std::string, std::shared_ptr<Cache>> memoize(ast::ASTNode& root, const env::Environment& env,
+                                                                    size_t capacity);
+}
+
+#endif  // SPL_MEMO_H
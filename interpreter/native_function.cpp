@@ -0,0 +1,27 @@
+#include "environment.h"
+
+#include <stdexcept>
+#include <utility>
+
+types::NativeFunction::NativeFunction(std::string name, int arity, Implementation implementation)
+    : data(std::make_shared<const Data>(Data{std::move(name), arity, std::move(implementation)})) {}
+
+const std::string& types::NativeFunction::name() const {
+    return data->name;
+}
+
+int types::NativeFunction::arity() const {
+    return data->arity;
+}
+
+env::VariantType types::NativeFunction::call(const std::vector<env::VariantType>& arguments) const {
+    if (data->arity != VARIADIC && static_cast<size_t>(data->arity) != arguments.size()) {
+        throw std::runtime_error("Function " + data->name + " expects " + std::to_string(data->arity) + " arguments, but got " + std::to_string(arguments.size()));
+    }
+
+    return data->implementation(arguments);
+}
+
+bool types::NativeFunction::operator==(const NativeFunction& other) const {
+    return data == other.data;
+}
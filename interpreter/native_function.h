@@ -0,0 +1,53 @@
+#ifndef SPL_NATIVE_FUNCTION_H
+#define SPL_NATIVE_FUNCTION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+// This header is included by environment.h after env::VariantType is declared
+
+namespace types {
+    /**
+     * A function implemented in C++. Unlike types::Function, calling a native function does not create a new
+     * environment: the arguments are evaluated by the caller and handed to the implementation directly.
+     */
+    class NativeFunction {
+    public:
+        using Implementation = std::function<env::VariantType(const std::vector<env::VariantType>& arguments)>;
+
+        /**
+         * Pass this as the arity of functions that take a variable number of arguments. Those functions have to check
+         * the argument count themselves.
+         */
+        static constexpr int VARIADIC = -1;
+
+        NativeFunction(std::string name, int arity, Implementation implementation);
+
+        [[nodiscard]] const std::string& name() const;
+        [[nodiscard]] int arity() const;
+
+        /**
+         * Calls the function.
+         * @throws std::runtime_error if the number of arguments does not match the arity
+         */
+        env::VariantType call(const std::vector<env::VariantType>& arguments) const;
+
+        /**
+         * Two native functions are equal if they are copies of the same registered function.
+         */
+        bool operator==(const NativeFunction& other) const;
+
+    private:
+        struct Data {
+            std::string name;
+            int arity;
+            Implementation implementation;
+        };
+
+        std::shared_ptr<const Data> data;
+    };
+}
+
+#endif  // SPL_NATIVE_FUNCTION_H
@@ -1,14 +1,19 @@
 #include "parser.h"
 
-#include "rpn.h"
-
 #include <stdexcept>
 #include <iostream>
 
 
-Parser::Parser(std::vector<token::Token> input) {
-    tokens = std::move(input);
-    pos = 0;
+Parser::Parser(std::vector<token::Token> input)
+    : Parser(std::make_shared<const std::vector<token::Token>>(std::move(input))) {}
+
+
+Parser::Parser(std::shared_ptr<const std::vector<token::Token>> source)
+    : Parser(source, 0, source->size()) {}
+
+
+Parser::Parser(std::shared_ptr<const std::vector<token::Token>> source, size_t begin, size_t end)
+    : tokens(std::move(source)), pos(begin), endPos(end) {
 
     astRoot = parse();
 }
@@ -35,26 +40,33 @@ ast::RootNode Parser::root() const {
 
 
 bool Parser::atEnd() const {
-    return pos >= tokens.size();
+    return pos >= endPos;
 }
 
 
-token::Token Parser::currentToken() const {
-    return tokens[pos];
+const token::Token& Parser::currentToken() const {
+    if (atEnd()) {
+        throw std::runtime_error("Unexpected end of input");
+    }
+
+    return (*tokens)[pos];
 }
 
 
 token::Token Parser::advance() {
-    return tokens[pos++];
+    const token::Token& token = currentToken();
+    pos++;
+
+    return token;
 }
 
 
-token::Token Parser::peek() const {
-    if (pos + 1 >= tokens.size()) {
+const token::Token& Parser::peek() const {
+    if (pos + 1 >= endPos) {
         throw std::runtime_error("Could not peek: end of input");
     }
 
-    return tokens[pos + 1];
+    return (*tokens)[pos + 1];
 }
 
 
@@ -66,6 +78,16 @@ std::shared_ptr<ast::ASTNode> Parser::parseStatement() {
         std::shared_ptr<ast::ASTNode> declarationNode = std::static_pointer_cast<ast::ASTNode>(declaration);
 
         return declarationNode;
+    } else if (currentToken().type() == token::TokenType::IDENTIFIER && isCompoundAssignment(peek().type())) {
+        std::shared_ptr<ast::CompoundAssignmentNode> assignment = parseCompoundAssignment();
+        std::shared_ptr<ast::ASTNode> assignmentNode = std::static_pointer_cast<ast::ASTNode>(assignment);
+
+        return assignmentNode;
+    } else if (atIndexAssignment()) {
+        std::shared_ptr<ast::IndexAssignmentNode> assignment = parseIndexAssignment();
+        std::shared_ptr<ast::ASTNode> assignmentNode = std::static_pointer_cast<ast::ASTNode>(assignment);
+
+        return assignmentNode;
     } else if (currentToken().type() == token::TokenType::IDENTIFIER || currentToken().type() == token::TokenType::LITERAL_INT) {
         std::shared_ptr<ast::ExpressionNode> expression = parseExpression();
         std::shared_ptr<ast::ASTNode> expressionNode = std::static_pointer_cast<ast::ASTNode>(expression);
@@ -91,6 +113,11 @@ std::shared_ptr<ast::ASTNode> Parser::parseStatement() {
         std::shared_ptr<ast::ASTNode> whileStatementNode = std::static_pointer_cast<ast::ASTNode>(whileStatement);
 
         return whileStatementNode;
+    } else if (currentToken().type() == token::TokenType::FOR) {
+        std::shared_ptr<ast::ForNode> forStatement = parseFor();
+        std::shared_ptr<ast::ASTNode> forStatementNode = std::static_pointer_cast<ast::ASTNode>(forStatement);
+
+        return forStatementNode;
     } else {
         throw std::runtime_error("Could not determine how to parse a statement from the current token");
     }
@@ -144,32 +171,210 @@ token::FunctionCallToken Parser::parseFunctionCall() {
 }
 
 
-std::shared_ptr<ast::ExpressionNode> Parser::parseExpression() {
-    std::vector<std::shared_ptr<token::Token>> expressionTokens;
+token::ArrayLiteralToken Parser::parseArrayLiteral() {
+    token::Token openBracket = advance();
+
+    std::vector<std::shared_ptr<ast::ExpressionNode>> elements;
+
+    while (currentToken().type() != token::TokenType::CLOSE_BRACKET) {
+        elements.push_back(parseExpression());
 
-    int parenCount = 0;
-    while (currentToken().type() != token::TokenType::SEMICOLON && currentToken().type() != token::TokenType::SEPARATOR) {
-        if (currentToken().type() == token::TokenType::OPEN_PAREN) {
-            parenCount++;
-        } else if (currentToken().type() == token::TokenType::CLOSE_PAREN) {
-            parenCount--;
+        // supports syntax like [a, b] instead of [a, b,]
+        if (currentToken().type() == token::TokenType::CLOSE_BRACKET) {
+            break;
         }
 
-        if (parenCount < 0) {
+        advance();  // skip the comma
+    }
+
+    expect(token::TokenType::CLOSE_BRACKET);
+
+    return token::ArrayLiteralToken{openBracket.line(), openBracket.column(), elements};
+}
+
+
+token::DictLiteralToken Parser::parseDictLiteral() {
+    token::Token openBrace = advance();
+
+    std::vector<token::DictLiteralToken::Entry> entries;
+
+    while (currentToken().type() != token::TokenType::CLOSE_BRACE) {
+        std::shared_ptr<ast::ExpressionNode> key = parseExpression();
+        expect(token::TokenType::COLON);
+        std::shared_ptr<ast::ExpressionNode> value = parseExpression();
+
+        entries.emplace_back(key, value);
+
+        // supports syntax like {a: 1} instead of {a: 1,}
+        if (currentToken().type() == token::TokenType::CLOSE_BRACE) {
             break;
         }
 
-        if (!atEnd() && currentToken().type() == token::TokenType::IDENTIFIER && peek().type() == token::TokenType::OPEN_PAREN) {
-            token::FunctionCallToken functionCall = parseFunctionCall();
-            expressionTokens.push_back(std::make_shared<token::FunctionCallToken>(functionCall));
-        } else {
-            expressionTokens.push_back(std::make_shared<token::Token>(advance()));
+        advance();  // skip the comma
+    }
+
+    expect(token::TokenType::CLOSE_BRACE);
+
+    return token::DictLiteralToken{openBrace.line(), openBrace.column(), entries};
+}
+
+
+token::IndexToken Parser::parseIndex() {
+    token::Token identifier = advance();
+    expect(token::TokenType::OPEN_BRACKET);
+
+    std::shared_ptr<ast::ExpressionNode> index = parseExpression();
+
+    expect(token::TokenType::CLOSE_BRACKET);
+
+    return token::IndexToken{identifier.value(), identifier.line(), identifier.column(), index};
+}
+
+
+bool Parser::atIndexAssignment() const {
+    if (currentToken().type() != token::TokenType::IDENTIFIER || pos + 1 >= endPos || peek().type() != token::TokenType::OPEN_BRACKET) {
+        return false;
+    }
+
+    // find the matching close bracket and check that an assignment follows it
+    int bracketCount = 0;
+    for (size_t i = pos + 1; i < endPos; i++) {
+        if ((*tokens)[i].type() == token::TokenType::OPEN_BRACKET) {
+            bracketCount++;
+        } else if ((*tokens)[i].type() == token::TokenType::CLOSE_BRACKET) {
+            bracketCount--;
+        }
+
+        if (bracketCount == 0) {
+            return i + 1 < endPos && (*tokens)[i + 1].type() == token::TokenType::OPERATOR_DEFINE;
         }
     }
 
-    ShuntingYardParser shuntingYardParser{expressionTokens};
+    return false;
+}
+
+
+bool Parser::isCompoundAssignment(token::TokenType type) {
+    return type == token::TokenType::OPERATOR_ADD_ASSIGN || type == token::TokenType::OPERATOR_SUB_ASSIGN
+           || type == token::TokenType::OPERATOR_MUL_ASSIGN;
+}
+
+std::shared_ptr<ast::CompoundAssignmentNode> Parser::parseCompoundAssignment() {
+    token::Token identifier = advance();
+    token::Token assignment = advance();
+
+    std::string symbol = assignment.value().substr(0, 1);  // "+=" applies "+"
+    token::TokenType operation = assignment.type() == token::TokenType::OPERATOR_ADD_ASSIGN ? token::TokenType::OPERATOR_ADD
+                                 : assignment.type() == token::TokenType::OPERATOR_SUB_ASSIGN ? token::TokenType::OPERATOR_SUB
+                                 : token::TokenType::OPERATOR_MUL;
+
+    std::shared_ptr<ast::ExpressionNode> operand = parseExpression();
+    expect(token::TokenType::SEMICOLON);
+
+    auto target = std::make_shared<ast::ExpressionNode>(identifier, std::vector<std::shared_ptr<ast::ASTNode>>{});
+    auto current = std::make_shared<ast::ExpressionNode>(identifier, std::vector<std::shared_ptr<ast::ASTNode>>{});
+    auto value = std::make_shared<ast::ExpressionNode>(
+        token::Token{operation, symbol, assignment.line(), assignment.column()},
+        std::vector<std::shared_ptr<ast::ASTNode>>{current, operand});
+
+    return std::make_shared<ast::CompoundAssignmentNode>(std::vector<std::shared_ptr<ast::ASTNode>>{target, value});
+}
+
+std::shared_ptr<ast::IndexAssignmentNode> Parser::parseIndexAssignment() {
+    token::IndexToken target = parseIndex();
+    expect(token::TokenType::OPERATOR_DEFINE);
+
+    std::shared_ptr<ast::ExpressionNode> value = parseExpression();
+    expect(token::TokenType::SEMICOLON);
 
-    return shuntingYardParser.root();
+    return std::make_shared<ast::IndexAssignmentNode>(ast::IndexAssignmentNode{
+        target,
+        std::static_pointer_cast<ast::ASTNode>(target.index()),
+        std::static_pointer_cast<ast::ASTNode>(value)
+    });
+}
+
+
+std::shared_ptr<ast::ExpressionNode> Parser::parseExpression(int minPrecedence) {
+    std::shared_ptr<ast::ExpressionNode> left = parseOperand();
+
+    // precedence climbing: fold in binary operators that bind at least as tightly as minPrecedence. Anything else
+    // (;, ',', a closing paren/bracket/brace, a colon) ends the expression and is left for the caller
+    while (!atEnd()) {
+        token::TokenType type = currentToken().type();
+        token::OperatorInfo info = token::operatorInfo(type);
+
+        if (info.precedence < 0 || info.precedence < minPrecedence || type == token::TokenType::OPERATOR_UNARY_NOT) {
+            break;
+        }
+
+        token::Token operatorToken = advance();
+
+        // a left associative operator only takes operators that bind tighter on its right, so a - b - c is (a - b) - c
+        int rightPrecedence = info.associativity == token::Associativity::LEFT ? info.precedence + 1 : info.precedence;
+        std::shared_ptr<ast::ExpressionNode> right = parseExpression(rightPrecedence);
+
+        left = std::make_shared<ast::ExpressionNode>(operatorToken, std::vector<std::shared_ptr<ast::ASTNode>>{left, right});
+    }
+
+    return left;
+}
+
+
+std::shared_ptr<ast::ExpressionNode> Parser::parseOperand() {
+    if (atEnd()) {
+        throw std::runtime_error("Unexpected end of input in expression");
+    }
+
+    switch (currentToken().type()) {
+        case token::TokenType::OPEN_PAREN: {
+            advance();
+            std::shared_ptr<ast::ExpressionNode> inner = parseExpression();
+
+            if (atEnd() || currentToken().type() != token::TokenType::CLOSE_PAREN) {
+                throw std::runtime_error("Error: mismatched parentheses");
+            }
+
+            advance();
+            return inner;
+        }
+
+        case token::TokenType::OPERATOR_UNARY_NOT: {
+            token::Token notToken = advance();
+            std::shared_ptr<ast::ExpressionNode> operand = parseExpression(token::operatorInfo(notToken.type()).precedence);
+
+            return std::make_shared<ast::ExpressionNode>(notToken, std::vector<std::shared_ptr<ast::ASTNode>>{operand});
+        }
+
+        case token::TokenType::OPEN_BRACKET:
+            return std::make_shared<ast::ArrayLiteralNode>(parseArrayLiteral());
+
+        case token::TokenType::OPEN_BRACE:
+            return std::make_shared<ast::DictLiteralNode>(parseDictLiteral());
+
+        case token::TokenType::IDENTIFIER: {
+            token::TokenType next = pos + 1 < endPos ? (*tokens)[pos + 1].type() : token::TokenType::INVALID;
+
+            if (next == token::TokenType::OPEN_PAREN) {
+                return std::make_shared<ast::FunctionCallNode>(parseFunctionCall());
+            }
+
+            if (next == token::TokenType::OPEN_BRACKET) {
+                return std::make_shared<ast::IndexNode>(parseIndex());
+            }
+
+            return std::make_shared<ast::ExpressionNode>(advance(), std::vector<std::shared_ptr<ast::ASTNode>>{});
+        }
+
+        case token::TokenType::LITERAL_INT:
+        case token::TokenType::LITERAL_FLOAT:
+        case token::TokenType::LITERAL_BOOL:
+        case token::TokenType::LITERAL_STRING:
+            return std::make_shared<ast::ExpressionNode>(advance(), std::vector<std::shared_ptr<ast::ASTNode>>{});
+
+        default:
+            throw std::runtime_error("Unexpected token in expression");
+    }
 }
 
 
@@ -202,16 +407,14 @@ std::shared_ptr<ast::FunctionDefNode> Parser::parseFuncDeclaration() {
 
     expect(token::TokenType::CLOSE_PAREN);  // should be true because of the while loop
 
-    // get all tokens within the curly braces and create a parser for them
-    std::vector<token::Token> functionTokens = extractEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
-
-    Parser functionParser{functionTokens};
+    // only match the braces: the body is parsed the first time the function is called
+    auto [bodyBegin, bodyEnd] = skipEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
 
-    return std::make_shared<ast::FunctionDefNode>(ast::FunctionDefNode{
+    return std::make_shared<ast::FunctionDefNode>(
         identifier,
         arguments,
-        std::static_pointer_cast<ast::ASTNode>(std::make_shared<ast::RootNode>(functionParser.root()))
-    });
+        std::make_shared<ast::FunctionBodyNode>(tokens, bodyBegin, bodyEnd)
+    );
 }
 
 std::shared_ptr<ast::ControlFlowNode> Parser::parseControlFlow() {
@@ -233,94 +436,128 @@ std::shared_ptr<ast::ControlFlowNode> Parser::parseControlFlow() {
     }
 }
 
+std::shared_ptr<ast::ExpressionNode> Parser::parseCondition() {
+    expect(token::TokenType::OPEN_PAREN);
+
+    std::shared_ptr<ast::ExpressionNode> condition = parseExpression();
+
+    expect(token::TokenType::CLOSE_PAREN);
+
+    return condition;
+}
+
 std::shared_ptr<ast::IfNode> Parser::parseIf() {
     token::Token ifToken = advance();  // skip the "if" keyword
 
     std::vector<std::shared_ptr<ast::ASTNode>> children;
 
     // parse the 'if' condition and body
-    std::vector<std::shared_ptr<token::Token>> ifConditionTokens = extractEnclosedTokensPtr(token::TokenType::OPEN_PAREN, token::TokenType::CLOSE_PAREN);
-    std::vector<token::Token> ifBodyTokens = extractEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
+    std::shared_ptr<ast::ExpressionNode> ifCondition = parseCondition();
 
-    ShuntingYardParser ifConditionParser{ifConditionTokens};
-    Parser ifBodyParser{ifBodyTokens};
-
-    children.push_back(ifConditionParser.root());
-    children.push_back(std::make_shared<ast::RootNode>(ifBodyParser.root()));
+    children.push_back(ifCondition);
+    children.push_back(parseBlock());
 
     // parse elif statements
     while (!atEnd() && currentToken().type() == token::TokenType::ELIF_STATEMENT) {
         advance();  // skip the "elif" keyword
 
-        std::vector<std::shared_ptr<token::Token>> elifConditionTokens = extractEnclosedTokensPtr(token::TokenType::OPEN_PAREN, token::TokenType::CLOSE_PAREN);
-        std::vector<token::Token> elifBodyTokens = extractEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
-
-        ShuntingYardParser elifConditionParser{elifConditionTokens};
-        Parser elifBodyParser{elifBodyTokens};
+        std::shared_ptr<ast::ExpressionNode> elifCondition = parseCondition();
 
-        children.push_back(elifConditionParser.root());
-        children.push_back(std::make_shared<ast::RootNode>(elifBodyParser.root()));
+        children.push_back(elifCondition);
+        children.push_back(parseBlock());
     }
 
     // parse else statement
     if (!atEnd() && currentToken().type() == token::TokenType::ELSE_STATEMENT) {
         advance();  // skip the "else" keyword
 
-        std::vector<token::Token> elseBodyTokens = extractEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
-        Parser elseBodyParser{elseBodyTokens};
-
-        children.push_back(std::make_shared<ast::RootNode>(elseBodyParser.root()));
+        children.push_back(parseBlock());
     }
 
     return std::make_shared<ast::IfNode>(ast::IfNode{ifToken, children});
 }
 
-std::vector<std::shared_ptr<token::Token>> Parser::extractEnclosedTokensPtr(token::TokenType start, token::TokenType end) {
+std::pair<size_t, size_t> Parser::skipEnclosedTokens(token::TokenType start, token::TokenType end) {
     expect(start);
 
-    std::vector<std::shared_ptr<token::Token>> enclosedTokens;
+    size_t begin = pos;
     int count = 1;
 
-    while (count > 0) {
-        token::Token token = advance();
+    while (true) {
+        if (atEnd()) {
+            throw std::runtime_error("Unexpected end of input: unmatched brace or parenthesis");
+        }
+
+        token::TokenType type = (*tokens)[pos].type();
 
-        if (token.type() == start) {
+        if (type == start) {
             count++;
-        } else if (token.type() == end) {
+        } else if (type == end) {
             count--;
         }
 
-        if (count > 0) {
-            enclosedTokens.push_back(std::make_shared<token::Token>(token));
+        if (count == 0) {
+            break;
         }
+
+        pos++;
     }
 
-    return enclosedTokens;
-}
+    size_t enclosedEnd = pos;
+    pos++;  // skip the end token
 
-std::vector<token::Token> Parser::extractEnclosedTokens(token::TokenType start, token::TokenType end) {
-    std::vector<std::shared_ptr<token::Token>> enclosedTokensPtr = extractEnclosedTokensPtr(start, end);
+    return {begin, enclosedEnd};
+}
 
-    std::vector<token::Token> enclosedTokens;
-    for (const std::shared_ptr<token::Token>& tokenPtr : enclosedTokensPtr) {
-        enclosedTokens.push_back(*tokenPtr);
-    }
+std::shared_ptr<ast::RootNode> Parser::parseBlock() {
+    auto [begin, end] = skipEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
+    Parser blockParser{tokens, begin, end};
 
-    return enclosedTokens;
+    return std::make_shared<ast::RootNode>(blockParser.root());
 }
 
 std::shared_ptr<ast::WhileNode> Parser::parseWhile() {
     token::Token whileToken = advance();  // skip the "while" keyword
 
-    std::vector<std::shared_ptr<token::Token>> whileConditionTokens = extractEnclosedTokensPtr(token::TokenType::OPEN_PAREN, token::TokenType::CLOSE_PAREN);
-    std::vector<token::Token> whileBodyTokens = extractEnclosedTokens(token::TokenType::OPEN_BRACE, token::TokenType::CLOSE_BRACE);
-
-    ShuntingYardParser whileConditionParser{whileConditionTokens};
-    Parser whileBodyParser{whileBodyTokens};
+    std::shared_ptr<ast::ExpressionNode> whileCondition = parseCondition();
 
     return std::make_shared<ast::WhileNode>(ast::WhileNode{
         whileToken,
-        whileConditionParser.root(),
-        std::make_shared<ast::RootNode>(whileBodyParser.root())
+        whileCondition,
+        parseBlock()
     });
 }
+
+std::shared_ptr<ast::ForNode> Parser::parseFor() {
+    token::Token forToken = advance();  // skip the "for" keyword
+
+    expect(token::TokenType::OPEN_PAREN);
+    token::Token counter = advance();
+
+    if (counter.type() != token::TokenType::IDENTIFIER) {
+        throw std::runtime_error("Expected the name of the loop counter after \"for (\"");
+    }
+
+    expect(token::TokenType::IN);
+    std::shared_ptr<ast::ExpressionNode> start = parseExpression();
+    expect(token::TokenType::RANGE);
+    std::shared_ptr<ast::ExpressionNode> end = parseExpression();
+
+    // "step" is only a keyword here, so it can still be used as a variable name
+    std::shared_ptr<ast::ExpressionNode> step;
+    if (currentToken().type() == token::TokenType::IDENTIFIER && currentToken().value() == "step") {
+        advance();
+        step = parseExpression();
+    } else {
+        step = std::make_shared<ast::ExpressionNode>(
+            token::Token{token::TokenType::LITERAL_INT, "1", forToken.line(), forToken.column()},
+            std::vector<std::shared_ptr<ast::ASTNode>>{});
+    }
+
+    expect(token::TokenType::CLOSE_PAREN);
+
+    auto counterNode = std::make_shared<ast::ExpressionNode>(counter, std::vector<std::shared_ptr<ast::ASTNode>>{});
+    auto initialization = std::make_shared<ast::DeclarationNode>(std::vector<std::shared_ptr<ast::ASTNode>>{counterNode, start});
+
+    return std::make_shared<ast::ForNode>(forToken, initialization, end, step, parseBlock());
+}
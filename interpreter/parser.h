@@ -3,10 +3,20 @@
 
 #include "ast.h"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 
 class Parser {
 public:
     explicit Parser(std::vector<token::Token> input);
+    explicit Parser(std::shared_ptr<const std::vector<token::Token>> source);
+
+    /**
+     * Parses the tokens in [begin, end) of a token list shared with other parsers, e.g., a block or function body.
+     */
+    Parser(std::shared_ptr<const std::vector<token::Token>> source, size_t begin, size_t end);
 
     [[nodiscard]] ast::RootNode root() const;
 
@@ -18,49 +28,44 @@ private:
     ast::RootNode parse();
 
     /**
-     * Extracts all the tokens within two token types, defined as the start and end tokens. Nested tokens are supported.
+     * Skips over the tokens between a start token and its matching end token. Nested tokens are supported.
      *
      * For example, if the input is:  ((1 + 2) * 3) + 3, and the start token is '(' and the end token is ')', then the
-     * function will return the tokens: (1 + 2) * 3
+     * function will return the range of the tokens: (1 + 2) * 3, and leave the parser at the final + 3
      *
-     * Throws an exception if the start token is not the current token.
+     * Throws an exception if the start token is not the current token, or if it is never closed.
      *
-     * @param start The token type to start extracting from
-     * @param end The token type to end extracting at
-     * @return The enclosed tokens
+     * @param start The token type to start skipping from
+     * @param end The token type to end skipping at
+     * @return The indices [begin, end) of the enclosed tokens
      */
-    std::vector<token::Token> extractEnclosedTokens(token::TokenType start, token::TokenType end);
+    std::pair<size_t, size_t> skipEnclosedTokens(token::TokenType start, token::TokenType end);
 
     /**
-     * Extracts all the tokens within two token types, defined as the start and end tokens. Nested tokens are supported.
-     * Different than the other extractEnclosedTokens function, this function returns a vector of shared pointers.
-     *
-     * For example, if the input is:  ((1 + 2) * 3) + 3, and the start token is '(' and the end token is ')', then the
-     * function will return the tokens: (1 + 2) * 3
-     *
-     * @param start The token type to start extracting from
-     * @param end The token type to end extracting at
-     * @return The enclosed tokens
+     * Parses a block of statements enclosed in curly braces, e.g., the body of an if statement or while loop. Assumes
+     * the current token is the opening brace.
+     * @return The root of the block
      */
-    std::vector<std::shared_ptr<token::Token>> extractEnclosedTokensPtr(token::TokenType start, token::TokenType end);
+    std::shared_ptr<ast::RootNode> parseBlock();
 
     /**
-     * Checks if the parser is at the end of the input (pos >= the size of tokens).
+     * Checks if the parser is at the end of the input (pos >= endPos).
      * @return True if the parser is at the end of the input, false otherwise
      */
     [[nodiscard]] bool atEnd() const;
 
     /**
      * Returns the current token.
+     * @throws std::runtime_error if the parser is at the end of the input
      * @return The current token
      */
-    [[nodiscard]] token::Token currentToken() const;
+    [[nodiscard]] const token::Token& currentToken() const;
 
     /**
      * Peeks at the next token.
      * @return The next token
      */
-    [[nodiscard]] token::Token peek() const;
+    [[nodiscard]] const token::Token& peek() const;
 
     /**
      * Advances the parser by one token.
@@ -81,13 +86,34 @@ private:
     std::shared_ptr<ast::DeclarationNode> parseDeclaration();
 
     /**
-     * Parses an expression using the shunting yard algorithm.
+     * @return True if the token type is a compound assignment operator, e.g., +=
+     */
+    static bool isCompoundAssignment(token::TokenType type);
+
+    /**
+     * Parses a compound assignment to a variable, e.g., total += 2;
+     * @return The root of the assignment tree
+     */
+    std::shared_ptr<ast::CompoundAssignmentNode> parseCompoundAssignment();
+
+    /**
+     * Parses an expression by precedence climbing (a Pratt parser), building the nodes as it goes. Stops at the first
+     * token that can't continue the expression, without consuming it.
+     * @param minPrecedence Only binary operators with at least this precedence are folded into the expression
      * @return The root of the expression tree
      */
-    std::shared_ptr<ast::ExpressionNode> parseExpression();
+    std::shared_ptr<ast::ExpressionNode> parseExpression(int minPrecedence = 0);
 
     /**
-     * Parses a function declaration. Assumes the current token is the function name/identifier.
+     * Parses an operand of an expression: a literal, variable, call, index, array or dictionary literal, parenthesized
+     * expression, or a unary operator applied to an operand.
+     * @return The root of the operand tree
+     */
+    std::shared_ptr<ast::ExpressionNode> parseOperand();
+
+    /**
+     * Parses a function declaration. The body is only checked for matching braces; it is parsed the first time the
+     * function is called (see ast::FunctionBodyNode). Assumes the current token is the function keyword.
      * @return The root of the function declaration tree
      */
     std::shared_ptr<ast::FunctionDefNode> parseFuncDeclaration();
@@ -98,6 +124,13 @@ private:
      */
     std::shared_ptr<ast::ControlFlowNode> parseControlFlow();
 
+    /**
+     * Parses a parenthesized condition, e.g., of an if statement or while loop. Assumes the current token is the
+     * opening parenthesis.
+     * @return The root of the condition expression tree
+     */
+    std::shared_ptr<ast::ExpressionNode> parseCondition();
+
     /**
      * Parses an if statement.
      * @return The root of the if statement tree
@@ -110,12 +143,51 @@ private:
      */
     std::shared_ptr<ast::WhileNode> parseWhile();
 
+    /**
+     * Parses a counted for loop: for (name in start..end) or for (name in start..end step step). Assumes the current
+     * token is the for keyword.
+     * @return The root of the for loop tree
+     */
+    std::shared_ptr<ast::ForNode> parseFor();
+
     /**
      * Parses a function call. Assumes the current token is the function name/identifier.
      * @return The function call pseudo-token
      */
     token::FunctionCallToken parseFunctionCall();
 
+    /**
+     * Parses an array literal. Assumes the current token is the opening bracket.
+     * @return The array literal pseudo-token
+     */
+    token::ArrayLiteralToken parseArrayLiteral();
+
+    /**
+     * Parses a dictionary literal. Assumes the current token is the opening brace.
+     * @return The dictionary literal pseudo-token
+     */
+    token::DictLiteralToken parseDictLiteral();
+
+    /**
+     * Parses an index into a variable (e.g., values[i]). Assumes the current token is the variable name/identifier.
+     * @return The index pseudo-token
+     */
+    token::IndexToken parseIndex();
+
+    /**
+     * Parses an assignment to an array element or dictionary entry (e.g., values[i] = 5;). Assumes the current token is the array
+     * name/identifier.
+     * @return The root of the index assignment tree
+     */
+    std::shared_ptr<ast::IndexAssignmentNode> parseIndexAssignment();
+
+    /**
+     * Checks if the statement starting at the current token is an assignment to an array element or dictionary entry,
+     * without advancing.
+     * @return True if the current tokens are of the form identifier[...] =
+     */
+    [[nodiscard]] bool atIndexAssignment() const;
+
     /**
      * Checks if the current token is of the expected type. Throws an exception if it is not. Also advances the parser.
      *
@@ -125,8 +197,9 @@ private:
     void expect(token::TokenType type);
 
     ast::RootNode astRoot;
-    std::vector<token::Token> tokens;
-    int pos;
+    std::shared_ptr<const std::vector<token::Token>> tokens;
+    size_t pos;
+    size_t endPos;  // one past the last token this parser may read
 };
 
 #endif  // SPL_PARSER_H
@@ -0,0 +1,80 @@
+#include "sandbox.h"
+
+#include <algorithm>
+#include <utility>
+
+
+sandbox::Limits::Limits(uint64_t steps, size_t memoryBytes)
+    : budget(steps), remaining(steps), refills(0), memoryCap(memoryBytes), memoryInUse(0), maxDepth(UNLIMITED_DEPTH),
+      depth(0) {}
+
+void sandbox::Limits::onExhausted(YieldHandler handler) {
+    yieldHandler = std::move(handler);
+}
+
+void sandbox::Limits::limitCallDepth(size_t calls) {
+    maxDepth = calls;
+}
+
+void sandbox::Limits::exhausted() {
+    if (budget > 0 && yieldHandler && yieldHandler()) {
+        remaining = budget;
+        refills++;
+        return;
+    }
+
+    throw StepLimitExceeded("Step limit of " + std::to_string(budget) + " exceeded");
+}
+
+void sandbox::Limits::allocate(size_t bytes) {
+    reserve(bytes);
+    memoryInUse += bytes;
+}
+
+void sandbox::Limits::release(size_t bytes) {
+    memoryInUse -= std::min(bytes, memoryInUse);
+}
+
+void sandbox::Limits::reserve(size_t bytes) const {
+    if (bytes > memoryCap - memoryInUse) {
+        throw MemoryLimitExceeded("Memory limit of " + std::to_string(memoryCap) + " bytes exceeded");
+    }
+}
+
+uint64_t sandbox::Limits::stepsTaken() const {
+    return refills * budget + (budget - remaining);
+}
+
+size_t sandbox::Limits::memoryUsed() const {
+    return memoryInUse;
+}
+
+
+sandbox::Account::Account(Limits* limits) : limits(limits), charged(0) {}
+
+void sandbox::Account::charge(size_t bytes) {
+    if (limits != nullptr) {
+        limits->allocate(bytes);
+        charged += bytes;
+    }
+}
+
+void sandbox::Account::refund(size_t bytes) {
+    if (limits != nullptr) {
+        bytes = std::min(bytes, charged);
+        limits->release(bytes);
+        charged -= bytes;
+    }
+}
+
+void sandbox::Account::close() {
+    if (limits != nullptr) {
+        limits->release(charged);
+        limits = nullptr;
+        charged = 0;
+    }
+}
+
+bool sandbox::Account::isOpen() const {
+    return limits != nullptr;
+}
@@ -0,0 +1,137 @@
+#ifndef SPL_SANDBOX_H
+#define SPL_SANDBOX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Limits for running untrusted scripts: a step budget, checked at every loop iteration and function call, a cap on the
+ * memory held by variables, strings, arrays and dictionaries, and a cap on how deeply function calls nest.
+ */
+namespace sandbox {
+    class StepLimitExceeded : public std::runtime_error {
+    public:
+        explicit StepLimitExceeded(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    class MemoryLimitExceeded : public std::runtime_error {
+    public:
+        explicit MemoryLimitExceeded(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    class CallDepthExceeded : public std::runtime_error {
+    public:
+        explicit CallDepthExceeded(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    class Limits {
+    public:
+        static constexpr uint64_t UNLIMITED_STEPS = UINT64_MAX;
+        static constexpr size_t UNLIMITED_MEMORY = SIZE_MAX;
+        static constexpr size_t UNLIMITED_DEPTH = SIZE_MAX;
+
+        /**
+         * Called when the step budget runs out. Return true to give the script another budget of the same size (e.g.,
+         * after checking a deadline or letting other work run), or false to stop the script.
+         */
+        using YieldHandler = std::function<bool()>;
+
+        /**
+         * @param steps The number of loop iterations and function calls the script may make
+         * @param memoryBytes The number of bytes the script's variables, strings, arrays and dictionaries may use
+         */
+        Limits(uint64_t steps, size_t memoryBytes);
+
+        void onExhausted(YieldHandler handler);
+
+        /**
+         * Caps the number of SPL function calls that can be running at once, e.g., so deep recursion fails the script
+         * before it overflows a fixed-size stack. Unlimited by default.
+         */
+        void limitCallDepth(size_t calls);
+
+        /**
+         * Counts a function call that has started. Every successful enter must be matched by a leave.
+         * @throws CallDepthExceeded if the call would nest deeper than the cap. Nothing is counted in that case
+         */
+        void enter() {
+            if (depth == maxDepth) {
+                throw CallDepthExceeded("Call depth limit of " + std::to_string(maxDepth) + " exceeded");
+            }
+
+            depth++;
+        }
+
+        void leave() {
+            depth--;
+        }
+
+        /**
+         * Counts one step. Called at loop back-edges and function entry.
+         * @throws StepLimitExceeded if the budget runs out and the yield handler does not refill it
+         */
+        void step() {
+            if (remaining == 0) {
+                exhausted();
+            }
+
+            remaining--;
+        }
+
+        /**
+         * Records memory that stays in use until release is called.
+         * @throws MemoryLimitExceeded if the cap would be exceeded. Nothing is recorded in that case
+         */
+        void allocate(size_t bytes);
+        void release(size_t bytes);
+
+        /**
+         * Checks that a temporary of the given size fits under the cap, without recording it.
+         * @throws MemoryLimitExceeded if it does not fit
+         */
+        void reserve(size_t bytes) const;
+
+        [[nodiscard]] uint64_t stepsTaken() const;
+        [[nodiscard]] size_t memoryUsed() const;
+
+    private:
+        void exhausted();
+
+        uint64_t budget;
+        uint64_t remaining;
+        uint64_t refills;
+        size_t memoryCap;
+        size_t memoryInUse;
+        size_t maxDepth;
+        size_t depth;
+        YieldHandler yieldHandler;
+    };
+
+    /**
+     * Memory counted against limits on behalf of an environment and the arrays and dictionaries stored in it, which
+     * may outlive both. Closing the account releases everything it counted; charges and refunds made after that do
+     * nothing.
+     */
+    class Account {
+    public:
+        explicit Account(Limits* limits);
+
+        /**
+         * @throws MemoryLimitExceeded if the cap would be exceeded. Nothing is counted in that case
+         */
+        void charge(size_t bytes);
+        void refund(size_t bytes);
+
+        void close();
+        [[nodiscard]] bool isOpen() const;
+
+    private:
+        Limits* limits;  // nullptr once closed
+        size_t charged;
+    };
+}
+
+#endif  // SPL_SANDBOX_H
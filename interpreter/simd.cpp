@@ -0,0 +1,561 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SPL_SIMD_SSE2 1
+#endif
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#define SPL_SIMD_SSE41 1
+#endif
+
+
+namespace {
+#ifdef SPL_SIMD_SSE2
+    /**
+     * Splits a vector of two 64-bit lanes.
+     */
+    void storeLanes(int64_t* lanes, __m128i v) {
+        alignas(16) int64_t aligned[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(aligned), v);
+        lanes[0] = aligned[0];
+        lanes[1] = aligned[1];
+    }
+
+    float horizontalSum(__m128 v) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, v);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    __m128i selectMin(__m128i a, __m128i b) {
+#ifdef SPL_SIMD_SSE41
+        return _mm_min_epi32(a, b);
+#else
+        __m128i mask = _mm_cmplt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+    }
+
+    __m128i selectMax(__m128i a, __m128i b) {
+#ifdef SPL_SIMD_SSE41
+        return _mm_max_epi32(a, b);
+#else
+        __m128i mask = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+#endif
+    }
+
+    __m128i load(const int* data) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    void store(int* data, __m128i v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data), v);
+    }
+
+    /**
+     * Narrows four vectors of lane masks (all ones or all zeros) to 16 bytes of 1 or 0.
+     */
+    void storeMasks(uint8_t* out, __m128i a, __m128i b, __m128i c, __m128i d) {
+        __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_and_si128(bytes, _mm_set1_epi8(1)));
+    }
+
+    __m128i compareLanes(simd::Comparison comparison, __m128i left, __m128i right) {
+        __m128i ones = _mm_set1_epi32(-1);
+
+        switch (comparison) {
+            case simd::Comparison::LESS:
+                return _mm_cmplt_epi32(left, right);
+            case simd::Comparison::LESS_EQ:
+                return _mm_xor_si128(_mm_cmpgt_epi32(left, right), ones);
+            case simd::Comparison::GREATER:
+                return _mm_cmpgt_epi32(left, right);
+            case simd::Comparison::GREATER_EQ:
+                return _mm_xor_si128(_mm_cmplt_epi32(left, right), ones);
+            case simd::Comparison::EQ:
+                return _mm_cmpeq_epi32(left, right);
+            default:
+                return _mm_xor_si128(_mm_cmpeq_epi32(left, right), ones);
+        }
+    }
+
+    // compared directly rather than by negating the opposite comparison, which would be true for NaN
+    __m128i compareLanes(simd::Comparison comparison, __m128 left, __m128 right) {
+        switch (comparison) {
+            case simd::Comparison::LESS:
+                return _mm_castps_si128(_mm_cmplt_ps(left, right));
+            case simd::Comparison::LESS_EQ:
+                return _mm_castps_si128(_mm_cmple_ps(left, right));
+            case simd::Comparison::GREATER:
+                return _mm_castps_si128(_mm_cmpgt_ps(left, right));
+            case simd::Comparison::GREATER_EQ:
+                return _mm_castps_si128(_mm_cmpge_ps(left, right));
+            case simd::Comparison::EQ:
+                return _mm_castps_si128(_mm_cmpeq_ps(left, right));
+            default:
+                return _mm_castps_si128(_mm_cmpneq_ps(left, right));
+        }
+    }
+#endif
+
+    template<typename T>
+    bool compareScalar(simd::Comparison comparison, T left, T right) {
+        switch (comparison) {
+            case simd::Comparison::LESS:
+                return left < right;
+            case simd::Comparison::LESS_EQ:
+                return left <= right;
+            case simd::Comparison::GREATER:
+                return left > right;
+            case simd::Comparison::GREATER_EQ:
+                return left >= right;
+            case simd::Comparison::EQ:
+                return left == right;
+            default:
+                return left != right;
+        }
+    }
+}
+
+
+int64_t simd::sum(const int* data, size_t size) {
+    size_t i = 0;
+    int64_t result = 0;
+
+#ifdef SPL_SIMD_SSE2
+    // the ints are widened to 64-bit lanes by pairing each with a lane of its sign bits
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i v = load(data + i);
+        __m128i sign = _mm_srai_epi32(v, 31);
+
+        acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_unpacklo_epi32(v, sign), _mm_unpackhi_epi32(v, sign)));
+    }
+
+    int64_t lanes[2];
+    storeLanes(lanes, acc);
+    result = lanes[0] + lanes[1];
+#endif
+
+    for (; i < size; i++) {
+        result += data[i];
+    }
+
+    return result;
+}
+
+float simd::sum(const float* data, size_t size) {
+    size_t i = 0;
+    float result = 0;
+
+#ifdef SPL_SIMD_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= size; i += 4) {
+        acc = _mm_add_ps(acc, _mm_loadu_ps(data + i));
+    }
+    result = horizontalSum(acc);
+#endif
+
+    for (; i < size; i++) {
+        result += data[i];
+    }
+
+    return result;
+}
+
+int simd::min(const int* data, size_t size) {
+    size_t i = 0;
+    int result = data[0];
+
+#ifdef SPL_SIMD_SSE2
+    if (size >= 4) {
+        __m128i acc = load(data);
+        for (i = 4; i + 4 <= size; i += 4) {
+            acc = selectMin(acc, load(data + i));
+        }
+
+        alignas(16) int lanes[4];
+        store(lanes, acc);
+        result = *std::min_element(lanes, lanes + 4);
+    }
+#endif
+
+    for (; i < size; i++) {
+        result = std::min(result, data[i]);
+    }
+
+    return result;
+}
+
+float simd::min(const float* data, size_t size) {
+    size_t i = 0;
+    float result = data[0];
+
+#ifdef SPL_SIMD_SSE2
+    if (size >= 4) {
+        __m128 acc = _mm_loadu_ps(data);
+        for (i = 4; i + 4 <= size; i += 4) {
+            acc = _mm_min_ps(acc, _mm_loadu_ps(data + i));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        result = *std::min_element(lanes, lanes + 4);
+    }
+#endif
+
+    for (; i < size; i++) {
+        result = std::min(result, data[i]);
+    }
+
+    return result;
+}
+
+int simd::max(const int* data, size_t size) {
+    size_t i = 0;
+    int result = data[0];
+
+#ifdef SPL_SIMD_SSE2
+    if (size >= 4) {
+        __m128i acc = load(data);
+        for (i = 4; i + 4 <= size; i += 4) {
+            acc = selectMax(acc, load(data + i));
+        }
+
+        alignas(16) int lanes[4];
+        store(lanes, acc);
+        result = *std::max_element(lanes, lanes + 4);
+    }
+#endif
+
+    for (; i < size; i++) {
+        result = std::max(result, data[i]);
+    }
+
+    return result;
+}
+
+float simd::max(const float* data, size_t size) {
+    size_t i = 0;
+    float result = data[0];
+
+#ifdef SPL_SIMD_SSE2
+    if (size >= 4) {
+        __m128 acc = _mm_loadu_ps(data);
+        for (i = 4; i + 4 <= size; i += 4) {
+            acc = _mm_max_ps(acc, _mm_loadu_ps(data + i));
+        }
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        result = *std::max_element(lanes, lanes + 4);
+    }
+#endif
+
+    for (; i < size; i++) {
+        result = std::max(result, data[i]);
+    }
+
+    return result;
+}
+
+bool simd::dot(const int* left, const int* right, size_t size, int64_t& result) {
+    size_t i = 0;
+    bool overflowed = false;
+    result = 0;
+
+    // the product of two ints always fits 64 bits, only adding the products up can overflow. SSE2 has no signed
+    // widening multiply, so the int kernel needs SSE4.1
+#ifdef SPL_SIMD_SSE41
+    __m128i acc = _mm_setzero_si128();
+    __m128i overflow = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = load(left + i);
+        __m128i r = load(right + i);
+
+        // _mm_mul_epi32 multiplies the even lanes; shifting moves the odd lanes down to them
+        for (__m128i product : {_mm_mul_epi32(l, r), _mm_mul_epi32(_mm_srli_epi64(l, 32), _mm_srli_epi64(r, 32))}) {
+            __m128i sum = _mm_add_epi64(acc, product);
+
+            // as in add: a lane overflowed if the sum's sign differs from the signs of both operands
+            overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(sum, acc), _mm_xor_si128(sum, product)));
+            acc = sum;
+        }
+    }
+
+    int64_t lanes[2];
+    storeLanes(lanes, acc);
+    overflowed = _mm_movemask_pd(_mm_castsi128_pd(overflow)) != 0;
+    overflowed |= __builtin_add_overflow(lanes[0], lanes[1], &result);
+#endif
+
+    for (; i < size; i++) {
+        overflowed |= __builtin_add_overflow(result, static_cast<int64_t>(left[i]) * right[i], &result);
+    }
+
+    return !overflowed;
+}
+
+float simd::dot(const float* left, const float* right, size_t size) {
+    size_t i = 0;
+    float result = 0;
+
+#ifdef SPL_SIMD_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= size; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)));
+    }
+    result = horizontalSum(acc);
+#endif
+
+    for (; i < size; i++) {
+        result += left[i] * right[i];
+    }
+
+    return result;
+}
+
+bool simd::scale(int* data, size_t size, int scalar) {
+    bool overflowed = false;
+
+    // as in multiply, there is no vector multiply that reports overflow
+    for (size_t i = 0; i < size; i++) {
+        int64_t product = static_cast<int64_t>(data[i]) * scalar;
+
+        overflowed |= product != static_cast<int32_t>(product);
+        data[i] = static_cast<int>(product);
+    }
+
+    return !overflowed;
+}
+
+void simd::scale(float* data, size_t size, float scalar) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    __m128 factor = _mm_set1_ps(scalar);
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), factor));
+    }
+#endif
+
+    for (; i < size; i++) {
+        data[i] *= scalar;
+    }
+}
+
+bool simd::offset(int* data, size_t size, int scalar) {
+    size_t i = 0;
+    bool overflowed = false;
+
+#ifdef SPL_SIMD_SSE2
+    // checked like add
+    __m128i term = _mm_set1_epi32(scalar);
+    __m128i overflow = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i v = load(data + i);
+        __m128i sum = _mm_add_epi32(v, term);
+
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(sum, v), _mm_xor_si128(sum, term)));
+        store(data + i, sum);
+    }
+    overflowed = _mm_movemask_ps(_mm_castsi128_ps(overflow)) != 0;
+#endif
+
+    for (; i < size; i++) {
+        overflowed |= __builtin_add_overflow(data[i], scalar, &data[i]);
+    }
+
+    return !overflowed;
+}
+
+void simd::offset(float* data, size_t size, float scalar) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    __m128 term = _mm_set1_ps(scalar);
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(data + i, _mm_add_ps(_mm_loadu_ps(data + i), term));
+    }
+#endif
+
+    for (; i < size; i++) {
+        data[i] += scalar;
+    }
+}
+
+bool simd::add(const int* left, const int* right, int* out, size_t size) {
+    size_t i = 0;
+    bool overflowed = false;
+
+#ifdef SPL_SIMD_SSE2
+    // a lane overflowed if the sum's sign differs from the signs of both operands
+    __m128i overflow = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = load(left + i);
+        __m128i r = load(right + i);
+        __m128i sum = _mm_add_epi32(l, r);
+
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(sum, l), _mm_xor_si128(sum, r)));
+        store(out + i, sum);
+    }
+    overflowed = _mm_movemask_ps(_mm_castsi128_ps(overflow)) != 0;
+#endif
+
+    for (; i < size; i++) {
+        overflowed |= __builtin_add_overflow(left[i], right[i], &out[i]);
+    }
+
+    return !overflowed;
+}
+
+bool simd::subtract(const int* left, const int* right, int* out, size_t size) {
+    size_t i = 0;
+    bool overflowed = false;
+
+#ifdef SPL_SIMD_SSE2
+    // a lane overflowed if the operands' signs differ and the difference's sign differs from the left operand's
+    __m128i overflow = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = load(left + i);
+        __m128i r = load(right + i);
+        __m128i difference = _mm_sub_epi32(l, r);
+
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(l, r), _mm_xor_si128(l, difference)));
+        store(out + i, difference);
+    }
+    overflowed = _mm_movemask_ps(_mm_castsi128_ps(overflow)) != 0;
+#endif
+
+    for (; i < size; i++) {
+        overflowed |= __builtin_sub_overflow(left[i], right[i], &out[i]);
+    }
+
+    return !overflowed;
+}
+
+bool simd::multiply(const int* left, const int* right, int* out, size_t size) {
+    bool overflowed = false;
+
+    // there is no vector multiply that reports overflow, so this widens to 64 bits instead
+    for (size_t i = 0; i < size; i++) {
+        int64_t product = static_cast<int64_t>(left[i]) * right[i];
+
+        overflowed |= product != static_cast<int32_t>(product);
+        out[i] = static_cast<int>(product);
+    }
+
+    return !overflowed;
+}
+
+void simd::add(const float* left, const float* right, float* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = left[i] + right[i];
+    }
+}
+
+void simd::subtract(const float* left, const float* right, float* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = left[i] - right[i];
+    }
+}
+
+void simd::multiply(const float* left, const float* right, float* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = left[i] * right[i];
+    }
+}
+
+void simd::divide(const float* left, const float* right, float* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(out + i, _mm_div_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = left[i] / right[i];
+    }
+}
+
+void simd::compare(Comparison comparison, const int* left, const int* right, uint8_t* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 16 <= size; i += 16) {
+        storeMasks(out + i,
+                   compareLanes(comparison, load(left + i), load(right + i)),
+                   compareLanes(comparison, load(left + i + 4), load(right + i + 4)),
+                   compareLanes(comparison, load(left + i + 8), load(right + i + 8)),
+                   compareLanes(comparison, load(left + i + 12), load(right + i + 12)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = compareScalar(comparison, left[i], right[i]);
+    }
+}
+
+void simd::compare(Comparison comparison, const float* left, const float* right, uint8_t* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 16 <= size; i += 16) {
+        storeMasks(out + i,
+                   compareLanes(comparison, _mm_loadu_ps(left + i), _mm_loadu_ps(right + i)),
+                   compareLanes(comparison, _mm_loadu_ps(left + i + 4), _mm_loadu_ps(right + i + 4)),
+                   compareLanes(comparison, _mm_loadu_ps(left + i + 8), _mm_loadu_ps(right + i + 8)),
+                   compareLanes(comparison, _mm_loadu_ps(left + i + 12), _mm_loadu_ps(right + i + 12)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = compareScalar(comparison, left[i], right[i]);
+    }
+}
+
+void simd::toFloat(const int* data, float* out, size_t size) {
+    size_t i = 0;
+
+#ifdef SPL_SIMD_SSE2
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(out + i, _mm_cvtepi32_ps(load(data + i)));
+    }
+#endif
+
+    for (; i < size; i++) {
+        out[i] = static_cast<float>(data[i]);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef SPL_SIMD_H
+#define SPL_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bulk kernels used by the array builtins and by batch evaluation (see batch.h). On x86-64 these use SSE2 (and SSE4.1 when the compiler is allowed to emit
+ * it), everywhere else they fall back to plain scalar loops. Integer kernels that can overflow report it; the results they
+ * leave behind then wrap instead of invoking UB.
+ */
+namespace simd {
+    /**
+     * Adds up the elements in 64 bits, which can't overflow for an array that fits in memory.
+     */
+    [[nodiscard]] int64_t sum(const int* data, size_t size);
+    [[nodiscard]] float sum(const float* data, size_t size);
+
+    /**
+     * Finds the smallest element. The caller must make sure that size > 0.
+     */
+    [[nodiscard]] int min(const int* data, size_t size);
+    [[nodiscard]] float min(const float* data, size_t size);
+
+    /**
+     * Finds the largest element. The caller must make sure that size > 0.
+     */
+    [[nodiscard]] int max(const int* data, size_t size);
+    [[nodiscard]] float max(const float* data, size_t size);
+
+    /**
+     * Adds up the products of the elements in 64 bits.
+     * @return false if the sum overflowed 64 bits. result then holds the wrapped sum
+     */
+    [[nodiscard]] bool dot(const int* left, const int* right, size_t size, int64_t& result);
+    [[nodiscard]] float dot(const float* left, const float* right, size_t size);
+
+    /**
+     * Multiplies every element by the scalar, in place.
+     * @return false if any element overflowed. data then holds the wrapped results
+     */
+    [[nodiscard]] bool scale(int* data, size_t size, int scalar);
+    void scale(float* data, size_t size, float scalar);
+
+    /**
+     * Adds the scalar to every element, in place.
+     * @return false if any element overflowed. data then holds the wrapped results
+     */
+    [[nodiscard]] bool offset(int* data, size_t size, int scalar);
+    void offset(float* data, size_t size, float scalar);
+
+    /**
+     * Element-wise int arithmetic: out[i] = left[i] + right[i], and so on.
+     * @return false if any element overflowed. out then holds the wrapped results
+     */
+    [[nodiscard]] bool add(const int* left, const int* right, int* out, size_t size);
+    [[nodiscard]] bool subtract(const int* left, const int* right, int* out, size_t size);
+    [[nodiscard]] bool multiply(const int* left, const int* right, int* out, size_t size);
+
+    void add(const float* left, const float* right, float* out, size_t size);
+    void subtract(const float* left, const float* right, float* out, size_t size);
+    void multiply(const float* left, const float* right, float* out, size_t size);
+    void divide(const float* left, const float* right, float* out, size_t size);
+
+    enum class Comparison {
+        LESS,
+        LESS_EQ,
+        GREATER,
+        GREATER_EQ,
+        EQ,
+        NOT_EQ
+    };
+
+    /**
+     * Element-wise comparison: out[i] is 1 if the comparison holds between left[i] and right[i], otherwise 0.
+     */
+    void compare(Comparison comparison, const int* left, const int* right, uint8_t* out, size_t size);
+    void compare(Comparison comparison, const float* left, const float* right, uint8_t* out, size_t size);
+
+    /**
+     * Converts every element to a float, rounding like static_cast does.
+     */
+    void toFloat(const int* data, float* out, size_t size);
+}
+
+#endif  // SPL_SIMD_H
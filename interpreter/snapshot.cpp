@@ -0,0 +1,433 @@
+#include "snapshot.h"
+
+#include "ast.h"
+#include "flat.h"
+#include "io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+
+namespace {
+    constexpr char MAGIC[8] = {'S', 'P', 'L', 'S', 'N', 'A', 'P', '\0'};
+    constexpr uint32_t VERSION = 3;  // token types are stored by number, so adding one needs a new version
+
+    enum class Tag : uint8_t {
+        BOOL,
+        INT,
+        FLOAT,
+        STRING,
+        BIG_INT,
+        ARRAY,
+        DICT,
+        FUNCTION,
+        REFERENCE  // an array or dictionary written earlier in the snapshot
+    };
+
+    class Writer {
+    public:
+        template<typename T>
+        void write(std::string& output, T value) {
+            output.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void writeString(std::string& output, std::string_view text) {
+            write(output, static_cast<uint32_t>(text.size()));
+            output.append(text);
+        }
+
+        void writeValue(const env::VariantType& value) {
+            if (const bool* boolean = std::get_if<bool>(&value)) {
+                write(variables, Tag::BOOL);
+                write(variables, static_cast<uint8_t>(*boolean));
+            } else if (const int* integer = std::get_if<int>(&value)) {
+                write(variables, Tag::INT);
+                write(variables, static_cast<int32_t>(*integer));
+            } else if (const float* real = std::get_if<float>(&value)) {
+                write(variables, Tag::FLOAT);
+                write(variables, *real);
+            } else if (types::isString(value)) {
+                write(variables, Tag::STRING);
+                writeString(variables, types::stringView(value));
+            } else if (const types::BigInt* big = std::get_if<types::BigInt>(&value)) {
+                write(variables, Tag::BIG_INT);
+                write(variables, static_cast<uint8_t>(big->isNegative()));
+                write(variables, static_cast<uint32_t>(big->digits().size()));
+                variables.append(reinterpret_cast<const char*>(big->digits().data()), big->digits().size() * sizeof(uint32_t));
+            } else if (const types::Array* array = std::get_if<types::Array>(&value)) {
+                if (writeReference(array->identity())) {
+                    return;
+                }
+
+                write(variables, Tag::ARRAY);
+                write(variables, static_cast<uint8_t>(array->elementType()));
+                write(variables, static_cast<uint32_t>(array->size()));
+
+                if (array->elementType() == types::ElementType::INT) {
+                    variables.append(reinterpret_cast<const char*>(array->ints().data()), array->size() * sizeof(int));
+                } else {
+                    variables.append(reinterpret_cast<const char*>(array->floats().data()), array->size() * sizeof(float));
+                }
+            } else if (const types::Dict* dict = std::get_if<types::Dict>(&value)) {
+                if (writeReference(dict->identity())) {
+                    return;
+                }
+
+                std::vector<size_t> saved;
+                for (size_t i = 0; i < dict->size(); i++) {
+                    if (!std::holds_alternative<types::NativeFunction>(dict->valueAt(i))) {
+                        saved.push_back(i);
+                    }
+                }
+
+                write(variables, Tag::DICT);
+                write(variables, static_cast<uint32_t>(saved.size()));
+
+                for (size_t i : saved) {
+                    writeValue(dict->keyAt(i));
+                    writeValue(dict->valueAt(i));
+                }
+            } else if (const types::Function* function = std::get_if<types::Function>(&value)) {
+                write(variables, Tag::FUNCTION);
+                write(variables, bodyIndex(*function->body()));
+                write(variables, static_cast<uint32_t>(function->parameters().size()));
+
+                for (const std::string& parameter : function->parameters()) {
+                    writeString(variables, parameter);
+                }
+            } else {
+                throw std::runtime_error("Cannot save a native function");
+            }
+        }
+
+        /**
+         * @return The snapshot: the header, the tokens of the function bodies, and the variables
+         */
+        std::string finish(uint32_t variableCount) {
+            std::string output{MAGIC, sizeof(MAGIC)};
+            write(output, VERSION);
+
+            write(output, static_cast<uint32_t>(tokens.size()));
+            for (const token::Token& token : tokens) {
+                write(output, static_cast<uint8_t>(token.type()));
+                write(output, static_cast<uint32_t>(token.line()));
+                write(output, static_cast<uint32_t>(token.column()));
+                writeString(output, token.value());
+            }
+
+            write(output, static_cast<uint32_t>(bodyRanges.size()));
+            for (const auto& [begin, end] : bodyRanges) {
+                write(output, begin);
+                write(output, end);
+            }
+
+            write(output, variableCount);
+            output += variables;
+
+            return output;
+        }
+
+        std::string variables;
+
+    private:
+        /**
+         * Writes a reference if the array or dictionary was written before, otherwise numbers it for later references.
+         * @return True if a reference was written
+         */
+        bool writeReference(const void* identity) {
+            auto [it, inserted] = objects.emplace(identity, static_cast<uint32_t>(objects.size()));
+
+            if (inserted) {
+                return false;
+            }
+
+            write(variables, Tag::REFERENCE);
+            write(variables, it->second);
+            return true;
+        }
+
+        uint32_t bodyIndex(const ast::ASTNode& body) {
+            const ast::FunctionBodyNode* tree = dynamic_cast<const ast::FunctionBodyNode*>(&body);
+
+            if (const auto* flattened = dynamic_cast<const flat::FunctionBody*>(&body)) {
+                tree = flattened->tree().get();
+            }
+
+            if (tree == nullptr) {
+                throw std::runtime_error("Cannot save a function whose body is not a function body node");
+            }
+
+            auto [it, inserted] = bodies.emplace(tree, static_cast<uint32_t>(bodyRanges.size()));
+
+            if (inserted) {
+                auto begin = static_cast<uint32_t>(tokens.size());
+                tokens.insert(tokens.end(), tree->tokensBegin(), tree->tokensEnd());
+                bodyRanges.emplace_back(begin, static_cast<uint32_t>(tokens.size()));
+            }
+
+            return it->second;
+        }
+
+        std::unordered_map<const void*, uint32_t> objects;
+        std::unordered_map<const ast::FunctionBodyNode*, uint32_t> bodies;
+        std::vector<token::Token> tokens;
+        std::vector<std::pair<uint32_t, uint32_t>> bodyRanges;
+    };
+
+    class Reader {
+    public:
+        /**
+         * @param mapped The snapshot as a slice to take strings from, or nullptr to copy them
+         */
+        Reader(std::string_view data, const types::StringSlice* mapped) : data(data), mapped(mapped), position(0) {}
+
+        template<typename T>
+        T read() {
+            T value;
+            std::memcpy(&value, bytes(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+
+        /**
+         * Fills a vector with the next items of the snapshot.
+         */
+        template<typename T>
+        void readInto(std::vector<T>& items) {
+            std::string_view source = bytes(items.size() * sizeof(T));
+
+            // an empty vector may have no storage, and memcpy must not be given a null pointer even to copy nothing
+            if (!items.empty()) {
+                std::memcpy(items.data(), source.data(), source.size());
+            }
+        }
+
+        std::string_view bytes(size_t count) {
+            if (count > data.size() - position) {
+                throw std::runtime_error("Snapshot is truncated");
+            }
+
+            std::string_view result = data.substr(position, count);
+            position += count;
+            return result;
+        }
+
+        /**
+         * Reads the number of items that follow, checking they can fit in what is left of the snapshot before anything
+         * is allocated for them.
+         * @param minimumBytes The fewest bytes an item takes
+         */
+        uint32_t readCount(size_t minimumBytes) {
+            auto count = read<uint32_t>();
+
+            if (count > (data.size() - position) / minimumBytes) {
+                throw std::runtime_error("Snapshot is truncated");
+            }
+
+            return count;
+        }
+
+        std::string readString() {
+            return std::string{bytes(read<uint32_t>())};
+        }
+
+        void readHeader() {
+            if (bytes(sizeof(MAGIC)) != std::string_view{MAGIC, sizeof(MAGIC)}) {
+                throw std::runtime_error("Not a snapshot");
+            }
+
+            if (read<uint32_t>() != VERSION) {
+                throw std::runtime_error("Snapshot was written by an incompatible version");
+            }
+
+            auto tokenCount = readCount(sizeof(uint8_t) + 3 * sizeof(uint32_t));
+            auto tokens = std::make_shared<std::vector<token::Token>>();
+            tokens->reserve(tokenCount);
+
+            for (uint32_t i = 0; i < tokenCount; i++) {
+                auto type = read<uint8_t>();
+                auto line = read<uint32_t>();
+                auto column = read<uint32_t>();
+
+                if (type >= token::TOKEN_TYPE_COUNT) {
+                    throw std::runtime_error("Snapshot is corrupt");
+                }
+
+                tokens->emplace_back(static_cast<token::TokenType>(type), readString(), line, column);
+            }
+
+            std::shared_ptr<const std::vector<token::Token>> source = std::move(tokens);
+            auto bodyCount = readCount(2 * sizeof(uint32_t));
+
+            for (uint32_t i = 0; i < bodyCount; i++) {
+                auto begin = read<uint32_t>();
+                auto end = read<uint32_t>();
+
+                if (begin > end || end > source->size()) {
+                    throw std::runtime_error("Snapshot is corrupt");
+                }
+
+                bodies.push_back(std::make_shared<ast::FunctionBodyNode>(source, begin, end));
+            }
+        }
+
+        env::VariantType readValue() {
+            switch (read<Tag>()) {
+                case Tag::BOOL:
+                    return read<uint8_t>() != 0;
+                case Tag::INT:
+                    return static_cast<int>(read<int32_t>());
+                case Tag::FLOAT:
+                    return read<float>();
+                case Tag::STRING: {
+                    auto length = read<uint32_t>();
+                    size_t offset = position;
+                    std::string_view text = bytes(length);
+
+                    if (mapped != nullptr) {
+                        return mapped->substr(offset, length);
+                    }
+
+                    return std::string{text};
+                }
+                case Tag::BIG_INT: {
+                    bool negative = read<uint8_t>() != 0;
+                    std::vector<uint32_t> digits(readCount(sizeof(uint32_t)));
+                    readInto(digits);
+
+                    return types::normalize(types::BigInt::fromDigits(negative, std::move(digits)));
+                }
+                case Tag::ARRAY: {
+                    auto type = read<uint8_t>();
+                    auto size = readCount(sizeof(int));
+
+                    if (type > static_cast<uint8_t>(types::ElementType::FLOAT)) {
+                        throw std::runtime_error("Snapshot is corrupt");
+                    }
+
+                    if (type == static_cast<uint8_t>(types::ElementType::INT)) {
+                        std::vector<int> values(size);
+                        readInto(values);
+                        objects.emplace_back(types::Array{std::move(values)});
+                    } else {
+                        std::vector<float> values(size);
+                        readInto(values);
+                        objects.emplace_back(types::Array{std::move(values)});
+                    }
+
+                    return objects.back();
+                }
+                case Tag::DICT: {
+                    auto size = readCount(2);
+
+                    // numbered before its entries are read, as save numbers it before writing them
+                    types::Dict dict;
+                    objects.emplace_back(dict);
+
+                    for (uint32_t i = 0; i < size; i++) {
+                        env::VariantType key = readValue();
+                        dict.set(key, readValue());
+                    }
+
+                    return dict;
+                }
+                case Tag::FUNCTION: {
+                    auto body = read<uint32_t>();
+
+                    if (body >= bodies.size()) {
+                        throw std::runtime_error("Snapshot is corrupt");
+                    }
+
+                    std::vector<std::string> parameters(readCount(sizeof(uint32_t)));
+                    for (std::string& parameter : parameters) {
+                        parameter = readString();
+                    }
+
+                    return types::Function{std::move(parameters), bodies[body]};
+                }
+                case Tag::REFERENCE: {
+                    auto index = read<uint32_t>();
+
+                    if (index >= objects.size()) {
+                        throw std::runtime_error("Snapshot is corrupt");
+                    }
+
+                    return objects[index];
+                }
+                default:
+                    throw std::runtime_error("Snapshot is corrupt");
+            }
+        }
+
+    private:
+        std::string_view data;
+        const types::StringSlice* mapped;
+        size_t position;
+
+        std::vector<std::shared_ptr<ast::FunctionBodyNode>> bodies;
+        std::vector<env::VariantType> objects;  // arrays and dictionaries, in the order they were written
+    };
+
+    void restoreFrom(env::Environment& env, std::string_view data, const types::StringSlice* mapped) {
+        Reader reader{data, mapped};
+        reader.readHeader();
+
+        auto count = reader.readCount(sizeof(uint32_t) + 1);
+        std::vector<std::pair<std::string, env::VariantType>> variables;
+
+        // read everything before defining anything, so a truncated snapshot leaves the environment unchanged
+        for (uint32_t i = 0; i < count; i++) {
+            std::string name = reader.readString();
+            variables.emplace_back(std::move(name), reader.readValue());
+        }
+
+        for (auto& [name, value] : variables) {
+            env.define(name, std::move(value));
+        }
+    }
+}
+
+
+std::string snapshot::save(const env::Environment& env) {
+    std::vector<std::string> names = env.names();
+
+    // sorted so the same environment always gives the same snapshot
+    std::sort(names.begin(), names.end());
+
+    Writer writer;
+    uint32_t count = 0;
+
+    for (const std::string& name : names) {
+        const env::VariantType& value = *env.lookup(name);
+
+        if (std::holds_alternative<types::NativeFunction>(value)) {
+            continue;
+        }
+
+        writer.writeString(writer.variables, name);
+        writer.writeValue(value);
+        count++;
+    }
+
+    return writer.finish(count);
+}
+
+void snapshot::saveFile(const env::Environment& env, const std::string& path) {
+    io::writeAll(path, save(env));
+}
+
+void snapshot::restore(env::Environment& env, std::string_view data) {
+    restoreFrom(env, data, nullptr);
+}
+
+void snapshot::restoreFile(env::Environment& env, const std::string& path) {
+    env::VariantType contents = io::readAll(path);
+
+    if (const auto* mapped = std::get_if<types::StringSlice>(&contents)) {
+        restoreFrom(env, mapped->view(), mapped);
+    } else {
+        restoreFrom(env, types::stringView(contents), nullptr);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef SPL_SNAPSHOT_H
+#define SPL_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+
+#include "environment.h"
+
+/**
+ * Binary snapshots of an environment, so a process can start from the state a prelude script left behind instead of
+ * running the prelude again.
+ *
+ * A snapshot holds the variables of one environment (not of its parents): bools, ints, floats, strings, arrays,
+ * dictionaries and functions. Arrays and dictionaries shared between variables are still shared after restoring. A
+ * function is saved with the tokens of its body, which are parsed on its first call
+ * as in the program it came from. Native functions, including those stored in dictionaries, are skipped: the host
+ * registers them again, as it did before running the prelude. Memoization caches (see memo.h) are not saved.
+ *
+ * Snapshots are meant to be restored by the same build on the same machine: numbers are stored in native byte order.
+ */
+namespace snapshot {
+    /**
+     * @return The snapshot of the variables of the environment
+     */
+    std::string save(const env::Environment& env);
+
+    /**
+     * Writes the snapshot of the environment to a file.
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void saveFile(const env::Environment& env, const std::string& path);
+
+    /**
+     * Defines the variables of a snapshot in the environment. Strings are copied out of the snapshot.
+     * @throws std::runtime_error if the data is not a snapshot or is truncated. The environment is left unchanged
+     */
+    void restore(env::Environment& env, std::string_view data);
+
+    /**
+     * Maps a snapshot file and defines its variables in the environment. Strings are slices of the mapped file rather
+     * than copies, so the file stays mapped while any of them is alive.
+     * @throws std::runtime_error if the file cannot be read, is not a snapshot or is truncated. The environment is left
+     * unchanged
+     */
+    void restoreFile(env::Environment& env, const std::string& path);
+}
+
+#endif  // SPL_SNAPSHOT_H
@@ -0,0 +1,223 @@
+#include "environment.h"
+
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+
+namespace {
+    /**
+     * A buffer that owns its characters, for slicing strings that were built in memory.
+     */
+    class OwnedBuffer : public types::StringBuffer {
+    public:
+        explicit OwnedBuffer(std::string text) : text(std::move(text)) {}
+
+        [[nodiscard]] std::string_view view() const override {
+            return text;
+        }
+
+    private:
+        std::string text;
+    };
+
+    /**
+     * Calls the function with every slice in the value and in the dictionaries it holds, until the function returns
+     * false.
+     * @param visited The dictionaries already searched, so each is searched once
+     * @return False if the function stopped the search
+     */
+    bool visitSlices(const env::VariantType& value, const std::function<bool(const types::StringSlice&)>& visit,
+                     std::unordered_set<const void*>& visited) {
+        if (const auto* slice = std::get_if<types::StringSlice>(&value)) {
+            return visit(*slice);
+        }
+
+        const auto* dict = std::get_if<types::Dict>(&value);
+        if (dict == nullptr || !visited.insert(dict->identity()).second) {
+            return true;
+        }
+
+        bool searching = true;
+        dict->forEachValue([&](const env::VariantType& entry) {
+            searching = searching && visitSlices(entry, visit, visited);
+        });
+
+        return searching;
+    }
+
+    /**
+     * Replaces the slices of the buffer in the value, and in the dictionaries it holds, with copies of their characters.
+     */
+    void copySlices(env::VariantType& value, const types::StringBuffer* buffer, std::unordered_set<const void*>& visited) {
+        if (auto* slice = std::get_if<types::StringSlice>(&value)) {
+            if (slice->source().get() == buffer) {
+                value = types::StringSlice::owning(std::string(slice->view()));
+            }
+
+            return;
+        }
+
+        auto* dict = std::get_if<types::Dict>(&value);
+        if (dict != nullptr && visited.insert(dict->identity()).second) {
+            dict->updateValues([&](env::VariantType& entry) {
+                copySlices(entry, buffer, visited);
+            });
+        }
+    }
+}
+
+
+types::StringSlice::StringSlice(std::shared_ptr<const StringBuffer> buffer)
+    : buffer(std::move(buffer)), offset(0), length(this->buffer->view().size()) {}
+
+types::StringSlice::StringSlice(std::shared_ptr<const StringBuffer> buffer, size_t offset, size_t length)
+    : buffer(std::move(buffer)), offset(offset), length(length) {}
+
+types::StringSlice types::StringSlice::owning(std::string text) {
+    return StringSlice{std::make_shared<OwnedBuffer>(std::move(text))};
+}
+
+std::string_view types::StringSlice::view() const {
+    return buffer->view().substr(offset, length);
+}
+
+size_t types::StringSlice::size() const {
+    return length;
+}
+
+types::StringSlice types::StringSlice::substr(size_t position, size_t count) const {
+    if (position > length || count > length - position) {
+        throw std::out_of_range("String slice out of range");
+    }
+
+    return StringSlice{buffer, offset + position, count};
+}
+
+bool types::StringSlice::wastesBuffer() const {
+    size_t bufferSize = buffer->view().size();
+    return buffer.use_count() == 1 && bufferSize >= COMPACT_MIN_BUFFER && length < bufferSize / COMPACT_RATIO;
+}
+
+const std::shared_ptr<const types::StringBuffer>& types::StringSlice::source() const {
+    return buffer;
+}
+
+bool types::StringSlice::operator==(const StringSlice& other) const {
+    return view() == other.view();
+}
+
+bool types::isString(const env::VariantType& value) {
+    return std::holds_alternative<std::string>(value) || std::holds_alternative<StringSlice>(value);
+}
+
+std::string_view types::stringView(const env::VariantType& value) {
+    if (std::holds_alternative<std::string>(value)) {
+        return std::get<std::string>(value);
+    }
+
+    if (std::holds_alternative<StringSlice>(value)) {
+        return std::get<StringSlice>(value).view();
+    }
+
+    throw std::runtime_error("Expected a string");
+}
+
+types::StringSlice types::toSlice(const env::VariantType& value) {
+    if (const auto* slice = std::get_if<StringSlice>(&value)) {
+        return *slice;
+    }
+
+    return StringSlice::owning(std::string(stringView(value)));
+}
+
+void types::share(env::VariantType& value) {
+    auto* text = std::get_if<std::string>(&value);
+
+    if (text != nullptr && text->size() >= StringSlice::SHARE_MIN) {
+        value = StringSlice::owning(std::move(*text));
+    }
+}
+
+void types::compact(env::VariantType& value) {
+    auto* slice = std::get_if<StringSlice>(&value);
+
+    if (slice != nullptr && slice->wastesBuffer()) {
+        value = StringSlice::owning(std::string(slice->view()));
+    }
+}
+
+std::vector<std::shared_ptr<const types::StringBuffer>> types::heldBuffers(const env::VariantType& value) {
+    std::vector<std::shared_ptr<const StringBuffer>> held;
+
+    // a dictionary that is still used elsewhere keeps holding its slices
+    const auto* dict = std::get_if<Dict>(&value);
+    if (!std::holds_alternative<StringSlice>(value) && (dict == nullptr || !dict->isLastReference())) {
+        return held;
+    }
+
+    std::unordered_map<const StringBuffer*, size_t> covered;
+    std::unordered_set<const void*> visited;
+
+    visitSlices(value, [&](const StringSlice& slice) {
+        size_t bufferSize = slice.source()->view().size();
+
+        if (bufferSize >= StringSlice::COMPACT_MIN_BUFFER) {
+            size_t& length = covered[slice.source().get()];
+            if (length < bufferSize / StringSlice::COMPACT_RATIO && length + slice.size() >= bufferSize / StringSlice::COMPACT_RATIO) {
+                held.push_back(slice.source());
+            }
+
+            length += slice.size();
+        }
+
+        return true;
+    }, visited);
+
+    return held;
+}
+
+void types::compactSlices(std::vector<std::shared_ptr<const StringBuffer>> buffers, const std::vector<env::VariantType*>& stored) {
+    for (std::shared_ptr<const StringBuffer>& buffer : buffers) {
+        // besides this reference, every use of the buffer must be one of the slices found
+        size_t uses = buffer.use_count() - 1;
+        size_t limit = buffer->view().size() / StringSlice::COMPACT_RATIO;
+        size_t found = 0;
+        size_t length = 0;
+
+        auto count = [&](const StringSlice& slice) {
+            if (slice.source() == buffer) {
+                found++;
+                length += slice.size();
+            }
+
+            return found <= uses && length < limit;
+        };
+
+        // variables first, since a variable holding most of the buffer ends the search before any dictionary is read
+        bool wasteful = uses > 0;
+        for (size_t i = 0; i < stored.size() && wasteful; i++) {
+            if (const auto* slice = std::get_if<StringSlice>(stored[i])) {
+                wasteful = count(*slice);
+            }
+        }
+
+        std::unordered_set<const void*> visited;
+        for (size_t i = 0; i < stored.size() && wasteful; i++) {
+            if (std::holds_alternative<Dict>(*stored[i])) {
+                wasteful = visitSlices(*stored[i], count, visited);
+            }
+        }
+
+        if (!wasteful || found != uses) {
+            continue;
+        }
+
+        visited.clear();
+        for (env::VariantType* value : stored) {
+            copySlices(*value, buffer.get(), visited);
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef SPL_STRING_SLICE_H
+#define SPL_STRING_SLICE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// This header is included by environment.h after env::VariantType is declared
+
+namespace types {
+    /**
+     * Immutable character storage that string slices point into. The storage is released when the last slice
+     * referencing it goes away.
+     */
+    class StringBuffer {
+    public:
+        virtual ~StringBuffer() = default;
+
+        [[nodiscard]] virtual std::string_view view() const = 0;
+    };
+
+    /**
+     * A read-only string that points into a shared StringBuffer (e.g., a memory-mapped file) instead of owning its
+     * characters. Scripts can use slices anywhere they can use strings.
+     */
+    class StringSlice {
+    public:
+        /**
+         * A slice that is the last reference to a buffer at least this large, and covers less than
+         * 1 / COMPACT_RATIO of it, is worth copying out so the buffer can be freed (see compact).
+         */
+        static constexpr size_t COMPACT_MIN_BUFFER = 4096;
+        static constexpr size_t COMPACT_RATIO = 4;
+
+        /**
+         * A std::string at least this long is stored as a slice of a buffer of its own (see share), so reading it
+         * doesn't copy it.
+         */
+        static constexpr size_t SHARE_MIN = 4096;
+
+        explicit StringSlice(std::shared_ptr<const StringBuffer> buffer);
+        StringSlice(std::shared_ptr<const StringBuffer> buffer, size_t offset, size_t length);
+
+        /**
+         * @return A slice of the whole text, which is moved into a buffer of its own
+         */
+        static StringSlice owning(std::string text);
+
+        [[nodiscard]] std::string_view view() const;
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @return A slice of part of this slice, sharing the same buffer
+         * @throws std::out_of_range if the part is not inside this slice
+         */
+        [[nodiscard]] StringSlice substr(size_t position, size_t count) const;
+
+        /**
+         * @return True if this slice is the only reference to its buffer, and the buffer is much larger than the slice
+         * (see COMPACT_MIN_BUFFER)
+         */
+        [[nodiscard]] bool wastesBuffer() const;
+
+        /**
+         * @return The buffer the slice points into
+         */
+        [[nodiscard]] const std::shared_ptr<const StringBuffer>& source() const;
+
+        /**
+         * Slices compare by their characters, like strings do.
+         */
+        bool operator==(const StringSlice& other) const;
+
+    private:
+        std::shared_ptr<const StringBuffer> buffer;
+        size_t offset;
+        size_t length;
+    };
+
+    /**
+     * @return True if the value is a std::string or a StringSlice
+     */
+    [[nodiscard]] bool isString(const env::VariantType& value);
+
+    /**
+     * @throws std::runtime_error if the value is not a std::string or a StringSlice
+     * @return The characters of the string or slice. Valid for as long as the value is
+     */
+    [[nodiscard]] std::string_view stringView(const env::VariantType& value);
+
+    /**
+     * @return The value as a slice: a slice is returned as it is, in constant time, and a std::string is copied into a
+     * new buffer, in linear time. Long strings are already slices once they are stored (see share)
+     * @throws std::runtime_error if the value is not a std::string or a StringSlice
+     */
+    [[nodiscard]] StringSlice toSlice(const env::VariantType& value);
+
+    /**
+     * Moves a std::string of at least StringSlice::SHARE_MIN characters into a buffer of its own and replaces it with a
+     * slice of the buffer. Called where values are stored, so reading a long string from a variable or dictionary,
+     * and slicing it, take constant time instead of copying it every time. Other values are left as they are.
+     */
+    void share(env::VariantType& value);
+
+    /**
+     * Replaces a slice that wastes its buffer (see StringSlice::wastesBuffer) with a copy of its characters, so the
+     * buffer is freed. Called where values are stored, so a short slice of a large file doesn't keep the whole file in
+     * memory once nothing else uses it. Other values are left as they are.
+     */
+    void compact(env::VariantType& value);
+
+    /**
+     * @return The buffers of at least COMPACT_MIN_BUFFER bytes that the slices in the value (or in the dictionaries it
+     * holds, if it is the last reference to them) cover at least 1 / COMPACT_RATIO of. Releasing such a value may
+     * leave the buffer to slices that waste it (see compactSlices)
+     */
+    [[nodiscard]] std::vector<std::shared_ptr<const StringBuffer>> heldBuffers(const env::VariantType& value);
+
+    /**
+     * Called after a value holding large parts of the buffers (see heldBuffers) was overwritten or removed. A buffer
+     * that is now only used by slices stored in the given values, which together cover less than 1 / COMPACT_RATIO of
+     * it, is freed by replacing those slices with copies of their characters. Dictionaries in the values are searched
+     * too. Returns early once a buffer is seen to be used by more than that.
+     * @param buffers The buffers, which are released by this function
+     * @param stored Where the other slices of the buffers may be, e.g., every variable the script can still reach
+     */
+    void compactSlices(std::vector<std::shared_ptr<const StringBuffer>> buffers, const std::vector<env::VariantType*>& stored);
+}
+
+#endif  // SPL_STRING_SLICE_H
@@ -4,10 +4,53 @@
 #include <utility>
 #include <string>
 #include <cctype>
+#include <unordered_map>
 
 #include "ast.h"
 
 
+namespace {
+    const std::unordered_map<std::string, token::TokenType> simpleTokens = {
+            {"(", token::TokenType::OPEN_PAREN},
+            {")", token::TokenType::CLOSE_PAREN},
+            {"{", token::TokenType::OPEN_BRACE},
+            {"}", token::TokenType::CLOSE_BRACE},
+            {"[", token::TokenType::OPEN_BRACKET},
+            {"]", token::TokenType::CLOSE_BRACKET},
+            {"=", token::TokenType::OPERATOR_DEFINE},
+            {"+", token::TokenType::OPERATOR_ADD},
+            {"-", token::TokenType::OPERATOR_SUB},
+            {"*", token::TokenType::OPERATOR_MUL},
+            {"/", token::TokenType::OPERATOR_DIV},
+            {",", token::TokenType::SEPARATOR},
+            {";", token::TokenType::SEMICOLON},
+            {":", token::TokenType::COLON},
+            {"..", token::TokenType::RANGE},
+            {"==", token::TokenType::OPERATOR_EQ},
+            {"+=", token::TokenType::OPERATOR_ADD_ASSIGN},
+            {"-=", token::TokenType::OPERATOR_SUB_ASSIGN},
+            {"*=", token::TokenType::OPERATOR_MUL_ASSIGN},
+            {"!=", token::TokenType::OPERATOR_NOT_EQ},
+            {"&&", token::TokenType::OPERATOR_BOOL_AND},
+            {"||", token::TokenType::OPERATOR_BOOL_OR},
+            {"!", token::TokenType::OPERATOR_UNARY_NOT},
+            {"true", token::TokenType::LITERAL_BOOL},
+            {"false", token::TokenType::LITERAL_BOOL},
+            {"if", token::TokenType::IF_STATEMENT},
+            {"elif", token::TokenType::ELIF_STATEMENT},
+            {"else", token::TokenType::ELSE_STATEMENT},
+            {"while", token::TokenType::WHILE},
+            {"continue", token::TokenType::CONTINUE},
+            {"break", token::TokenType::BREAK},
+            {"%", token::TokenType::OPERATOR_MOD},
+            {"<", token::TokenType::OPERATOR_LESS},
+            {">", token::TokenType::OPERATOR_GREATER},
+            {"<=", token::TokenType::OPERATOR_LESS_EQ},
+            {">=", token::TokenType::OPERATOR_GREATER_EQ}
+    };
+}
+
+
 token::Token::Token(TokenType type, std::string value, size_t line, size_t column)
     : tokenType(type), tokenValue(std::move(value)), lineAt(line), columnAt(column) {}
 
@@ -28,24 +71,12 @@ size_t token::Token::column() const {
 }
 
 
-/**
- *
- * @return
- */
 int token::Token::precedence() const {
-    if (operatorPrecedenceMap.find(tokenType) == operatorPrecedenceMap.end()) {
-        return -1;
-    }
-
-    return operatorPrecedenceMap.at(tokenType);;
+    return operatorInfo(tokenType).precedence;
 }
 
 token::Associativity token::Token::associativity() const {
-    if (operatorAssociativityMap.find(tokenType) == operatorAssociativityMap.end()) {
-        return Associativity::NOT_APPLICABLE;
-    }
-
-    return operatorAssociativityMap.at(tokenType);
+    return operatorInfo(tokenType).associativity;
 }
 
 token::Token::Token() {
@@ -56,8 +87,8 @@ token::Token::Token() {
 }
 
 
-token::Tokenizer::Tokenizer(const std::string& input) {
-    tokens = tokenize(input);
+token::Tokenizer::Tokenizer(std::string_view input, size_t firstLine, size_t firstColumn) {
+    tokens = tokenize(input, firstLine, firstColumn);
 }
 
 
@@ -72,6 +103,10 @@ void token::Tokenizer::processComplexToken(
         tokens.emplace_back(TokenType::FUNCTION_DEF, buffer, line, column);
     } else if (buffer == "return") {
         tokens.emplace_back(TokenType::RETURN, buffer, line, column);
+    } else if (buffer == "for") {
+        tokens.emplace_back(TokenType::FOR, buffer, line, column);
+    } else if (buffer == "in") {
+        tokens.emplace_back(TokenType::IN, buffer, line, column);
     } else if (std::isalpha(buffer[0])) {
         tokens.emplace_back(TokenType::IDENTIFIER, buffer, line, column);
     } else if (buffer[0] == '"') {
@@ -102,13 +137,13 @@ void token::Tokenizer::processComplexToken(
 
 
 
-std::vector<token::Token> token::Tokenizer::tokenize(const std::string& input) {
+std::vector<token::Token> token::Tokenizer::tokenize(std::string_view input, size_t firstLine, size_t firstColumn) {
     std::vector<Token> tokens;
     std::string buffer;
-    size_t line = 1;
-    size_t col = 0;  // set to 0 because the loops increments immediately
+    size_t line = firstLine;
+    size_t col = firstColumn;  // 0 at the start of a line, because the loop increments immediately
 
-    for (int i = 0; i < input.size(); i++) {
+    for (size_t i = 0; i < input.size(); i++) {
         char ch = input[i];
         col++;
 
@@ -127,8 +162,10 @@ std::vector<token::Token> token::Tokenizer::tokenize(const std::string& input) {
         // 3rd condition: this is not an unclosed string literal (i.e., !(buffer[0] == '"' && buffer[buffer.length() - 1] != '"'))
         bool isSpace = std::isspace(ch);
         bool complexToSimple = !buffer.empty() && !simpleTokens.count(buffer) && simpleTokens.count(std::string(1, ch));
+        // "0..10" is a range, not the float "0." followed by ".10"
+        bool startsRange = !buffer.empty() && buffer != "." && ch == '.' && i + 1 < input.size() && input[i + 1] == '.';
         bool notUnclosedString = !(buffer[0] == '"' && buffer[buffer.length() - 1] != '"');
-        if ((isSpace || complexToSimple) && notUnclosedString) {
+        if ((isSpace || complexToSimple || startsRange) && notUnclosedString) {
             processComplexToken(buffer, tokens, line, col);
 
             if (isSpace) {
@@ -166,3 +203,29 @@ token::FunctionCallToken::FunctionCallToken(const std::string& functionName, siz
 std::vector<std::shared_ptr<ast::ExpressionNode>> token::FunctionCallToken::arguments() const {
     return functionArguments;
 }
+
+token::ArrayLiteralToken::ArrayLiteralToken(size_t line, size_t column,
+                                            std::vector<std::shared_ptr<ast::ExpressionNode>> elements)
+        : Token(TokenType::ARRAY_LITERAL, "", line, column), arrayElements(std::move(elements)) {
+}
+
+std::vector<std::shared_ptr<ast::ExpressionNode>> token::ArrayLiteralToken::elements() const {
+    return arrayElements;
+}
+
+token::DictLiteralToken::DictLiteralToken(size_t line, size_t column, std::vector<Entry> entries)
+        : Token(TokenType::DICT_LITERAL, "", line, column), dictEntries(std::move(entries)) {
+}
+
+std::vector<token::DictLiteralToken::Entry> token::DictLiteralToken::entries() const {
+    return dictEntries;
+}
+
+token::IndexToken::IndexToken(const std::string& identifier, size_t line, size_t column,
+                              std::shared_ptr<ast::ExpressionNode> index)
+        : Token(TokenType::INDEX, identifier, line, column), indexExpression(std::move(index)) {
+}
+
+std::shared_ptr<ast::ExpressionNode> token::IndexToken::index() const {
+    return indexExpression;
+}
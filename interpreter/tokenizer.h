@@ -1,10 +1,11 @@
 #ifndef SPL_TOKENIZER_H
 #define SPL_TOKENIZER_H
 
+#include <array>
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
 #include <memory>
 
 namespace ast {
@@ -20,11 +21,14 @@ namespace token {
         CLOSE_PAREN,
         OPEN_BRACE,
         CLOSE_BRACE,
+        OPEN_BRACKET,
+        CLOSE_BRACKET,
         LITERAL_INT,
         LITERAL_BOOL,
         LITERAL_FLOAT,
         LITERAL_STRING,
         SEMICOLON,
+        COLON,
         OPERATOR_DEFINE,
         OPERATOR_ADD,
         OPERATOR_SUB,
@@ -40,16 +44,25 @@ namespace token {
         OPERATOR_BOOL_OR,
         OPERATOR_UNARY_NOT,
         OPERATOR_EQ,
+        OPERATOR_ADD_ASSIGN,
+        OPERATOR_SUB_ASSIGN,
+        OPERATOR_MUL_ASSIGN,
         FUNCTION_DEF,
         FUNCTION_CALL,
+        ARRAY_LITERAL,
+        DICT_LITERAL,
+        INDEX,
         RETURN,
         SEPARATOR,
         IF_STATEMENT,
         ELIF_STATEMENT,
         ELSE_STATEMENT,
         WHILE,
+        FOR,
+        IN,
+        RANGE,
         CONTINUE,
-        BREAK
+        BREAK  // keep last: TOKEN_TYPE_COUNT is derived from it
     };
 
     /**
@@ -61,73 +74,55 @@ namespace token {
         NOT_APPLICABLE
     };
 
-    const std::unordered_map<TokenType, int> operatorPrecedenceMap = {
-            {TokenType::OPERATOR_DEFINE,     1},   // Assignment has lowest precedence
-            {TokenType::OPERATOR_BOOL_OR,    2},   // Logical OR
-            {TokenType::OPERATOR_BOOL_AND,   3},   // Logical AND
-            {TokenType::OPERATOR_EQ,         4},   // Equality checks
-            {TokenType::OPERATOR_NOT_EQ,     4},
-            {TokenType::OPERATOR_LESS,       5},   // Relational (>, <, >=, <=)
-            {TokenType::OPERATOR_LESS_EQ,    5},
-            {TokenType::OPERATOR_GREATER,    5},
-            {TokenType::OPERATOR_GREATER_EQ, 5},
-            {TokenType::OPERATOR_ADD,        6},   // Addition/Subtraction
-            {TokenType::OPERATOR_SUB,        6},
-            {TokenType::OPERATOR_MUL,        7},   // Multiplication/Division/Modulus
-            {TokenType::OPERATOR_DIV,        7},
-            {TokenType::OPERATOR_MOD,        7},
-            {TokenType::OPERATOR_UNARY_NOT,  8}    // Unary NOT (higher precedence than relational and arithmetic)
+    /**
+     * The precedence and associativity of an operator. Tokens that are not operators have a precedence of -1 and an
+     * associativity of NOT_APPLICABLE.
+     */
+    struct OperatorInfo {
+        int precedence;
+        Associativity associativity;
     };
 
-    const std::unordered_map<TokenType, Associativity> operatorAssociativityMap = {
-            {TokenType::OPERATOR_DEFINE,     Associativity::RIGHT},
-            {TokenType::OPERATOR_ADD,        Associativity::LEFT},
-            {TokenType::OPERATOR_SUB,        Associativity::LEFT},
-            {TokenType::OPERATOR_MUL,        Associativity::LEFT},
-            {TokenType::OPERATOR_DIV,        Associativity::LEFT},
-            {TokenType::OPERATOR_BOOL_AND,   Associativity::LEFT},
-            {TokenType::OPERATOR_BOOL_OR,    Associativity::LEFT},
-            {TokenType::OPERATOR_UNARY_NOT,  Associativity::RIGHT},
-            {TokenType::OPERATOR_EQ,         Associativity::LEFT},
-            {TokenType::OPERATOR_NOT_EQ,     Associativity::LEFT},
-            {TokenType::OPERATOR_LESS,       Associativity::LEFT},
-            {TokenType::OPERATOR_LESS_EQ,    Associativity::LEFT},
-            {TokenType::OPERATOR_GREATER,    Associativity::LEFT},
-            {TokenType::OPERATOR_GREATER_EQ, Associativity::LEFT},
-            {TokenType::OPERATOR_MOD,        Associativity::LEFT}
-    };
+    constexpr size_t TOKEN_TYPE_COUNT = static_cast<size_t>(TokenType::BREAK) + 1;
+
+    constexpr std::array<OperatorInfo, TOKEN_TYPE_COUNT> makeOperatorTable() {
+        std::array<OperatorInfo, TOKEN_TYPE_COUNT> table{};
+
+        for (OperatorInfo& info : table) {
+            info = {-1, Associativity::NOT_APPLICABLE};
+        }
+
+        auto set = [&table](TokenType type, int precedence, Associativity associativity) {
+            table[static_cast<size_t>(type)] = {precedence, associativity};
+        };
+
+        set(TokenType::OPERATOR_DEFINE,     1, Associativity::RIGHT);  // Assignment has lowest precedence
+        set(TokenType::OPERATOR_BOOL_OR,    2, Associativity::LEFT);   // Logical OR
+        set(TokenType::OPERATOR_BOOL_AND,   3, Associativity::LEFT);   // Logical AND
+        set(TokenType::OPERATOR_EQ,         4, Associativity::LEFT);   // Equality checks
+        set(TokenType::OPERATOR_NOT_EQ,     4, Associativity::LEFT);
+        set(TokenType::OPERATOR_LESS,       5, Associativity::LEFT);   // Relational (>, <, >=, <=)
+        set(TokenType::OPERATOR_LESS_EQ,    5, Associativity::LEFT);
+        set(TokenType::OPERATOR_GREATER,    5, Associativity::LEFT);
+        set(TokenType::OPERATOR_GREATER_EQ, 5, Associativity::LEFT);
+        set(TokenType::OPERATOR_ADD,        6, Associativity::LEFT);   // Addition/Subtraction
+        set(TokenType::OPERATOR_SUB,        6, Associativity::LEFT);
+        set(TokenType::OPERATOR_MUL,        7, Associativity::LEFT);   // Multiplication/Division/Modulus
+        set(TokenType::OPERATOR_DIV,        7, Associativity::LEFT);
+        set(TokenType::OPERATOR_MOD,        7, Associativity::LEFT);
+        set(TokenType::OPERATOR_UNARY_NOT,  8, Associativity::RIGHT);  // Unary NOT (higher precedence than relational and arithmetic)
+
+        return table;
+    }
 
-    const std::unordered_map<std::string, TokenType> simpleTokens = {
-            {"(", TokenType::OPEN_PAREN},
-            {")", TokenType::CLOSE_PAREN},
-            {"{", TokenType::OPEN_BRACE},
-            {"}", TokenType::CLOSE_BRACE},
-            {"=", TokenType::OPERATOR_DEFINE},
-            {"+", TokenType::OPERATOR_ADD},
-            {"-", TokenType::OPERATOR_SUB},
-            {"*", TokenType::OPERATOR_MUL},
-            {"/", TokenType::OPERATOR_DIV},
-            {",", TokenType::SEPARATOR},
-            {";", TokenType::SEMICOLON},
-            {"==", TokenType::OPERATOR_EQ},
-            {"!=", TokenType::OPERATOR_NOT_EQ},
-            {"&&", TokenType::OPERATOR_BOOL_AND},
-            {"||", TokenType::OPERATOR_BOOL_OR},
-            {"!", TokenType::OPERATOR_UNARY_NOT},
-            {"true", TokenType::LITERAL_BOOL},
-            {"false", TokenType::LITERAL_BOOL},
-            {"if", TokenType::IF_STATEMENT},
-            {"elif", TokenType::ELIF_STATEMENT},
-            {"else", TokenType::ELSE_STATEMENT},
-            {"while", TokenType::WHILE},
-            {"continue", TokenType::CONTINUE},
-            {"break", TokenType::BREAK},
-            {"%", TokenType::OPERATOR_MOD},
-            {"<", TokenType::OPERATOR_LESS},
-            {">", TokenType::OPERATOR_GREATER},
-            {"<=", TokenType::OPERATOR_LESS_EQ},
-            {">=", TokenType::OPERATOR_GREATER_EQ}
-    };
+    /**
+     * Operator metadata indexed by TokenType, so the expression parser looks it up without hashing.
+     */
+    inline constexpr std::array<OperatorInfo, TOKEN_TYPE_COUNT> operatorTable = makeOperatorTable();
+
+    constexpr OperatorInfo operatorInfo(TokenType type) {
+        return operatorTable[static_cast<size_t>(type)];
+    }
 
     class Token {
     public:
@@ -161,8 +156,7 @@ namespace token {
     };
 
     /**
-     * A special "pseudo-token" for function calls. This token is used to represent a function call so it can be
-     * passed to the Shunting Yard Parser.
+     * A special "pseudo-token" for function calls. Holds the already-parsed argument expressions.
      */
     class FunctionCallToken : public Token {
     public:
@@ -177,9 +171,63 @@ namespace token {
         std::vector<std::shared_ptr<ast::ExpressionNode>> functionArguments;
     };
 
+    /**
+     * A pseudo-token for array literals (e.g., [1, 2, 3]). Holds the already-parsed element expressions.
+     */
+    class ArrayLiteralToken : public Token {
+    public:
+        ArrayLiteralToken(size_t line, size_t column, std::vector<std::shared_ptr<ast::ExpressionNode>> elements);
+
+        ~ArrayLiteralToken() override = default;
+
+        [[nodiscard]] std::vector<std::shared_ptr<ast::ExpressionNode>> elements() const;
+
+    private:
+        std::vector<std::shared_ptr<ast::ExpressionNode>> arrayElements;
+    };
+
+    /**
+     * A pseudo-token for dictionary literals (e.g., {"a": 1, 2: "b"}). Holds the already-parsed key and value
+     * expressions, in source order.
+     */
+    class DictLiteralToken : public Token {
+    public:
+        using Entry = std::pair<std::shared_ptr<ast::ExpressionNode>, std::shared_ptr<ast::ExpressionNode>>;
+
+        DictLiteralToken(size_t line, size_t column, std::vector<Entry> entries);
+
+        ~DictLiteralToken() override = default;
+
+        [[nodiscard]] std::vector<Entry> entries() const;
+
+    private:
+        std::vector<Entry> dictEntries;
+    };
+
+    /**
+     * A pseudo-token for indexing into an array or dictionary variable (e.g., values[i + 1]). The value of the token is the name of the
+     * variable being indexed.
+     */
+    class IndexToken : public Token {
+    public:
+        IndexToken(const std::string& identifier, size_t line, size_t column, std::shared_ptr<ast::ExpressionNode> index);
+
+        ~IndexToken() override = default;
+
+        [[nodiscard]] std::shared_ptr<ast::ExpressionNode> index() const;
+
+    private:
+        std::shared_ptr<ast::ExpressionNode> indexExpression;
+    };
+
     class Tokenizer {
     public:
-        explicit Tokenizer(const std::string& input);
+        /**
+         * @param input The source code
+         * @param firstLine The line number of the first line of the input, for tokenizing part of a larger source
+         * @param firstColumn The number of characters before the input on its first line
+         */
+        explicit Tokenizer(std::string_view input, size_t firstLine = 1, size_t firstColumn = 0);
 
         [[nodiscard]] std::vector<Token> getTokens() const;
 
@@ -196,7 +244,7 @@ namespace token {
          * @param column The column number of the token.
          */
         static void processComplexToken(std::string& buffer, std::vector<Token>& tokens, size_t line, size_t column);
-        static std::vector<Token> tokenize(const std::string& input);
+        static std::vector<Token> tokenize(std::string_view input, size_t firstLine, size_t firstColumn);
     };
 }
 
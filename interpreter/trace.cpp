@@ -0,0 +1,355 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+std::atomic<bool> trace::detail::active{false};
+thread_local trace::detail::Buffer* trace::detail::current = nullptr;
+
+namespace {
+    constexpr char MAGIC[8] = {'S', 'P', 'L', 'T', 'R', 'A', 'C', 'E'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t RECORD_BYTES = sizeof(uint8_t) + 2 * sizeof(int32_t);
+
+    std::atomic<size_t> capacity{4096};
+
+    // buffers are never freed, so a signal handler can read them at any time
+    std::atomic<trace::detail::Buffer*> buffers[trace::MAX_THREADS];
+    std::atomic<size_t> claimed{0};
+
+    thread_local bool refused = false;  // all buffers were taken when this thread first recorded
+
+    char signalPath[4096];
+
+    /**
+     * Hands the thread's buffer back when the thread exits, so a new thread can reuse it.
+     */
+    struct Owner {
+        ~Owner() {
+            if (trace::detail::current != nullptr) {
+                trace::detail::current->owned.store(false, std::memory_order_release);
+                trace::detail::current = nullptr;
+            }
+        }
+    };
+
+    thread_local Owner owner;
+
+    /**
+     * Writes to a file descriptor through a fixed buffer on the stack.
+     */
+    class FileSink {
+    public:
+        explicit FileSink(int fd) : fd(fd), used(0), failed(false) {}
+
+        void put(const void* data, size_t size) {
+            if (size > sizeof(pending) - used) {
+                flush();
+            }
+
+            std::memcpy(pending + used, data, size);
+            used += size;
+        }
+
+        bool flush() {
+            size_t written = 0;
+
+            while (!failed && written < used) {
+                ssize_t result = ::write(fd, pending + written, used - written);
+
+                if (result < 0 && errno != EINTR) {
+                    failed = true;
+                } else if (result > 0) {
+                    written += static_cast<size_t>(result);
+                }
+            }
+
+            used = 0;
+            return !failed;
+        }
+
+    private:
+        int fd;
+        char pending[4096];
+        size_t used;
+        bool failed;
+    };
+
+    class StringSink {
+    public:
+        void put(const void* data, size_t size) {
+            output.append(static_cast<const char*>(data), size);
+        }
+
+        std::string output;
+    };
+
+    template<typename Sink, typename T>
+    void put(Sink& sink, T value) {
+        sink.put(&value, sizeof(value));
+    }
+
+    template<typename Sink>
+    void serialize(Sink& sink) {
+        size_t count = std::min(claimed.load(std::memory_order_acquire), trace::MAX_THREADS);
+        uint32_t threads = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            threads += buffers[i].load(std::memory_order_acquire) != nullptr;
+        }
+
+        sink.put(MAGIC, sizeof(MAGIC));
+        put(sink, VERSION);
+        put(sink, threads);
+
+        for (size_t i = 0; i < count; i++) {
+            trace::detail::Buffer* buffer = buffers[i].load(std::memory_order_acquire);
+
+            if (buffer == nullptr) {
+                continue;
+            }
+
+            uint64_t recorded = buffer->next.load(std::memory_order_acquire);
+            uint64_t kept = std::min(recorded, buffer->mask + 1);
+
+            put(sink, buffer->index);
+            put(sink, recorded);
+            put(sink, kept);
+
+            for (uint64_t sequence = recorded - kept; sequence < recorded; sequence++) {
+                const trace::Record& record = buffer->records[sequence & buffer->mask];
+
+                put(sink, static_cast<uint8_t>(record.event));
+                put(sink, record.line);
+                put(sink, record.column);
+            }
+        }
+    }
+
+    void dumpToSignalPath(int) {
+        int fd = ::open(signalPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (fd >= 0) {
+            trace::dump(fd);
+            ::close(fd);
+        }
+    }
+
+    class Reader {
+    public:
+        explicit Reader(std::string_view data) : data(data), position(0) {}
+
+        template<typename T>
+        T read() {
+            if (sizeof(T) > data.size() - position) {
+                throw std::runtime_error("Trace is truncated");
+            }
+
+            T value;
+            std::memcpy(&value, data.data() + position, sizeof(T));
+            position += sizeof(T);
+            return value;
+        }
+
+        [[nodiscard]] size_t remaining() const {
+            return data.size() - position;
+        }
+
+    private:
+        std::string_view data;
+        size_t position;
+    };
+}
+
+
+trace::detail::Buffer* trace::detail::claim() {
+    if (refused) {
+        return nullptr;
+    }
+
+    // touching the owner registers its destructor for this thread
+    (void) &owner;
+
+    size_t count = std::min(claimed.load(std::memory_order_acquire), MAX_THREADS);
+
+    for (size_t i = 0; i < count; i++) {
+        Buffer* buffer = buffers[i].load(std::memory_order_acquire);
+        bool free = false;
+
+        if (buffer != nullptr && buffer->owned.compare_exchange_strong(free, true, std::memory_order_acq_rel)) {
+            current = buffer;
+            return buffer;
+        }
+    }
+
+    size_t slot = claimed.fetch_add(1, std::memory_order_acq_rel);
+
+    if (slot >= MAX_THREADS) {
+        refused = true;
+        return nullptr;
+    }
+
+    size_t size = capacity.load(std::memory_order_relaxed);
+
+    auto* buffer = new Buffer;
+    buffer->index = static_cast<uint32_t>(slot);
+    buffer->mask = size - 1;
+    buffer->records = std::make_unique<Record[]>(size);
+
+    buffers[slot].store(buffer, std::memory_order_release);
+    current = buffer;
+
+    return buffer;
+}
+
+void trace::enable(size_t eventsPerThread) {
+    size_t size = 1;
+    while (size < eventsPerThread) {
+        size *= 2;
+    }
+
+    capacity.store(size, std::memory_order_relaxed);
+    detail::active.store(true, std::memory_order_relaxed);
+}
+
+void trace::disable() {
+    detail::active.store(false, std::memory_order_relaxed);
+}
+
+void trace::clear() {
+    size_t count = std::min(claimed.load(std::memory_order_acquire), MAX_THREADS);
+
+    for (size_t i = 0; i < count; i++) {
+        if (detail::Buffer* buffer = buffers[i].load(std::memory_order_acquire)) {
+            buffer->next.store(0, std::memory_order_release);
+        }
+    }
+}
+
+std::string trace::save() {
+    StringSink sink;
+    serialize(sink);
+
+    return std::move(sink.output);
+}
+
+void trace::saveFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + " to write the trace");
+    }
+
+    bool written = dump(fd);
+    ::close(fd);
+
+    if (!written) {
+        throw std::runtime_error("Could not write the trace to " + path);
+    }
+}
+
+bool trace::dump(int fd) {
+    FileSink sink{fd};
+    serialize(sink);
+
+    return sink.flush();
+}
+
+void trace::dumpOnSignal(int signal, const std::string& path) {
+    if (path.size() >= sizeof(signalPath)) {
+        throw std::runtime_error("The trace path is too long");
+    }
+
+    std::memcpy(signalPath, path.c_str(), path.size() + 1);
+
+    struct sigaction action {};
+    action.sa_handler = dumpToSignalPath;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(signal, &action, nullptr) != 0) {
+        throw std::runtime_error("Could not install the trace signal handler");
+    }
+}
+
+std::vector<trace::Thread> trace::decode(std::string_view data) {
+    if (data.size() < sizeof(MAGIC) || data.compare(0, sizeof(MAGIC), std::string_view{MAGIC, sizeof(MAGIC)}) != 0) {
+        throw std::runtime_error("Not a trace");
+    }
+
+    Reader reader{data.substr(sizeof(MAGIC))};
+
+    if (reader.read<uint32_t>() != VERSION) {
+        throw std::runtime_error("Unsupported trace version");
+    }
+
+    auto count = reader.read<uint32_t>();
+    std::vector<Thread> threads;
+
+    for (uint32_t i = 0; i < count; i++) {
+        Thread thread;
+        thread.index = reader.read<uint32_t>();
+        thread.recorded = reader.read<uint64_t>();
+
+        auto kept = reader.read<uint64_t>();
+        if (kept > reader.remaining() / RECORD_BYTES) {
+            throw std::runtime_error("Trace is truncated");
+        }
+
+        thread.records.reserve(kept);
+
+        for (uint64_t j = 0; j < kept; j++) {
+            auto event = reader.read<uint8_t>();
+            if (event > static_cast<uint8_t>(Event::ERROR)) {
+                throw std::runtime_error("Unknown event in trace");
+            }
+
+            auto line = reader.read<int32_t>();
+            auto column = reader.read<int32_t>();
+            thread.records.push_back(Record{static_cast<Event>(event), line, column});
+        }
+
+        threads.push_back(std::move(thread));
+    }
+
+    return threads;
+}
+
+std::string trace::format(const std::vector<Thread>& threads) {
+    std::string text;
+
+    for (const Thread& thread : threads) {
+        text += "thread " + std::to_string(thread.index) + ": last " + std::to_string(thread.records.size()) + " of "
+                + std::to_string(thread.recorded) + " events\n";
+
+        for (const Record& record : thread.records) {
+            text += "  ";
+            text += name(record.event);
+            text += " at line " + std::to_string(record.line) + ", column " + std::to_string(record.column) + "\n";
+        }
+    }
+
+    return text;
+}
+
+const char* trace::name(Event event) {
+    switch (event) {
+        case Event::STATEMENT:
+            return "statement";
+        case Event::CALL:
+            return "call";
+        case Event::RETURN:
+            return "return";
+        case Event::ITERATION:
+            return "iteration";
+        default:
+            return "error";
+    }
+}
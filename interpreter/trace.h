@@ -0,0 +1,153 @@
+#ifndef SPL_TRACE_H
+#define SPL_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * An opt-in flight recorder of what scripts were doing, for finding out what led up to a failure without adding prints.
+ *
+ * While tracing is enabled, the interpreter records an event for every statement it runs, every function call and
+ * return, every loop iteration and every error a statement throws. Each thread writes into its own ring buffer, which
+ * keeps only the most recent events, so recording takes no locks and the memory used stays fixed. An error is recorded
+ * once for each statement it unwinds through, innermost first.
+ *
+ * The buffers can be written out at any time with save or dump, from a signal handler (see dumpOnSignal), or when a
+ * script throws (see RunOptions::traceOnError), and read back with decode. tools/spl_trace.cpp prints a saved trace.
+ * Events still being written while a trace is saved from another thread may be saved half-written.
+ */
+namespace trace {
+    enum class Event : uint8_t {
+        STATEMENT,
+        CALL,
+        RETURN,
+        ITERATION,
+        ERROR
+    };
+
+    struct Record {
+        Event event;
+        int32_t line;
+        int32_t column;
+    };
+
+    /**
+     * The events one thread recorded, oldest first.
+     */
+    struct Thread {
+        uint32_t index;  // the buffer the thread wrote into. A buffer is reused by a new thread once its thread exits
+        uint64_t recorded;  // every event recorded, including the ones the ring buffer no longer holds
+        std::vector<Record> records;
+    };
+
+    /**
+     * The most threads that can record at once. Threads past the limit do not record.
+     */
+    constexpr size_t MAX_THREADS = 64;
+
+    namespace detail {
+        struct Buffer {
+            uint32_t index;
+            uint64_t mask;  // the capacity minus one
+            std::atomic<uint64_t> next{0};  // only written by the owning thread
+            std::atomic<bool> owned{true};
+            std::unique_ptr<Record[]> records;
+        };
+
+        extern std::atomic<bool> active;
+        extern thread_local Buffer* current;
+
+        /**
+         * @return The calling thread's buffer, claiming one on its first event, or nullptr if all are taken
+         */
+        Buffer* claim();
+    }
+
+    /**
+     * Starts recording on every thread.
+     * @param eventsPerThread How many of the most recent events each thread keeps. Rounded up to a power of two. Buffers
+     * claimed before keep their size
+     */
+    void enable(size_t eventsPerThread = 4096);
+
+    /**
+     * Stops recording. The recorded events are kept until clear is called.
+     */
+    void disable();
+
+    [[nodiscard]] inline bool enabled() {
+        return detail::active.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Forgets every recorded event. Must not be called while scripts are running.
+     */
+    void clear();
+
+    /**
+     * Records an event at a position in the source. Does nothing unless tracing is enabled.
+     */
+    inline void record(Event event, int32_t line, int32_t column) {
+        if (!enabled()) {
+            return;
+        }
+
+        detail::Buffer* buffer = detail::current != nullptr ? detail::current : detail::claim();
+
+        if (buffer == nullptr) {
+            return;
+        }
+
+        uint64_t next = buffer->next.load(std::memory_order_relaxed);
+        buffer->records[next & buffer->mask] = Record{event, line, column};
+        buffer->next.store(next + 1, std::memory_order_release);
+    }
+
+    /**
+     * @return The recorded events of every thread, in the format decode reads
+     */
+    std::string save();
+
+    /**
+     * Writes the recorded events to a file.
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void saveFile(const std::string& path);
+
+    /**
+     * Writes the recorded events to a file descriptor, in the format decode reads. Async-signal-safe: it neither
+     * allocates nor locks.
+     * @return false if writing failed
+     */
+    bool dump(int fd);
+
+    /**
+     * Installs a handler that writes the recorded events to a file whenever the process receives the signal, e.g.,
+     * SIGUSR1 to look at a script that seems stuck.
+     * @throws std::runtime_error if the path is too long or the handler cannot be installed
+     */
+    void dumpOnSignal(int signal, const std::string& path);
+
+    /**
+     * Reads a saved trace.
+     * @throws std::runtime_error if the data is not a trace or is truncated
+     */
+    std::vector<Thread> decode(std::string_view data);
+
+    /**
+     * @return The events as text, one line per event
+     */
+    std::string format(const std::vector<Thread>& threads);
+
+    /**
+     * @return The name of the event, e.g., "call"
+     */
+    const char* name(Event event);
+}
+
+#endif  // SPL_TRACE_H
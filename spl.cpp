@@ -1,17 +1,125 @@
 #include <string>
+#include <utility>
 
-#include "interpreter/tokenizer.h"
+#include "spl.h"
+
+#include "interpreter/dce.h"
 #include "interpreter/environment.h"
-#include "interpreter/parser.h"
+#include "interpreter/flat.h"
+#include "interpreter/frontend.h"
+#include "interpreter/extension.h"
+#include "interpreter/io.h"
+#include "interpreter/inference.h"
+#include "interpreter/inlining.h"
+#include "interpreter/memo.h"
+#include "interpreter/trace.h"
 
 
-env::Environment run(const std::string& input) {
-    token::Tokenizer token{input};
+namespace {
+    /**
+     * Attaches limits to an environment for the duration of a run, including when the script throws.
+     */
+    class AttachedLimits {
+    public:
+        AttachedLimits(env::Environment& env, sandbox::Limits* limits) : env(env), limits(limits) {
+            if (limits != nullptr) {
+                env.attachLimits(limits);
+            }
+        }
+
+        ~AttachedLimits() {
+            if (limits != nullptr) {
+                env.attachLimits(nullptr);
+            }
+        }
+
+    private:
+        env::Environment& env;
+        sandbox::Limits* limits;
+    };
+}
+
 
-    Parser parser{token.getTokens()};
+env::Environment run(const std::string& input) {
     env::Environment env;
 
-    parser.root().eval(env);
+    run(input, env);
 
     return env;
 }
+
+void run(const std::string& input, env::Environment& env) {
+    run(input, env, RunOptions{});
+}
+
+void run(const std::string& input, env::Environment& env, const RunOptions& options) {
+    ast::RootNode root = frontend::parse(input, options.parseThreads);
+
+    if (options.eliminateDeadCode) {
+        dce::Report report = dce::eliminate(root);
+
+        if (options.deadCodeReport != nullptr) {
+            *options.deadCodeReport = report;
+        }
+    }
+
+    if (options.inlineFunctions) {
+        inlining::Report report = inlining::inlineFunctions(root, options.inliningHeuristics);
+
+        if (options.inliningReport != nullptr) {
+            *options.inliningReport = report;
+        }
+    }
+
+    if (options.inferTypes) {
+        inference::Report report = inference::specialize(root);
+
+        if (options.inferenceReport != nullptr) {
+            *options.inferenceReport = report;
+        }
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<memo::Cache>> caches;
+    if (options.memoize) {
+        caches = memo::memoize(root, env, options.memoCapacity);
+    }
+
+    {
+        AttachedLimits attached{env, options.limits};
+
+        try {
+            if (options.flatten) {
+                flat::Program{root}.run(env);
+            } else {
+                root.eval(env);
+            }
+        } catch (const std::runtime_error&) {
+            if (!options.traceOnError.empty() && trace::enabled()) {
+                trace::saveFile(options.traceOnError);
+            }
+
+            throw;
+        }
+    }
+
+    if (options.memoStatistics != nullptr) {
+        options.memoStatistics->clear();
+
+        for (const auto& [name, cache] : caches) {
+            (*options.memoStatistics)[name] = cache->statistics();
+        }
+    }
+}
+
+void registerFunction(env::Environment& env, const std::string& name, int arity,
+                      types::NativeFunction::Implementation implementation) {
+    env.set(name, types::NativeFunction{name, arity, std::move(implementation)});
+}
+
+void loadExtension(env::Environment& env, const std::string& path) {
+    extension::load(env, path);
+}
+
+void flushOutput() {
+    io::standardOutput().flush();
+}
@@ -1,8 +1,80 @@
 #ifndef SPL_SPL_H
 #define SPL_SPL_H
 
+#include "interpreter/dce.h"
 #include "interpreter/environment.h"
+#include "interpreter/inference.h"
+#include "interpreter/inlining.h"
+#include "interpreter/memo.h"
+#include "interpreter/sandbox.h"
+
+/**
+ * Options for running a script.
+ */
+struct RunOptions {
+    bool inferTypes = true;  // specialize expressions whose types can be proven (see interpreter/inference.h)
+    inference::Report* inferenceReport = nullptr;  // if set, receives how many operations were specialized
+
+    bool memoize = false;  // cache the results of pure functions (see interpreter/memo.h)
+    size_t memoCapacity = 4096;  // the maximum number of results cached per function
+    std::unordered_map<std::string, memo::Statistics>* memoStatistics = nullptr;  // if set, receives the cache hits and misses of each memoized function
+
+    sandbox::Limits* limits = nullptr;  // if set, the step budget and memory cap the script runs under
+
+    size_t parseThreads = 1;  // threads to tokenize and parse large sources on, 0 for one per hardware thread (see interpreter/frontend.h)
+
+    bool flatten = false;  // evaluate a flat copy of the AST instead of walking the tree (see interpreter/flat.h)
+
+    bool eliminateDeadCode = false;  // remove unreachable statements, unused functions and dead assignments (see interpreter/dce.h)
+    dce::Report* deadCodeReport = nullptr;  // if set, receives how much code was removed
+
+    bool inlineFunctions = false;  // replace calls to small functions with their bodies (see interpreter/inlining.h)
+    inlining::Heuristics inliningHeuristics;  // which functions are small enough to inline
+    inlining::Report* inliningReport = nullptr;  // if set, receives how many functions and calls were inlined
+
+    std::string traceOnError;  // if set and tracing is enabled, where the trace is saved when the script throws (see interpreter/trace.h)
+};
 
 env::Environment run(const std::string& input);
 
+/**
+ * Runs the input in an existing environment. Use this to run scripts against an environment that has native functions
+ * registered, or to run several scripts that share state.
+ * @param input The source code
+ * @param env The environment to run in
+ */
+void run(const std::string& input, env::Environment& env);
+
+/**
+ * Runs the input in an existing environment with the given options.
+ * @param input The source code
+ * @param env The environment to run in
+ * @param options How to run the script
+ */
+void run(const std::string& input, env::Environment& env, const RunOptions& options);
+
+/**
+ * Registers a C++ function that scripts can call like any other function.
+ * @param env The environment to register the function in
+ * @param name The name scripts call the function by
+ * @param arity The number of arguments, or types::NativeFunction::VARIADIC
+ * @param implementation The function. Throw std::runtime_error to report an error to the script
+ */
+void registerFunction(env::Environment& env, const std::string& name, int arity,
+                      types::NativeFunction::Implementation implementation);
+
+/**
+ * Loads an extension module (a shared object implementing the C ABI in spl_extension.h) and registers its functions.
+ * @throws std::runtime_error if the module cannot be loaded
+ * @param env The environment to register the functions in
+ * @param path The path of the shared object
+ */
+void loadExtension(env::Environment& env, const std::string& path);
+
+/**
+ * Writes out everything scripts have printed so far. Printed output is buffered and otherwise only written when the
+ * buffer fills up or the program exits.
+ */
+void flushOutput();
+
 #endif  // SPL_SPL_H
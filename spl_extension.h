@@ -0,0 +1,99 @@
+#ifndef SPL_EXTENSION_H
+#define SPL_EXTENSION_H
+
+/*
+ * The C ABI for SPL extension modules. An extension module is a shared object that exports spl_extension_info (see
+ * SPL_EXTENSION_ENTRY_POINT) returning a table of native functions. This header is plain C so extensions can be built
+ * with any compiler; nothing in it may change without bumping SPL_EXTENSION_ABI_VERSION.
+ *
+ * A minimal extension:
+ *
+ *     static int twice(const spl_value* arguments, size_t count, spl_value* result) {
+ *         if (arguments[0].type != SPL_VALUE_INT) {
+ *             result->type = SPL_VALUE_STRING;
+ *             result->as.string.data = "twice expects an int";
+ *             result->as.string.size = 20;
+ *             return 1;
+ *         }
+ *
+ *         result->type = SPL_VALUE_INT;
+ *         result->as.integer = arguments[0].as.integer * 2;
+ *         return 0;
+ *     }
+ *
+ *     static const spl_function_entry functions[] = {{"twice", 1, twice}};
+ *     static const spl_extension extension = {SPL_EXTENSION_ABI_VERSION, 1, functions};
+ *
+ *     SPL_EXPORT const spl_extension* spl_extension_info(void) {
+ *         return &extension;
+ *     }
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPL_EXTENSION_ABI_VERSION 1u
+#define SPL_EXTENSION_ENTRY_POINT "spl_extension_info"
+
+#if defined(_WIN32)
+#define SPL_EXPORT __declspec(dllexport)
+#else
+#define SPL_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef enum spl_value_type {
+    SPL_VALUE_BOOL = 0,
+    SPL_VALUE_INT = 1,
+    SPL_VALUE_FLOAT = 2,
+    SPL_VALUE_STRING = 3
+} spl_value_type;
+
+/*
+ * A value passed between the interpreter and an extension. Strings are not null-terminated.
+ *
+ * Argument strings are owned by the interpreter and valid for the duration of the call. Result strings are copied by
+ * the interpreter as soon as the function returns, so they only have to outlive the call (e.g., a string literal or a
+ * static/thread-local buffer).
+ */
+typedef struct spl_value {
+    uint32_t type;  /* an spl_value_type */
+    union {
+        int32_t boolean;
+        int32_t integer;
+        float floating;
+        struct {
+            const char* data;
+            size_t size;
+        } string;
+    } as;
+} spl_value;
+
+/*
+ * A native function. Returns 0 on success with the return value stored in result. Any other return value is an error,
+ * in which case result may hold an SPL_VALUE_STRING with the error message.
+ */
+typedef int (*spl_native_fn)(const spl_value* arguments, size_t count, spl_value* result);
+
+typedef struct spl_function_entry {
+    const char* name;
+    int32_t arity;  /* -1 for any number of arguments */
+    spl_native_fn function;
+} spl_function_entry;
+
+typedef struct spl_extension {
+    uint32_t abi_version;  /* must be SPL_EXTENSION_ABI_VERSION */
+    size_t function_count;
+    const spl_function_entry* functions;
+} spl_extension;
+
+typedef const spl_extension* (*spl_extension_info_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SPL_EXTENSION_H */
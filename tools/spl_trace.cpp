@@ -0,0 +1,36 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "../interpreter/trace.h"
+
+/**
+ * Prints a trace saved by the interpreter, e.g., with RunOptions::traceOnError or trace::dumpOnSignal.
+ *
+ * Usage: spl_trace <trace file>
+ */
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace file>" << std::endl;
+        return 2;
+    }
+
+    std::ifstream file{argv[1], std::ios::binary};
+    if (!file) {
+        std::cerr << "Could not open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    try {
+        std::cout << trace::format(trace::decode(contents.str()));
+    } catch (const std::runtime_error& e) {
+        std::cerr << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}